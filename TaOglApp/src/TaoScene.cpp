@@ -2765,14 +2765,22 @@ namespace tao_scene {
             std::string fileName = fullPath.filename().string();
             std::string fullPathStr = fullPath.string();
 
+            // The renderer caches the processed cubes next to the HDRIs
+            if(fullPath.extension()==".dds") continue;
+
             if (stat(fullPathStr.c_str(), &sb) == 0 && !(sb.st_mode & S_IFDIR))
             {
                 auto envKey = renderer.AddEnvironmentTexture(fullPathStr.c_str());
                 _environmentLights.push_back({fileName, envKey});
-                renderer.SetCurrentEnvironment(envKey);
-                _currentEnvironment = _environmentLights.size()-1;
             }
         }
+
+        // Only the current one is processed, the others when selected
+        if(!_environmentLights.empty())
+        {
+            _currentEnvironment = _environmentLights.size()-1;
+            renderer.SetCurrentEnvironment(_environmentLights[_currentEnvironment].second);
+        }
     }
 
     size_t TaoScene::EnvironmentsCount() const {
@@ -2874,17 +2882,34 @@ namespace tao_scene {
                       : vec2{0.0f};
         }
 
-        return Mesh{mPos, mNrm, mTex, mTri};
+        // Tangent frames from the asset, if any (FlipUVs flips the bitangents too)
+        if(hasTex0 && mesh->HasTangentsAndBitangents())
+        {
+            vector<vec3> mTan(mesh->mNumVertices), mBtn(mesh->mNumVertices);
+            for(int i=0;i<mTan.size();i++)
+            {
+                mTan[i] = vec3{mesh->mTangents  [i].x, mesh->mTangents  [i].y, mesh->mTangents  [i].z};
+                mBtn[i] = vec3{mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z};
+            }
+
+            return Mesh{std::move(mPos), std::move(mNrm), std::move(mTex), std::move(mTri), std::move(mTan), std::move(mBtn)};
+        }
+
+        return Mesh{std::move(mPos), std::move(mNrm), std::move(mTex), std::move(mTri)};
     }
 
     void TaoScene::LoadAiScene(PbrRenderer &renderer, const aiScene *scene, const string &rootDirName) {
         // --- Load meshes
         // maps 1:1 to scene.mMeshes
+        // Dense meshes get a lod chain, small ones aren't worth it
+        constexpr unsigned int kLodMinTriangles = 4096;
+        constexpr int          kLodCount        = 4;
+
         vector<GenKey<Mesh>> myMeshes(scene->mNumMeshes);
         for(int i=0; i<scene->mNumMeshes; i++)
         {
-            auto myMesh = LoadAiMesh(renderer, scene->mMeshes[i]);
-            myMeshes[i] = renderer.AddMesh(myMesh);
+            const int lodCount = scene->mMeshes[i]->mNumFaces >= kLodMinTriangles ? kLodCount : 1;
+            myMeshes[i] = renderer.AddMesh(LoadAiMesh(renderer, scene->mMeshes[i]), mesh_residency::cpu_and_gpu, lodCount);
         }
 
         // --- Load Textures
@@ -2956,7 +2981,7 @@ namespace tao_scene {
         if(hasRoughnessTex) { mat->Get(AI_MATKEY_TEXTURE(aiTextureType_DIFFUSE_ROUGHNESS, 0), roughnessTexName);    CreateTextureIfNeeded(renderer, pbrTextures, rootDirName, GetTexName(roughnessTexName, scene), false); }
         if(hasMetalnessTex) { mat->Get(AI_MATKEY_TEXTURE(aiTextureType_METALNESS, 0), metalnessTexName);            CreateTextureIfNeeded(renderer, pbrTextures, rootDirName, GetTexName(metalnessTexName, scene), false); }
         if(hasEmissionTex)  { mat->Get(AI_MATKEY_TEXTURE(aiTextureType_EMISSIVE, 0), emissionTexName);              CreateTextureIfNeeded(renderer, pbrTextures, rootDirName, GetTexName(emissionTexName, scene), true); }
-        if(hasNormalTex)    { mat->Get(AI_MATKEY_TEXTURE(aiTextureType_NORMALS, 0), normalTexName);                 CreateTextureIfNeeded(renderer, pbrTextures, rootDirName, GetTexName(normalTexName, scene), false); }
+        if(hasNormalTex)    { mat->Get(AI_MATKEY_TEXTURE(aiTextureType_NORMALS, 0), normalTexName);                 CreateTextureIfNeeded(renderer, pbrTextures, rootDirName, GetTexName(normalTexName, scene), false, texture_content::normal_map); }
         if(hasOcclusionTex) { mat->Get(AI_MATKEY_TEXTURE(aiTextureType_AMBIENT_OCCLUSION, 0), occlusionTexName);    CreateTextureIfNeeded(renderer, pbrTextures, rootDirName, GetTexName(occlusionTexName, scene), false); }
 
         pbr_material_descriptor descriptor
@@ -2990,10 +3015,10 @@ namespace tao_scene {
     }
 
     void TaoScene::CreateTextureIfNeeded(PbrRenderer &renderer, map<string, GenKey<ImageTexture>> &pbrTextures,
-                                         const string &rootDirName, const string &texName, bool srgb) {
+                                         const string &rootDirName, const string &texName, bool srgb, texture_content content) {
         if(!pbrTextures.contains(texName))
         {
-            ImageTexture i{std::format("{}/{}",rootDirName,texName), srgb};
+            ImageTexture i{std::format("{}/{}",rootDirName,texName), srgb, content};
             auto texKey = renderer.AddImageTexture(i);
             pbrTextures.insert({texName,  texKey});
         }
@@ -3005,6 +3030,7 @@ namespace tao_scene {
         _lightSelectionEnterCallback = [this](auto && PH1) { OnLightSelectionEnter(std::forward<decltype(PH1)>(PH1)); };
         _lightSelectionExitCallback = [this](auto && PH1) { OnLightSelectionExit(std::forward<decltype(PH1)>(PH1)); };
         _tmUpdateCallback = [this](auto && PH1) { OnTmUpdate(std::forward<decltype(PH1)>(PH1)); };
+        _meshPickCallback = [this](float x, float y, int w, int h) { OnMeshPick(x, y, w, h); };
     }
 
     void TaoScene::OnResize(int w, int h) {
@@ -3292,6 +3318,7 @@ namespace tao_scene {
 
         // --- Gizmos interaction
         _gizmoPickAgent= make_unique<GizmoPickAgent>(_gizmosRenderer.get());
+        _gizmoPickAgent->SubscribeToMouseDown(&_meshPickCallback);
         _inputManager->AddInputAgent(_gizmoPickAgent.get());
 
         // --- Transform manipulator gizmo
@@ -3400,6 +3427,24 @@ namespace tao_scene {
         _transformManipulator->Disable();
     }
 
+    std::optional<tao_pbr::GenKey<tao_pbr::MeshRenderer>> TaoScene::PickMeshRenderer(float x, float y) {
+
+        // cursor to NDC, then back to world space
+        vec2 ndc = vec2{x / _fboWidth, y / _fboHeight} * 2.0f - 1.0f;
+        mat4 invViewProj = inverse(_projMatrix * _viewMatrix);
+
+        vec4 pNear = invViewProj * vec4{ndc, -1.0f, 1.0f};
+        vec4 pFar  = invViewProj * vec4{ndc,  1.0f, 1.0f};
+        pNear /= pNear.w;
+        pFar  /= pFar.w;
+
+        return _pbrRenderer->PickMeshRenderer(Ray{vec3{pNear}, vec3{pFar - pNear}});
+    }
+
+    void TaoScene::OnMeshPick(float x, float y, int w, int h) {
+        _pickedMeshRenderer = PickMeshRenderer(x, y);
+    }
+
     void TaoScene::OnTmUpdate(const mat4 & t) {
         MyDirectionalLight* dirLight    = nullptr;
         MySphereLight*      sphereLight = nullptr;
@@ -760,6 +760,10 @@ namespace tao_scene {
         void AddLight(const tao_pbr::SphereLight& light);
         void AddLight(const tao_pbr::RectLight& light);
 
+        // Mesh renderer under the cursor (bottom-left origin, pixels)
+        std::optional<tao_pbr::GenKey<tao_pbr::MeshRenderer>> PickMeshRenderer(float x, float y);
+        std::optional<tao_pbr::GenKey<tao_pbr::MeshRenderer>> GetPickedMeshRenderer() const {return _pickedMeshRenderer; }
+
     private:
         unsigned int _windowWidth  = 0;
         unsigned int _windowHeight = 0;
@@ -791,6 +795,9 @@ namespace tao_scene {
         std::function<void(LightGizmos::anyLightPtr)> _lightSelectionEnterCallback;
         std::function<void(LightGizmos::anyLightPtr)> _lightSelectionExitCallback;
         std::function<void(const glm::mat4&)> _tmUpdateCallback;
+        std::function<void(float, float, int, int)> _meshPickCallback;
+
+        std::optional<tao_pbr::GenKey<tao_pbr::MeshRenderer>> _pickedMeshRenderer = std::nullopt;
 
         template<typename LightType, typename LightGizmoType>
         struct MyLight
@@ -826,7 +833,8 @@ namespace tao_scene {
 
         static void CreateTextureIfNeeded(tao_pbr::PbrRenderer &renderer,
                                           std::map<std::string, tao_pbr::GenKey<tao_pbr::ImageTexture>> &pbrTextures,
-                                          const std::string &rootDirName, const std::string &texName, bool srgb);
+                                          const std::string &rootDirName, const std::string &texName, bool srgb,
+                                          tao_pbr::texture_content content = tao_pbr::texture_content::color);
 
         static std::string GetTexName(const aiString &texName, const aiScene *scene);
 
@@ -850,6 +858,8 @@ namespace tao_scene {
 
         void OnTmUpdate(const glm::mat4&);
 
+        void OnMeshPick(float x, float y, int w, int h);
+
         template<typename LightType, typename LightGizmoType>
         void SelectLight(std::weak_ptr<LightGizmoType> l, std::vector<MyLight<LightType, LightGizmoType>>& v);
 
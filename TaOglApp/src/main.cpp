@@ -105,6 +105,22 @@ void StartImGuiFrame(tao_scene::TaoScene &scene)
     ImGui::Begin("GPU perf");
     ImGui::Text(std::format("GPass(ms)    : {}", scene.GetPbrRenderer().PerfCounters.GPassTime).c_str());
     ImGui::Text(std::format("LightPass(ms): {}", scene.GetPbrRenderer().PerfCounters.LightPassTime).c_str());
+    ImGui::Text(std::format("LightCull(ms): {}", scene.GetPbrRenderer().PerfCounters.LightCullingTime).c_str());
+    ImGui::Text(std::format("Meshlets(ms) : {}", scene.GetPbrRenderer().PerfCounters.MeshletCullingTime).c_str());
+    ImGui::Text(std::format("Visible      : {}", scene.GetPbrRenderer().PerfCounters.VisibleMeshRenderers).c_str());
+    ImGui::Text(std::format("Culled       : {}", scene.GetPbrRenderer().PerfCounters.CulledMeshRenderers).c_str());
+    ImGui::Text(std::format("Triangles    : {}", scene.GetPbrRenderer().PerfCounters.CameraTriangles).c_str());
+    ImGui::Text(std::format("Meshlet draws: {}", scene.GetPbrRenderer().PerfCounters.MeshletJobs).c_str());
+    ImGui::Text(std::format("Culled (shdw): {}", scene.GetPbrRenderer().PerfCounters.CulledShadowCasters).c_str());
+    ImGui::Text(std::format("Shadow maps  : {}", scene.GetPbrRenderer().PerfCounters.ShadowMapUpdates).c_str());
+    ImGui::Text(std::format("Cube faces   : {}", scene.GetPbrRenderer().PerfCounters.CubeShadowFaces).c_str());
+    ImGui::Text(std::format("Shadowed     : {}", scene.GetPbrRenderer().PerfCounters.ShadowedLights).c_str());
+    ImGui::Text(std::format("Textures pend: {}", scene.GetPbrRenderer().PerfCounters.PendingTextures).c_str());
+    ImGui::Text(std::format("Textures drop: {}", scene.GetPbrRenderer().PerfCounters.DroppedTextures).c_str());
+    ImGui::Text(std::format("Upload (KiB) : {}", scene.GetPbrRenderer().PerfCounters.TextureUploadBytes >> 10).c_str());
+    ImGui::Text(std::format("Tex res (MiB): {}", scene.GetPbrRenderer().PerfCounters.TextureResidentBytes >> 20).c_str());
+    auto picked = scene.GetPickedMeshRenderer();
+    ImGui::Text(std::format("Picked mesh  : {}", picked.has_value() ? std::to_string(picked.value().Index) : "none").c_str());
     ImGui::End();
 
 }
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "TaoMath.h"
+#include <vector>
+#include <optional>
+#include <functional>
+
+namespace tao_math
+{
+    // Bounding volume hierarchy over a set of boxes, items are
+    // identified by their index in the arrays passed to Build.
+    // Built top-down using binned SAH. Moving items can be handled
+    // with Refit (the topology doesn't change, a Build now and then
+    // keeps the tree in good shape if things move a lot).
+    class Bvh
+    {
+    public:
+        struct RayHit
+        {
+            int     item;
+            float   t;
+        };
+
+        void Build(const std::vector<glm::vec3>& mins, const std::vector<glm::vec3>& maxs);
+        void Clear();
+
+        // Updates the item's box and the ones of its ancestors
+        void Refit(int item, const glm::vec3& min, const glm::vec3& max);
+
+        bool Empty()     const { return _nodes.empty(); }
+        int  ItemCount() const { return static_cast<int>(_items.size()); }
+
+        BoundingBox<float, 3>::AaBb Bounds() const;
+
+        // Items are appended to `items`, no specific order.
+        // As for FrustumCull only the first `planeCount` planes are used.
+        void QueryFrustum(const Frustum& frustum, std::vector<int>& items, int planeCount = Frustum::PLANE_COUNT) const;
+        void QuerySphere (const glm::vec3& center, float radius, std::vector<int>& items) const;
+
+        // Closest item along the ray. Without `hitTest` the item's
+        // box is the hit, otherwise it is called for the items whose
+        // box is hit and should return the ray parameter, if any
+        // (e.g. from a ray-triangles test).
+        std::optional<RayHit> Raycast(const Ray& ray, const std::function<std::optional<float>(int)>& hitTest = nullptr) const;
+
+    private:
+        struct Node
+        {
+            glm::vec3 min;
+            int       first;    // leaf: first entry in _items, internal: left child (right is first+1)
+            glm::vec3 max;
+            int       count;    // 0 for internal nodes
+        };
+
+        static constexpr int BIN_COUNT     = 12;
+        static constexpr int MAX_LEAF_SIZE = 4;
+
+        std::vector<Node>       _nodes;
+        std::vector<int>        _parents;   // per node, -1 for the root
+        std::vector<int>        _items;     // leaves point to ranges of this
+        std::vector<int>        _itemLeaf;  // per item
+        std::vector<glm::vec3>  _itemMin;
+        std::vector<glm::vec3>  _itemMax;
+
+        void ComputeNodeBounds(int node);
+        void Subdivide(int node, const std::vector<glm::vec3>& centroids, std::vector<int>& stack);
+        void AppendItems(int node, std::vector<int>& items) const;
+    };
+}
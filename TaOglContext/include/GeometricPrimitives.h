@@ -3,6 +3,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "TangentSpace.h"
 
 
 namespace tao_geometry
@@ -28,53 +29,7 @@ namespace tao_geometry
         {
             if (_indices.empty() || _textureCoordinates.empty()) throw std::runtime_error("Cannot compute tangents without triangles and texture coordinates.");
 
-            std::vector<glm::vec3>
-                tangents = std::vector<glm::vec3>(_indices.size()),
-                bitangents = std::vector<glm::vec3>(_indices.size());
-
-            for (int i = 0; i < _indices.size(); i += 3)
-            {
-                int
-                    t1 = _indices.at(i + 0),
-                    t2 = _indices.at(i + 1),
-                    t3 = _indices.at(i + 2);
-
-                glm::vec3
-                    e1 = (_vertices.at(t2) - _vertices.at(t1)),
-                    e2 = (_vertices.at(t3) - _vertices.at(t2));
-
-                glm::vec2
-                    delta1 = (_textureCoordinates.at(t2) - _textureCoordinates.at(t1)),
-                    delta2 = (_textureCoordinates.at(t3) - _textureCoordinates.at(t2));
-
-
-                glm::mat3x2 mE = glm::transpose(glm::mat2x3(e1, e2));
-                glm::mat2 mDelta = glm::transpose(glm::mat2(delta1, delta2));
-                glm::mat2 mDeltaInverse = glm::inverse(mDelta);
-
-                glm::mat3x2 mTB = mDeltaInverse * mE;
-
-                glm::vec3 tangent = glm::transpose(mTB)[0];
-                glm::vec3 bitangent = glm::transpose(mTB)[1];
-
-                // Average vertex tangents and bitangents
-                tangents.at(t1) += tangent;
-                tangents.at(t2) += tangent;
-                tangents.at(t3) += tangent;
-
-                bitangents.at(t1) += bitangent;
-                bitangents.at(t2) += bitangent;
-                bitangents.at(t3) += bitangent;
-            }
-
-            for (auto& v : tangents)
-                v = glm::normalize(v);
-
-            for (auto& v : bitangents)
-                v = glm::normalize(v);
-
-            _tangents = tangents;
-            _bitangents = bitangents;
+            ComputeTangentFrames(_vertices, _normals, _textureCoordinates, _indices, _tangents, _bitangents);
         }
 
     public:
@@ -109,12 +64,21 @@ namespace tao_geometry
             ComputeTangentsAndBitangents();
         }
 
+        // With the given tangents (none are generated), the
+        // bitangents are cross(normal, tangent)
         Mesh(const std::vector<glm::vec3>& verts, const std::vector<glm::vec3>& normals, const std::vector<int>& tris,
             const std::vector<glm::vec2>& textureCoordinates, const std::vector<glm::vec3>& tangents)
-            : Mesh(verts, normals, tris, textureCoordinates)
+            : Mesh(verts, normals, tris)
         {
+            if (textureCoordinates.size() != verts.size() || tangents.size() != verts.size())
+                throw "number of vertices not compatible with number of texture coordinates or tangents";
 
+            _textureCoordinates = textureCoordinates;
             _tangents = tangents;
+
+            _bitangents.resize(tangents.size());
+            for (int i = 0; i < _bitangents.size(); i++)
+                _bitangents[i] = glm::normalize(glm::cross(_normals[i], _tangents[i]));
         }
     public:
         std::vector<glm::vec3> GetPositions()           const { return std::vector<glm::vec3>(_vertices); };
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace tao_geometry
+{
+    struct SimplifiedMesh
+    {
+        std::vector<int> indices;
+        float            error;     // largest collapse error, object space distance (approx.)
+    };
+
+    // Quadric error edge collapse. Vertices are collapsed onto one of their
+    // neighbours (never moved), so the results index the same vertices:
+    // a LOD is just another index list over the same vertex buffer.
+    // Border vertices, and vertices which share their position with others
+    // (uv / normal seams), are never removed.
+    // Collapses go in passes, the cheapest first. One result for each of
+    // the (decreasing) targets, each one carries on from the previous so
+    // the errors are measured against the original mesh. It stops early
+    // when nothing is left to collapse.
+    std::vector<SimplifiedMesh> SimplifyMesh(
+            const std::vector<glm::vec3>& positions,
+            const std::vector<int>&       indices,
+            const std::vector<size_t>&    targetIndexCounts);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace tao_geometry
+{
+    struct Meshlet
+    {
+        unsigned int firstIndex;    // into the (reordered) index list
+        unsigned int indexCount;
+
+        // Bounding sphere
+        glm::vec3    center;
+        float        radius;
+
+        // Normal cone: the meshlet faces away from eye if
+        //     dot(center - eye, coneAxis) >= coneCutoff * length(center - eye) + radius
+        // (sin of the normals' spread, MESHLET_CONE_DISABLED if they spread too much)
+        glm::vec3    coneAxis;
+        float        coneCutoff;
+    };
+
+    // Above 1, the cone test can't pass
+    static constexpr float MESHLET_CONE_DISABLED = 2.0f;
+
+    // Splits the triangles in clusters of at most `maxVertices` vertices and
+    // `maxTriangles` triangles, grown from a seed through the neighbouring
+    // triangles (the ones adding the fewest new vertices first), so they're
+    // compact enough to be culled on their own. `indices` is reordered:
+    // each meshlet's triangles are a contiguous range.
+    std::vector<Meshlet> BuildMeshlets(
+            const std::vector<glm::vec3>& positions,
+            std::vector<int>&             indices,
+            unsigned int                  maxVertices  = 64,
+            unsigned int                  maxTriangles = 124);
+}
@@ -259,6 +259,10 @@ namespace tao_ogl_resources
 		tex_int_for_rgba16ui = GL_RGBA16UI,
 		tex_int_for_rgba32i = GL_RGBA32I,
 		tex_int_for_rgba32ui = GL_RGBA32UI,
+		tex_int_for_compressed_red_rgtc1 = GL_COMPRESSED_RED_RGTC1,
+		tex_int_for_compressed_rg_rgtc2 = GL_COMPRESSED_RG_RGTC2,
+		tex_int_for_compressed_rgba_bptc_unorm = GL_COMPRESSED_RGBA_BPTC_UNORM,
+		tex_int_for_compressed_srgb_alpha_bptc_unorm = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM,
 
 		/// ... some other esoteric formats... ///
 	};
@@ -647,6 +651,15 @@ namespace tao_ogl_resources
 		map_flags_read_write	= GL_READ_WRITE
 	};
 
+	enum ogl_map_range_flags
+	{
+		map_range_flags_read				= GL_MAP_READ_BIT,
+		map_range_flags_write				= GL_MAP_WRITE_BIT,
+		map_range_flags_invalidate_range	= GL_MAP_INVALIDATE_RANGE_BIT,
+		map_range_flags_invalidate_buffer	= GL_MAP_INVALIDATE_BUFFER_BIT,
+		map_range_flags_unsynchronized		= GL_MAP_UNSYNCHRONIZED_BIT
+	};
+
 	enum ogl_sync_condition
 	{
 		sync_condition_gpu_commands_complete = GL_SYNC_GPU_COMMANDS_COMPLETE
@@ -682,6 +695,17 @@ namespace tao_ogl_resources
         vertex_attribute_desc* attrib_descriptors;
     };
 
+    // Layout mandated by the GL specs for
+    // glMultiDrawElementsIndirect commands.
+    struct draw_elements_indirect_command
+    {
+        GLuint  count;
+        GLuint  instance_count;
+        GLuint  first_index;
+        GLint   base_vertex;
+        GLuint  base_instance;
+    };
+
     enum ogl_debug_output_severity
     {
         dbg_out_severity_low        = GL_DEBUG_SEVERITY_LOW,
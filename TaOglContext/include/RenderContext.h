@@ -39,6 +39,9 @@ namespace tao_render_context
 
         int _uniformBufferOffsetAlignment;
         int _shaderStorageBufferOffsetAlignment;
+        bool _bindlessTextures;
+        bool _sparseTextures;
+        bool _vertexShaderLayer;
 
         void InitGlfwCallbacks();
 
@@ -201,6 +204,10 @@ namespace tao_render_context
         void DrawElements         (ogl_primitive_type mode, GLsizei count, ogl_indices_type type, const void* indices);
         void DrawElementsInstanced(ogl_primitive_type mode, GLsizei count, ogl_indices_type type, const void* offset, GLsizei instanceCount);
 
+        // Sources `drawCount` draw_elements_indirect_command(s) from the
+        // OglDrawIndirectBuffer currently bound, starting at byte offset `indirect`.
+        void MultiDrawElementsIndirect(ogl_primitive_type mode, ogl_indices_type type, const void* indirect, GLsizei drawCount, GLsizei stride = 0);
+
         void DispatchCompute      (GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
 
         [[nodiscard]] OglVertexShader   CreateVertexShader();
@@ -229,6 +236,8 @@ namespace tao_render_context
         [[nodiscard]] OglTexture2D              CreateTexture2D();
         [[nodiscard]] OglTextureCube            CreateTextureCube();
         [[nodiscard]] OglTexture2DMultisample   CreateTexture2DMultisample();
+        [[nodiscard]] OglTexture2DArray         CreateTexture2DArray();
+        [[nodiscard]] OglTextureCubeArray       CreateTextureCubeArray();
 
         [[nodiscard]] OglSampler CreateSampler();
         [[nodiscard]] OglSampler CreateSampler(ogl_sampler_params params);
@@ -242,13 +251,24 @@ namespace tao_render_context
 
         [[nodiscard]] OglShaderStorageBuffer CreateShaderStorageBuffer();
 
+        [[nodiscard]] OglDrawIndirectBuffer CreateDrawIndirectBuffer();
+
     	[[nodiscard]] OglPixelPackBuffer CreatePixelPackBuffer();
 
         [[nodiscard]] OglFence CreateFence();
 
+        // `partitions` frames in flight (see PersistentRingBuffer)
+        [[nodiscard]] PersistentRingBuffer CreatePersistentRingBuffer(GLsizeiptr partitionSize, int partitions = 3);
+
         [[nodiscard]] OglQuery CreateQuery();
 
         int UniformBufferOffsetAlignment() const {return _uniformBufferOffsetAlignment;};
+        bool BindlessTexturesSupported()   const {return _bindlessTextures;};
+        bool SparseTexturesSupported()     const {return _sparseTextures;};
+        // 2D sparse storage of that format and size: the format has a page size
+        // (some have none), the size is a multiple of it and within the limit.
+        bool SparseTextureSupported(tao_ogl_resources::ogl_texture_internal_format format, int width, int height) const;
+        bool VertexShaderLayerSupported()  const {return _vertexShaderLayer;};
     };
 }
 
@@ -7,6 +7,8 @@
 #include <glm\glm.hpp>
 #include <stdexcept>
 #include <functional>
+#include <bit>
+#include <algorithm>
 namespace tao_render_context
 {
     class RenderContext;
@@ -126,14 +128,12 @@ namespace tao_render_context
             return *this;
         }
 
-        [[nodiscard]] std::vector<unsigned char> InterleavedBuffer(unsigned int alignment  = 1) const
+        // Size of one interleaved element (rounded up to `alignment`)
+        [[nodiscard]] unsigned int InterleavedStride(unsigned int alignment = 1) const
         {
-            // early exit if empty
-            if (_dataArrays.empty()) return std::vector<unsigned char>{};
-
             // check all the arrays to be
             // the same length
-            const unsigned int elementCount = _dataArrays[0].elementsCount;
+            const unsigned int elementCount = _dataArrays.empty() ? 0 : _dataArrays[0].elementsCount;
             unsigned int cumulatedElementSize = 0;
             for (const auto &d: _dataArrays) {
                 if (d.elementsCount != elementCount)
@@ -148,20 +148,43 @@ namespace tao_render_context
                 cumulatedElementSize = (cumulatedElementSize/alignment)*alignment + ((cumulatedElementSize % alignment) ? alignment : 0);
             }
 
-            std::vector<unsigned char> interleaved(elementCount * cumulatedElementSize);
+            return cumulatedElementSize;
+        }
+
+        [[nodiscard]] std::size_t InterleavedSize(unsigned int alignment = 1) const
+        {
+            if (_dataArrays.empty()) return 0;
+
+            return static_cast<std::size_t>(_dataArrays[0].elementsCount) * InterleavedStride(alignment);
+        }
+
+        // Writes InterleavedSize(alignment) bytes to `dst`
+        // (e.g. straight into a mapped buffer, no staging copy)
+        void InterleaveInto(unsigned char* dst, unsigned int alignment = 1) const
+        {
+            if (_dataArrays.empty()) return;
+
+            const unsigned int elementCount         = _dataArrays[0].elementsCount;
+            const unsigned int cumulatedElementSize = InterleavedStride(alignment);
 
             for (int i = 0; i < elementCount; i++)
             {
                 unsigned int accum = 0;
                 for (int j = 0; j < _dataArrays.size(); j++)
                 {
-                    memcpy(interleaved.data() + (cumulatedElementSize * i + accum),
-                           _dataArrays[j].dataPtr + (i * _dataArrays[j].elementSize),
+                    memcpy(dst + (static_cast<std::size_t>(cumulatedElementSize) * i + accum),
+                           _dataArrays[j].dataPtr + (static_cast<std::size_t>(i) * _dataArrays[j].elementSize),
                            _dataArrays[j].elementSize
                            );
                     accum += _dataArrays[j].elementSize;
                 }
             }
+        }
+
+        [[nodiscard]] std::vector<unsigned char> InterleavedBuffer(unsigned int alignment  = 1) const
+        {
+            std::vector<unsigned char> interleaved(InterleavedSize(alignment));
+            InterleaveInto(interleaved.data(), alignment);
 
             return interleaved;
         }
@@ -231,6 +254,13 @@ namespace tao_render_context
 
     unsigned int ResizeBufferPolicy(unsigned int currVertCapacity, unsigned int newVertCount);
 
+    // LSD radix sort (8 bits digits) of `keys`, `values` follow along.
+    // The sort is stable, digits shared by all the keys are skipped.
+    // `tmpKeys` and `tmpValues` are scratch space (kept by the caller
+    // to avoid allocating every time).
+    void RadixSort(std::vector<unsigned long long>& keys, std::vector<int>& values,
+                   std::vector<unsigned long long>& tmpKeys, std::vector<int>& tmpValues);
+
     // Resizable VBO
     /////////////////////////////////
     tao_ogl_resources::OglVertexBuffer CreateEmptyVbo(RenderContext& rc, tao_ogl_resources::ogl_buffer_usage usg);
@@ -252,6 +282,140 @@ namespace tao_render_context
 
     typedef ResizableOglBuffer<tao_ogl_resources::OglShaderStorageBuffer, CreateEmptySsbo, ResizeSsbo> ResizableSsbo;
 
+    // CPU-GPU synced SSBO
+    /////////////////////////////////
+    // CPU copy of a GPU array of `GpuT` (std430, tightly packed), each
+    // element converted from a `T`. Set() only marks the element dirty,
+    // Flush() uploads the dirty elements, consecutive ones in a single
+    // call. If the GPU buffer has to grow, everything is uploaded.
+    template<typename T, typename GpuT>
+    class SyncedBuffer
+    {
+    public:
+        typedef std::function<GpuT(const T&)> converter;
+
+        SyncedBuffer(RenderContext& rc, tao_ogl_resources::ogl_buffer_usage usage, converter toGpu) :
+                _toGpu{std::move(toGpu)},
+                _data{},
+                _dirty{},
+                _anyDirty{false},
+                _gpuBuffer{rc, 0, usage, ResizeBufferPolicy}
+        {
+        }
+
+        std::size_t Size()                          const { return _data.size(); }
+        const GpuT& operator[](std::size_t index)   const { return _data[index]; }
+
+        // Only valid after Flush()
+        tao_ogl_resources::OglShaderStorageBuffer& OglBuffer() { return _gpuBuffer.OglBuffer(); }
+
+        // Grows if `index` is past the end
+        void Set(std::size_t index, const T& value)
+        {
+            if(index >= _data.size()) Resize(index + 1);
+
+            _data[index] = _toGpu(value);
+            MarkDirty(index);
+        }
+
+        void Assign(const std::vector<T>& values)
+        {
+            Resize(values.size());
+
+            for(std::size_t i = 0; i < values.size(); i++)
+            {
+                _data[i] = _toGpu(values[i]);
+                MarkDirty(i);
+            }
+        }
+
+        void Resize(std::size_t count)
+        {
+            _data.resize(count);
+            _dirty.resize((count + 63) / 64, 0ull);
+
+            // no dirty bits past the end
+            if(count % 64) _dirty.back() &= (1ull << (count % 64)) - 1;
+        }
+
+        // Returns the number of uploads
+        int Flush()
+        {
+            if(!_anyDirty) return 0;
+            _anyDirty = false;
+
+            if(_gpuBuffer.Resize(_data.size() * sizeof(GpuT)))
+            {
+                // New storage, the old content is gone
+                std::fill(_dirty.begin(), _dirty.end(), 0ull);
+                Upload(0, _data.size());
+                return 1;
+            }
+
+            int         uploads  = 0;
+            std::size_t runStart = NO_RUN;
+
+            for(std::size_t w = 0; w < _dirty.size(); w++)
+            {
+                const unsigned long long bits = _dirty[w];
+                _dirty[w] = 0ull;
+
+                // Clean and all dirty words are skipped at once
+                int b = 0;
+                while(b < 64)
+                {
+                    const unsigned long long rest = bits >> b;
+
+                    if(runStart == NO_RUN)
+                    {
+                        if(!rest) break;
+
+                        b += std::countr_zero(rest);
+                        runStart = w * 64 + b;
+                    }
+                    else
+                    {
+                        b += std::countr_one(rest);
+                        if(b < 64)
+                        {
+                            Upload(runStart, w * 64 + b);
+                            runStart = NO_RUN;
+                            uploads++;
+                        }
+                    }
+                }
+            }
+
+            if(runStart != NO_RUN)
+            {
+                Upload(runStart, _data.size());
+                uploads++;
+            }
+
+            return uploads;
+        }
+
+    private:
+        static constexpr std::size_t NO_RUN = ~std::size_t{0};
+
+        converter                       _toGpu;
+        std::vector<GpuT>               _data;
+        std::vector<unsigned long long> _dirty;    // one bit for each element
+        bool                            _anyDirty;
+        ResizableSsbo                   _gpuBuffer;
+
+        void MarkDirty(std::size_t index)
+        {
+            _dirty[index / 64] |= 1ull << (index % 64);
+            _anyDirty = true;
+        }
+
+        void Upload(std::size_t first, std::size_t last)
+        {
+            _gpuBuffer.OglBuffer().SetSubData(first * sizeof(GpuT), (last - first) * sizeof(GpuT), _data.data() + first);
+        }
+    };
+
     // Resizable UBO
     /////////////////////////////////
     tao_ogl_resources::OglUniformBuffer  CreateEmptyUbo(RenderContext& rc, tao_ogl_resources::ogl_buffer_usage usg);
@@ -259,5 +423,12 @@ namespace tao_render_context
 
     typedef ResizableOglBuffer<tao_ogl_resources::OglUniformBuffer, CreateEmptyUbo, ResizeUbo> ResizableUbo;
 
+    // Resizable Draw Indirect Buffer
+    /////////////////////////////////
+    tao_ogl_resources::OglDrawIndirectBuffer  CreateEmptyDibo(RenderContext& rc, tao_ogl_resources::ogl_buffer_usage usg);
+    void	ResizeDibo(tao_ogl_resources::OglDrawIndirectBuffer& buff, unsigned int newCapacity, tao_ogl_resources::ogl_buffer_usage usg);
+
+    typedef ResizableOglBuffer<tao_ogl_resources::OglDrawIndirectBuffer, CreateEmptyDibo, ResizeDibo> ResizableDibo;
+
 
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <concepts>
 #include <string>
 #include <type_traits>
+#include <vector>
+#include <optional>
 
 #include "OglUtils.h"
 
@@ -78,6 +80,12 @@ namespace tao_ogl_resources
 		static void Destroy(GLuint);
 		static constexpr const char* to_string = "shader storage buffer";
 	};
+	struct draw_indirect_buffer
+	{
+		static GLuint Create();
+		static void Destroy(GLuint);
+		static constexpr const char* to_string = "draw indirect buffer";
+	};
 	struct pixel_pack_buffer
 	{
 		static GLuint Create();
@@ -108,12 +116,24 @@ namespace tao_ogl_resources
 		static void Destroy(GLuint);
 		static constexpr const char* to_string = "texture 2D multisample";
 	};
+	struct texture_2D_array
+	{
+		static GLuint Create();
+		static void Destroy(GLuint);
+		static constexpr const char* to_string = "texture 2D array";
+	};
 	struct texture_cube
 	{
 		static GLuint Create();
 		static void Destroy(GLuint);
 		static constexpr const char* to_string = "texture cube";
 	};
+	struct texture_cube_array
+	{
+		static GLuint Create();
+		static void Destroy(GLuint);
+		static constexpr const char* to_string = "texture cube array";
+	};
 	struct framebuffer
 	{
 		static GLuint Create();
@@ -145,12 +165,15 @@ namespace tao_ogl_resources
 		std::is_same_v<T, index_buffer>				||
 		std::is_same_v<T, uniform_buffer>			||
 		std::is_same_v<T, shader_storage_buffer>	||
+		std::is_same_v<T, draw_indirect_buffer>		||
 		std::is_same_v<T, pixel_pack_buffer>		||
 		std::is_same_v<T, pixel_unpack_buffer>		||
 		std::is_same_v<T, texture_1D>				||
 		std::is_same_v<T, texture_2D>				||
 		std::is_same_v<T, texture_2D_multisample>	||
+		std::is_same_v<T, texture_2D_array>			||
 		std::is_same_v<T, texture_cube>				||
+		std::is_same_v<T, texture_cube_array>		||
 		std::is_same_v<T, framebuffer>				||
 		std::is_same_v<T, sampler>                  ||
         std::is_same_v<T, query>;
@@ -169,6 +192,7 @@ namespace tao_ogl_resources
 		std::is_same_v<T, uniform_buffer>		||
 		std::is_same_v<T, pixel_pack_buffer>	||
 		std::is_same_v<T, pixel_unpack_buffer>	||
+		std::is_same_v<T, draw_indirect_buffer>	||
 		std::is_same_v<T, shader_storage_buffer>;
 
 	template<typename T>
@@ -176,7 +200,9 @@ namespace tao_ogl_resources
 		std::is_same_v<T, texture_1D>			||
 		std::is_same_v<T, texture_2D>			||
 		std::is_same_v<T, texture_cube>			||
-		std::is_same_v<T, texture_2D_multisample>;
+		std::is_same_v<T, texture_cube_array>	||
+		std::is_same_v<T, texture_2D_multisample>	||
+		std::is_same_v<T, texture_2D_array>;
 
 	template <typename T> requires ogl_resource<T>
 	class OglResource
@@ -359,6 +385,11 @@ namespace tao_ogl_resources
 		static void UnBind();
 		void SetData(GLsizeiptr size, const void* data, ogl_buffer_usage usage);
 		void SetSubData(GLintptr offset, GLsizeiptr size, const void* data);
+		void CopySubData(const OglVertexBuffer& src, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size);
+		// `access` is a combination of ogl_map_range_flags,
+		// UnmapBuffer returns false if the content got lost.
+		void* MapBufferRange(GLintptr offset, GLsizeiptr length, GLbitfield access);
+		bool  UnmapBuffer();
 
     private:
         OglResource<ogl_resource_type> _ogl_obj;
@@ -378,6 +409,13 @@ namespace tao_ogl_resources
 		static void UnBind();
 		void SetData(GLsizeiptr size, const void* data, ogl_buffer_usage usage);
 		void SetSubData(GLintptr offset, GLsizeiptr size, const void* data);
+		void CopySubData(const OglIndexBuffer& src, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size);
+		// `access` is a combination of ogl_map_range_flags,
+		// UnmapBuffer returns false if the content got lost.
+		void* MapBufferRange(GLintptr offset, GLsizeiptr length, GLbitfield access);
+		bool  UnmapBuffer();
+		// Also as a shader storage buffer (compute reads/writes)
+		void BindStorage(GLuint index);
 
     private:
         OglResource<ogl_resource_type> _ogl_obj;
@@ -398,6 +436,7 @@ namespace tao_ogl_resources
 		void EnableVertexAttrib(GLuint index);
 		void DisableVertexAttrib(GLuint index);
 		void SetVertexAttribPointer(OglVertexBuffer& vertexBuffer, GLuint index, GLint size, ogl_vertex_attrib_type type, GLboolean normalized, GLsizei stride, const void* pointer, GLuint divisor=0);
+		void SetVertexAttribIPointer(OglVertexBuffer& vertexBuffer, GLuint index, GLint size, ogl_vertex_attrib_type type, GLsizei stride, const void* pointer, GLuint divisor=0);
 		void SetIndexBuffer(OglIndexBuffer& indexBuffer);
 
     private:
@@ -437,12 +476,36 @@ namespace tao_ogl_resources
         void BindRange(GLuint index, GLintptr offset, GLsizeiptr size);
         void SetData(GLsizeiptr size, const void* data, ogl_buffer_usage usage);
         void SetSubData(GLintptr offset, GLsizeiptr size, const void* data);
+        // Stalls until the GPU is done writing it (fence it first)
+        void GetSubData(GLintptr offset, GLsizeiptr size, void* data) const;
+        // Fills the buffer with the value pointed by `data`
+        void ClearData(ogl_texture_internal_format internalFormat, ogl_texture_format format, ogl_texture_data_type type, const void* data);
 
     private:
 		OglResource<ogl_resource_type> _ogl_obj;
 		OglShaderStorageBuffer(OglResource<ogl_resource_type>&& shader) :_ogl_obj(std::move(shader)) {}
 	};
 
+	/// Draw Indirect Buffer
+	//////////////////////////////////////
+	class OglDrawIndirectBuffer
+	{
+		friend class tao_render_context::RenderContext;
+
+	public:
+        typedef draw_indirect_buffer ogl_resource_type;
+        void Bind();
+        static void UnBind();
+        void SetData(GLsizeiptr size, const void* data, ogl_buffer_usage usage);
+        void SetSubData(GLintptr offset, GLsizeiptr size, const void* data);
+        // Also as a shader storage buffer (commands written by compute)
+        void BindStorage(GLuint index);
+
+    private:
+		OglResource<ogl_resource_type> _ogl_obj;
+		OglDrawIndirectBuffer(OglResource<ogl_resource_type>&& shader) :_ogl_obj(std::move(shader)) {}
+	};
+
 	/// PBO (pack)
 	//////////////////////////////////////
 	class OglPixelPackBuffer
@@ -505,6 +568,31 @@ namespace tao_ogl_resources
         OglTexture1D(OglResource<ogl_resource_type>&& shader) :_ogl_obj(std::move(shader)) {}
 	};
 
+	/// Bindless Textures
+	//////////////////////////////////////
+	// ARB_bindless_texture is not part of the glad loader, the
+	// RenderContext loads its entry points if the driver has it.
+	bool LoadBindlessTextureExt(GLADloadproc load);
+	bool BindlessTextureExtLoaded();
+
+	/// Sparse Textures
+	//////////////////////////////////////
+	// ARB_sparse_texture, same as above. Sparse storage is virtual,
+	// memory is committed (and released) a region at a time.
+	bool LoadSparseTextureExt(GLADloadproc load);
+	bool SparseTextureExtLoaded();
+
+#ifndef GL_ARB_sparse_texture
+#define GL_TEXTURE_SPARSE_ARB           0x91A6
+#define GL_NUM_SPARSE_LEVELS_ARB        0x91AA
+#define GL_NUM_VIRTUAL_PAGE_SIZES_ARB   0x91A8
+#define GL_VIRTUAL_PAGE_SIZE_X_ARB      0x9195
+#define GL_VIRTUAL_PAGE_SIZE_Y_ARB      0x9196
+#define GL_MAX_SPARSE_TEXTURE_SIZE_ARB  0x9198
+#endif
+
+	class OglSampler;
+
 	/// Texture2D
 	//////////////////////////////////////
 	class OglTexture2D
@@ -522,7 +610,22 @@ namespace tao_ogl_resources
         void BindToImageUnit  (GLuint unit, GLint level, ogl_image_access access, ogl_image_format format);
         static void UnBindToImageUnit(GLuint unit);
 		void TexImage(GLint level, ogl_texture_internal_format internalFormat, GLsizei width, GLsizei height, ogl_texture_format format, ogl_texture_data_type type, const void* data);
+		// Immutable storage, `internalFormat` must be a sized format
+		void TexStorage(GLsizei levels, ogl_texture_internal_format internalFormat, GLsizei width, GLsizei height);
+		// `data` is an offset in the bound pixel unpack buffer, if any
+		void TexSubImage(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, ogl_texture_format format, ogl_texture_data_type type, const void* data);
+		// Whole blocks (x, y, width and height multiples of 4 but at the level's edge),
+		// `internalFormat` matching the storage's. `data` as in TexSubImage.
+		void CompressedTexSubImage(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, ogl_texture_internal_format internalFormat, GLsizei imageSize, const void* data);
 		void GenerateMipmap();
+
+		// ARB_sparse_texture: SetSparse before TexStorage. Levels from
+		// NumSparseLevels() on are the mip tail, committed as a whole.
+		// Regions are whole pages or reach the level's edge.
+		void SetSparse(bool sparse);
+		GLint NumSparseLevels();
+		void PageCommitment(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, bool commit);
+
 		void SetDepthStencilMode(ogl_texture_depth_stencil_tex_mode mode);
 		void SetCompareParams(ogl_tex_compare_params params);
 		void SetFilterParams(ogl_tex_filter_params params);
@@ -530,6 +633,18 @@ namespace tao_ogl_resources
 		void SetWrapParams(ogl_tex_wrap_params params);
 		void SetParams(ogl_tex_params params);
 
+		// Copies `level` from `src` (no conversion, formats must be compatible)
+		void CopySubData(const OglTexture2D& src, GLint level, GLsizei width, GLsizei height);
+		void CopySubData(const OglTexture2D& src, GLint level, GLint srcX, GLint srcY, GLint dstX, GLint dstY, GLsizei width, GLsizei height);
+		// Fills a region of `level` with the value pointed by `data`
+		void ClearSubImage(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, ogl_texture_format format, ogl_texture_data_type type, const void* data);
+
+		// Bindless handle (ARB_bindless_texture). Once a handle
+		// is created the texture and sampler state can't change.
+		GLuint64 GetSamplerHandle(const OglSampler& sampler);
+		static void MakeHandleResident(GLuint64 handle);
+		static void MakeHandleNonResident(GLuint64 handle);
+
     private:
         OglResource<ogl_resource_type> _ogl_obj;
         OglTexture2D(OglResource<ogl_resource_type>&& shader) :_ogl_obj(std::move(shader)) {}
@@ -559,6 +674,38 @@ namespace tao_ogl_resources
         OglTexture2DMultisample(OglResource<ogl_resource_type>&& shader) :_ogl_obj(std::move(shader)) {}
 	};
 
+	/// Texture2D Array
+	//////////////////////////////////////
+	class OglTexture2DArray
+	{
+		template<typename Tex> requires ogl_texture<typename Tex::ogl_resource_type>
+		friend class OglFramebuffer;
+		friend class tao_render_context::RenderContext;
+
+	public:
+        typedef texture_2D_array ogl_resource_type;
+        void Bind();
+		static void UnBind();
+		void BindToTextureUnit(ogl_texture_unit unit);
+		static void UnBindToTextureUnit(ogl_texture_unit unit);
+		// Immutable storage, `internalFormat` must be a sized format
+		void TexStorage(GLsizei levels, ogl_texture_internal_format internalFormat, GLsizei width, GLsizei height, GLsizei layers);
+		void TexSubImage(GLint level, GLint layer, GLsizei width, GLsizei height, ogl_texture_format format, ogl_texture_data_type type, const void* data);
+		void TexSubImage(GLint level, GLint x, GLint y, GLint layer, GLsizei width, GLsizei height, ogl_texture_format format, ogl_texture_data_type type, const void* data);
+		void CompressedTexSubImage(GLint level, GLint x, GLint y, GLint layer, GLsizei width, GLsizei height, ogl_texture_internal_format internalFormat, GLsizei imageSize, const void* data);
+		// Copies `layers` layers of `level` from `src` (no conversion, formats must be compatible)
+		void CopySubData(const OglTexture2DArray& src, GLint level, GLint srcLayer, GLint dstLayer, GLsizei width, GLsizei height, GLsizei layers);
+		void GenerateMipmap();
+		void SetFilterParams(ogl_tex_filter_params params);
+		void SetLodParams(ogl_tex_lod_params params);
+		void SetWrapParams(ogl_tex_wrap_params params);
+		void SetParams(ogl_tex_params params);
+
+    private:
+        OglResource<ogl_resource_type> _ogl_obj;
+        OglTexture2DArray(OglResource<ogl_resource_type>&& shader) :_ogl_obj(std::move(shader)) {}
+	};
+
 	/// Texture Cube
 	//////////////////////////////////////
 	class OglTextureCube
@@ -576,6 +723,10 @@ namespace tao_ogl_resources
         void BindToImageUnit  (GLuint unit, GLint level, GLboolean  layered, GLint layer, ogl_image_access access, ogl_image_format format);
         static void UnBindToImageUnit(GLuint unit);
 		void TexImage(ogl_texture_cube_target target, GLint level, ogl_texture_internal_format internalFormat, GLsizei width, GLsizei height, GLint border, ogl_texture_format format, ogl_texture_data_type type, const void* data);
+		// Copies `level` of all the faces from `src` (no conversion, formats must be compatible)
+		void CopySubData(const OglTextureCube& src, GLint level, GLsizei width, GLsizei height);
+		// Reads back `level` of all the faces (+x, -x, +y, -y, +z, -z), `bufSize` bytes at most
+		void GetTexImage(GLint level, ogl_texture_format format, ogl_texture_data_type type, GLsizei bufSize, void* data) const;
 		void GenerateMipmap();
 		void SetDepthStencilMode(ogl_texture_depth_stencil_tex_mode mode);
 		void SetCompareParams(ogl_tex_compare_params params);
@@ -588,6 +739,38 @@ namespace tao_ogl_resources
         OglResource<ogl_resource_type> _ogl_obj;
         OglTextureCube(OglResource<ogl_resource_type>&& shader) :_ogl_obj(std::move(shader)) {}
 
+    };
+
+	/// Texture Cube Array
+	//////////////////////////////////////
+	// Layer-faces (layer * 6 + face) are the z of the
+	// texture, e.g. when attached as a layered target.
+	class OglTextureCubeArray
+	{
+		template<typename Tex> requires ogl_texture<typename Tex::ogl_resource_type>
+		friend class OglFramebuffer;
+		friend class tao_render_context::RenderContext;
+
+    public:
+        typedef texture_cube_array ogl_resource_type;
+        void Bind();
+		static void UnBind();
+		void BindToTextureUnit(ogl_texture_unit unit);
+		static void UnBindToTextureUnit(ogl_texture_unit unit);
+		// Immutable storage, `internalFormat` must be a sized format
+		void TexStorage(GLsizei levels, ogl_texture_internal_format internalFormat, GLsizei size, GLsizei cubes);
+		// Copies a region of `cubes` cubes (all the faces) of `level` from `src` (no conversion, formats must be compatible)
+		void CopySubData(const OglTextureCubeArray& src, GLint level, GLint srcCube, GLint dstCube, GLint x, GLint y, GLsizei width, GLsizei height, GLsizei cubes);
+		// Fills a region of `cubes` cubes (all the faces) of `level` with the value pointed by `data`
+		void ClearSubImage(GLint level, GLint cube, GLint x, GLint y, GLsizei width, GLsizei height, GLsizei cubes, ogl_texture_format format, ogl_texture_data_type type, const void* data);
+		void SetFilterParams(ogl_tex_filter_params params);
+		void SetLodParams(ogl_tex_lod_params params);
+		void SetWrapParams(ogl_tex_wrap_params params);
+		void SetParams(ogl_tex_params params);
+
+    private:
+        OglResource<ogl_resource_type> _ogl_obj;
+        OglTextureCubeArray(OglResource<ogl_resource_type>&& shader) :_ogl_obj(std::move(shader)) {}
     };
 
 	/// Sampler
@@ -595,6 +778,7 @@ namespace tao_ogl_resources
 	class OglSampler
 	{
 		friend class tao_render_context::RenderContext;
+		friend class OglTexture2D;
 
 	public:
         typedef sampler ogl_resource_type;
@@ -623,6 +807,8 @@ namespace tao_ogl_resources
         void Bind(ogl_framebuffer_binding target);
 		static void UnBind(ogl_framebuffer_binding target);
 		void AttachTexture(ogl_framebuffer_attachment attachment, const Tex& texture, GLint level);
+		// A single layer of an array (or cube) texture
+		void AttachTextureLayer(ogl_framebuffer_attachment attachment, const Tex& texture, GLint level, GLint layer);
 		void SetDrawBuffers(GLsizei n, const ogl_framebuffer_read_draw_buffs* buffs);
 		void SetReadBuffer(ogl_framebuffer_read_draw_buffs buff);
 
@@ -657,6 +843,7 @@ namespace tao_ogl_resources
 	{
 		// RenderContext is the one in charge of calling the private constructor
 		friend class tao_render_context::RenderContext; 
+		friend class PersistentRingBuffer;
 
 	public:
 		OglFence(const OglFence&) = delete;
@@ -711,4 +898,57 @@ namespace tao_ogl_resources
         OglResource<ogl_resource_type> _ogl_obj;
         OglQuery(OglResource<ogl_resource_type>&& shader) :_ogl_obj(std::move(shader)) {}
     };
+
+    /// Persistent Ring Buffer
+    //////////////////////////////////////
+    // Per-frame dynamic data (uniform blocks and small storage arrays,
+    // texture uploads through the pixel unpack binding).
+    // The storage is split in partitions, each frame sub-allocates from
+    // the next one with a bump pointer and writes through the persistent
+    // coherent mapping. EndFrame() fences the partition, BeginFrame()
+    // waits for it before writing there again.
+    class PersistentRingBuffer
+    {
+        friend class tao_render_context::RenderContext;
+
+    public:
+        typedef uniform_buffer ogl_resource_type;
+
+        struct allocation
+        {
+            GLintptr   offset;  // in the buffer
+            GLsizeiptr size;
+            void*      data;    // mapped
+        };
+
+        void BeginFrame();
+        void EndFrame();
+
+        // Aligned for both uniform and shader storage bindings,
+        // throws if the frame's partition is full.
+        [[nodiscard]] allocation Allocate(GLsizeiptr size);
+        allocation Write(const void* data, GLsizeiptr size);
+
+        void BindUniformRange(GLuint index, const allocation& alloc);
+        void BindStorageRange(GLuint index, const allocation& alloc);
+        // Texture uploads take allocation offsets as their data pointer
+        // (unbind with OglPixelUnpackBuffer::UnBind)
+        void BindPixelUnpack();
+
+        GLsizeiptr PartitionSize() const { return _partitionSize; }
+        GLsizeiptr Alignment()     const { return _alignment; }
+        // Left in this frame's partition (for an aligned allocation)
+        GLsizeiptr Available()     const;
+
+    private:
+        OglResource<ogl_resource_type>          _ogl_obj;
+        std::vector<std::optional<OglFence>>    _fences;    // one for each partition
+        unsigned char*                          _mapped;
+        GLsizeiptr                              _partitionSize;
+        GLsizeiptr                              _alignment;
+        int                                     _partition = 0;
+        GLsizeiptr                              _head = 0;  // in the current partition
+
+        PersistentRingBuffer(OglResource<ogl_resource_type>&& buffer, GLsizeiptr partitionSize, int partitions, GLsizeiptr alignment);
+    };
 }
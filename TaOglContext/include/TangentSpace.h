@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace tao_geometry
+{
+    // Per-vertex tangent frames for normal mapping, with the MikkTSpace
+    // conventions: each triangle corner adds its face tangent, projected
+    // onto the vertex normal's plane and weighted by the corner angle;
+    // the bitangent is sign * cross(normal, tangent). Vertices are not
+    // split, the index buffer is used as it is.
+    // Vertices are processed in parallel chunks, each gathers its own
+    // corners (no shared accumulation, the result doesn't depend on
+    // the thread count).
+    void ComputeTangentFrames(
+            const std::vector<glm::vec3>& positions,
+            const std::vector<glm::vec3>& normals,
+            const std::vector<glm::vec2>& textureCoordinates,
+            const std::vector<int>&       indices,
+            std::vector<glm::vec3>&       tangents,
+            std::vector<glm::vec3>&       bitangents,
+            unsigned int                  threadCount = 0);    // 0: hardware concurrency
+}
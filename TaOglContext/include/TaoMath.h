@@ -92,8 +92,51 @@ namespace tao_math
     std::optional<glm::vec3> RayPlaneIntersection(const Ray& r, const Plane& pl,                                                    float tol=TAO_MATH_DEFAULT_TOL);
     std::optional<glm::vec3> RayTriangleIntersection(const Ray& r, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,   float tol=TAO_MATH_DEFAULT_TOL);
     void RaySphereIntersection(const Ray& r, const glm::vec3& center,float radius, std::optional<glm::vec3>& intersection0, std::optional<glm::vec3>& intersection1, float tol = TAO_MATH_DEFAULT_TOL);
+    // Distance to the box's entry point (0 if the origin is inside)
+    std::optional<float>     RayAabbIntersection(const Ray& r, const glm::vec3& min, const glm::vec3& max);
 
 
+    // Frustum ----------
+    // --------------------
+    class Frustum
+    {
+    public:
+        // Planes order, the near plane goes last so that it
+        // can be left out (e.g. for shadow casters culling).
+        enum FrustumPlane
+        {
+            PLANE_LEFT = 0, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_FAR, PLANE_NEAR,
+            PLANE_COUNT
+        };
+
+        // From the (projection * view) matrix, planes are extracted
+        // as described by Gribb and Hartmann. Normals point inwards.
+        explicit Frustum(const glm::mat4& viewProjection);
+
+        const glm::vec4& PlaneEquation(int plane) const {return _planes[plane];}
+
+    private:
+        glm::vec4 _planes[PLANE_COUNT];
+    };
+
+    // Axis aligned boxes as a structure of arrays (center, half extents),
+    // the culling loop runs over contiguous floats and vectorizes well.
+    struct AabbSoA
+    {
+        std::vector<float> cx, cy, cz;
+        std::vector<float> ex, ey, ez;
+
+        void Clear();
+        void Reserve(size_t count);
+        void PushBack(const glm::vec3& min, const glm::vec3& max);
+        size_t Size() const {return cx.size();}
+    };
+
+    // Writes 1 to `visible[i]` if the i-th box intersects the frustum, 0 otherwise.
+    // Conservative: boxes close to the frustum corners may be reported as visible.
+    // Only the first `planeCount` planes are tested. Returns the visible count.
+    int FrustumCull(const Frustum& frustum, const AabbSoA& boxes, std::vector<unsigned char>& visible, int planeCount = Frustum::PLANE_COUNT);
+
     // Closest point ------
     // --------------------
     // TODO: use Ray class
@@ -190,6 +233,23 @@ namespace tao_math
             return AaBb(min, max);
         }
 
+        // Box of the transformed box, without the points (Arvo)
+        static AaBb TransformBbox(const AaBb& box, const glm::mat<N+1,N+1,T>& transformation)
+        {
+            vec_type min{ transformation[N] }, max{ transformation[N] };
+
+            for (int c = 0; c < N; c++)
+                for (int r = 0; r < N; r++)
+                {
+                    const value_type a = transformation[c][r] * box.Min[c];
+                    const value_type b = transformation[c][r] * box.Max[c];
+                    min[r] += glm::min(a, b);
+                    max[r] += glm::max(a, b);
+                }
+
+            return AaBb(min, max);
+        }
+
         void Update(const std::vector<vec_type> &points)
         {
             vec_type nMin{ _min }, nMax{ _max };
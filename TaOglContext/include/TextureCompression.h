@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+namespace tao_texture
+{
+    // 4x4 texel blocks: BC4 one channel (8 bytes), BC5 two channels
+    // (two BC4 blocks), BC7 rgba (16 bytes, mode 6 only: a single
+    // endpoint pair, 4 bit indices).
+    enum class block_format
+    {
+        bc4,
+        bc5,
+        bc7
+    };
+
+    constexpr int BlockBytes(block_format format) { return format == block_format::bc4 ? 8 : 16; }
+
+    // How the mip levels are averaged
+    enum class mip_filter
+    {
+        linear,
+        srgb,       // in linear space (rgb, alpha is linear anyway)
+        normal_map  // tangent space xy(z) in [0, 1], renormalized
+    };
+
+    // Levels down to 1x1, tightly packed `channels` bytes texels
+    struct MipChain
+    {
+        int                                     width;      // level 0
+        int                                     height;
+        int                                     channels;
+        std::vector<std::vector<unsigned char>> levels;
+    };
+
+    int MipCount(int width, int height);
+
+    // Box filtered: each texel averages the footprint it covers in the
+    // level above (odd sizes included). Level 0 is a copy of `pixels`.
+    MipChain GenerateMips(const unsigned char* pixels, int width, int height, int channels, mip_filter filter);
+
+    // Rows of blocks, the blocks across the right/bottom edge repeat
+    // the edge texels. `channels` in [1, 4]: BC4 takes the first one,
+    // BC5 the first two, BC7 rgb (opaque) or rgba.
+    std::vector<unsigned char> CompressImage(const unsigned char* pixels, int width, int height, int channels, block_format format);
+}
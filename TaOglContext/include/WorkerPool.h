@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+namespace tao_concurrency
+{
+    // Long lived threads running the submitted jobs, first in first out.
+    // Jobs must not throw (they're run as they are) and must not touch
+    // OpenGL, results go back to the owner through its own (locked) state.
+    // The destructor drops the jobs not started yet and waits for the
+    // running ones: declare the pool after what its jobs use.
+    class WorkerPool
+    {
+    public:
+        explicit WorkerPool(unsigned int threadCount = 0);     // 0: hardware concurrency - 1 (at least 1)
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&)            = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        void Submit(std::function<void()> job);
+
+        unsigned int ThreadCount() const { return static_cast<unsigned int>(_threads.size()); }
+
+    private:
+        std::vector<std::thread>            _threads;
+        std::deque<std::function<void()>>   _jobs;
+        std::mutex                          _mutex;
+        std::condition_variable             _wake;
+        bool                                _stopping = false;
+
+        void Run();
+    };
+}
@@ -0,0 +1,428 @@
+#include "Bvh.h"
+
+#include <numeric>
+#include <stdexcept>
+
+using namespace glm;
+
+namespace tao_math
+{
+    static float SurfaceArea(const vec3& min, const vec3& max)
+    {
+        const vec3 e = max-min;
+        return 2.0f*(e.x*e.y + e.y*e.z + e.z*e.x);
+    }
+
+    // Slab test, returns the entry distance (can be < 0
+    // if the origin is inside the box) or nullopt.
+    static std::optional<float> RayBoxIntersection(const vec3& origin, const vec3& invDir, const vec3& min, const vec3& max, float tMax)
+    {
+        const vec3 t0 = (min-origin)*invDir;
+        const vec3 t1 = (max-origin)*invDir;
+
+        const vec3 tNear = glm::min(t0, t1);
+        const vec3 tFar  = glm::max(t0, t1);
+
+        const float tEnter = glm::max(glm::max(tNear.x, tNear.y), tNear.z);
+        const float tExit  = glm::min(glm::min(tFar.x, tFar.y), tFar.z);
+
+        if(tEnter>tExit || tExit<0.0f || tEnter>tMax) return std::nullopt;
+
+        return tEnter;
+    }
+
+    void Bvh::Clear()
+    {
+        _nodes   .clear();
+        _parents .clear();
+        _items   .clear();
+        _itemLeaf.clear();
+        _itemMin .clear();
+        _itemMax .clear();
+    }
+
+    void Bvh::Build(const std::vector<vec3>& mins, const std::vector<vec3>& maxs)
+    {
+        if(mins.size()!=maxs.size()) throw std::runtime_error("Bvh: `mins` and `maxs` size mismatch.");
+
+        Clear();
+
+        const int count = static_cast<int>(mins.size());
+        if(count==0) return;
+
+        _itemMin = mins;
+        _itemMax = maxs;
+
+        _items.resize(count);
+        std::iota(_items.begin(), _items.end(), 0);
+
+        std::vector<vec3> centroids(count);
+        for(int i=0;i<count;i++) centroids[i] = (mins[i]+maxs[i])*0.5f;
+
+        // At most 2n-1 nodes
+        _nodes  .reserve(2*count);
+        _parents.reserve(2*count);
+
+        _nodes  .push_back(Node{.first = 0, .count = count});
+        _parents.push_back(-1);
+        ComputeNodeBounds(0);
+
+        // No recursion, degenerate inputs may go deep
+        std::vector<int> stack{0};
+        while(!stack.empty())
+        {
+            const int node = stack.back(); stack.pop_back();
+            Subdivide(node, centroids, stack);
+        }
+
+        _itemLeaf.resize(count);
+        for(int n=0;n<_nodes.size();n++)
+        {
+            if(_nodes[n].count==0) continue;
+
+            for(int i=0;i<_nodes[n].count;i++)
+                _itemLeaf[_items[_nodes[n].first+i]] = n;
+        }
+    }
+
+    void Bvh::ComputeNodeBounds(int node)
+    {
+        Node& n = _nodes[node];
+
+        vec3 min{std::numeric_limits<float>::max()};
+        vec3 max{-std::numeric_limits<float>::max()};
+
+        if(n.count>0)
+        {
+            for(int i=0;i<n.count;i++)
+            {
+                const int item = _items[n.first+i];
+                min = glm::min(min, _itemMin[item]);
+                max = glm::max(max, _itemMax[item]);
+            }
+        }
+        else
+        {
+            const Node& l = _nodes[n.first];
+            const Node& r = _nodes[n.first+1];
+            min = glm::min(l.min, r.min);
+            max = glm::max(l.max, r.max);
+        }
+
+        n.min = min;
+        n.max = max;
+    }
+
+    void Bvh::Subdivide(int node, const std::vector<vec3>& centroids, std::vector<int>& stack)
+    {
+        const int first = _nodes[node].first;
+        const int count = _nodes[node].count;
+
+        if(count<=MAX_LEAF_SIZE) return;
+
+        // Bins are laid out on the centroids' bounds
+        vec3 cMin{std::numeric_limits<float>::max()};
+        vec3 cMax{-std::numeric_limits<float>::max()};
+        for(int i=0;i<count;i++)
+        {
+            cMin = glm::min(cMin, centroids[_items[first+i]]);
+            cMax = glm::max(cMax, centroids[_items[first+i]]);
+        }
+
+        struct Bin
+        {
+            vec3 min{std::numeric_limits<float>::max()};
+            vec3 max{-std::numeric_limits<float>::max()};
+            int  count = 0;
+        };
+
+        float bestCost  = std::numeric_limits<float>::max();
+        int   bestAxis  = -1;
+        int   bestSplit = -1;
+
+        for(int axis=0; axis<3; axis++)
+        {
+            const float extent = cMax[axis]-cMin[axis];
+            if(extent<=0.0f) continue;
+
+            const float scale = BIN_COUNT/extent;
+
+            Bin bins[BIN_COUNT];
+            for(int i=0;i<count;i++)
+            {
+                const int item = _items[first+i];
+                const int b    = glm::min(BIN_COUNT-1, static_cast<int>((centroids[item][axis]-cMin[axis])*scale));
+
+                bins[b].min = glm::min(bins[b].min, _itemMin[item]);
+                bins[b].max = glm::max(bins[b].max, _itemMax[item]);
+                bins[b].count++;
+            }
+
+            // Sweep from the left and from the right,
+            // split `s` means bins [0, s) go to the left.
+            float leftArea[BIN_COUNT], rightArea[BIN_COUNT];
+            int   leftCount[BIN_COUNT], rightCount[BIN_COUNT];
+
+            Bin l{}, r{};
+            for(int s=1; s<BIN_COUNT; s++)
+            {
+                const Bin& bl = bins[s-1];
+                l.min = glm::min(l.min, bl.min); l.max = glm::max(l.max, bl.max); l.count+=bl.count;
+                leftArea [s] = l.count ? SurfaceArea(l.min, l.max) : 0.0f;
+                leftCount[s] = l.count;
+
+                const Bin& br = bins[BIN_COUNT-s];
+                r.min = glm::min(r.min, br.min); r.max = glm::max(r.max, br.max); r.count+=br.count;
+                rightArea [BIN_COUNT-s] = r.count ? SurfaceArea(r.min, r.max) : 0.0f;
+                rightCount[BIN_COUNT-s] = r.count;
+            }
+
+            for(int s=1; s<BIN_COUNT; s++)
+            {
+                if(leftCount[s]==0 || rightCount[s]==0) continue;
+
+                const float cost = leftCount[s]*leftArea[s] + rightCount[s]*rightArea[s];
+                if(cost<bestCost)
+                {
+                    bestCost  = cost;
+                    bestAxis  = axis;
+                    bestSplit = s;
+                }
+            }
+        }
+
+        // All the centroids in the same spot
+        if(bestAxis<0) return;
+
+        // Not worth splitting
+        const float leafCost = count*SurfaceArea(_nodes[node].min, _nodes[node].max);
+        if(bestCost>=leafCost) return;
+
+        const float scale = BIN_COUNT/(cMax[bestAxis]-cMin[bestAxis]);
+        const auto mid = std::partition(_items.begin()+first, _items.begin()+first+count, [&](int item)
+        {
+            const int b = glm::min(BIN_COUNT-1, static_cast<int>((centroids[item][bestAxis]-cMin[bestAxis])*scale));
+            return b<bestSplit;
+        });
+
+        const int leftCount = static_cast<int>(mid-(_items.begin()+first));
+        if(leftCount==0 || leftCount==count) return;
+
+        const int left = static_cast<int>(_nodes.size());
+
+        _nodes  .push_back(Node{.first = first,            .count = leftCount});
+        _nodes  .push_back(Node{.first = first+leftCount,  .count = count-leftCount});
+        _parents.push_back(node);
+        _parents.push_back(node);
+
+        ComputeNodeBounds(left);
+        ComputeNodeBounds(left+1);
+
+        _nodes[node].first = left;
+        _nodes[node].count = 0;
+
+        stack.push_back(left);
+        stack.push_back(left+1);
+    }
+
+    void Bvh::Refit(int item, const vec3& min, const vec3& max)
+    {
+        if(item<0 || item>=_itemLeaf.size()) throw std::runtime_error("Bvh: invalid item.");
+
+        _itemMin[item] = min;
+        _itemMax[item] = max;
+
+        // Walk up, stop as soon as a node doesn't change
+        for(int node = _itemLeaf[item]; node!=-1; node = _parents[node])
+        {
+            const vec3 oldMin = _nodes[node].min;
+            const vec3 oldMax = _nodes[node].max;
+
+            ComputeNodeBounds(node);
+
+            if(oldMin==_nodes[node].min && oldMax==_nodes[node].max) break;
+        }
+    }
+
+    BoundingBox<float, 3>::AaBb Bvh::Bounds() const
+    {
+        if(_nodes.empty()) return {};
+
+        return {_nodes[0].min, _nodes[0].max};
+    }
+
+    void Bvh::AppendItems(int node, std::vector<int>& items) const
+    {
+        // Leaves of a subtree are not necessarily contiguous in
+        // _items, walk the subtree down to them.
+        std::vector<int> stack{node};
+        while(!stack.empty())
+        {
+            const Node& n = _nodes[stack.back()]; stack.pop_back();
+
+            if(n.count>0)
+                items.insert(items.end(), _items.begin()+n.first, _items.begin()+n.first+n.count);
+            else
+            {
+                stack.push_back(n.first);
+                stack.push_back(n.first+1);
+            }
+        }
+    }
+
+    void Bvh::QueryFrustum(const Frustum& frustum, std::vector<int>& items, int planeCount) const
+    {
+        if(_nodes.empty()) return;
+
+        // -1: outside, 0: intersecting, 1: inside
+        auto classify = [&frustum](int plane, const vec3& min, const vec3& max)
+        {
+            const vec4  pl   = frustum.PlaneEquation(plane);
+            const vec3  c    = (min+max)*0.5f;
+            const vec3  e    = (max-min)*0.5f;
+            const float dist = dot(vec3{pl}, c) + pl.w;
+            const float rad  = dot(abs(vec3{pl}), e);
+
+            return dist+rad<0.0f ? -1 : (dist-rad>=0.0f ? 1 : 0);
+        };
+
+        // Planes the box is already inside of are dropped
+        // from the mask, children don't need to test them.
+        struct Entry { int node; unsigned mask; };
+        std::vector<Entry> stack{{0, (1u<<planeCount)-1u}};
+
+        while(!stack.empty())
+        {
+            auto [node, mask] = stack.back(); stack.pop_back();
+            const Node& n = _nodes[node];
+
+            bool outside = false;
+            for(int p=0; p<planeCount && !outside; p++)
+            {
+                if(!(mask & (1u<<p))) continue;
+
+                const int res = classify(p, n.min, n.max);
+                if(res<0)  outside = true;
+                if(res>0)  mask &= ~(1u<<p);
+            }
+
+            if(outside) continue;
+
+            if(mask==0)
+            {
+                AppendItems(node, items);
+                continue;
+            }
+
+            if(n.count>0)
+            {
+                for(int i=0;i<n.count;i++)
+                {
+                    const int item = _items[n.first+i];
+
+                    bool itemOutside = false;
+                    for(int p=0; p<planeCount && !itemOutside; p++)
+                        if(mask & (1u<<p)) itemOutside = classify(p, _itemMin[item], _itemMax[item])<0;
+
+                    if(!itemOutside) items.push_back(item);
+                }
+            }
+            else
+            {
+                stack.push_back({n.first  , mask});
+                stack.push_back({n.first+1, mask});
+            }
+        }
+    }
+
+    void Bvh::QuerySphere(const vec3& center, float radius, std::vector<int>& items) const
+    {
+        if(_nodes.empty()) return;
+
+        const float rSq = radius*radius;
+        auto overlaps = [&center, rSq](const vec3& min, const vec3& max)
+        {
+            const vec3 d = center-glm::clamp(center, min, max);
+            return dot(d, d)<=rSq;
+        };
+
+        std::vector<int> stack{0};
+        while(!stack.empty())
+        {
+            const Node& n = _nodes[stack.back()]; stack.pop_back();
+
+            if(!overlaps(n.min, n.max)) continue;
+
+            if(n.count>0)
+            {
+                for(int i=0;i<n.count;i++)
+                {
+                    const int item = _items[n.first+i];
+                    if(overlaps(_itemMin[item], _itemMax[item])) items.push_back(item);
+                }
+            }
+            else
+            {
+                stack.push_back(n.first);
+                stack.push_back(n.first+1);
+            }
+        }
+    }
+
+    std::optional<Bvh::RayHit> Bvh::Raycast(const Ray& ray, const std::function<std::optional<float>(int)>& hitTest) const
+    {
+        if(_nodes.empty()) return std::nullopt;
+
+        const vec3 origin = ray.Origin();
+        const vec3 invDir = 1.0f/ray.Direction();
+
+        std::optional<RayHit> closest = std::nullopt;
+        float tMax = std::numeric_limits<float>::max();
+
+        std::vector<int> stack{0};
+        while(!stack.empty())
+        {
+            const Node& n = _nodes[stack.back()]; stack.pop_back();
+
+            if(!RayBoxIntersection(origin, invDir, n.min, n.max, tMax)) continue;
+
+            if(n.count>0)
+            {
+                for(int i=0;i<n.count;i++)
+                {
+                    const int item = _items[n.first+i];
+
+                    auto tBox = RayBoxIntersection(origin, invDir, _itemMin[item], _itemMax[item], tMax);
+                    if(!tBox) continue;
+
+                    auto t = hitTest ? hitTest(item) : std::make_optional(glm::max(0.0f, tBox.value()));
+                    if(t && t.value()>=0.0f && t.value()<tMax)
+                    {
+                        tMax    = t.value();
+                        closest = RayHit{.item = item, .t = tMax};
+                    }
+                }
+            }
+            else
+            {
+                // Visit the closer child first so that tMax
+                // shrinks early and prunes the other one.
+                const Node& l = _nodes[n.first];
+                const Node& r = _nodes[n.first+1];
+                auto tl = RayBoxIntersection(origin, invDir, l.min, l.max, tMax);
+                auto tr = RayBoxIntersection(origin, invDir, r.min, r.max, tMax);
+
+                if(tl && tr)
+                {
+                    const bool leftFirst = tl.value()<=tr.value();
+                    stack.push_back(leftFirst ? n.first+1 : n.first);
+                    stack.push_back(leftFirst ? n.first   : n.first+1);
+                }
+                else if(tl) stack.push_back(n.first);
+                else if(tr) stack.push_back(n.first+1);
+            }
+        }
+
+        return closest;
+    }
+}
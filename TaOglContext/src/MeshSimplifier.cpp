@@ -0,0 +1,262 @@
+#include "MeshSimplifier.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <bit>
+
+using namespace glm;
+
+namespace tao_geometry
+{
+    // Symmetric 4x4 error quadric (Garland-Heckbert), the sum of
+    // the area weighted squared distances to a set of planes.
+    struct Quadric
+    {
+        double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+        double b0  = 0, b1  = 0, b2  = 0;
+        double c   = 0;
+        double w   = 0;     // total weight (area)
+
+        static Quadric Plane(const dvec3& n, double d, double w)
+        {
+            return Quadric
+            {
+                .a00 = w*n.x*n.x, .a01 = w*n.x*n.y, .a02 = w*n.x*n.z,
+                .a11 = w*n.y*n.y, .a12 = w*n.y*n.z, .a22 = w*n.z*n.z,
+                .b0  = w*n.x*d,   .b1  = w*n.y*d,   .b2  = w*n.z*d,
+                .c   = w*d*d,
+                .w   = w
+            };
+        }
+
+        Quadric& operator+=(const Quadric& q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+            b0  += q.b0;  b1  += q.b1;  b2  += q.b2;
+            c   += q.c;
+            w   += q.w;
+            return *this;
+        }
+
+        // Mean squared distance of p
+        double Error(const dvec3& p) const
+        {
+            const double e =
+                    a00*p.x*p.x + a11*p.y*p.y + a22*p.z*p.z +
+                    2.0*(a01*p.x*p.y + a02*p.x*p.z + a12*p.y*p.z) +
+                    2.0*(b0*p.x + b1*p.y + b2*p.z) +
+                    c;
+
+            return glm::max(e, 0.0) / glm::max(w, 1e-30);
+        }
+    };
+
+    struct Collapse
+    {
+        float cost;
+        int   from;
+        int   to;
+    };
+
+    // Vertices which can't be removed: the ones sharing their position
+    // with others (seams) and the ones on a border (or non manifold) edge.
+    static std::vector<char> LockedVertices(const std::vector<vec3>& positions, const std::vector<int>& indices)
+    {
+        struct PositionHash
+        {
+            size_t operator()(const vec3& p) const
+            {
+                return std::hash<unsigned long long>{}(
+                        (static_cast<unsigned long long>(std::bit_cast<unsigned int>(p.x)) * 73856093ull) ^
+                        (static_cast<unsigned long long>(std::bit_cast<unsigned int>(p.y)) * 19349663ull) ^
+                        (static_cast<unsigned long long>(std::bit_cast<unsigned int>(p.z)) * 83492791ull));
+            }
+        };
+
+        std::vector<int> positionId(positions.size());
+        std::vector<int> positionUses;
+        {
+            std::unordered_map<vec3, int, PositionHash> ids;
+            ids.reserve(positions.size());
+
+            for (int v = 0; v < positions.size(); v++)
+            {
+                auto [it, inserted] = ids.try_emplace(positions[v], static_cast<int>(positionUses.size()));
+                if (inserted) positionUses.push_back(0);
+
+                positionId[v] = it->second;
+                positionUses[it->second]++;
+            }
+        }
+
+        // Triangles for each edge (between positions, not vertices)
+        std::unordered_map<unsigned long long, int> edgeUses;
+        edgeUses.reserve(indices.size());
+        for (int i = 0; i < indices.size(); i += 3)
+            for (int e = 0; e < 3; e++)
+            {
+                const unsigned int a = positionId[indices[i + e]];
+                const unsigned int b = positionId[indices[i + (e + 1) % 3]];
+                edgeUses[(static_cast<unsigned long long>(glm::min(a, b)) << 32) | glm::max(a, b)]++;
+            }
+
+        std::vector<char> lockedPosition(positionUses.size(), 0);
+        for (int p = 0; p < positionUses.size(); p++) lockedPosition[p] = positionUses[p] > 1;
+        for (const auto& [edge, uses] : edgeUses)
+            if (uses != 2)
+            {
+                lockedPosition[edge >> 32]         = 1;
+                lockedPosition[edge & 0xFFFFFFFFu] = 1;
+            }
+
+        std::vector<char> locked(positions.size());
+        for (int v = 0; v < positions.size(); v++) locked[v] = lockedPosition[positionId[v]];
+
+        return locked;
+    }
+
+    std::vector<SimplifiedMesh> SimplifyMesh(
+            const std::vector<vec3>&   positions,
+            const std::vector<int>&    indices,
+            const std::vector<size_t>& targetIndexCounts)
+    {
+        const int vertexCount = static_cast<int>(positions.size());
+
+        const std::vector<char> locked = LockedVertices(positions, indices);
+
+        std::vector<Quadric> quadrics(vertexCount);
+        for (int i = 0; i < indices.size(); i += 3)
+        {
+            const dvec3 p0{positions[indices[i]]}, p1{positions[indices[i + 1]]}, p2{positions[indices[i + 2]]};
+
+            dvec3 n = cross(p1 - p0, p2 - p0);
+            const double area2 = length(n);
+            if (area2 <= 0.0) continue;
+
+            n /= area2;
+            const Quadric q = Quadric::Plane(n, -dot(n, p0), 0.5 * area2);
+            for (int k = 0; k < 3; k++) quadrics[indices[i + k]] += q;
+        }
+
+        std::vector<SimplifiedMesh> results;
+        std::vector<int> current = indices;
+        float maxError = 0.0f;
+
+        // Per pass
+        std::vector<int>      triangleStart(vertexCount + 1);
+        std::vector<int>      vertexTriangles;
+        std::vector<Collapse> collapses;
+        std::vector<char>     touched(vertexCount);
+        std::vector<int>      remap(vertexCount);
+
+        for (size_t target : targetIndexCounts)
+        {
+            while (current.size() > target)
+            {
+                const int triangleCount = static_cast<int>(current.size() / 3);
+
+                // Triangles of each vertex (CSR)
+                std::fill(triangleStart.begin(), triangleStart.end(), 0);
+                for (int v : current) triangleStart[v + 1]++;
+                for (int v = 0; v < vertexCount; v++) triangleStart[v + 1] += triangleStart[v];
+                vertexTriangles.resize(current.size());
+                {
+                    std::vector<int> fill(triangleStart.begin(), triangleStart.end() - 1);
+                    for (int i = 0; i < current.size(); i++) vertexTriangles[fill[current[i]]++] = i / 3;
+                }
+
+                // Every edge once, both ways, the cheapest first
+                collapses.clear();
+                for (int i = 0; i < current.size(); i += 3)
+                    for (int e = 0; e < 3; e++)
+                    {
+                        const int a = current[i + e];
+                        const int b = current[i + (e + 1) % 3];
+                        if (a > b) continue;    // the other triangle has it (border ones are locked)
+
+                        for (auto [from, to] : {std::pair{a, b}, std::pair{b, a}})
+                        {
+                            if (locked[from]) continue;
+
+                            Quadric q = quadrics[from];
+                            q += quadrics[to];
+                            collapses.push_back({static_cast<float>(q.Error(dvec3{positions[to]})), from, to});
+                        }
+                    }
+
+                std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r){ return l.cost < r.cost; });
+
+                // Each interior collapse removes two triangles. A vertex takes
+                // part in one collapse per pass, the neighbours of a removed
+                // vertex are left alone too (their triangles just changed).
+                std::fill(touched.begin(), touched.end(), 0);
+                for (int v = 0; v < vertexCount; v++) remap[v] = v;
+
+                const int toRemove = static_cast<int>((current.size() - target) / 3);
+                int removed = 0;
+
+                for (const Collapse& c : collapses)
+                {
+                    if (removed >= toRemove) break;
+                    if (touched[c.from] || touched[c.to]) continue;
+
+                    // Would any triangle around `from` flip (or fold)?
+                    bool flips = false;
+                    for (int k = triangleStart[c.from]; k < triangleStart[c.from + 1] && !flips; k++)
+                    {
+                        const int* t = &current[vertexTriangles[k] * 3];
+                        if (t[0] == c.to || t[1] == c.to || t[2] == c.to) continue;
+
+                        vec3 p[3], q[3];
+                        for (int j = 0; j < 3; j++)
+                        {
+                            p[j] = positions[t[j]];
+                            q[j] = positions[t[j] == c.from ? c.to : t[j]];
+                        }
+
+                        const vec3 nOld = cross(p[1] - p[0], p[2] - p[0]);
+                        const vec3 nNew = cross(q[1] - q[0], q[2] - q[0]);
+                        // Turning past ~75 degrees, slivers included
+                        flips = dot(nOld, nNew) <= 0.25f * sqrt(dot(nOld, nOld) * dot(nNew, nNew));
+                    }
+                    if (flips) continue;
+
+                    remap[c.from] = c.to;
+                    quadrics[c.to] += quadrics[c.from];
+                    maxError = glm::max(maxError, glm::sqrt(c.cost));
+
+                    for (int k = triangleStart[c.from]; k < triangleStart[c.from + 1]; k++)
+                    {
+                        const int* t = &current[vertexTriangles[k] * 3];
+                        touched[t[0]] = touched[t[1]] = touched[t[2]] = 1;
+
+                        if (t[0] == c.to || t[1] == c.to || t[2] == c.to) removed++;
+                    }
+                }
+
+                if (removed == 0) break;
+
+                // Remapped, without the degenerate triangles
+                int write = 0;
+                for (int i = 0; i < triangleCount * 3; i += 3)
+                {
+                    const int a = remap[current[i]], b = remap[current[i + 1]], c = remap[current[i + 2]];
+                    if (a == b || b == c || c == a) continue;
+
+                    current[write++] = a;
+                    current[write++] = b;
+                    current[write++] = c;
+                }
+                current.resize(write);
+            }
+
+            // Nothing gained over the previous one
+            const size_t previous = results.empty() ? indices.size() : results.back().indices.size();
+            if (current.size() >= previous) break;
+
+            results.push_back(SimplifiedMesh{.indices = current, .error = maxError});
+        }
+
+        return results;
+    }
+}
@@ -0,0 +1,177 @@
+#include "MeshletBuilder.h"
+
+#include <stdexcept>
+#include <limits>
+
+using namespace glm;
+
+namespace tao_geometry
+{
+    // Spreads wider than this (min dot with the axis) are never back facing
+    static constexpr float MIN_CONE_DOT = 0.1f;
+
+    static void ComputeBounds(const std::vector<vec3>& positions, const std::vector<int>& indices, Meshlet& meshlet)
+    {
+        const unsigned int first = meshlet.firstIndex;
+        const unsigned int last  = meshlet.firstIndex + meshlet.indexCount;
+
+        // Sphere around the box
+        vec3 min{std::numeric_limits<float>::max()}, max{-std::numeric_limits<float>::max()};
+        for (unsigned int i = first; i < last; i++)
+        {
+            min = glm::min(min, positions[indices[i]]);
+            max = glm::max(max, positions[indices[i]]);
+        }
+
+        meshlet.center = 0.5f * (min + max);
+        meshlet.radius = 0.0f;
+        for (unsigned int i = first; i < last; i++)
+            meshlet.radius = glm::max(meshlet.radius, distance(meshlet.center, positions[indices[i]]));
+
+        // Cone around the (area weighted) average normal
+        vec3 sum{0.0f};
+        for (unsigned int i = first; i < last; i += 3)
+        {
+            const vec3& p0 = positions[indices[i]];
+            sum += cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+        }
+
+        meshlet.coneAxis   = vec3{0.0f, 0.0f, 1.0f};
+        meshlet.coneCutoff = MESHLET_CONE_DISABLED;
+
+        const float sumLength = length(sum);
+        if (!(sumLength > 0.0f)) return;
+
+        const vec3 axis = sum / sumLength;
+
+        float minDot = 1.0f;
+        for (unsigned int i = first; i < last; i += 3)
+        {
+            const vec3& p0 = positions[indices[i]];
+            const vec3  n  = cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+            const float l  = length(n);
+
+            if (l > 0.0f) minDot = glm::min(minDot, dot(n, axis) / l);
+        }
+
+        meshlet.coneAxis = axis;
+        if (minDot > MIN_CONE_DOT) meshlet.coneCutoff = sqrt(1.0f - minDot * minDot);
+    }
+
+    std::vector<Meshlet> BuildMeshlets(
+            const std::vector<vec3>& positions,
+            std::vector<int>&        indices,
+            unsigned int             maxVertices,
+            unsigned int             maxTriangles)
+    {
+        if (indices.size() % 3 != 0)
+            throw std::runtime_error("Invalid input: indices must be a list of triangles");
+
+        if (maxVertices < 3 || maxTriangles < 1)
+            throw std::runtime_error("Invalid input: a meshlet must fit at least one triangle");
+
+        const int vertexCount   = static_cast<int>(positions.size());
+        const int triangleCount = static_cast<int>(indices.size() / 3);
+
+        for (int i : indices)
+            if (i < 0 || i >= vertexCount)
+                throw std::runtime_error("Invalid input: indices reference out of bounds");
+
+        // Triangles of each vertex (CSR)
+        std::vector<int> triangleStart(vertexCount + 1, 0);
+        std::vector<int> vertexTriangles(indices.size());
+
+        for (int i : indices) triangleStart[i + 1]++;
+        for (int v = 0; v < vertexCount; v++) triangleStart[v + 1] += triangleStart[v];
+        {
+            std::vector<int> fill(triangleStart.begin(), triangleStart.end() - 1);
+            for (int i = 0; i < indices.size(); i++) vertexTriangles[fill[indices[i]]++] = i / 3;
+        }
+
+        // Stamps: the last meshlet a vertex (triangle) was added to (a candidate of)
+        std::vector<char> emitted       (triangleCount, 0);
+        std::vector<int>  vertexStamp   (vertexCount  , -1);
+        std::vector<int>  candidateStamp(triangleCount, -1);
+        std::vector<int>  candidates;
+
+        std::vector<int>     reordered;
+        std::vector<Meshlet> meshlets;
+        reordered.reserve(indices.size());
+
+        int seed = 0;
+        while (true)
+        {
+            while (seed < triangleCount && emitted[seed]) seed++;
+            if (seed == triangleCount) break;
+
+            const int    m            = static_cast<int>(meshlets.size());
+            unsigned int vertexUses   = 0;
+            unsigned int triangleUses = 0;
+
+            Meshlet meshlet{.firstIndex = static_cast<unsigned int>(reordered.size())};
+            candidates.clear();
+
+            for (int next = seed; next >= 0;)
+            {
+                emitted[next] = 1;
+                triangleUses++;
+
+                for (int k = 0; k < 3; k++)
+                {
+                    const int v = indices[next * 3 + k];
+                    reordered.push_back(v);
+
+                    if (vertexStamp[v] == m) continue;
+
+                    vertexStamp[v] = m;
+                    vertexUses++;
+
+                    for (int t = triangleStart[v]; t < triangleStart[v + 1]; t++)
+                    {
+                        const int tri = vertexTriangles[t];
+                        if (emitted[tri] || candidateStamp[tri] == m) continue;
+
+                        candidateStamp[tri] = m;
+                        candidates.push_back(tri);
+                    }
+                }
+
+                if (triangleUses == maxTriangles) break;
+
+                // The neighbour adding the fewest new vertices (and still fitting)
+                next = -1;
+                unsigned int best = 3;
+                for (int c = 0; c < candidates.size();)
+                {
+                    const int tri = candidates[c];
+                    if (emitted[tri])
+                    {
+                        candidates[c] = candidates.back();
+                        candidates.pop_back();
+                        continue;
+                    }
+
+                    unsigned int fresh = 0;
+                    for (int k = 0; k < 3; k++) fresh += vertexStamp[indices[tri * 3 + k]] != m;
+
+                    if (fresh < best && vertexUses + fresh <= maxVertices)
+                    {
+                        best = fresh;
+                        next = tri;
+                        if (fresh == 0) break;
+                    }
+                    c++;
+                }
+            }
+
+            meshlet.indexCount = static_cast<unsigned int>(reordered.size()) - meshlet.firstIndex;
+            ComputeBounds(positions, reordered, meshlet);
+
+            meshlets.push_back(meshlet);
+        }
+
+        indices = std::move(reordered);
+
+        return meshlets;
+    }
+}
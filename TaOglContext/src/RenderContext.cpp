@@ -1,5 +1,6 @@
 #include "RenderContext.h"
 #include <glad/glad.h>
+#include <algorithm>
 namespace tao_render_context
 {
 
@@ -131,6 +132,34 @@ namespace tao_render_context
 
         GL_CALL(glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &res));
         _shaderStorageBufferOffsetAlignment = res;
+
+        _bindlessTextures =
+                glfwExtensionSupported("GL_ARB_bindless_texture") &&
+                LoadBindlessTextureExt(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+
+        _sparseTextures =
+                glfwExtensionSupported("GL_ARB_sparse_texture") &&
+                LoadSparseTextureExt(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+
+        // gl_Layer from the vertex shader (no entry points to load)
+        _vertexShaderLayer = glfwExtensionSupported("GL_ARB_shader_viewport_layer_array");
+    }
+
+    bool RenderContext::SparseTextureSupported(ogl_texture_internal_format format, int width, int height) const
+    {
+        if(!_sparseTextures) return false;
+
+        GLint pageSizes = 0;
+        GL_CALL(glGetInternalformativ(GL_TEXTURE_2D, format, GL_NUM_VIRTUAL_PAGE_SIZES_ARB, 1, &pageSizes));
+        if(pageSizes<=0) return false;
+
+        // TexStorage fails otherwise (page size index 0, the default)
+        GLint pageX = 0, pageY = 0, maxSize = 0;
+        GL_CALL(glGetInternalformativ(GL_TEXTURE_2D, format, GL_VIRTUAL_PAGE_SIZE_X_ARB, 1, &pageX));
+        GL_CALL(glGetInternalformativ(GL_TEXTURE_2D, format, GL_VIRTUAL_PAGE_SIZE_Y_ARB, 1, &pageY));
+        GL_CALL(glGetIntegerv(GL_MAX_SPARSE_TEXTURE_SIZE_ARB, &maxSize));
+
+        return pageX>0 && pageY>0 && width%pageX==0 && height%pageY==0 && width<=maxSize && height<=maxSize;
     }
 
     void RenderContext::SetupGl()
@@ -287,6 +316,11 @@ namespace tao_render_context
 		GL_CALL(glDrawElementsInstanced( mode, count, type, offset, instanceCount));
 	}
 
+    void RenderContext::MultiDrawElementsIndirect(ogl_primitive_type mode, ogl_indices_type type, const void* indirect, GLsizei drawCount, GLsizei stride)
+    {
+        GL_CALL(glMultiDrawElementsIndirect(mode, type, indirect, drawCount, stride));
+    }
+
     void RenderContext::DispatchCompute(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z)
     {
         GL_CALL(glDispatchCompute(num_groups_x, num_groups_y, num_groups_z));
@@ -451,6 +485,11 @@ namespace tao_render_context
 		return OglShaderStorageBuffer{ OglResource<shader_storage_buffer>{} };
 	}
 
+	OglDrawIndirectBuffer RenderContext::CreateDrawIndirectBuffer()
+	{
+		return OglDrawIndirectBuffer{ OglResource<draw_indirect_buffer>{} };
+	}
+
 	OglPixelPackBuffer RenderContext::CreatePixelPackBuffer()
 	{
 		return OglPixelPackBuffer{ OglResource<pixel_pack_buffer>{} };
@@ -461,6 +500,15 @@ namespace tao_render_context
 		return OglFence{ sync_condition_gpu_commands_complete };
 	}
 
+	PersistentRingBuffer RenderContext::CreatePersistentRingBuffer(GLsizeiptr partitionSize, int partitions)
+	{
+		if(partitions < 1 || partitionSize <= 0)
+			throw std::runtime_error("PersistentRingBuffer: invalid size.");
+
+		const GLsizeiptr alignment = std::max(_uniformBufferOffsetAlignment, _shaderStorageBufferOffsetAlignment);
+		return PersistentRingBuffer{ OglResource<uniform_buffer>{}, partitionSize, partitions, alignment };
+	}
+
     OglQuery RenderContext::CreateQuery()
     {
         return OglQuery{ OglResource<query>{} };
@@ -481,6 +529,16 @@ namespace tao_render_context
 		return OglTexture2DMultisample{ OglResource<texture_2D_multisample>{} };
 	}
 
+    OglTexture2DArray RenderContext::CreateTexture2DArray()
+    {
+        return OglTexture2DArray{ OglResource<texture_2D_array>{} };
+    }
+
+    OglTextureCubeArray RenderContext::CreateTextureCubeArray()
+    {
+        return OglTextureCubeArray{ OglResource<texture_cube_array>{} };
+    }
+
 	OglSampler RenderContext::CreateSampler()
 	{
 		return OglSampler{ OglResource<sampler>{} };
@@ -505,6 +563,8 @@ namespace tao_render_context
 	template OglFramebuffer<OglTexture2D>			 RenderContext::CreateFramebuffer();
 	template OglFramebuffer<OglTexture2DMultisample> RenderContext::CreateFramebuffer();
 	template OglFramebuffer<OglTextureCube>			 RenderContext::CreateFramebuffer();
+	template OglFramebuffer<OglTexture2DArray>		 RenderContext::CreateFramebuffer();
+	template OglFramebuffer<OglTextureCubeArray>	 RenderContext::CreateFramebuffer();
 
 	// ReSharper restore CppMemberFunctionMayBeStatic
 }
\ No newline at end of file
@@ -169,6 +169,20 @@ namespace tao_render_context
         buff.SetData(newCapacity, nullptr, usg);
     }
 
+    // Resizable Draw Indirect Buffer
+    /////////////////////////////////
+    tao_ogl_resources::OglDrawIndirectBuffer  CreateEmptyDibo(RenderContext& rc, tao_ogl_resources::ogl_buffer_usage usg)
+    {
+        auto dibo = rc.CreateDrawIndirectBuffer();
+        dibo.SetData(0, nullptr, usg);
+        return dibo;
+    }
+
+    void ResizeDibo(tao_ogl_resources::OglDrawIndirectBuffer& buff, unsigned int newCapacity, tao_ogl_resources::ogl_buffer_usage usg)
+    {
+        buff.SetData(newCapacity, nullptr, usg);
+    }
+
     unsigned int ResizeBufferPolicy(unsigned int currVertCapacity, unsigned int newVertCount) {
         // initialize vbo size to the required count
         if (currVertCapacity == 0)					return newVertCount;
@@ -181,6 +195,56 @@ namespace tao_render_context
         else 										return currVertCapacity * ((newVertCount / currVertCapacity) + 1);
     }
 
+    void RadixSort(std::vector<unsigned long long>& keys, std::vector<int>& values,
+                   std::vector<unsigned long long>& tmpKeys, std::vector<int>& tmpValues)
+    {
+        if(keys.size()!=values.size())
+            throw std::runtime_error("RadixSort: keys and values size mismatch.");
+
+        constexpr int kDigitBits  = 8;
+        constexpr int kBuckets    = 1 << kDigitBits;
+        constexpr int kPasses     = 64 / kDigitBits;
+
+        const size_t count = keys.size();
+        if(count<2) return;
+
+        tmpKeys  .resize(count);
+        tmpValues.resize(count);
+
+        // All the histograms in a single read
+        size_t histograms[kPasses][kBuckets] = {};
+        for(size_t i=0; i<count; i++)
+            for(int p=0; p<kPasses; p++)
+                histograms[p][(keys[i] >> (p*kDigitBits)) & (kBuckets-1)]++;
+
+        for(int p=0; p<kPasses; p++)
+        {
+            size_t* hist = histograms[p];
+            const int shift = p*kDigitBits;
+
+            // every key has the same digit, nothing to do
+            if(hist[(keys[0] >> shift) & (kBuckets-1)] == count) continue;
+
+            size_t offset = 0;
+            for(int b=0; b<kBuckets; b++)
+            {
+                const size_t c = hist[b];
+                hist[b] = offset;
+                offset += c;
+            }
+
+            for(size_t i=0; i<count; i++)
+            {
+                const size_t dst = hist[(keys[i] >> shift) & (kBuckets-1)]++;
+                tmpKeys  [dst] = keys[i];
+                tmpValues[dst] = values[i];
+            }
+
+            keys  .swap(tmpKeys);
+            values.swap(tmpValues);
+        }
+    }
+
 
     WindowCompositor::WindowCompositor(RenderContext& renderContext, int width, int height)
                                                             :   _renderContext{&renderContext},
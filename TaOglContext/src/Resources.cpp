@@ -1,4 +1,6 @@
 #include "Resources.h"
+#include <stdexcept>
+#include <cstring>
 
 namespace tao_ogl_resources
 {
@@ -22,6 +24,8 @@ namespace tao_ogl_resources
     void   uniform_buffer::Destroy(GLuint id) { GL_CALL(glDeleteBuffers(1, &id)); }
     GLuint shader_storage_buffer::Create() { GLuint id = 0; GL_CALL(glCreateBuffers(1, &id)); return id; }
     void   shader_storage_buffer::Destroy(GLuint id) { GL_CALL(glDeleteBuffers(1, &id)); }
+    GLuint draw_indirect_buffer::Create() { GLuint id = 0; GL_CALL(glCreateBuffers(1, &id)); return id; }
+    void   draw_indirect_buffer::Destroy(GLuint id) { GL_CALL(glDeleteBuffers(1, &id)); }
     GLuint pixel_pack_buffer::Create() { GLuint id = 0; GL_CALL(glCreateBuffers(1, &id)); return id; }
     void   pixel_pack_buffer::Destroy(GLuint id) { GL_CALL(glDeleteBuffers(1, &id)); }
     GLuint pixel_unpack_buffer::Create() { GLuint id = 0; GL_CALL(glCreateBuffers(1, &id)); return id; }
@@ -34,8 +38,12 @@ namespace tao_ogl_resources
     void   texture_2D::Destroy(GLuint id) { GL_CALL(glDeleteTextures(1, &id)); }
     GLuint texture_2D_multisample::Create() { GLuint id = 0; GL_CALL(glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE, 1, &id)); return id; }
     void   texture_2D_multisample::Destroy(GLuint id) { GL_CALL(glDeleteTextures(1, &id)); }
+    GLuint texture_2D_array::Create() { GLuint id = 0; GL_CALL(glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &id)); return id; }
+    void   texture_2D_array::Destroy(GLuint id) { GL_CALL(glDeleteTextures(1, &id)); }
     GLuint texture_cube::Create() { GLuint id = 0; GL_CALL(glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &id)); return id; }
     void   texture_cube::Destroy(GLuint id) { GL_CALL(glDeleteTextures(1, &id)); }
+    GLuint texture_cube_array::Create() { GLuint id = 0; GL_CALL(glCreateTextures(GL_TEXTURE_CUBE_MAP_ARRAY, 1, &id)); return id; }
+    void   texture_cube_array::Destroy(GLuint id) { GL_CALL(glDeleteTextures(1, &id)); }
     GLuint framebuffer::Create() { GLuint id = 0; GL_CALL(glCreateFramebuffers(1, &id)); return id; }
     void   framebuffer::Destroy(GLuint id) { GL_CALL(glDeleteFramebuffers(1, &id)); }
     GLuint sampler::Create() { GLuint id = 0; GL_CALL(glCreateSamplers(1, &id)); return id; }
@@ -138,11 +146,15 @@ namespace tao_ogl_resources
     ///////////////////
     static void namedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage) { GL_CALL(glNamedBufferData(buffer, size, data, usage)); }
     static void namedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) { GL_CALL(glNamedBufferSubData(buffer, offset, size, data)); }
+    static void copyNamedBufferSubData(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) { GL_CALL(glCopyNamedBufferSubData(readBuffer, writeBuffer, readOffset, writeOffset, size)); }
 
     void OglVertexBuffer::Bind() { GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, _ogl_obj.ID())); }
     void OglVertexBuffer::UnBind() { GL_CALL(glBindBuffer(GL_ARRAY_BUFFER,0)); }
     void OglVertexBuffer::SetData(GLsizeiptr size, const void* data, ogl_buffer_usage usage){namedBufferData(_ogl_obj.ID(), size, data, usage);}
     void OglVertexBuffer::SetSubData(GLintptr offset, GLsizeiptr size, const void* data) { namedBufferSubData(_ogl_obj.ID(), offset, size, data); }
+    void OglVertexBuffer::CopySubData(const OglVertexBuffer& src, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) { copyNamedBufferSubData(src._ogl_obj.ID(), _ogl_obj.ID(), readOffset, writeOffset, size); }
+    void* OglVertexBuffer::MapBufferRange(GLintptr offset, GLsizeiptr length, GLbitfield access) { void* ptr; GL_CALL(ptr = glMapNamedBufferRange(_ogl_obj.ID(), offset, length, access)); return ptr; }
+    bool  OglVertexBuffer::UnmapBuffer() { GLboolean ok; GL_CALL(ok = glUnmapNamedBuffer(_ogl_obj.ID())); return ok == GL_TRUE; }
    
     /// Index Buffer
     ///////////////////
@@ -150,6 +162,10 @@ namespace tao_ogl_resources
     void OglIndexBuffer::UnBind() { GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0)); }
     void OglIndexBuffer::SetData(GLsizeiptr size, const void* data, ogl_buffer_usage usage) { namedBufferData(_ogl_obj.ID(), size, data, usage); }
     void OglIndexBuffer::SetSubData(GLintptr offset, GLsizeiptr size, const void* data) { namedBufferSubData(_ogl_obj.ID(), offset, size, data); }
+    void OglIndexBuffer::CopySubData(const OglIndexBuffer& src, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) { copyNamedBufferSubData(src._ogl_obj.ID(), _ogl_obj.ID(), readOffset, writeOffset, size); }
+    void* OglIndexBuffer::MapBufferRange(GLintptr offset, GLsizeiptr length, GLbitfield access) { void* ptr; GL_CALL(ptr = glMapNamedBufferRange(_ogl_obj.ID(), offset, length, access)); return ptr; }
+    bool  OglIndexBuffer::UnmapBuffer() { GLboolean ok; GL_CALL(ok = glUnmapNamedBuffer(_ogl_obj.ID())); return ok == GL_TRUE; }
+    void OglIndexBuffer::BindStorage(GLuint index) { GL_CALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, _ogl_obj.ID())); }
 
     /// VertexAttrib Array
     //////////////////////////
@@ -170,6 +186,21 @@ namespace tao_ogl_resources
 
         UnBind();
     }
+
+    void OglVertexAttribArray::SetVertexAttribIPointer(OglVertexBuffer& vertexBuffer, GLuint index, GLint size, ogl_vertex_attrib_type type, GLsizei stride, const void* pointer, GLuint divisor)
+    {
+        Bind();
+
+        vertexBuffer.Bind();
+
+        // integer attributes are not converted to float
+        GL_CALL(glVertexAttribIPointer(index, size, type, stride, pointer));
+        GL_CALL(glVertexAttribDivisor(index,divisor));
+
+        OglVertexBuffer::UnBind();
+
+        UnBind();
+    }
     
 	void OglVertexAttribArray::SetIndexBuffer(OglIndexBuffer& indexBuffer)
 	{
@@ -192,6 +223,19 @@ namespace tao_ogl_resources
     void OglShaderStorageBuffer::BindRange(GLuint index, GLintptr offset, GLsizeiptr size) { GL_CALL(glBindBufferRange(GL_SHADER_STORAGE_BUFFER, index, _ogl_obj.ID(), offset, size)); }
     void OglShaderStorageBuffer::SetData(GLsizeiptr size, const void* data, ogl_buffer_usage usage) { namedBufferData(_ogl_obj.ID(), size, data, usage); }
     void OglShaderStorageBuffer::SetSubData(GLintptr offset, GLsizeiptr size, const void* data) { namedBufferSubData(_ogl_obj.ID(), offset, size, data); }
+    void OglShaderStorageBuffer::GetSubData(GLintptr offset, GLsizeiptr size, void* data) const { GL_CALL(glGetNamedBufferSubData(_ogl_obj.ID(), offset, size, data)); }
+    void OglShaderStorageBuffer::ClearData(ogl_texture_internal_format internalFormat, ogl_texture_format format, ogl_texture_data_type type, const void* data)
+    {
+        GL_CALL(glClearNamedBufferData(_ogl_obj.ID(), internalFormat, format, type, data));
+    }
+
+    /// Draw Indirect Buffer
+    ////////////////////////////
+    void OglDrawIndirectBuffer::Bind() { GL_CALL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _ogl_obj.ID())); }
+    void OglDrawIndirectBuffer::UnBind() { GL_CALL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0)); }
+    void OglDrawIndirectBuffer::SetData(GLsizeiptr size, const void* data, ogl_buffer_usage usage) { namedBufferData(_ogl_obj.ID(), size, data, usage); }
+    void OglDrawIndirectBuffer::SetSubData(GLintptr offset, GLsizeiptr size, const void* data) { namedBufferSubData(_ogl_obj.ID(), offset, size, data); }
+    void OglDrawIndirectBuffer::BindStorage(GLuint index) { GL_CALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, _ogl_obj.ID())); }
 
     /// Pixel Pack Buffer
     ////////////////////////////
@@ -307,6 +351,61 @@ namespace tao_ogl_resources
     void OglTexture1D::SetLodParams(ogl_tex_lod_params params) { setTextureLodParams(_ogl_obj.ID(), params); }
     void OglTexture1D::SetWrapParams(ogl_tex_wrap_params params) { setTextureWrapParams(_ogl_obj.ID(), params); }
 
+    /// Bindless Textures
+    ///////////////////
+    typedef GLuint64 (APIENTRYP PFNGLGETTEXTURESAMPLERHANDLEARBPROC)(GLuint texture, GLuint sampler);
+    typedef void     (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+    typedef void     (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+
+    static PFNGLGETTEXTURESAMPLERHANDLEARBPROC      glGetTextureSamplerHandleARB      = nullptr;
+    static PFNGLMAKETEXTUREHANDLERESIDENTARBPROC    glMakeTextureHandleResidentARB    = nullptr;
+    static PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC glMakeTextureHandleNonResidentARB = nullptr;
+
+    bool LoadBindlessTextureExt(GLADloadproc load)
+    {
+        glGetTextureSamplerHandleARB      = reinterpret_cast<PFNGLGETTEXTURESAMPLERHANDLEARBPROC>     (load("glGetTextureSamplerHandleARB"));
+        glMakeTextureHandleResidentARB    = reinterpret_cast<PFNGLMAKETEXTUREHANDLERESIDENTARBPROC>   (load("glMakeTextureHandleResidentARB"));
+        glMakeTextureHandleNonResidentARB = reinterpret_cast<PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC>(load("glMakeTextureHandleNonResidentARB"));
+
+        return BindlessTextureExtLoaded();
+    }
+
+    bool BindlessTextureExtLoaded()
+    {
+        return glGetTextureSamplerHandleARB && glMakeTextureHandleResidentARB && glMakeTextureHandleNonResidentARB;
+    }
+
+    static void checkBindlessTextureExt()
+    {
+        if(!BindlessTextureExtLoaded())
+            throw std::runtime_error("ARB_bindless_texture is not available.");
+    }
+
+    /// Sparse Textures
+    ///////////////////
+    typedef void (APIENTRYP PFNGLTEXPAGECOMMITMENTARBPROC)(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+                                                           GLsizei width, GLsizei height, GLsizei depth, GLboolean commit);
+
+    static PFNGLTEXPAGECOMMITMENTARBPROC glTexPageCommitmentARB = nullptr;
+
+    bool LoadSparseTextureExt(GLADloadproc load)
+    {
+        glTexPageCommitmentARB = reinterpret_cast<PFNGLTEXPAGECOMMITMENTARBPROC>(load("glTexPageCommitmentARB"));
+
+        return SparseTextureExtLoaded();
+    }
+
+    bool SparseTextureExtLoaded()
+    {
+        return glTexPageCommitmentARB;
+    }
+
+    static void checkSparseTextureExt()
+    {
+        if(!SparseTextureExtLoaded())
+            throw std::runtime_error("ARB_sparse_texture is not available.");
+    }
+
     /// Texture2D
     ///////////////////
     void OglTexture2D::Bind()                                       { bind(GL_TEXTURE_2D, _ogl_obj.ID()); }
@@ -326,13 +425,105 @@ namespace tao_ogl_resources
     {
         texImage2D(_ogl_obj.ID(), GL_TEXTURE_2D, level, internalFormat, width, height, 0, format, type, data);
     }
+    void OglTexture2D::TexStorage(GLsizei levels, ogl_texture_internal_format internalFormat, GLsizei width, GLsizei height)
+    {
+        GL_CALL(glTextureStorage2D(_ogl_obj.ID(), levels, internalFormat, width, height));
+    }
+    void OglTexture2D::TexSubImage(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, ogl_texture_format format, ogl_texture_data_type type, const void* data)
+    {
+        GL_CALL(glTextureSubImage2D(_ogl_obj.ID(), level, x, y, width, height, format, type, data));
+    }
+    void OglTexture2D::CompressedTexSubImage(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, ogl_texture_internal_format internalFormat, GLsizei imageSize, const void* data)
+    {
+        GL_CALL(glCompressedTextureSubImage2D(_ogl_obj.ID(), level, x, y, width, height, internalFormat, imageSize, data));
+    }
     void OglTexture2D::GenerateMipmap() { generateMipmap(_ogl_obj.ID()); }
+    void OglTexture2D::SetSparse(bool sparse)
+    {
+        checkSparseTextureExt();
+        GL_CALL(glTextureParameteri(_ogl_obj.ID(), GL_TEXTURE_SPARSE_ARB, sparse ? GL_TRUE : GL_FALSE));
+    }
+    GLint OglTexture2D::NumSparseLevels()
+    {
+        GLint levels = 0;
+        GL_CALL(glGetTextureParameteriv(_ogl_obj.ID(), GL_NUM_SPARSE_LEVELS_ARB, &levels));
+        return levels;
+    }
+    void OglTexture2D::PageCommitment(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, bool commit)
+    {
+        // No DSA version in the ARB extension
+        checkSparseTextureExt();
+        bind(GL_TEXTURE_2D, _ogl_obj.ID());
+        GL_CALL(glTexPageCommitmentARB(GL_TEXTURE_2D, level, x, y, 0, width, height, 1, commit ? GL_TRUE : GL_FALSE));
+    }
     void OglTexture2D::SetDepthStencilMode(ogl_texture_depth_stencil_tex_mode mode) { setDepthStencilTextureMode(_ogl_obj.ID(), mode); }
     void OglTexture2D::SetCompareParams(ogl_tex_compare_params params) { setTextureCompareParams(_ogl_obj.ID(), params); }
     void OglTexture2D::SetFilterParams(ogl_tex_filter_params params) { setTextureFilterParms(_ogl_obj.ID(), params); }
     void OglTexture2D::SetLodParams(ogl_tex_lod_params params) { setTextureLodParams(_ogl_obj.ID(), params); }
     void OglTexture2D::SetWrapParams(ogl_tex_wrap_params params) { setTextureWrapParams(_ogl_obj.ID(), params); }
     void OglTexture2D::SetParams(ogl_tex_params params) { setTextureParams(_ogl_obj.ID(), params); }
+    void OglTexture2D::CopySubData(const OglTexture2D& src, GLint level, GLsizei width, GLsizei height)
+    {
+        GL_CALL(glCopyImageSubData(
+                src._ogl_obj.ID(), GL_TEXTURE_2D, level, 0, 0, 0,
+                _ogl_obj.ID()    , GL_TEXTURE_2D, level, 0, 0, 0,
+                width, height, 1));
+    }
+    void OglTexture2D::CopySubData(const OglTexture2D& src, GLint level, GLint srcX, GLint srcY, GLint dstX, GLint dstY, GLsizei width, GLsizei height)
+    {
+        GL_CALL(glCopyImageSubData(
+                src._ogl_obj.ID(), GL_TEXTURE_2D, level, srcX, srcY, 0,
+                _ogl_obj.ID()    , GL_TEXTURE_2D, level, dstX, dstY, 0,
+                width, height, 1));
+    }
+    void OglTexture2D::ClearSubImage(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, ogl_texture_format format, ogl_texture_data_type type, const void* data)
+    {
+        GL_CALL(glClearTexSubImage(_ogl_obj.ID(), level, x, y, 0, width, height, 1, format, type, data));
+    }
+    GLuint64 OglTexture2D::GetSamplerHandle(const OglSampler& sampler)
+    {
+        checkBindlessTextureExt();
+        GLuint64 handle = 0;
+        GL_CALL(handle = glGetTextureSamplerHandleARB(_ogl_obj.ID(), sampler._ogl_obj.ID()));
+        return handle;
+    }
+    void OglTexture2D::MakeHandleResident(GLuint64 handle)      { checkBindlessTextureExt(); GL_CALL(glMakeTextureHandleResidentARB(handle)); }
+    void OglTexture2D::MakeHandleNonResident(GLuint64 handle)   { checkBindlessTextureExt(); GL_CALL(glMakeTextureHandleNonResidentARB(handle)); }
+
+    /// Texture2D Array
+    ///////////////////
+    void OglTexture2DArray::Bind()                                       { bind(GL_TEXTURE_2D_ARRAY, _ogl_obj.ID()); }
+    void OglTexture2DArray::UnBind()                                     { unBind(GL_TEXTURE_2D_ARRAY); }
+    void OglTexture2DArray::BindToTextureUnit(ogl_texture_unit unit)     { bindToTextureUnit(GL_TEXTURE_2D_ARRAY, _ogl_obj.ID(), unit); }
+    void OglTexture2DArray::UnBindToTextureUnit(ogl_texture_unit unit)   { unBindToTextureUnit(GL_TEXTURE_2D_ARRAY, unit); }
+    void OglTexture2DArray::TexStorage(GLsizei levels, ogl_texture_internal_format internalFormat, GLsizei width, GLsizei height, GLsizei layers)
+    {
+        GL_CALL(glTextureStorage3D(_ogl_obj.ID(), levels, internalFormat, width, height, layers));
+    }
+    void OglTexture2DArray::TexSubImage(GLint level, GLint layer, GLsizei width, GLsizei height, ogl_texture_format format, ogl_texture_data_type type, const void* data)
+    {
+        GL_CALL(glTextureSubImage3D(_ogl_obj.ID(), level, 0, 0, layer, width, height, 1, format, type, data));
+    }
+    void OglTexture2DArray::TexSubImage(GLint level, GLint x, GLint y, GLint layer, GLsizei width, GLsizei height, ogl_texture_format format, ogl_texture_data_type type, const void* data)
+    {
+        GL_CALL(glTextureSubImage3D(_ogl_obj.ID(), level, x, y, layer, width, height, 1, format, type, data));
+    }
+    void OglTexture2DArray::CompressedTexSubImage(GLint level, GLint x, GLint y, GLint layer, GLsizei width, GLsizei height, ogl_texture_internal_format internalFormat, GLsizei imageSize, const void* data)
+    {
+        GL_CALL(glCompressedTextureSubImage3D(_ogl_obj.ID(), level, x, y, layer, width, height, 1, internalFormat, imageSize, data));
+    }
+    void OglTexture2DArray::CopySubData(const OglTexture2DArray& src, GLint level, GLint srcLayer, GLint dstLayer, GLsizei width, GLsizei height, GLsizei layers)
+    {
+        GL_CALL(glCopyImageSubData(
+                src._ogl_obj.ID(), GL_TEXTURE_2D_ARRAY, level, 0, 0, srcLayer,
+                _ogl_obj.ID()    , GL_TEXTURE_2D_ARRAY, level, 0, 0, dstLayer,
+                width, height, layers));
+    }
+    void OglTexture2DArray::GenerateMipmap() { generateMipmap(_ogl_obj.ID()); }
+    void OglTexture2DArray::SetFilterParams(ogl_tex_filter_params params) { setTextureFilterParms(_ogl_obj.ID(), params); }
+    void OglTexture2DArray::SetLodParams(ogl_tex_lod_params params) { setTextureLodParams(_ogl_obj.ID(), params); }
+    void OglTexture2DArray::SetWrapParams(ogl_tex_wrap_params params) { setTextureWrapParams(_ogl_obj.ID(), params); }
+    void OglTexture2DArray::SetParams(ogl_tex_params params) { setTextureParams(_ogl_obj.ID(), params); }
 
     /// Texture2D Multisample
     ///////////////////
@@ -379,6 +570,18 @@ namespace tao_ogl_resources
         GL_CALL(glTexImage2D(target, level, internalFormat, width, height, border, format, type, data));
         UnBind();
     }
+    void OglTextureCube::CopySubData(const OglTextureCube& src, GLint level, GLsizei width, GLsizei height)
+    {
+        // faces are the layers (z) of the cube map
+        GL_CALL(glCopyImageSubData(
+                src._ogl_obj.ID(), GL_TEXTURE_CUBE_MAP, level, 0, 0, 0,
+                _ogl_obj.ID()    , GL_TEXTURE_CUBE_MAP, level, 0, 0, 0,
+                width, height, 6));
+    }
+    void OglTextureCube::GetTexImage(GLint level, ogl_texture_format format, ogl_texture_data_type type, GLsizei bufSize, void* data) const
+    {
+        GL_CALL(glGetTextureImage(_ogl_obj.ID(), level, format, type, bufSize, data));
+    }
     void OglTextureCube::GenerateMipmap() { generateMipmap(_ogl_obj.ID()); }
     void OglTextureCube::SetDepthStencilMode(ogl_texture_depth_stencil_tex_mode mode) { setDepthStencilTextureMode(_ogl_obj.ID(), mode); }
     void OglTextureCube::SetCompareParams(ogl_tex_compare_params params) { setTextureCompareParams(_ogl_obj.ID(), params); }
@@ -387,6 +590,32 @@ namespace tao_ogl_resources
     void OglTextureCube::SetWrapParams(ogl_tex_wrap_params params) { setTextureWrapParams(_ogl_obj.ID(), params); }
     void OglTextureCube::SetParams(ogl_tex_params params) { setTextureParams(_ogl_obj.ID(), params); }
 
+    /// Texture Cube Array
+    ///////////////////
+    void OglTextureCubeArray::Bind()                                       { bind(GL_TEXTURE_CUBE_MAP_ARRAY, _ogl_obj.ID()); }
+    void OglTextureCubeArray::UnBind()                                     { unBind(GL_TEXTURE_CUBE_MAP_ARRAY); }
+    void OglTextureCubeArray::BindToTextureUnit(ogl_texture_unit unit)     { bindToTextureUnit(GL_TEXTURE_CUBE_MAP_ARRAY, _ogl_obj.ID(), unit); }
+    void OglTextureCubeArray::UnBindToTextureUnit(ogl_texture_unit unit)   { unBindToTextureUnit(GL_TEXTURE_CUBE_MAP_ARRAY, unit); }
+    void OglTextureCubeArray::TexStorage(GLsizei levels, ogl_texture_internal_format internalFormat, GLsizei size, GLsizei cubes)
+    {
+        GL_CALL(glTextureStorage3D(_ogl_obj.ID(), levels, internalFormat, size, size, cubes*6));
+    }
+    void OglTextureCubeArray::CopySubData(const OglTextureCubeArray& src, GLint level, GLint srcCube, GLint dstCube, GLint x, GLint y, GLsizei width, GLsizei height, GLsizei cubes)
+    {
+        GL_CALL(glCopyImageSubData(
+                src._ogl_obj.ID(), GL_TEXTURE_CUBE_MAP_ARRAY, level, x, y, srcCube*6,
+                _ogl_obj.ID()    , GL_TEXTURE_CUBE_MAP_ARRAY, level, x, y, dstCube*6,
+                width, height, cubes*6));
+    }
+    void OglTextureCubeArray::ClearSubImage(GLint level, GLint cube, GLint x, GLint y, GLsizei width, GLsizei height, GLsizei cubes, ogl_texture_format format, ogl_texture_data_type type, const void* data)
+    {
+        GL_CALL(glClearTexSubImage(_ogl_obj.ID(), level, x, y, cube*6, width, height, cubes*6, format, type, data));
+    }
+    void OglTextureCubeArray::SetFilterParams(ogl_tex_filter_params params) { setTextureFilterParms(_ogl_obj.ID(), params); }
+    void OglTextureCubeArray::SetLodParams(ogl_tex_lod_params params) { setTextureLodParams(_ogl_obj.ID(), params); }
+    void OglTextureCubeArray::SetWrapParams(ogl_tex_wrap_params params) { setTextureWrapParams(_ogl_obj.ID(), params); }
+    void OglTextureCubeArray::SetParams(ogl_tex_params params) { setTextureParams(_ogl_obj.ID(), params); }
+
     /// Sampler
     ///////////////////
     void OglSampler::BindToTextureUnit  (ogl_texture_unit unit) { GL_CALL(glBindSampler(unit - GL_TEXTURE0, _ogl_obj.ID())); }
@@ -433,6 +662,11 @@ namespace tao_ogl_resources
     {
 	    GL_CALL(glNamedFramebufferTexture(_ogl_obj.ID(), attachment, texture._ogl_obj.ID(), level));
     }
+    template<typename Tex> requires ogl_texture<typename Tex::ogl_resource_type>
+	void OglFramebuffer<Tex>::AttachTextureLayer(ogl_framebuffer_attachment attachment, const Tex& texture, GLint level, GLint layer)
+    {
+	    GL_CALL(glNamedFramebufferTextureLayer(_ogl_obj.ID(), attachment, texture._ogl_obj.ID(), level, layer));
+    }
     template<> // Texture 2D Multisample template spec
     void OglFramebuffer<OglTexture2DMultisample>::AttachTexture(ogl_framebuffer_attachment attachment, const OglTexture2DMultisample& texture, GLint level)
     {
@@ -510,6 +744,8 @@ namespace tao_ogl_resources
     template class OglFramebuffer<OglTexture2D>;
     template class OglFramebuffer<OglTexture2DMultisample>;
     template class OglFramebuffer<OglTextureCube>;
+    template class OglFramebuffer<OglTexture2DArray>;
+    template class OglFramebuffer<OglTextureCubeArray>;
 
     template void  OglFramebuffer<OglTexture2D>::           CopyTo<OglTexture2D>           (OglFramebuffer<OglTexture2D>*, GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLint, ogl_framebuffer_copy_mask, ogl_framebuffer_copy_filter) const;
     template void  OglFramebuffer<OglTexture2D>::           CopyTo<OglTexture2DMultisample>(OglFramebuffer<OglTexture2DMultisample>*, GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLint, ogl_framebuffer_copy_mask, ogl_framebuffer_copy_filter) const;
@@ -540,5 +776,82 @@ namespace tao_ogl_resources
     void OglQuery::GetInteger64v(tao_ogl_resources::ogl_query_param pname, GLint64 *params){ GL_CALL(glGetQueryObjecti64v(_ogl_obj.ID(), pname, params)); }
     void OglQuery::QueryCounter(tao_ogl_resources::ogl_query_counter_target target) {GL_CALL(glQueryCounter(_ogl_obj.ID(), target));}
 
+    /// Persistent Ring Buffer
+    ////////////////////////////
+    static constexpr GLbitfield PERSISTENT_RING_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    PersistentRingBuffer::PersistentRingBuffer(OglResource<ogl_resource_type>&& buffer, GLsizeiptr partitionSize, int partitions, GLsizeiptr alignment) :
+        _ogl_obj(std::move(buffer)),
+        _fences(partitions),
+        _partitionSize((partitionSize + alignment - 1) / alignment * alignment),
+        _alignment(alignment)
+    {
+        const GLsizeiptr size = _partitionSize * partitions;
+
+        GL_CALL(glNamedBufferStorage(_ogl_obj.ID(), size, nullptr, PERSISTENT_RING_FLAGS));
+        GL_CALL(_mapped = static_cast<unsigned char*>(glMapNamedBufferRange(_ogl_obj.ID(), 0, size, PERSISTENT_RING_FLAGS)));
+
+        if(!_mapped)
+            throw std::runtime_error("PersistentRingBuffer: cannot map the buffer.");
+    }
+
+    void PersistentRingBuffer::BeginFrame()
+    {
+        _head = 0;
+
+        auto& fence = _fences[_partition];
+        if(!fence) return;
+
+        // The GPU is at most (partitions - 1) frames behind,
+        // this only blocks if it's further than that.
+        while(true)
+        {
+            auto res = fence->ClientWaitSync(wait_sync_flags_flush_commands, 1000000000ull);
+
+            if(res == wait_sync_res_already_signaled || res == wait_sync_res_condition_satisfied)
+                break;
+            else if(res == wait_sync_res_failed)
+                throw std::runtime_error("PersistentRingBuffer: unexpected OpenGl sync object state.");
+        }
+
+        fence.reset();
+    }
+
+    void PersistentRingBuffer::EndFrame()
+    {
+        _fences[_partition] = OglFence{sync_condition_gpu_commands_complete};
+        _partition = (_partition + 1) % static_cast<int>(_fences.size());
+    }
+
+    PersistentRingBuffer::allocation PersistentRingBuffer::Allocate(GLsizeiptr size)
+    {
+        const GLsizeiptr offset = (_head + _alignment - 1) / _alignment * _alignment;
+
+        if(offset + size > _partitionSize)
+            throw std::runtime_error("PersistentRingBuffer: out of space for this frame.");
+
+        _head = offset + size;
+
+        const GLintptr bufferOffset = _partition * _partitionSize + offset;
+        return allocation{ .offset = bufferOffset, .size = size, .data = _mapped + bufferOffset };
+    }
+
+    PersistentRingBuffer::allocation PersistentRingBuffer::Write(const void* data, GLsizeiptr size)
+    {
+        auto alloc = Allocate(size);
+        memcpy(alloc.data, data, size);
+        return alloc;
+    }
+
+    void PersistentRingBuffer::BindUniformRange(GLuint index, const allocation& alloc) { GL_CALL(glBindBufferRange(GL_UNIFORM_BUFFER, index, _ogl_obj.ID(), alloc.offset, alloc.size)); }
+    void PersistentRingBuffer::BindStorageRange(GLuint index, const allocation& alloc) { GL_CALL(glBindBufferRange(GL_SHADER_STORAGE_BUFFER, index, _ogl_obj.ID(), alloc.offset, alloc.size)); }
+    void PersistentRingBuffer::BindPixelUnpack() { GL_CALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _ogl_obj.ID())); }
+
+    GLsizeiptr PersistentRingBuffer::Available() const
+    {
+        const GLsizeiptr offset = (_head + _alignment - 1) / _alignment * _alignment;
+        return offset < _partitionSize ? _partitionSize - offset : 0;
+    }
+
 	// ReSharper restore CppMemberFunctionMayBeConst
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "TangentSpace.h"
+
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace glm;
+
+namespace tao_geometry
+{
+    // Below this many vertices per thread it's not worth spawning one
+    static constexpr size_t MIN_VERTICES_PER_THREAD = 16384;
+
+    // Calls func(begin, end) over [0, count) in about equal
+    // chunks, the last one on the calling thread.
+    template<typename F>
+    static void ParallelChunks(size_t count, unsigned int threadCount, const F& func)
+    {
+        const size_t chunks    = std::clamp<size_t>(count / MIN_VERTICES_PER_THREAD, 1, threadCount);
+        const size_t chunkSize = (count + chunks - 1) / chunks;
+
+        std::vector<std::thread> threads;
+        threads.reserve(chunks - 1);
+
+        for(size_t c=0; c+1<chunks; c++)
+            threads.emplace_back(func, c*chunkSize, (c+1)*chunkSize);
+
+        func((chunks-1)*chunkSize, count);
+
+        for(auto& t : threads) t.join();
+    }
+
+    // Any unit vector orthogonal to n
+    static vec3 Orthogonal(const vec3& n)
+    {
+        const vec3 axis = abs(n.x) < 0.9f ? vec3{1.0f, 0.0f, 0.0f} : vec3{0.0f, 1.0f, 0.0f};
+        return normalize(cross(n, axis));
+    }
+
+    void ComputeTangentFrames(
+            const std::vector<vec3>& positions,
+            const std::vector<vec3>& normals,
+            const std::vector<vec2>& textureCoordinates,
+            const std::vector<int>&  indices,
+            std::vector<vec3>&       tangents,
+            std::vector<vec3>&       bitangents,
+            unsigned int             threadCount)
+    {
+        const size_t vertexCount = positions.size();
+
+        if (textureCoordinates.size() != vertexCount || normals.size() != vertexCount)
+            throw std::runtime_error("Invalid input: positions, normals and textureCoordinates must match in size");
+
+        if (indices.size() % 3 != 0)
+            throw std::runtime_error("Invalid input: indices must be a list of triangles");
+
+        // Checked once here, the loops below don't
+        for (int i : indices)
+            if (i < 0 || i >= vertexCount)
+                throw std::runtime_error("Invalid input: indices reference out of bounds");
+
+        if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+        // Corners of each vertex (CSR): the corners of
+        // vertex v are cornerList[cornerStart[v], cornerStart[v+1]).
+        std::vector<int> cornerStart(vertexCount + 1, 0);
+        std::vector<int> cornerList (indices.size());
+
+        for (int i : indices) cornerStart[i + 1]++;
+        for (size_t v = 0; v < vertexCount; v++) cornerStart[v + 1] += cornerStart[v];
+        {
+            std::vector<int> fill(cornerStart.begin(), cornerStart.end() - 1);
+            for (int c = 0; c < indices.size(); c++) cornerList[fill[indices[c]]++] = c;
+        }
+
+        tangents  .resize(vertexCount);
+        bitangents.resize(vertexCount);
+
+        ParallelChunks(vertexCount, threadCount, [&](size_t begin, size_t end)
+        {
+            for (size_t v = begin; v < end; v++)
+            {
+                const vec3 n = normalize(normals[v]);
+
+                vec3 sumT{0.0f}, sumB{0.0f};
+
+                for (int k = cornerStart[v]; k < cornerStart[v + 1]; k++)
+                {
+                    // This corner first, then the other two (same winding)
+                    const int c     = cornerList[k];
+                    const int first = c - c % 3;
+                    const int i0    = indices[c];
+                    const int i1    = indices[first + (c + 1) % 3];
+                    const int i2    = indices[first + (c + 2) % 3];
+
+                    const vec3 e1 = positions[i1] - positions[i0];
+                    const vec3 e2 = positions[i2] - positions[i0];
+                    const vec2 d1 = textureCoordinates[i1] - textureCoordinates[i0];
+                    const vec2 d2 = textureCoordinates[i2] - textureCoordinates[i0];
+
+                    // Closed form 2x2 inverse, degenerate uvs add nothing
+                    const float det = d1.x * d2.y - d2.x * d1.y;
+                    if (!(abs(det) > 1e-20f)) continue;
+
+                    const float r    = 1.0f / det;
+                    const vec3  tri  = (e1 * d2.y - e2 * d1.y) * r;
+                    const vec3  bri  = (e2 * d1.x - e1 * d2.x) * r;
+
+                    // Projected onto the normal's plane, angle weighted
+                    const float l1 = dot(e1, e1), l2 = dot(e2, e2);
+                    if (l1 <= 0.0f || l2 <= 0.0f) continue;
+
+                    const float angle = acos(clamp(dot(e1, e2) * inversesqrt(l1 * l2), -1.0f, 1.0f));
+
+                    const vec3 t = tri - n * dot(n, tri);
+                    const vec3 b = bri - n * dot(n, bri);
+                    const float lt = dot(t, t), lb = dot(b, b);
+
+                    if (lt > 0.0f) sumT += t * (angle * inversesqrt(lt));
+                    if (lb > 0.0f) sumB += b * (angle * inversesqrt(lb));
+                }
+
+                vec3 t = sumT - n * dot(n, sumT);
+                t = dot(t, t) > 1e-20f ? normalize(t) : Orthogonal(n);
+
+                const vec3  nxt  = cross(n, t);
+                const float sign = dot(nxt, sumB) < 0.0f ? -1.0f : 1.0f;
+
+                tangents  [v] = t;
+                bitangents[v] = sign * nxt;
+            }
+        });
+    }
+}
@@ -42,6 +42,23 @@ namespace tao_math
         intersection1 = t1>0.0f ? std::make_optional(r.PointAt(t1)) : std::nullopt;
     }
 
+    std::optional<float> RayAabbIntersection(const Ray& r, const glm::vec3& min, const glm::vec3& max)
+    {
+        const glm::vec3 invDir = 1.0f/r.Direction();
+        const glm::vec3 t0     = (min-r.Origin())*invDir;
+        const glm::vec3 t1     = (max-r.Origin())*invDir;
+
+        const glm::vec3 tNear  = glm::min(t0, t1);
+        const glm::vec3 tFar   = glm::max(t0, t1);
+
+        const float tEnter = glm::max(glm::max(tNear.x, tNear.y), tNear.z);
+        const float tExit  = glm::min(glm::min(tFar.x, tFar.y), tFar.z);
+
+        if(tEnter>tExit || tExit<0.0f) return std::nullopt;
+
+        return glm::max(tEnter, 0.0f);
+    }
+
     std::optional<glm::vec3> RayTriangleIntersection(const Ray& r, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float tol)
     {
         // origin at t0
@@ -78,6 +95,78 @@ namespace tao_math
         return std::make_optional<glm::vec3>(r.PointAt(t));
     }
 
+    Frustum::Frustum(const glm::mat4& viewProjection)
+    {
+        // rows of the matrix (glm is column major)
+        const glm::mat4 m = glm::transpose(viewProjection);
+
+        _planes[PLANE_LEFT]   = m[3] + m[0];
+        _planes[PLANE_RIGHT]  = m[3] - m[0];
+        _planes[PLANE_BOTTOM] = m[3] + m[1];
+        _planes[PLANE_TOP]    = m[3] - m[1];
+        _planes[PLANE_FAR]    = m[3] - m[2];
+        _planes[PLANE_NEAR]   = m[3] + m[2];
+
+        for(auto& p : _planes)
+            p /= glm::length(glm::vec3{p});
+    }
+
+    void AabbSoA::Clear()
+    {
+        cx.clear(); cy.clear(); cz.clear();
+        ex.clear(); ey.clear(); ez.clear();
+    }
+
+    void AabbSoA::Reserve(size_t count)
+    {
+        cx.reserve(count); cy.reserve(count); cz.reserve(count);
+        ex.reserve(count); ey.reserve(count); ez.reserve(count);
+    }
+
+    void AabbSoA::PushBack(const glm::vec3& min, const glm::vec3& max)
+    {
+        const glm::vec3 c = (max+min)*0.5f;
+        const glm::vec3 e = (max-min)*0.5f;
+
+        cx.push_back(c.x); cy.push_back(c.y); cz.push_back(c.z);
+        ex.push_back(e.x); ey.push_back(e.y); ez.push_back(e.z);
+    }
+
+    int FrustumCull(const Frustum& frustum, const AabbSoA& boxes, std::vector<unsigned char>& visible, int planeCount)
+    {
+        const int count = static_cast<int>(boxes.Size());
+
+        visible.assign(count, 1);
+
+        const float* cx = boxes.cx.data(); const float* cy = boxes.cy.data(); const float* cz = boxes.cz.data();
+        const float* ex = boxes.ex.data(); const float* ey = boxes.ey.data(); const float* ez = boxes.ez.data();
+        unsigned char* vis = visible.data();
+
+        // One plane at a time over all the boxes: no branches
+        // in the inner loop, the compiler can go wide on it.
+        for(int p=0; p<planeCount; p++)
+        {
+            const glm::vec4 pl = frustum.PlaneEquation(p);
+            const float nx = pl.x, ny = pl.y, nz = pl.z, d = pl.w;
+            const float ax = glm::abs(nx), ay = glm::abs(ny), az = glm::abs(nz);
+
+            for(int i=0; i<count; i++)
+            {
+                // signed distance of the center and
+                // projected radius of the box on the normal
+                const float dist = nx*cx[i] + ny*cy[i] + nz*cz[i] + d;
+                const float rad  = ax*ex[i] + ay*ey[i] + az*ez[i];
+
+                vis[i] &= static_cast<unsigned char>(dist + rad >= 0.0f);
+            }
+        }
+
+        int visibleCount = 0;
+        for(int i=0; i<count; i++) visibleCount+=vis[i];
+
+        return visibleCount;
+    }
+
     glm::vec2 PointLineClosestPoint(const glm::vec2& pt, const glm::vec2& l0, const glm::vec2& l1)
     {
         vec2 l01Nrm = glm::normalize(l1-l0);
@@ -0,0 +1,382 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <stdexcept>
+
+namespace tao_texture
+{
+    static float SrgbToLinear(float c) { return c <= 0.04045f   ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f); }
+    static float LinearToSrgb(float c) { return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f; }
+
+    static unsigned char ToUnorm8(float v) { return static_cast<unsigned char>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); }
+
+    int MipCount(int width, int height)
+    {
+        int count = 1;
+        for (int size = std::max(width, height); size > 1; size >>= 1) count++;
+
+        return count;
+    }
+
+    static std::vector<unsigned char> Downsample(const std::vector<unsigned char>& src, int srcWidth, int srcHeight,
+                                                 int width, int height, int channels, mip_filter filter,
+                                                 const std::array<float, 256>& toLinear)
+    {
+        // Decoded before averaging: sRGB colors to linear, normals to [-1, 1]
+        const int colorChannels = filter == mip_filter::linear ? 0 : std::min(channels, 3);
+
+        std::vector<unsigned char> dst(static_cast<size_t>(width) * height * channels);
+
+        for (int y = 0; y < height; y++)
+        {
+            const int y0 = y * srcHeight / height;
+            const int y1 = std::max(y0 + 1, ((y + 1) * srcHeight + height - 1) / height);
+
+            for (int x = 0; x < width; x++)
+            {
+                const int x0 = x * srcWidth / width;
+                const int x1 = std::max(x0 + 1, ((x + 1) * srcWidth + width - 1) / width);
+
+                float sum[4] = {};
+                for (int sy = y0; sy < y1; sy++)
+                    for (int sx = x0; sx < x1; sx++)
+                    {
+                        const unsigned char* t = &src[(static_cast<size_t>(sy) * srcWidth + sx) * channels];
+                        for (int c = 0; c < channels; c++)
+                            sum[c] += c >= colorChannels              ? t[c] / 255.0f
+                                    : filter == mip_filter::srgb      ? toLinear[t[c]]
+                                    :                                   t[c] / 255.0f * 2.0f - 1.0f;
+                    }
+
+                const float count = static_cast<float>((y1 - y0) * (x1 - x0));
+                for (int c = 0; c < channels; c++) sum[c] /= count;
+
+                // Shorter on average where the normals diverge
+                if (filter == mip_filter::normal_map && colorChannels == 3)
+                {
+                    const float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+                    if (length > 0.0f)
+                        for (int c = 0; c < 3; c++) sum[c] /= length;
+                }
+
+                unsigned char* t = &dst[(static_cast<size_t>(y) * width + x) * channels];
+                for (int c = 0; c < channels; c++)
+                    t[c] = c >= colorChannels              ? ToUnorm8(sum[c])
+                         : filter == mip_filter::srgb      ? ToUnorm8(LinearToSrgb(sum[c]))
+                         :                                   ToUnorm8(sum[c] * 0.5f + 0.5f);
+            }
+        }
+
+        return dst;
+    }
+
+    MipChain GenerateMips(const unsigned char* pixels, int width, int height, int channels, mip_filter filter)
+    {
+        if (width < 1 || height < 1 || channels < 1 || channels > 4)
+            throw std::runtime_error("Invalid input: empty image or channels not in [1, 4]");
+
+        std::array<float, 256> toLinear;
+        for (int v = 0; v < 256; v++) toLinear[v] = SrgbToLinear(v / 255.0f);
+
+        MipChain chain{.width = width, .height = height, .channels = channels, .levels = {}};
+        chain.levels.reserve(MipCount(width, height));
+        chain.levels.emplace_back(pixels, pixels + static_cast<size_t>(width) * height * channels);
+
+        // Each level from the previous one
+        for (int w = width, h = height; w > 1 || h > 1;)
+        {
+            const int nw = std::max(1, w / 2);
+            const int nh = std::max(1, h / 2);
+
+            chain.levels.push_back(Downsample(chain.levels.back(), w, h, nw, nh, channels, filter, toLinear));
+            w = nw;
+            h = nh;
+        }
+
+        return chain;
+    }
+
+    typedef unsigned char Block[16][4];
+
+    // rgba, missing channels are 0 (alpha 255)
+    static void FetchBlock(const unsigned char* pixels, int width, int height, int channels, int blockX, int blockY, Block& block)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            const int x = std::min(blockX * 4 + (i & 3) , width  - 1);
+            const int y = std::min(blockY * 4 + (i >> 2), height - 1);
+            const unsigned char* t = pixels + (static_cast<size_t>(y) * width + x) * channels;
+
+            block[i][0] = t[0];
+            block[i][1] = channels > 1 ? t[1] : 0;
+            block[i][2] = channels > 2 ? t[2] : 0;
+            block[i][3] = channels > 3 ? t[3] : 255;
+        }
+    }
+
+    // Little endian bit stream, `out` zeroed
+    struct BitWriter
+    {
+        unsigned char* out;
+        int            bit = 0;
+
+        void Write(unsigned int value, int count)
+        {
+            for (int i = 0; i < count; i++, bit++)
+                if ((value >> i) & 1u) out[bit >> 3] |= static_cast<unsigned char>(1u << (bit & 7));
+        }
+    };
+
+    // BC4: the extremes as endpoints (r0 > r1: 6 values in between),
+    // each texel picks the closest of the 8.
+    static void EncodeBc4(const Block& block, int channel, unsigned char* out)
+    {
+        int lo = 255, hi = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            lo = std::min<int>(lo, block[i][channel]);
+            hi = std::max<int>(hi, block[i][channel]);
+        }
+
+        int palette[8] = {hi, lo};
+        for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * hi + i * lo + 3) / 7;
+
+        out[0] = static_cast<unsigned char>(hi);
+        out[1] = static_cast<unsigned char>(lo);
+
+        BitWriter bits{.out = out + 2};
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            for (int p = 1; p < 8; p++)
+                if (std::abs(palette[p] - block[i][channel]) < std::abs(palette[best] - block[i][channel])) best = p;
+
+            bits.Write(best, 3);
+        }
+    }
+
+    static constexpr int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    // Mode 6 endpoint: 7 bits a channel, the p bit is their lsb
+    struct Bc7Endpoint
+    {
+        int color[4];
+        int p;
+
+        int Value(int c) const { return (color[c] << 1) | p; }
+    };
+
+    static Bc7Endpoint QuantizeEndpoint(const float (&e)[4])
+    {
+        Bc7Endpoint best{};
+        float bestError = FLT_MAX;
+
+        for (int p = 0; p < 2; p++)
+        {
+            Bc7Endpoint q{.color = {}, .p = p};
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++)
+            {
+                q.color[c] = std::clamp(static_cast<int>(std::lround((e[c] - p) * 0.5f)), 0, 127);
+                const float d = static_cast<float>(q.Value(c)) - e[c];
+                error += d * d;
+            }
+
+            if (error < bestError)
+            {
+                bestError = error;
+                best      = q;
+            }
+        }
+
+        return best;
+    }
+
+    // Closest palette entry of each texel, returns the squared error
+    static int Bc7Indices(const Block& block, const Bc7Endpoint (&ends)[2], int (&indices)[16])
+    {
+        int palette[16][4];
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 4; c++)
+                palette[i][c] = ((64 - BC7_WEIGHTS[i]) * ends[0].Value(c) + BC7_WEIGHTS[i] * ends[1].Value(c) + 32) >> 6;
+
+        int total = 0;
+        for (int t = 0; t < 16; t++)
+        {
+            int bestError = INT_MAX;
+            for (int i = 0; i < 16; i++)
+            {
+                int error = 0;
+                for (int c = 0; c < 4; c++)
+                {
+                    const int d = palette[i][c] - block[t][c];
+                    error += d * d;
+                }
+
+                if (error < bestError)
+                {
+                    bestError  = error;
+                    indices[t] = i;
+                }
+            }
+            total += bestError;
+        }
+
+        return total;
+    }
+
+    // BC7 mode 6: endpoints along the texels' principal axis, then
+    // refined by least squares for the indices they got.
+    static void EncodeBc7(const Block& block, unsigned char* out)
+    {
+        float mean[4] = {}, lo[4], hi[4];
+        for (int c = 0; c < 4; c++) lo[c] = hi[c] = block[0][c];
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 4; c++)
+            {
+                mean[c] += block[i][c] / 16.0f;
+                lo[c] = std::min<float>(lo[c], block[i][c]);
+                hi[c] = std::max<float>(hi[c], block[i][c]);
+            }
+
+        float cov[4][4] = {};
+        for (int i = 0; i < 16; i++)
+            for (int r = 0; r < 4; r++)
+                for (int c = 0; c < 4; c++)
+                    cov[r][c] += (block[i][r] - mean[r]) * (block[i][c] - mean[c]);
+
+        // Power iterations, from the bounding box diagonal
+        float axis[4];
+        for (int c = 0; c < 4; c++) axis[c] = hi[c] - lo[c];
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = {}, length = 0.0f;
+            for (int r = 0; r < 4; r++)
+            {
+                for (int c = 0; c < 4; c++) next[r] += cov[r][c] * axis[c];
+                length += next[r] * next[r];
+            }
+
+            length = std::sqrt(length);
+            if (!(length > 0.0f)) break;
+            for (int c = 0; c < 4; c++) axis[c] = next[c] / length;
+        }
+
+        float axisLength = 0.0f;
+        for (int c = 0; c < 4; c++) axisLength += axis[c] * axis[c];
+        if (axisLength > 0.0f)
+            for (int c = 0; c < 4; c++) axis[c] /= std::sqrt(axisLength);
+
+        float tMin = 0.0f, tMax = 0.0f;
+        for (int i = 0; i < 16; i++)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < 4; c++) t += (block[i][c] - mean[c]) * axis[c];
+            tMin = std::min(tMin, t);
+            tMax = std::max(tMax, t);
+        }
+
+        float e0[4], e1[4];
+        for (int c = 0; c < 4; c++)
+        {
+            e0[c] = std::clamp(mean[c] + tMin * axis[c], 0.0f, 255.0f);
+            e1[c] = std::clamp(mean[c] + tMax * axis[c], 0.0f, 255.0f);
+        }
+
+        Bc7Endpoint ends[2] = {QuantizeEndpoint(e0), QuantizeEndpoint(e1)};
+        int indices[16];
+        int error = Bc7Indices(block, ends, indices);
+
+        for (int iteration = 0; iteration < 2 && error > 0; iteration++)
+        {
+            // Minimizes sum |(1 - w) e0 + w e1 - texel|^2
+            float a00 = 0.0f, a01 = 0.0f, a11 = 0.0f, b0[4] = {}, b1[4] = {};
+            for (int i = 0; i < 16; i++)
+            {
+                const float w = BC7_WEIGHTS[indices[i]] / 64.0f;
+                a00 += (1.0f - w) * (1.0f - w);
+                a01 += (1.0f - w) * w;
+                a11 += w * w;
+                for (int c = 0; c < 4; c++)
+                {
+                    b0[c] += (1.0f - w) * block[i][c];
+                    b1[c] += w * block[i][c];
+                }
+            }
+
+            const float det = a00 * a11 - a01 * a01;
+            if (std::abs(det) < 1e-6f) break;
+
+            for (int c = 0; c < 4; c++)
+            {
+                e0[c] = std::clamp((a11 * b0[c] - a01 * b1[c]) / det, 0.0f, 255.0f);
+                e1[c] = std::clamp((a00 * b1[c] - a01 * b0[c]) / det, 0.0f, 255.0f);
+            }
+
+            const Bc7Endpoint refined[2] = {QuantizeEndpoint(e0), QuantizeEndpoint(e1)};
+            int refinedIndices[16];
+            const int refinedError = Bc7Indices(block, refined, refinedIndices);
+            if (refinedError >= error) break;
+
+            ends[0] = refined[0];
+            ends[1] = refined[1];
+            std::copy_n(refinedIndices, 16, indices);
+            error = refinedError;
+        }
+
+        // The first texel's index has its top bit implied 0
+        if (indices[0] & 8)
+        {
+            std::swap(ends[0], ends[1]);
+            for (int& i : indices) i = 15 - i;
+        }
+
+        std::fill_n(out, 16, 0);
+        BitWriter bits{.out = out};
+
+        bits.Write(1u << 6, 7);     // mode 6
+        for (int c = 0; c < 4; c++)
+        {
+            bits.Write(ends[0].color[c], 7);
+            bits.Write(ends[1].color[c], 7);
+        }
+        bits.Write(ends[0].p, 1);
+        bits.Write(ends[1].p, 1);
+
+        bits.Write(indices[0], 3);
+        for (int i = 1; i < 16; i++) bits.Write(indices[i], 4);
+    }
+
+    std::vector<unsigned char> CompressImage(const unsigned char* pixels, int width, int height, int channels, block_format format)
+    {
+        if (width < 1 || height < 1 || channels < 1 || channels > 4)
+            throw std::runtime_error("Invalid input: empty image or channels not in [1, 4]");
+
+        const int blocksX = (width  + 3) / 4;
+        const int blocksY = (height + 3) / 4;
+        const int bytes   = BlockBytes(format);
+
+        std::vector<unsigned char> blocks(static_cast<size_t>(blocksX) * blocksY * bytes);
+
+        Block block;
+        for (int by = 0; by < blocksY; by++)
+            for (int bx = 0; bx < blocksX; bx++)
+            {
+                unsigned char* out = &blocks[(static_cast<size_t>(by) * blocksX + bx) * bytes];
+                FetchBlock(pixels, width, height, channels, bx, by, block);
+
+                switch (format)
+                {
+                    case block_format::bc4: EncodeBc4(block, 0, out); break;
+                    case block_format::bc5: EncodeBc4(block, 0, out); EncodeBc4(block, 1, out + 8); break;
+                    case block_format::bc7: EncodeBc7(block, out); break;
+                }
+            }
+
+        return blocks;
+    }
+}
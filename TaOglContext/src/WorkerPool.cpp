@@ -0,0 +1,56 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+namespace tao_concurrency
+{
+    WorkerPool::WorkerPool(unsigned int threadCount)
+    {
+        // One core left to the render thread
+        if (threadCount == 0) threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+        _threads.reserve(threadCount);
+        for (unsigned int t = 0; t < threadCount; t++)
+            _threads.emplace_back(&WorkerPool::Run, this);
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard lock{_mutex};
+            _stopping = true;
+            _jobs.clear();
+        }
+        _wake.notify_all();
+
+        for (auto& t : _threads) t.join();
+    }
+
+    void WorkerPool::Submit(std::function<void()> job)
+    {
+        {
+            std::lock_guard lock{_mutex};
+            _jobs.push_back(std::move(job));
+        }
+        _wake.notify_one();
+    }
+
+    void WorkerPool::Run()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock lock{_mutex};
+                _wake.wait(lock, [this]{ return _stopping || !_jobs.empty(); });
+
+                if (_stopping) return;
+
+                job = std::move(_jobs.front());
+                _jobs.pop_front();
+            }
+
+            job();
+        }
+    }
+}
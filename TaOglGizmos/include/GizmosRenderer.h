@@ -76,6 +76,10 @@ namespace tao_gizmos
 		bool		 selectable = true;
 	};
 
+	// GPU array with one element for each instance
+	template<typename GpuT>
+	using InstanceSsbo = tao_render_context::SyncedBuffer<gizmo_instance_descriptor, GpuT>;
+
 	// TODO: virtual destructor and deleted methods
 	class Gizmo
 	{
@@ -96,8 +100,15 @@ namespace tao_gizmos
 			_instanceCount = instances.size();
 			_instanceData  = instances;
 		};
+		virtual void									SetInstance(unsigned int index, const gizmo_instance_descriptor& instance)
+		{
+			_instanceData[index] = instance;
+		};
 		const std::vector<gizmo_instance_descriptor>&	GetInstanceData()const { return _instanceData; }
 
+		// uploads the instance data changed since the last call
+		virtual void									SyncInstanceData() {};
+
 		// zoom invariance
 		// ---------------------------------------------------
 		bool  _isZoomInvariant = false;
@@ -205,10 +216,10 @@ namespace tao_gizmos
 		// graphics data -----------------
 		unsigned int _vertexCount = 0;
 		tao_render_context::ResizableVbo			   _vbo;
-        tao_render_context::ResizableSsbo			   _ssboInstanceColor;
-        tao_render_context::ResizableSsbo			   _ssboInstanceTransform;
-        tao_render_context::ResizableSsbo			   _ssboInstanceVisibility;
-        tao_render_context::ResizableSsbo			   _ssboInstanceSelectability;
+        InstanceSsbo<glm::vec4>          			   _ssboInstanceColor;
+        InstanceSsbo<glm::mat4>          			   _ssboInstanceTransform;
+        InstanceSsbo<unsigned int>       			   _ssboInstanceVisibility;
+        InstanceSsbo<unsigned int>       			   _ssboInstanceSelectability;
 		tao_ogl_resources::OglVertexAttribArray        _vao;
 		std::optional<tao_ogl_resources::OglTexture2D> _symbolAtlas;
 		
@@ -220,6 +231,8 @@ namespace tao_gizmos
 		// this will be called by GizomsRenderer instances
 		PointGizmo(tao_render_context::RenderContext& rc, const point_gizmo_descriptor& desc);
 		void SetInstanceData(const std::vector<gizmo_instance_descriptor>& instances) override;
+		void SetInstance(unsigned int index, const gizmo_instance_descriptor& instance) override;
+		void SyncInstanceData() override;
 		
 	};
 
@@ -290,10 +303,10 @@ namespace tao_gizmos
 		// -----------------------------
 		unsigned int _vertexCount = 0;
 		tao_render_context::ResizableVbo			   _vbo;
-		tao_render_context::ResizableSsbo			   _ssboInstanceColor;
-		tao_render_context::ResizableSsbo			   _ssboInstanceTransform;
-		tao_render_context::ResizableSsbo			   _ssboInstanceVisibility;
-		tao_render_context::ResizableSsbo			   _ssboInstanceSelectability;
+		InstanceSsbo<glm::vec4>          			   _ssboInstanceColor;
+		InstanceSsbo<glm::mat4>          			   _ssboInstanceTransform;
+		InstanceSsbo<unsigned int>       			   _ssboInstanceVisibility;
+		InstanceSsbo<unsigned int>       			   _ssboInstanceSelectability;
 		tao_ogl_resources::OglVertexAttribArray        _vao;
 		std::optional<tao_ogl_resources::OglTexture2D> _patternTexture;
 
@@ -313,6 +326,8 @@ namespace tao_gizmos
 		LineListGizmo(tao_render_context::RenderContext& rc, const line_list_gizmo_descriptor& desc);
         void SetGizmoVertices(const std::vector<LineGizmoVertex>& instances);
 		void SetInstanceData(const std::vector<gizmo_instance_descriptor>& instances) override;
+		void SetInstance(unsigned int index, const gizmo_instance_descriptor& instance) override;
+		void SyncInstanceData() override;
 
 	};
 
@@ -341,10 +356,10 @@ namespace tao_gizmos
         static constexpr int kVertSize = 7 * sizeof(float);
 
 		tao_render_context::ResizableVbo				_vboVertices;
-		tao_render_context::ResizableSsbo				_ssboInstanceColor;
-		tao_render_context::ResizableSsbo				_ssboInstanceTransform;
-		tao_render_context::ResizableSsbo			    _ssboInstanceVisibility;
-		tao_render_context::ResizableSsbo			    _ssboInstanceSelectability;
+		InstanceSsbo<glm::vec4>          				_ssboInstanceColor;
+		InstanceSsbo<glm::mat4>          				_ssboInstanceTransform;
+		InstanceSsbo<unsigned int>       			    _ssboInstanceVisibility;
+		InstanceSsbo<unsigned int>       			    _ssboInstanceSelectability;
         tao_render_context::ResizableSsbo               _ssboScreenLength;
 		tao_ogl_resources::OglVertexAttribArray			_vao;
 		std::optional<tao_ogl_resources::OglTexture2D>  _patternTexture;
@@ -358,6 +373,8 @@ namespace tao_gizmos
 		LineStripGizmo(tao_render_context::RenderContext& rc, const line_strip_gizmo_descriptor& desc);
         void SetGizmoVertices(const std::vector<LineGizmoVertex>& vertices, bool isLoop);
 		void SetInstanceData(const std::vector<gizmo_instance_descriptor>& instances) override;
+		void SetInstance(unsigned int index, const gizmo_instance_descriptor& instance) override;
+		void SyncInstanceData() override;
 		
 	};
 
@@ -439,6 +456,12 @@ namespace tao_gizmos
 	{
 		friend class GizmosRenderer;
 	private:
+		struct instance_nrm_mat_and_color
+		{
+			glm::mat4 normalMatrix;
+			glm::vec4 color;
+		};
+
 		unsigned int _vertexCount				= 0;
 		unsigned int _trisCount					= 0;
 		
@@ -458,17 +481,20 @@ namespace tao_gizmos
 
 		tao_render_context::ResizableVbo		    _vboVertices;
 		tao_render_context::ResizableEbo			_ebo;
-		tao_render_context::ResizableSsbo			_ssboInstanceTransform;
-		tao_render_context::ResizableSsbo			_ssboInstanceVisibility;
-		tao_render_context::ResizableSsbo			_ssboInstanceSelectability;
-		tao_render_context::ResizableSsbo			_ssboInstanceColorAndNrmMat;
+		InstanceSsbo<glm::mat4>          			_ssboInstanceTransform;
+		InstanceSsbo<unsigned int>       			_ssboInstanceVisibility;
+		InstanceSsbo<unsigned int>       			_ssboInstanceSelectability;
+		InstanceSsbo<instance_nrm_mat_and_color>			_ssboInstanceColorAndNrmMat;
 		tao_ogl_resources::OglVertexAttribArray		_vao;
 
 		// this will be called by GizomsRenderer instances
 		MeshGizmo(tao_render_context::RenderContext& rc, const mesh_gizmo_descriptor& desc);
         void SetGizmoVertices(const std::vector<MeshGizmoVertex>& vertices, const std::vector<int>* triangles);
 		void SetInstanceData(const std::vector<gizmo_instance_descriptor>& instances) override;
+		void SetInstance(unsigned int index, const gizmo_instance_descriptor& instance) override;
+		void SyncInstanceData() override;
 
+		static instance_nrm_mat_and_color InstanceNrmMatAndColor(const gizmo_instance_descriptor& d);
 	};
 
 	constexpr tao_ogl_resources::ogl_depth_state GetDefaultDepthState()
@@ -611,11 +637,14 @@ namespace tao_gizmos
 		tao_ogl_resources::OglShaderProgram _meshShaderForSelection;
 		void InitShadersForSelection();
 
-		tao_ogl_resources::OglUniformBuffer _pointsObjDataUbo;
-		tao_ogl_resources::OglUniformBuffer _linesObjDataUbo;
-		tao_ogl_resources::OglUniformBuffer _lineStripObjDataUbo;
-		tao_ogl_resources::OglUniformBuffer _meshObjDataUbo;
-		tao_ogl_resources::OglUniformBuffer _frameDataUbo;
+		// Frame and per-gizmo uniform blocks, Render and
+		// GetGizmoUnderCursor each take a partition.
+		tao_ogl_resources::PersistentRingBuffer _frameRing;
+		static constexpr GLsizeiptr FRAME_RING_PARTITION_SIZE = 1 << 20;
+		static constexpr int        FRAME_RING_PARTITIONS     = 4;
+		// Grows the ring (before BeginFrame) if a block for each
+		// gizmo in each of the `passes` doesn't fit a partition.
+		void ReserveFrameRing(std::size_t passes);
 
 		tao_render_context::ResizableSsbo _selectionColorSsbo;
 
@@ -32,6 +32,12 @@ namespace tao_gizmos
 		}
 	}
 
+	// Instance data layouts (see InstanceSsbo)
+	mat4		 InstanceTransform		(const gizmo_instance_descriptor& d) { return d.transform;	}
+	vec4		 InstanceColor			(const gizmo_instance_descriptor& d) { return d.color;		}
+	unsigned int InstanceVisibility		(const gizmo_instance_descriptor& d) { return d.visible;	}
+	unsigned int InstanceSelectability	(const gizmo_instance_descriptor& d) { return d.selectable; }
+
 	 PointGizmo::PointGizmo(RenderContext& rc, const point_gizmo_descriptor& desc):
 		_vertexCount			{ static_cast<unsigned int>(desc.vertices.size())},
 		_vbo{rc, 0,
@@ -40,25 +46,25 @@ namespace tao_gizmos
 			: buf_usg_dynamic_draw
 			, ResizeBufferPolicy },
 
-		_ssboInstanceColor{rc, 0,
+		_ssboInstanceColor{rc,
 			desc.usage_hint == gizmo_usage_hint::usage_static
 			? buf_usg_static_draw
-			: buf_usg_dynamic_draw, ResizeBufferPolicy},
+			: buf_usg_dynamic_draw, InstanceColor },
 
-		_ssboInstanceTransform{rc, 0,
+		_ssboInstanceTransform{rc,
 			desc.zoom_invariant || desc.usage_hint == gizmo_usage_hint::usage_dynamic		// Zoom invariance means we must update
 			? buf_usg_dynamic_draw															// the transform list whenever the view/proj
-			: buf_usg_static_draw, ResizeBufferPolicy },										// matrix changes -> `dynamic` hint.
+			: buf_usg_static_draw, InstanceTransform },										// matrix changes -> `dynamic` hint.
 																								
-		 _ssboInstanceVisibility	{rc, 0,
+		 _ssboInstanceVisibility	{rc,
 		 	desc.usage_hint == gizmo_usage_hint::usage_dynamic 
 			? buf_usg_dynamic_draw
-			: buf_usg_static_draw, ResizeBufferPolicy },
+			: buf_usg_static_draw, InstanceVisibility },
 
-		_ssboInstanceSelectability {rc, 0,
+		_ssboInstanceSelectability {rc,
 		 	desc.usage_hint == gizmo_usage_hint::usage_dynamic 
 			? buf_usg_dynamic_draw
-			: buf_usg_static_draw, ResizeBufferPolicy },
+			: buf_usg_static_draw, InstanceSelectability },
 
 		_vao{rc.CreateVertexAttribArray()},
 		_pointSize(desc.point_half_size),
@@ -105,38 +111,29 @@ namespace tao_gizmos
 	 {
 		Gizmo::SetInstanceData(instances);
 
-		std::vector<glm::mat4> transformations (_instanceCount);
-		std::vector<glm::vec4> colors		   (_instanceCount);
-		std::vector<unsigned int> visibility   (_instanceCount);
-		std::vector<unsigned int> selectability(_instanceCount);
+		// uploaded by SyncInstanceData()
+		_ssboInstanceTransform		.Assign(instances);
+		_ssboInstanceColor			.Assign(instances);
+		_ssboInstanceVisibility		.Assign(instances);
+		_ssboInstanceSelectability	.Assign(instances);
+	 }
 
-		for(int i=0;i<_instanceCount; i++)
-		{
-			transformations[i] = _instanceData[i].transform;
-			colors	       [i] = _instanceData[i].color;
-			visibility	   [i] = _instanceData[i].visible;
-			selectability  [i] = _instanceData[i].selectable;
-		}
+	 void PointGizmo::SetInstance(unsigned int index, const gizmo_instance_descriptor& instance)
+	 {
+		Gizmo::SetInstance(index, instance);
 
-		 // Set instance transformation data
-		 unsigned int dataSize = _instanceCount * sizeof(float) * 16;
-		 _ssboInstanceTransform.Resize(dataSize);
-		 _ssboInstanceTransform.OglBuffer().SetSubData(0, dataSize, transformations.data());
-
-		 // Set instance color data
-		 dataSize = _instanceCount * sizeof(float) * 4;
-		 _ssboInstanceColor.Resize(dataSize);
-		 _ssboInstanceColor.OglBuffer().SetSubData(0, dataSize, colors.data());
-
-		 // Set visibility data
-		 dataSize = _instanceCount * sizeof(unsigned int);
-		 _ssboInstanceVisibility.Resize(dataSize);
-		 _ssboInstanceVisibility.OglBuffer().SetSubData(0, dataSize, visibility.data());
-
-		 // Set selectability data
-		 dataSize = _instanceCount * sizeof(unsigned int);
-		 _ssboInstanceSelectability.Resize(dataSize);
-		 _ssboInstanceSelectability.OglBuffer().SetSubData(0, dataSize, selectability.data());
+		_ssboInstanceTransform		.Set(index, instance);
+		_ssboInstanceColor			.Set(index, instance);
+		_ssboInstanceVisibility		.Set(index, instance);
+		_ssboInstanceSelectability	.Set(index, instance);
+	 }
+
+	 void PointGizmo::SyncInstanceData()
+	 {
+		_ssboInstanceTransform		.Flush();
+		_ssboInstanceColor			.Flush();
+		_ssboInstanceVisibility		.Flush();
+		_ssboInstanceSelectability	.Flush();
 	 }
 
     void LineListGizmo::SetGizmoVertices(const std::vector<LineGizmoVertex> &vertices)
@@ -154,25 +151,25 @@ namespace tao_gizmos
 			? buf_usg_static_draw
 			: buf_usg_dynamic_draw, ResizeBufferPolicy },
 
-		 _ssboInstanceColor		{rc, 0,
+		 _ssboInstanceColor		{rc,
 			desc.usage_hint == gizmo_usage_hint::usage_static
 			? buf_usg_static_draw
-			: buf_usg_dynamic_draw, ResizeBufferPolicy },
+			: buf_usg_dynamic_draw, InstanceColor },
 
-		 _ssboInstanceTransform	{rc, 0,													    // Zoom invariance means we must update
+		 _ssboInstanceTransform	{rc,													    // Zoom invariance means we must update
 			desc.zoom_invariant || desc.usage_hint == gizmo_usage_hint::usage_dynamic		// the transform list whenever the view/proj  
 			? ogl_buffer_usage::buf_usg_dynamic_draw										// matrix changes -> `dynamic` hint.
-		 	: ogl_buffer_usage::buf_usg_static_draw, ResizeBufferPolicy },
+		 	: ogl_buffer_usage::buf_usg_static_draw, InstanceTransform },
 
-		 _ssboInstanceVisibility	{rc, 0,
+		 _ssboInstanceVisibility	{rc,
 		 	desc.usage_hint == gizmo_usage_hint::usage_dynamic 
 			? buf_usg_dynamic_draw
-			: buf_usg_static_draw, ResizeBufferPolicy },
+			: buf_usg_static_draw, InstanceVisibility },
 
-		_ssboInstanceSelectability {rc, 0,
+		_ssboInstanceSelectability {rc,
 		 	desc.usage_hint == gizmo_usage_hint::usage_dynamic 
 			? buf_usg_dynamic_draw
-			: buf_usg_static_draw, ResizeBufferPolicy },
+			: buf_usg_static_draw, InstanceSelectability },
 
 		 _vao					{ rc.CreateVertexAttribArray() },
 		 _lineSize				{ desc.line_size    },
@@ -212,40 +209,31 @@ namespace tao_gizmos
 
 	 void LineListGizmo::SetInstanceData(const vector<gizmo_instance_descriptor>& instances)
 	 {
-		 Gizmo::SetInstanceData(instances);
+		Gizmo::SetInstanceData(instances);
 
-		 std::vector<glm::mat4> transformations(_instanceCount);
-		std::vector<glm::vec4> colors		   (_instanceCount);
-		std::vector<unsigned int> visibility   (_instanceCount);
-        std::vector<unsigned int> selectability(_instanceCount);
+		// uploaded by SyncInstanceData()
+		_ssboInstanceTransform		.Assign(instances);
+		_ssboInstanceColor			.Assign(instances);
+		_ssboInstanceVisibility		.Assign(instances);
+		_ssboInstanceSelectability	.Assign(instances);
+	 }
 
-		for(int i=0;i<_instanceCount; i++)
-		{
-			transformations[i] = _instanceData[i].transform;
-			colors	       [i] = _instanceData[i].color;
-			visibility	   [i] = _instanceData[i].visible;
-            selectability  [i] = _instanceData[i].selectable;
-		}
+	 void LineListGizmo::SetInstance(unsigned int index, const gizmo_instance_descriptor& instance)
+	 {
+		Gizmo::SetInstance(index, instance);
 
-		 // Set instance transformation data
-		 unsigned int dataSize = _instanceCount * sizeof(float) * 16;
-		 _ssboInstanceTransform.Resize(dataSize);
-		 _ssboInstanceTransform.OglBuffer().SetSubData(0, dataSize, transformations.data());
-
-		 // Set instance color data
-		 dataSize = _instanceCount * sizeof(float) * 4;
-		 _ssboInstanceColor.Resize(dataSize);
-		 _ssboInstanceColor.OglBuffer().SetSubData(0, dataSize, colors.data());
-
-		// Set visibility data
-		 dataSize = _instanceCount * sizeof(unsigned int);
-		 _ssboInstanceVisibility.Resize(dataSize);
-		 _ssboInstanceVisibility.OglBuffer().SetSubData(0, dataSize, visibility.data());
-
-         // Set selectability data
-         dataSize = _instanceCount * sizeof(unsigned int);
-         _ssboInstanceSelectability.Resize(dataSize);
-         _ssboInstanceSelectability.OglBuffer().SetSubData(0, dataSize, selectability.data());
+		_ssboInstanceTransform		.Set(index, instance);
+		_ssboInstanceColor			.Set(index, instance);
+		_ssboInstanceVisibility		.Set(index, instance);
+		_ssboInstanceSelectability	.Set(index, instance);
+	 }
+
+	 void LineListGizmo::SyncInstanceData()
+	 {
+		_ssboInstanceTransform		.Flush();
+		_ssboInstanceColor			.Flush();
+		_ssboInstanceVisibility		.Flush();
+		_ssboInstanceSelectability	.Flush();
 	 }
 
     void LineStripGizmo::SetGizmoVertices(const std::vector<LineGizmoVertex> &vertices, bool isLoop)
@@ -298,25 +286,25 @@ namespace tao_gizmos
 			? buf_usg_static_draw
 			: buf_usg_dynamic_draw, ResizeBufferPolicy },
 
-		 _ssboInstanceColor		{rc, 0,
+		 _ssboInstanceColor		{rc,
 			desc.usage_hint == gizmo_usage_hint::usage_static
 			? buf_usg_static_draw
-			: buf_usg_dynamic_draw, ResizeBufferPolicy },
+			: buf_usg_dynamic_draw, InstanceColor },
 
-		 _ssboInstanceTransform{rc, 0,
+		 _ssboInstanceTransform{rc,
 			desc.zoom_invariant || desc.usage_hint == gizmo_usage_hint::usage_dynamic
 		 	? ogl_buffer_usage::buf_usg_dynamic_draw
-			: ogl_buffer_usage::buf_usg_static_draw, ResizeBufferPolicy },
+			: ogl_buffer_usage::buf_usg_static_draw, InstanceTransform },
 
-		 _ssboInstanceVisibility	{rc, 0,
+		 _ssboInstanceVisibility	{rc,
 		 	desc.usage_hint == gizmo_usage_hint::usage_dynamic 
 			? buf_usg_dynamic_draw
-			: buf_usg_static_draw, ResizeBufferPolicy },
+			: buf_usg_static_draw, InstanceVisibility },
 
-		 _ssboInstanceSelectability {rc, 0,
+		 _ssboInstanceSelectability {rc,
 		 	desc.usage_hint == gizmo_usage_hint::usage_dynamic 
 			? buf_usg_dynamic_draw
-			: buf_usg_static_draw, ResizeBufferPolicy },
+			: buf_usg_static_draw, InstanceSelectability },
 
          _ssboScreenLength {rc, 0,
              desc.usage_hint == gizmo_usage_hint::usage_dynamic
@@ -365,38 +353,29 @@ namespace tao_gizmos
 	 {
 		Gizmo::SetInstanceData(instances);
 
-		std::vector<glm::mat4> transformations (_instanceCount);
-		std::vector<glm::vec4> colors		   (_instanceCount);
-		std::vector<unsigned int> visibility   (_instanceCount);
-		std::vector<unsigned int> selectability(_instanceCount);
+		// uploaded by SyncInstanceData()
+		_ssboInstanceTransform		.Assign(instances);
+		_ssboInstanceColor			.Assign(instances);
+		_ssboInstanceVisibility		.Assign(instances);
+		_ssboInstanceSelectability	.Assign(instances);
+	 }
+
+	 void LineStripGizmo::SetInstance(unsigned int index, const gizmo_instance_descriptor& instance)
+	 {
+		Gizmo::SetInstance(index, instance);
 
-		for(int i=0;i<_instanceCount; i++)
-		{
-			transformations[i] = _instanceData[i].transform;
-			colors	       [i] = _instanceData[i].color;
-			visibility	   [i] = _instanceData[i].visible;
-			selectability  [i] = _instanceData[i].selectable;
-		}
+		_ssboInstanceTransform		.Set(index, instance);
+		_ssboInstanceColor			.Set(index, instance);
+		_ssboInstanceVisibility		.Set(index, instance);
+		_ssboInstanceSelectability	.Set(index, instance);
+	 }
 
-		 // Set instance transformation data
-		 unsigned int dataSize = _instanceCount * sizeof(float) * 16;
-		 _ssboInstanceTransform.Resize(dataSize);
-		 _ssboInstanceTransform.OglBuffer().SetSubData(0, dataSize, transformations.data());
-
-		 // Set instance color data
-		 dataSize = _instanceCount * sizeof(float) * 4;
-		 _ssboInstanceColor.Resize(dataSize);
-		 _ssboInstanceColor.OglBuffer().SetSubData(0, dataSize, colors.data());
-
-		 // Set visibility data
-		 dataSize = _instanceCount * sizeof(unsigned int);
-		 _ssboInstanceVisibility.Resize(dataSize);
-		 _ssboInstanceVisibility.OglBuffer().SetSubData(0, dataSize, visibility.data());
-
-		 // Set selectability data
-		 dataSize = _instanceCount * sizeof(unsigned int);
-		 _ssboInstanceSelectability.Resize(dataSize);
-		 _ssboInstanceSelectability.OglBuffer().SetSubData(0, dataSize, selectability.data());
+	 void LineStripGizmo::SyncInstanceData()
+	 {
+		_ssboInstanceTransform		.Flush();
+		_ssboInstanceColor			.Flush();
+		_ssboInstanceVisibility		.Flush();
+		_ssboInstanceSelectability	.Flush();
 	 }
 
     void MeshGizmo::SetGizmoVertices(const std::vector<MeshGizmoVertex> &vertices, const std::vector<int>* triangles)
@@ -446,25 +425,25 @@ namespace tao_gizmos
 										? buf_usg_static_draw
 										: buf_usg_dynamic_draw, ResizeBufferPolicy },
 
-		 _ssboInstanceTransform		{rc, 0,
+		 _ssboInstanceTransform		{rc,
 		 	desc.usage_hint == gizmo_usage_hint::usage_dynamic || desc.zoom_invariant
 										? buf_usg_dynamic_draw
-										: buf_usg_static_draw, ResizeBufferPolicy },
+										: buf_usg_static_draw, InstanceTransform },
 
-		 _ssboInstanceVisibility	{rc, 0,
+		 _ssboInstanceVisibility	{rc,
 		 	desc.usage_hint == gizmo_usage_hint::usage_dynamic 
 										? buf_usg_dynamic_draw
-										: buf_usg_static_draw, ResizeBufferPolicy },
+										: buf_usg_static_draw, InstanceVisibility },
 
-		 _ssboInstanceSelectability {rc, 0,
+		 _ssboInstanceSelectability {rc,
 		 	desc.usage_hint == gizmo_usage_hint::usage_dynamic 
 										? buf_usg_dynamic_draw
-										: buf_usg_static_draw, ResizeBufferPolicy },
+										: buf_usg_static_draw, InstanceSelectability },
 
-		 _ssboInstanceColorAndNrmMat{rc, 0,
+		 _ssboInstanceColorAndNrmMat{rc,
 			desc.usage_hint == gizmo_usage_hint::usage_static
 										? buf_usg_static_draw
-										: buf_usg_dynamic_draw, ResizeBufferPolicy },
+										: buf_usg_dynamic_draw, InstanceNrmMatAndColor },
 
 		 _vao{ rc.CreateVertexAttribArray() }
 	  {
@@ -487,56 +466,42 @@ namespace tao_gizmos
           SetGizmoVertices(desc.vertices, desc.triangles);
 	 }
 
+	 MeshGizmo::instance_nrm_mat_and_color MeshGizmo::InstanceNrmMatAndColor(const gizmo_instance_descriptor& d)
+	 {
+		 return instance_nrm_mat_and_color
+		 {
+			 .normalMatrix = inverse(transpose(d.transform)),
+			 .color		   = d.color
+		 };
+	 }
+
 	 void MeshGizmo::SetInstanceData(const vector<gizmo_instance_descriptor>& instances)
 	 {
-		 Gizmo::SetInstanceData(instances);
+		Gizmo::SetInstanceData(instances);
 
-		 vector<mat4> transformations		(_instanceCount);
-		 vector<vec4> colors				(_instanceCount);
-		 vector<unsigned int> visiblity		(_instanceCount);
-		 vector<unsigned int> selectability (_instanceCount);
+		// uploaded by SyncInstanceData()
+		_ssboInstanceTransform		.Assign(instances);
+		_ssboInstanceVisibility		.Assign(instances);
+		_ssboInstanceSelectability	.Assign(instances);
+		_ssboInstanceColorAndNrmMat	.Assign(instances);
+	 }
 
-		 for(int i=0;i<_instanceCount;i++)
-		 {
-			 transformations[i] = instances[i].transform;
-			 colors			[i] = instances[i].color;
-			 visiblity      [i] = instances[i].visible;
-			 selectability  [i] = instances[i].selectable;
-		 }
+	 void MeshGizmo::SetInstance(unsigned int index, const gizmo_instance_descriptor& instance)
+	 {
+		Gizmo::SetInstance(index, instance);
+
+		_ssboInstanceTransform		.Set(index, instance);
+		_ssboInstanceVisibility		.Set(index, instance);
+		_ssboInstanceSelectability	.Set(index, instance);
+		_ssboInstanceColorAndNrmMat	.Set(index, instance);
+	 }
 
-		// Instance data:
-		// mat4 transform - mat4 normal matrix - vec4 color - uint visibility - uint selectability
-		// [ ---buff0--- ]  [ ---------buff1------------- ]	 [ ----buff2---- ] [ -----buff3------ ] 
-		//   per-frame					constant			      constant			 constant
-		// (zoom invariance)
-		//    
-
-		// Transform
-		unsigned int dataSize = _instanceCount * sizeof(float) * 16;
-		_ssboInstanceTransform.Resize(dataSize);
-		_ssboInstanceTransform.OglBuffer().SetSubData(0, dataSize, transformations.data());
-
-		// Visibility
-		dataSize = _instanceCount * sizeof(unsigned int);
-		_ssboInstanceVisibility.Resize(dataSize);
-		_ssboInstanceVisibility.OglBuffer().SetSubData(0, dataSize, visiblity.data());
-
-		// Selectability
-		dataSize = _instanceCount * sizeof(unsigned int);
-		_ssboInstanceSelectability.Resize(dataSize);
-		_ssboInstanceSelectability.OglBuffer().SetSubData(0, dataSize, selectability.data());
-
-		// Normal matrix and Color
-		vector<glm::mat4> normalMatrices{ _instanceCount };
-		for (int i = 0; i < _instanceCount; i++) normalMatrices[i] = inverse(transpose(transformations[i]));
-
-		BufferDataPacker pack{};
-		const auto data = pack
-			.AddDataArray(normalMatrices)
-			.AddDataArray(colors)
-			.InterleavedBuffer();
-		_ssboInstanceColorAndNrmMat.Resize(data.size());
-		_ssboInstanceColorAndNrmMat.OglBuffer().SetSubData(0, data.size(), data.data());
+	 void MeshGizmo::SyncInstanceData()
+	 {
+		_ssboInstanceTransform		.Flush();
+		_ssboInstanceVisibility		.Flush();
+		_ssboInstanceSelectability	.Flush();
+		_ssboInstanceColorAndNrmMat	.Flush();
 	 }
 
 	 RenderLayer GizmosRenderer::DefaultLayer()
@@ -657,11 +622,7 @@ namespace tao_gizmos
 		 _linesShaderForSelection	  (GizmosShaderLib::CreateShaderProgram(rc, gizmos_shader_type::lines       , gizmos_shader_modifier::selection , SHADER_SRC_DIR)),
 		 _lineStripShaderForSelection (GizmosShaderLib::CreateShaderProgram(rc, gizmos_shader_type::lineStrip   , gizmos_shader_modifier::selection , SHADER_SRC_DIR)),
 		 _meshShaderForSelection	  (GizmosShaderLib::CreateShaderProgram(rc, gizmos_shader_type::mesh		 , gizmos_shader_modifier::selection , SHADER_SRC_DIR)),
-		 _pointsObjDataUbo	 (rc.CreateUniformBuffer()),
-		 _linesObjDataUbo	 (rc.CreateUniformBuffer()),
-		 _lineStripObjDataUbo(rc.CreateUniformBuffer()),
-		 _meshObjDataUbo     (rc.CreateUniformBuffer()),
-		 _frameDataUbo		 (rc.CreateUniformBuffer()),
+		 _frameRing			 (rc.CreatePersistentRingBuffer(FRAME_RING_PARTITION_SIZE, FRAME_RING_PARTITIONS)),
 		 _selectionColorSsbo {rc, 0, buf_usg_dynamic_draw, ResizeBufferPolicy },
 		  _selectionPBOs	 {},
 		 _nearestSampler	 (rc.CreateSampler()),
@@ -703,14 +664,6 @@ namespace tao_gizmos
 		 InitShaders();
 		 InitShadersForSelection();
 
-		 // uniform buffers
-		 // -----------------------------------------
-		 _pointsObjDataUbo	  .SetData(sizeof(points_obj_data_block)	 , nullptr, buf_usg_static_draw);
-		 _linesObjDataUbo	  .SetData(sizeof(lines_obj_data_block)		 , nullptr, buf_usg_static_draw);
-		 _lineStripObjDataUbo .SetData(sizeof(line_strip_obj_data_block), nullptr, buf_usg_static_draw);
-		 _meshObjDataUbo      .SetData(sizeof(mesh_obj_data_block)      , nullptr, buf_usg_static_draw);
-		 _frameDataUbo		  .SetData(sizeof(frame_data_block)			 , nullptr, buf_usg_static_draw);
-
 		// samplers
 		// -----------------------------------------
 		 _nearestSampler.SetParams(ogl_sampler_params{
@@ -968,22 +921,16 @@ namespace tao_gizmos
 			gzm = &_lineStripGizmos.at(kLineStrip);
 		}
 		
-		// 1. copy current data
-		// 2. edit only the instance data identified by the keys in `instances`
-		// 3. send all the data (old+new) to the GPU
-		std::vector<gizmo_instance_descriptor> newInstData	= gzm->GetInstanceData();
-		
+		// only the edited instances are marked for upload,
+		// the GPU data is synced before the next draw
 		for (int i = 0; i < instances.size(); i++)
 		{
-			const unsigned int index = instances[i].first._instanceKey;
-
-			if (index >= newInstData.size())
+			if (instances[i].first._instanceKey >= gzm->GetInstanceData().size())
 				throw std::runtime_error{ "Invalid gizmo instance id." };
-
-			newInstData[index]	= instances[i].second;
 		}
 
-		gzm->SetInstanceData(newInstData);
+		for (int i = 0; i < instances.size(); i++)
+			gzm->SetInstance(instances[i].first._instanceKey, instances[i].second);
 	}
 
 	gizmo_id GizmosRenderer::CreateLineGizmo(const line_list_gizmo_descriptor& desc)
@@ -1231,8 +1178,10 @@ namespace tao_gizmos
 	void GizmosRenderer::ProcessPointGizmos(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
 	{
 		for (auto& pGzm : _pointGizmos)
-		if (pGzm.second._isZoomInvariant)
 		{
+			pGzm.second.SyncInstanceData();
+			if (!pGzm.second._isZoomInvariant) continue;
+
 			vector<mat4> newTransf =
 				ComputeZoomInvarianceTransformations(
 					pGzm.second._zoomInvariantScale,
@@ -1244,8 +1193,6 @@ namespace tao_gizmos
 
 	void GizmosRenderer::RenderPointGizmos(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const RenderPass& currentPass)
 	{
-		_pointsObjDataUbo.Bind(POINTS_OBJ_DATA_BINDING);
-
 		for (auto& pGzm : _pointGizmos)
 		{
             if(pGzm.second._instanceCount==0) continue;
@@ -1267,7 +1214,7 @@ namespace tao_gizmos
 				.has_texture = hasTexture
 			};
 
-			_pointsObjDataUbo.SetSubData(0, sizeof(points_obj_data_block), &objData);
+			_frameRing.BindUniformRange(POINTS_OBJ_DATA_BINDING, _frameRing.Write(&objData, sizeof(points_obj_data_block)));
 
 			// bind static instance data SSBO (draw instanced)
 			pGzm.second._ssboInstanceColor.OglBuffer().Bind(INSTANCE_DATA_STATIC_SSBO_BINDING);
@@ -1301,8 +1248,6 @@ namespace tao_gizmos
 
 	void GizmosRenderer::RenderPointGizmosForSelection(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const std::function<void(unsigned int)>& preDrawFunc)
 	{
-		_pointsObjDataUbo.Bind(POINTS_OBJ_DATA_BINDING);
-
 		for (auto& pGzm : _pointGizmos)
 		{
             if (pGzm.second._instanceCount == 0)continue;
@@ -1326,7 +1271,7 @@ namespace tao_gizmos
 
 			preDrawFunc(pGzm.second._instanceCount);
 
-			_pointsObjDataUbo.SetSubData(0, sizeof(points_obj_data_block), &objData);
+			_frameRing.BindUniformRange(POINTS_OBJ_DATA_BINDING, _frameRing.Write(&objData, sizeof(points_obj_data_block)));
 
 			// bind static instance data SSBO (draw instanced)
 			pGzm.second._ssboInstanceColor			.OglBuffer().Bind(INSTANCE_DATA_STATIC_SSBO_BINDING);
@@ -1352,21 +1297,21 @@ namespace tao_gizmos
 	void GizmosRenderer::ProcessLineListGizmos(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
 	{
 		for (auto& lGzm : _lineGizmos)
-			if (lGzm.second._isZoomInvariant)
-			{
-				vector<mat4> newTransf =
-					ComputeZoomInvarianceTransformations(
-						lGzm.second._zoomInvariantScale,
-						viewMatrix, projectionMatrix, lGzm.second._instanceData
-					);
-				lGzm.second._ssboInstanceTransform.OglBuffer().SetSubData(0, newTransf.size() * 16 /*mat4*/ * sizeof(float), newTransf.data());
-			}
+		{
+			lGzm.second.SyncInstanceData();
+			if (!lGzm.second._isZoomInvariant) continue;
+
+			vector<mat4> newTransf =
+				ComputeZoomInvarianceTransformations(
+					lGzm.second._zoomInvariantScale,
+					viewMatrix, projectionMatrix, lGzm.second._instanceData
+				);
+			lGzm.second._ssboInstanceTransform.OglBuffer().SetSubData(0, newTransf.size() * 16 /*mat4*/ * sizeof(float), newTransf.data());
+		}
 	}
 
 	void GizmosRenderer::RenderLineGizmos(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const RenderPass& currentPass)
 	 {
-		_linesObjDataUbo.Bind(LINES_OBJ_DATA_BINDING);
-
 		for (auto& lGzm : _lineGizmos)
 		{
             if(lGzm.second._instanceCount==0) continue;
@@ -1385,7 +1330,7 @@ namespace tao_gizmos
 				.pattern_size	= lGzm.second._patternSize
 			};
 
-			_linesObjDataUbo.SetSubData(0, sizeof(lines_obj_data_block), &objData);
+			_frameRing.BindUniformRange(LINES_OBJ_DATA_BINDING, _frameRing.Write(&objData, sizeof(lines_obj_data_block)));
 			
 			// bind static instance data SSBO (draw instanced)
 			lGzm.second._ssboInstanceColor		.OglBuffer().Bind(INSTANCE_DATA_STATIC_SSBO_BINDING);
@@ -1413,8 +1358,6 @@ namespace tao_gizmos
 
 	void GizmosRenderer::RenderLineGizmosForSelection(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const std::function<void(unsigned int)>& preDrawFunc)
 	 {
-		_linesObjDataUbo.Bind(LINES_OBJ_DATA_BINDING);
-
 		for (auto& lGzm : _lineGizmos)
 		{
             if(lGzm.second._instanceCount==0) continue;
@@ -1435,7 +1378,7 @@ namespace tao_gizmos
 
 			preDrawFunc(lGzm.second._instanceCount);
 
-			_linesObjDataUbo.SetSubData(0, sizeof(lines_obj_data_block), &objData);
+			_frameRing.BindUniformRange(LINES_OBJ_DATA_BINDING, _frameRing.Write(&objData, sizeof(lines_obj_data_block)));
 			
 			// bind static instance data SSBO (draw instanced)
 			lGzm.second._ssboInstanceColor			.OglBuffer().Bind(INSTANCE_DATA_STATIC_SSBO_BINDING);
@@ -1589,6 +1532,8 @@ namespace tao_gizmos
 		for (auto& pair : _lineStripGizmos)
 		{
 			LineStripGizmo& lGzm = pair.second;
+			lGzm.SyncInstanceData();
+
 			vector<gizmo_instance_descriptor> realTransformList = lGzm._instanceData;
 
 			if (lGzm._isZoomInvariant)
@@ -1619,8 +1564,6 @@ namespace tao_gizmos
 
 	void GizmosRenderer::RenderLineStripGizmos(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const RenderPass& currentPass)
 	{
-		_lineStripObjDataUbo.Bind(LINE_STRIP_OBJ_DATA_BINDING);
-
 		unsigned int vertDrawn = 0;
 		for (auto& lGzm : _lineStripGizmos)
 		{
@@ -1645,7 +1588,7 @@ namespace tao_gizmos
 			};
 
 			// Bind UBO
-			_lineStripObjDataUbo.SetSubData(0, sizeof(line_strip_obj_data_block), &objData);
+			_frameRing.BindUniformRange(LINE_STRIP_OBJ_DATA_BINDING, _frameRing.Write(&objData, sizeof(line_strip_obj_data_block)));
 			// Bind SSBO for screen length sum
             lGzm.second._ssboScreenLength       .OglBuffer().Bind(LINE_STRIP_SCREEN_LENGTH_SSBO_BINDING);
 			// bind static instance data SSBO (draw instanced)
@@ -1676,8 +1619,6 @@ namespace tao_gizmos
 
 	void GizmosRenderer::RenderLineStripGizmosForSelection(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const std::function<void(unsigned int)>& preDrawFunc)
 	{
-        _lineStripObjDataUbo.Bind(LINE_STRIP_OBJ_DATA_BINDING);
-
 		unsigned int vertDrawn = 0;
 		for (auto& lGzm : _lineStripGizmos)
 		{
@@ -1704,7 +1645,7 @@ namespace tao_gizmos
 			preDrawFunc(lGzm.second._instanceCount);
 
 			// Bind UBO
-			_lineStripObjDataUbo.SetSubData(0, sizeof(line_strip_obj_data_block), &objData);
+			_frameRing.BindUniformRange(LINE_STRIP_OBJ_DATA_BINDING, _frameRing.Write(&objData, sizeof(line_strip_obj_data_block)));
 			// Bind SSBO for screen length sum
             lGzm.second._ssboScreenLength           .OglBuffer().Bind(LINE_STRIP_SCREEN_LENGTH_SSBO_BINDING);
 			// bind static instance data SSBO (draw instanced)
@@ -1727,8 +1668,10 @@ namespace tao_gizmos
 	void GizmosRenderer::ProcessMeshGizmos(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
 	{
 		for (auto& mGzm : _meshGizmos)
-		if (mGzm.second._isZoomInvariant)
 		{
+			mGzm.second.SyncInstanceData();
+			if (!mGzm.second._isZoomInvariant) continue;
+
 			vector<glm::mat4> newTransf =
 				ComputeZoomInvarianceTransformations(
 					mGzm.second._zoomInvariantScale,
@@ -1740,8 +1683,6 @@ namespace tao_gizmos
 
 	void GizmosRenderer::RenderMeshGizmos(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const RenderPass& currentPass)
 	{
-		_meshObjDataUbo.Bind(MESH_OBJ_DATA_BINDING);
-
 		for (auto& mGzm : _meshGizmos)
 		{
             if(mGzm.second._instanceCount==0) continue;
@@ -1756,7 +1697,7 @@ namespace tao_gizmos
 				.has_texture = false,
 			};
 
-			_meshObjDataUbo.SetSubData(0, sizeof(mesh_obj_data_block), &objData);
+			_frameRing.BindUniformRange(MESH_OBJ_DATA_BINDING, _frameRing.Write(&objData, sizeof(mesh_obj_data_block)));
 
 			// bind VAO
 			mGzm.second._vao.Bind();
@@ -1795,8 +1736,6 @@ namespace tao_gizmos
 
 	void GizmosRenderer::RenderMeshGizmosForSelection(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const std::function<void(unsigned int)>& preDrawFunc)
 	{
-		_meshObjDataUbo.Bind(MESH_OBJ_DATA_BINDING);
-
 		unsigned int drawnInstances = 0;
 		for (auto& mGzm : _meshGizmos)
 		{
@@ -1807,7 +1746,7 @@ namespace tao_gizmos
 				.has_texture = false,
 			};
 
-			_meshObjDataUbo.SetSubData(0, sizeof(mesh_obj_data_block), &objData);
+			_frameRing.BindUniformRange(MESH_OBJ_DATA_BINDING, _frameRing.Write(&objData, sizeof(mesh_obj_data_block)));
 
 			preDrawFunc(mGzm.second._instanceCount);
 
@@ -1892,6 +1831,9 @@ namespace tao_gizmos
 
 		_renderContext->SetViewport(0, 0, _windowWidth, _windowHeight);
 
+		ReserveFrameRing(_renderPasses.size());
+		_frameRing.BeginFrame();
+
 		// Set the default states so that clear operations
 		// are not disabled by what happened previously
 		_renderContext->SetDepthState		(DEFAULT_DEPTH_STATE);
@@ -1920,8 +1862,7 @@ namespace tao_gizmos
 			.near_far = _nearFar
 		};
 
-		_frameDataUbo.SetSubData(0, sizeof(frame_data_block), &frameData);
-		_frameDataUbo.Bind(FRAME_DATA_BINDING);
+		_frameRing.BindUniformRange(FRAME_DATA_BINDING, _frameRing.Write(&frameData, sizeof(frame_data_block)));
 
 		ProcessPointGizmos(_viewMatrix, _projectionMatrix);
 		ProcessLineListGizmos(_viewMatrix, _projectionMatrix);
@@ -1942,6 +1883,8 @@ namespace tao_gizmos
         // resolve color
         _mainFramebuffer.CopyTo(&_outFramebuffer, _windowWidth, _windowHeight, fbo_copy_mask_color_bit);
 
+		_frameRing.EndFrame();
+
 		return _outColorTex;
 	}
 
@@ -2055,6 +1998,23 @@ namespace tao_gizmos
 	}
 
 
+	void GizmosRenderer::ReserveFrameRing(std::size_t passes)
+	{
+		const GLsizeiptr blockSize = std::max({
+				sizeof(points_obj_data_block), sizeof(lines_obj_data_block), sizeof(line_strip_obj_data_block),
+				sizeof(mesh_obj_data_block), sizeof(frame_data_block)});
+		const GLsizeiptr alignment = _frameRing.Alignment();
+
+		// Upper bound: gizmos without instances are skipped
+		const std::size_t gizmos = _pointGizmos.size() + _lineGizmos.size() + _lineStripGizmos.size() + _meshGizmos.size();
+		const GLsizeiptr  needed = static_cast<GLsizeiptr>(gizmos * passes + 1) * ((blockSize + alignment - 1) / alignment * alignment);
+
+		if(needed <= _frameRing.PartitionSize()) return;
+
+		// Frames in flight keep reading the old one (GL side)
+		_frameRing = _renderContext->CreatePersistentRingBuffer(std::max(needed, 2 * _frameRing.PartitionSize()), FRAME_RING_PARTITIONS);
+	}
+
 	void GizmosRenderer::GetGizmoUnderCursor(const unsigned cursorX, const unsigned cursorY, const std::function<void(std::optional<gizmo_instance_id>)>& callback)
 	{
 		
@@ -2065,6 +2025,9 @@ namespace tao_gizmos
 
         _renderContext->SetViewport(0, 0, _windowWidth, _windowHeight);
 
+        ReserveFrameRing(1);
+        _frameRing.BeginFrame();
+
         frame_data_block const frameData
         {
                 .view_matrix = _viewMatrix,
@@ -2076,8 +2039,7 @@ namespace tao_gizmos
                 .near_far = _nearFar
         };
 
-        _frameDataUbo.SetSubData(0, sizeof(frame_data_block), &frameData);
-        _frameDataUbo.Bind(FRAME_DATA_BINDING);
+        _frameRing.BindUniformRange(FRAME_DATA_BINDING, _frameRing.Write(&frameData, sizeof(frame_data_block)));
 
         // TODO: could be optimized by allowing the selection
         // TODO: drawing only when calling GizmosRenderer.Render()
@@ -2166,6 +2128,8 @@ namespace tao_gizmos
 		IssueSelectionRequest(_windowWidth, _windowHeight, cursorX, cursorY, lut, callback);
 
 		OglFramebuffer<OglTexture2D>::UnBind(fbo_read_draw);
+
+		_frameRing.EndFrame();
 	}
 
     void GizmosRenderer::CopyDepthToMainFbo(tao_ogl_resources::OglTexture2D* depthTexture)
@@ -0,0 +1,207 @@
+// CPU microbenchmark: GenKeyVector (slot map) against the
+// container it replaced, at 1M elements.
+// Build with -DTAOGL_PBR_BENCHMARKS=ON, run in release.
+
+#include "GenKeyVector.h"
+
+#include <chrono>
+#include <cstdio>
+#include <list>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+namespace legacy
+{
+    using tao_pbr::GenKey;
+
+    // The previous GenKeyVector, as it was (remove_at without the
+    // `~_vector[index]` statement, which doesn't compile for classes).
+    template<typename T>
+    class GenKeyVector
+    {
+    public:
+        GenKeyVector() :
+                _vector{}, _generation{},  _free{}, _freeList{}
+        {
+
+        }
+
+        bool keyValid(const GenKey<T>& key) const
+        {
+            return
+                    key.Index<_generation.size()            &&
+                    key.Index<_vector.size()                &&
+                    key.Generation==_generation[key.Index]  ;
+        }
+
+        bool indexValid(int index) const
+        {
+            return index<_vector.size() && !_free[index];
+        }
+
+        T& at(const GenKey<T>& key)
+        {
+            if(!keyValid(key))
+                throw std::runtime_error("The given key is no longer valid.");
+
+            return _vector[key.Index];
+        }
+
+        const std::vector<T> vector() const
+        {
+                    return _vector;
+        }
+
+        GenKey<T> insert(const T& element)
+        {
+            size_t idx;
+            if (_freeList.empty()) {
+                _vector.push_back(element);
+                _free.push_back(false);
+                _generation.push_back(0);
+                idx = _vector.size() - 1;
+            } else {
+                idx = _freeList.front();
+                _vector[idx] = element;
+                _free[idx] = false;
+                _freeList.pop_front();
+            }
+
+            return GenKey<T>
+                    {
+                            .Generation = _generation[idx],
+                            .Index = _vector.size() - 1
+                    };
+        }
+
+        void remove_at(unsigned int index)
+        {
+            _free[index] = true;
+            _freeList.push_back(index);
+            _generation[index]++;
+        }
+
+    private:
+        std::vector<T> _vector;
+        std::vector<unsigned int> _generation;
+        std::vector<bool> _free;
+        std::list<std::size_t> _freeList;
+    };
+}
+
+namespace
+{
+    constexpr std::size_t ELEMENT_COUNT    = 1'000'000;
+    constexpr int         SIZE_QUERY_COUNT = 100;   // `vector().size()` in a loop
+
+    // About the size of a light or transform
+    struct payload
+    {
+        float data[16];
+    };
+
+    payload MakePayload(std::size_t i)
+    {
+        payload p{};
+        p.data[0] = static_cast<float>(i);
+        return p;
+    }
+
+    double Ms(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    struct results
+    {
+        double insert;
+        double lookup;
+        double iterate;
+        double sizeQueries;
+        double erase;
+        double reinsert;
+        double checksum;
+    };
+
+    // Insert all, look up in random order, iterate, query the size
+    // repeatedly, erase every other element, insert them back.
+    template<typename Container, typename Iterate, typename Size, typename Erase>
+    results Run(Iterate iterate, Size sizeOf, Erase erase)
+    {
+        using clock = std::chrono::steady_clock;
+
+        results r{};
+        Container c{};
+
+        std::vector<tao_pbr::GenKey<payload>> keys(ELEMENT_COUNT);
+
+        auto t = clock::now();
+        for(std::size_t i=0;i<ELEMENT_COUNT;i++) keys[i] = c.insert(MakePayload(i));
+        r.insert = Ms(t);
+
+        std::vector<std::size_t> order(ELEMENT_COUNT);
+        for(std::size_t i=0;i<ELEMENT_COUNT;i++) order[i] = i;
+        std::shuffle(order.begin(), order.end(), std::mt19937{42});
+
+        t = clock::now();
+        for(std::size_t i : order) r.checksum += c.at(keys[i]).data[0];
+        r.lookup = Ms(t);
+
+        t = clock::now();
+        r.checksum += iterate(c);
+        r.iterate = Ms(t);
+
+        t = clock::now();
+        for(int i=0;i<SIZE_QUERY_COUNT;i++) r.checksum += static_cast<double>(sizeOf(c));
+        r.sizeQueries = Ms(t);
+
+        t = clock::now();
+        for(std::size_t i=0;i<ELEMENT_COUNT;i+=2) erase(c, keys[i]);
+        r.erase = Ms(t);
+
+        t = clock::now();
+        for(std::size_t i=0;i<ELEMENT_COUNT;i+=2) keys[i] = c.insert(MakePayload(i));
+        r.reinsert = Ms(t);
+
+        return r;
+    }
+}
+
+int main()
+{
+    const results before = Run<legacy::GenKeyVector<payload>>(
+            [](legacy::GenKeyVector<payload>& c)
+            {
+                // As the renderer did: copy, then skip the free indices
+                double sum = 0.0;
+                const auto v = c.vector();
+                for(int i=0;i<v.size();i++)
+                    if(c.indexValid(i)) sum += v[i].data[0];
+                return sum;
+            },
+            [](legacy::GenKeyVector<payload>& c) { return c.vector().size(); },
+            [](legacy::GenKeyVector<payload>& c, const tao_pbr::GenKey<payload>& k) { c.remove_at(k.Index); });
+
+    const results after = Run<tao_pbr::GenKeyVector<payload>>(
+            [](tao_pbr::GenKeyVector<payload>& c)
+            {
+                double sum = 0.0;
+                for(const payload& p : c.values()) sum += p.data[0];
+                return sum;
+            },
+            [](tao_pbr::GenKeyVector<payload>& c) { return c.size(); },
+            [](tao_pbr::GenKeyVector<payload>& c, const tao_pbr::GenKey<payload>& k) { c.erase(k); });
+
+    std::printf("GenKeyVector, %zu elements of %zu bytes (ms)\n", ELEMENT_COUNT, sizeof(payload));
+    std::printf("%-28s %12s %12s\n", "", "previous", "slot map");
+    std::printf("%-28s %12.2f %12.2f\n", "insert",               before.insert,      after.insert);
+    std::printf("%-28s %12.2f %12.2f\n", "lookup (random)",      before.lookup,      after.lookup);
+    std::printf("%-28s %12.2f %12.2f\n", "iterate",              before.iterate,     after.iterate);
+    std::printf("%-28s %12.2f %12.2f\n", "size() x 100",         before.sizeQueries, after.sizeQueries);
+    std::printf("%-28s %12.2f %12.2f\n", "erase half",           before.erase,       after.erase);
+    std::printf("%-28s %12.2f %12.2f\n", "insert half (reuse)",  before.reinsert,    after.reinsert);
+    std::printf("checksum %f %f\n", before.checksum, after.checksum);
+
+    return 0;
+}
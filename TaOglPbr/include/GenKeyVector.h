@@ -0,0 +1,158 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <limits>
+#include <utility>
+#include <stdexcept>
+#include <cstddef>
+
+namespace tao_pbr
+{
+    template<typename T>
+    struct GenKey
+    {
+        using type = T;
+
+        unsigned int Generation;
+        std::size_t Index;
+    };
+
+    // Slot map
+    // ------------------------------------------------
+    // The values are densely packed (erase moves the last one into
+    // the hole), a key points to a slot which points to its value.
+    // The slot index (GenKey::Index) doesn't change while the key is
+    // alive: GPU-side arrays can be indexed by it. Erasing bumps the
+    // slot's generation, old keys are no longer valid.
+    template<typename T>
+    class GenKeyVector
+    {
+    public:
+        GenKeyVector() :
+                _values{}, _denseToSlot{}, _slots{}, _freeSlots{}
+        {
+
+        }
+
+        bool keyValid(const GenKey<T>& key) const
+        {
+            return
+                    key.Index<_slots.size()                         &&
+                    _slots[key.Index].dense!=FREE                   &&
+                    key.Generation==_slots[key.Index].generation    ;
+        }
+
+        // Slot index (see GenKey::Index)
+        bool indexValid(std::size_t index) const
+        {
+            return index<_slots.size() && _slots[index].dense!=FREE;
+        }
+
+        T& at(const GenKey<T>& key)
+        {
+            if(!keyValid(key))
+                throw std::runtime_error("The given key is no longer valid.");
+
+            return _values[_slots[key.Index].dense];
+        }
+
+        const T& at(const GenKey<T>& key) const
+        {
+            if(!keyValid(key))
+                throw std::runtime_error("The given key is no longer valid.");
+
+            return _values[_slots[key.Index].dense];
+        }
+
+        // By slot index, no checks (see indexValid)
+        T&       at_index(std::size_t index)       { return _values[_slots[index].dense]; }
+        const T& at_index(std::size_t index) const { return _values[_slots[index].dense]; }
+
+        // Live values, densely packed (no order)
+        std::span<T>       values()       { return _values; }
+        std::span<const T> values() const { return _values; }
+
+        // Key of the i-th live value
+        GenKey<T> key_of(std::size_t denseIndex) const
+        {
+            const std::size_t slot = _denseToSlot[denseIndex];
+            return GenKey<T>{ .Generation = _slots[slot].generation, .Index = slot };
+        }
+
+        std::size_t size()       const { return _values.size(); }
+
+        // Upper bound of the slot indices, live or free
+        std::size_t slot_count() const { return _slots.size(); }
+
+        GenKey<T> insert(const T& element)
+        {
+            _values.push_back(element);
+            return BindSlot();
+        }
+
+        GenKey<T> insert(T&& element)
+        {
+            _values.push_back(std::move(element));
+            return BindSlot();
+        }
+
+        void erase(const GenKey<T>& key)
+        {
+            if(!keyValid(key))
+                throw std::runtime_error("The given key is no longer valid.");
+
+            // Fill the hole with the last value
+            const std::size_t dense = _slots[key.Index].dense;
+            const std::size_t last  = _values.size() - 1;
+            if(dense != last)
+            {
+                _values[dense]      = std::move(_values[last]);
+                _denseToSlot[dense] = _denseToSlot[last];
+                _slots[_denseToSlot[dense]].dense = dense;
+            }
+            _values.pop_back();
+            _denseToSlot.pop_back();
+
+            _slots[key.Index].dense = FREE;
+            _slots[key.Index].generation++;
+            _freeSlots.push_back(key.Index);
+        }
+
+    private:
+        static constexpr std::size_t FREE = std::numeric_limits<std::size_t>::max();
+
+        struct slot
+        {
+            unsigned int generation;
+            std::size_t  dense;     // index in _values, FREE if unused
+        };
+
+        std::vector<T>           _values;
+        std::vector<std::size_t> _denseToSlot;
+        std::vector<slot>        _slots;
+        std::vector<std::size_t> _freeSlots;   // reused last in, first out
+
+        // Slot for the value just pushed back
+        GenKey<T> BindSlot()
+        {
+            std::size_t idx;
+            if (_freeSlots.empty()) {
+                idx = _slots.size();
+                _slots.push_back(slot{ .generation = 0, .dense = FREE });
+            } else {
+                idx = _freeSlots.back();
+                _freeSlots.pop_back();
+            }
+
+            _slots[idx].dense = _values.size() - 1;
+            _denseToSlot.push_back(idx);
+
+            return GenKey<T>
+                    {
+                            .Generation = _slots[idx].generation,
+                            .Index = idx
+                    };
+        }
+    };
+}
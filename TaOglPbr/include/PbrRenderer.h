@@ -3,10 +3,20 @@
 #include "RenderContext.h"
 #include "RenderContextUtils.h"
 #include "TaoMath.h"
+#include "Bvh.h"
 #include "Instrumentation.h"
+#include "GenKeyVector.h"
+#include "TangentSpace.h"
+#include "WorkerPool.h"
 
 #include <list>
 #include <optional>
+#include <algorithm>
+#include <numeric>
+#include <bit>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include "glm/glm.hpp"
 #include <glm/ext/matrix_transform.hpp>
 
@@ -14,118 +24,46 @@
 
 namespace tao_pbr
 {
-    template<typename T>
-    struct GenKey
-    {
-        using type = T;
-
-        unsigned int Generation;
-        std::size_t Index;
-    };
+    static constexpr int MAX_MESH_LODS = 6;
 
-    template<typename T>
-    class GenKeyVector
+    // A level of detail: its own index range over the mesh's vertices
+    struct MeshLod
     {
-    public:
-        GenKeyVector() :
-                _vector{}, _generation{},  _free{}, _freeList{}
-        {
-
-        }
-
-        bool keyValid(const GenKey<T>& key) const
-        {
-            return
-                    key.Index<_generation.size()            &&
-                    key.Index<_vector.size()                &&
-                    key.Generation==_generation[key.Index]  ;
-        }
-
-        bool indexValid(int index) const
-        {
-            return index<_vector.size() && !_free[index];
-        }
-
-        T& at(const GenKey<T>& key)
-        {
-            if(!keyValid(key))
-                throw std::runtime_error("The given key is no longer valid.");
-
-            return _vector[key.Index];
-        }
-
-        const std::vector<T> vector() const
-        {
-                    return _vector;
-        }
-
-        GenKey<T> insert(const T& element)
-        {
-            size_t idx;
-            if (_freeList.empty()) {
-                _vector.push_back(element);
-                _free.push_back(false);
-                _generation.push_back(0);
-                idx = _vector.size() - 1;
-            } else {
-                idx = _freeList.front();
-                _vector[idx] = element;
-                _free[idx] = false;
-                _freeList.pop_front();
-            }
-
-            return GenKey<T>
-                    {
-                            .Generation = _generation[idx],
-                            .Index = _vector.size() - 1
-                    };
-        }
-
-        GenKey<T> insert(T&& element)
-        {
-            size_t idx;
-            if (_freeList.empty()) {
-                _vector.push_back(std::move(element));
-                _free.push_back(false);
-                _generation.push_back(0);
-                idx = _vector.size() - 1;
-            } else {
-                idx = _freeList.front();
-                _vector[idx] = std::move(element);
-                _free[idx] = false;
-                _freeList.pop_front();
-            }
-
-            return GenKey<T>
-                    {
-                            .Generation = _generation[idx],
-                            .Index = _vector.size() - 1
-                    };
-        }
-
-        void remove_at(unsigned int index)
-        {
-            ~_vector[index];
-            _free[index] = true;
-            _freeList.push_back(index);
-            _generation[index]++;
-        }
-
-    private:
-        std::vector<T> _vector;
-        std::vector<unsigned int> _generation;
-        std::vector<bool> _free;
-        std::list<std::size_t> _freeList;
+        unsigned int firstIndex   = 0;      // in indices, from the start of the index arena
+        int          indicesCount = 0;
+        float        error        = 0.0f;   // object space, the distance it may be off by
     };
 
-
+    // Every mesh lives in the renderer's shared vertex/index
+    // arena, this is just the mesh's range inside of it.
     struct MeshGraphicsData
     {
-        tao_ogl_resources::OglVertexAttribArray _glVao;
-        tao_ogl_resources::OglVertexBuffer _glVbo;
-        tao_ogl_resources::OglIndexBuffer _glEbo;
+        unsigned int _firstIndex    = 0; // in indices, from the start of the index arena
+        int          _baseVertex    = 0; // in vertices, from the start of the vertex arena
+        int          _indicesCount  = 0;
+        int          _verticesCount = 0;
+        bool         _shortIndices  = false;    // 16 bit indices
+
+        // Lod 0 is the mesh itself (_firstIndex, _indicesCount)
+        MeshLod      _lods[MAX_MESH_LODS];
+        int          _lodCount      = 1;
+
+        // Lod 0 split in meshlets (its triangles reordered), culled
+        // one by one on the GPU. None for small meshes.
+        unsigned int _firstMeshlet  = 0; // in the renderer's meshlets buffer
+        int          _meshletCount  = 0;
+
+        // Object space position = offset + scale * stored position
+        // (identity unless the positions are quantized)
+        glm::vec3    _positionOffset{0.0f};
+        glm::vec3    _positionScale {1.0f};
+    };
 
-        int _indicesCount=0;
+    // What the renderer keeps CPU-side once a mesh is uploaded
+    enum class mesh_residency
+    {
+        cpu_and_gpu,    // all the geometry (picking tests the triangles)
+        gpu_only        // only the bounds (picking tests the boxes)
     };
 
     class Mesh
@@ -133,14 +71,31 @@ namespace tao_pbr
         friend class PbrRenderer;
 
     public:
-        Mesh(const std::vector<glm::vec3> &positions,
-             const std::vector<glm::vec3> &normals,
-             const std::vector<glm::vec2> &textureCoordinates,
-             const std::vector<int> &indices) : _positions(positions), _normals(normals),
-                                                            _textureCoordinates(textureCoordinates),
-                                                            _indices(indices)
-        {
-            ComputeTangentsAndBitangents(_textureCoordinates, _positions, _indices, _tangents, _bitangents);
+        // Pass the arrays as rvalues to avoid copying them
+        Mesh(std::vector<glm::vec3> positions,
+             std::vector<glm::vec3> normals,
+             std::vector<glm::vec2> textureCoordinates,
+             std::vector<int> indices) : _positions(std::move(positions)), _normals(std::move(normals)),
+                                         _textureCoordinates(std::move(textureCoordinates)),
+                                         _indices(std::move(indices))
+        {
+            tao_geometry::ComputeTangentFrames(_positions, _normals, _textureCoordinates, _indices, _tangents, _bitangents);
+        }
+
+        // With the asset's own tangent frames (none are generated)
+        Mesh(std::vector<glm::vec3> positions,
+             std::vector<glm::vec3> normals,
+             std::vector<glm::vec2> textureCoordinates,
+             std::vector<int> indices,
+             std::vector<glm::vec3> tangents,
+             std::vector<glm::vec3> bitangents) : _positions(std::move(positions)), _normals(std::move(normals)),
+                                                  _tangents(std::move(tangents)), _bitangents(std::move(bitangents)),
+                                                  _textureCoordinates(std::move(textureCoordinates)),
+                                                  _indices(std::move(indices))
+        {
+            const auto n = _positions.size();
+            if (_normals.size() != n || _textureCoordinates.size() != n || _tangents.size() != n || _bitangents.size() != n)
+                throw std::runtime_error("Invalid input: all the vertex attributes must match in size");
         }
 
     private:
@@ -151,75 +106,53 @@ namespace tao_pbr
         std::vector<glm::vec2> _textureCoordinates;
         std::vector<int> _indices;
 
+        // Object space, still there with mesh_residency::gpu_only
+        tao_math::BoundingBox<float, 3>::AaBb _bounds;
+        mesh_residency                        _residency = mesh_residency::cpu_and_gpu;
+
         // Handle to graphics data (ugly)
         std::optional<GenKey<MeshGraphicsData>> _graphicsData;
 
-        static void ComputeTangentsAndBitangents(
-                const std::vector<glm::vec2> &textureCoordinates,
-                const std::vector<glm::vec3> &positions,
-                const std::vector<int> &indices,
-
-                std::vector<glm::vec3>& tangents,
-                std::vector<glm::vec3>& bitangents)
+        // Frees the arrays (assigning a new vector, clear() keeps the capacity)
+        void ReleaseCpuData()
         {
-
-            if (textureCoordinates.size() != positions.size())
-                throw std::runtime_error("Invalid input: positions and textureCoordinates must match in size");
-
-            tangents = std::vector<glm::vec3>(textureCoordinates.size());
-            bitangents = std::vector<glm::vec3>(textureCoordinates.size());
-
-            for (int i = 0; i < indices.size(); i += 3)
-            {
-
-                int
-                        t1 = indices.at(i + 0),
-                        t2 = indices.at(i + 1),
-                        t3 = indices.at(i + 2);
-
-                if (t1 >= positions.size() || t2 >= positions.size() || t3 >= positions.size())
-                    throw std::runtime_error("Invalid input: indices reference out of bounds");
-
-                glm::vec3
-                        e1 = (positions.at(t2) - positions.at(t1)),
-                        e2 = (positions.at(t3) - positions.at(t2));
-
-                glm::vec2
-                        delta1 = (textureCoordinates.at(t2) - textureCoordinates.at(t1)),
-                        delta2 = (textureCoordinates.at(t3) - textureCoordinates.at(t2));
-
-
-                glm::mat3x2 mE = glm::transpose(glm::mat2x3(e1, e2));
-                glm::mat2 mDelta = glm::transpose(glm::mat2(delta1, delta2));
-                glm::mat2 mDeltaInverse = glm::inverse(mDelta);
-
-                glm::mat3x2 mTB = mDeltaInverse * mE;
-
-                glm::vec3 tangent = glm::transpose(mTB)[0];
-                glm::vec3 bitangent = glm::transpose(mTB)[1];
-
-                // Average vertex tangents and bitangents
-                tangents.at(t1) += tangent;
-                tangents.at(t2) += tangent;
-                tangents.at(t3) += tangent;
-
-                bitangents.at(t1) += bitangent;
-                bitangents.at(t2) += bitangent;
-                bitangents.at(t3) += bitangent;
-            }
-
-            for (auto &v: tangents)
-                v = glm::normalize(v);
-
-            for (auto &v: bitangents)
-                v = glm::normalize(v);
-
+            _positions          = std::vector<glm::vec3>{};
+            _normals            = std::vector<glm::vec3>{};
+            _tangents           = std::vector<glm::vec3>{};
+            _bitangents         = std::vector<glm::vec3>{};
+            _textureCoordinates = std::vector<glm::vec2>{};
+            _indices            = std::vector<int>{};
+
+            _residency = mesh_residency::gpu_only;
         }
     };
 
+    // Image textures are decoded and uploaded in the background
+    // (see PbrRenderer::TextureStreamingSettings)
+    enum class texture_status
+    {
+        pending,    // decoding or uploading, materials don't sample it yet
+        ready,
+        failed      // couldn't be decoded, never sampled
+    };
+
+    // With bindless textures every image is a texture of its own,
+    // reached through its (resident) handle. Otherwise it is a layer
+    // of one of the renderer's texture arrays.
     struct ImageTextureGraphicsData
     {
-        tao_ogl_resources::OglTexture2D _glTexture;
+        std::optional<tao_ogl_resources::OglTexture2D> _glTexture;
+        GLuint64 _handle = 0;
+        int      _array  = -1;
+        int      _layer  = -1;
+        texture_status _status = texture_status::pending;
+    };
+
+    // Picks the block format and how the mips are filtered
+    enum class texture_content
+    {
+        color,      // BC7 (BC4/BC5 for 1/2 channels), sRGB if accounting for gamma
+        normal_map  // tangent space, BC5: xy only, z is rebuilt when sampled
     };
 
     class ImageTexture
@@ -227,13 +160,15 @@ namespace tao_pbr
         friend class PbrRenderer;
 
     public:
-        ImageTexture(const std::string &path, bool accountForGamma) : _path(path), _accountForGamma(accountForGamma)
+        ImageTexture(const std::string &path, bool accountForGamma, texture_content content = texture_content::color) :
+                _path(path), _accountForGamma(accountForGamma), _content(content)
         {
 
         }
     private:
         std::string _path;
         bool _accountForGamma = false;
+        texture_content _content = texture_content::color;
 
         // Handle to graphics data (ugly)
         std::optional<GenKey<ImageTextureGraphicsData>> _graphicsData;
@@ -242,7 +177,7 @@ namespace tao_pbr
     struct EnvironmentTextureGraphicsData
     {
         tao_ogl_resources::OglTextureCube _envCube;              // environment map as cube map
-        tao_ogl_resources::OglTextureCube _irradianceCube;       // irradiance cube map
+        tao_ogl_resources::OglShaderStorageBuffer _irradianceSh; // irradiance, 9 SH coefficients (rgb, vec4 each)
         tao_ogl_resources::OglTextureCube _prefilteredEnvCube;   // incoming env irradiance map (split-sum approx)
     };
 
@@ -381,6 +316,7 @@ namespace tao_pbr
         tao_math::BoundingBox<float, 3>::AaBb   _aabb;
         GenKey<Mesh>                            _mesh;
         GenKey<PbrMaterial>                     _material;
+        bool                                    _dynamic = false;   // moved at least once (shadow caching)
 
         MeshRenderer(const PbrRenderer* renderer,
                      const GenKey<Mesh> &mesh,
@@ -405,8 +341,8 @@ namespace tao_pbr
                 _envBRDFLut {rc.CreateTexture2D()},
                 _ltcLut1    {rc.CreateTexture2D()},
                 _ltcLut2    {rc.CreateTexture2D()},
-                _frameDataUbo(rc.CreateUniformBuffer()),
-                _lightsDataUbo(rc.CreateUniformBuffer()),
+                _frameRing(rc.CreatePersistentRingBuffer(FRAME_RING_PARTITION_SIZE, FRAME_RING_PARTITIONS)),
+                _textureUploadRing(rc.CreatePersistentRingBuffer(TextureStreamingSettings{}.uploadBudget, FRAME_RING_PARTITIONS)),
                 _gBuffer
                 {
                         .texColor0  {_renderContext->CreateTexture2D()},
@@ -421,6 +357,11 @@ namespace tao_pbr
                         .texColor   {_renderContext->CreateTexture2D()},
                         .buff       {_renderContext->CreateFramebuffer<tao_ogl_resources::OglTexture2D>()},
                 },
+                _shadowAtlas
+                {
+                        .directionalFbo {_renderContext->CreateFramebuffer<tao_ogl_resources::OglTexture2D>()},
+                        .cubeFbo        {_renderContext->CreateFramebuffer<tao_ogl_resources::OglTextureCubeArray>()},
+                },
                 _shaders
                 {
                         .gPass          {_renderContext->CreateShaderProgram()},
@@ -429,20 +370,31 @@ namespace tao_pbr
                 },
                 _shaderBuffers
                 {
-                        .cameraUbo  {_renderContext->CreateUniformBuffer()},
                         .lightsUbo  {_renderContext->CreateUniformBuffer()},
-                        .transformUbo               {*_renderContext, 0, tao_ogl_resources::buf_usg_dynamic_draw, tao_render_context::ResizeBufferPolicy},
-                        .materialUbo                {*_renderContext, 0, tao_ogl_resources::buf_usg_dynamic_draw, tao_render_context::ResizeBufferPolicy},
-                        .directionalLightsSsbo      {*_renderContext, 0, tao_ogl_resources::buf_usg_dynamic_draw, tao_render_context::ResizeBufferPolicy},
-                        .sphereLightsSsbo           {*_renderContext, 0, tao_ogl_resources::buf_usg_dynamic_draw, tao_render_context::ResizeBufferPolicy},
-                        .rectLightsSsbo             {*_renderContext, 0, tao_ogl_resources::buf_usg_dynamic_draw, tao_render_context::ResizeBufferPolicy}
+                        .transformSsbo              {*_renderContext, tao_ogl_resources::buf_usg_dynamic_draw, static_cast<transform_gl_data_block(*)(const MeshRenderer&)>(ToGraphicsData)},
+                        .materialSsbo               {*_renderContext, tao_ogl_resources::buf_usg_dynamic_draw, [this](const PbrMaterial& m){ return ToGraphicsData(m); }},
+                        .drawDataSsbo               {*_renderContext, 0, tao_ogl_resources::buf_usg_dynamic_draw, tao_render_context::ResizeBufferPolicy},
+                        .cubeInstanceSsbo           {*_renderContext, 0, tao_ogl_resources::buf_usg_dynamic_draw, tao_render_context::ResizeBufferPolicy},
+                        .meshletSsbo                {*_renderContext, 0, tao_ogl_resources::buf_usg_static_draw , tao_render_context::ResizeBufferPolicy},
+                        .meshletJobSsbo             {*_renderContext, 0, tao_ogl_resources::buf_usg_dynamic_draw, tao_render_context::ResizeBufferPolicy},
+                        .meshletViewSsbo            {*_renderContext, 0, tao_ogl_resources::buf_usg_dynamic_draw, tao_render_context::ResizeBufferPolicy},
+                        .directionalLightsSsbo      {*_renderContext, tao_ogl_resources::buf_usg_dynamic_draw, static_cast<directional_light_gl_data_block(*)(const DirectionalLight&)>(ToGraphicsData)},
+                        .sphereLightsSsbo           {*_renderContext, tao_ogl_resources::buf_usg_dynamic_draw, static_cast<sphere_light_gl_data_block(*)(const SphereLight&)>(ToGraphicsData)},
+                        .rectLightsSsbo             {*_renderContext, tao_ogl_resources::buf_usg_dynamic_draw, static_cast<rect_light_gl_data_block(*)(const RectLight&)>(ToGraphicsData)},
+                        .textureResidencySsbo       {*_renderContext, tao_ogl_resources::buf_usg_dynamic_draw, static_cast<texture_residency_gl_data_block(*)(const TextureResidency&)>(ToGraphicsData)},
+                        .lightClustersSsbo          {_renderContext->CreateShaderStorageBuffer()},
+                        .clusterLightIndicesSsbo    {_renderContext->CreateShaderStorageBuffer()}
                 },
                 _computeShaders
                 {
                         .generateEnvironmentCube    {_renderContext->CreateShaderProgram()},
-                        .generateIrradianceCube     {_renderContext->CreateShaderProgram()},
+                        .projectIrradianceSh        {_renderContext->CreateShaderProgram()},
+                        .reduceIrradianceSh         {_renderContext->CreateShaderProgram()},
                         .generatePrefilteredEnvCube {_renderContext->CreateShaderProgram()},
                         .generateEnvBRDFLut         {_renderContext->CreateShaderProgram()},
+                        .cullLights                 {_renderContext->CreateShaderProgram()},
+                        .lightPass                  {_renderContext->CreateShaderProgram()},
+                        .cullMeshlets               {_renderContext->CreateShaderProgram()},
                 },
                 _fsQuad
                 {
@@ -450,6 +402,16 @@ namespace tao_pbr
                         .ebo{_renderContext->CreateIndexBuffer()},
                         .vao{_renderContext->CreateVertexAttribArray()}
                 },
+                _meshArena
+                {
+                        .vao        {_renderContext->CreateVertexAttribArray()},
+                        .vbo        {_renderContext->CreateVertexBuffer(nullptr, 0, tao_ogl_resources::buf_usg_static_draw)},
+                        .ebo        {_renderContext->CreateIndexBuffer()},
+                        .drawIdVbo  {_renderContext->CreateVertexBuffer(nullptr, 0, tao_ogl_resources::buf_usg_static_draw)},
+                        .culledVao  {_renderContext->CreateVertexAttribArray()},
+                        .culledEbo  {*_renderContext, 0, tao_ogl_resources::buf_usg_dynamic_copy, tao_render_context::ResizeBufferPolicy},
+                },
+                _drawCommands{*_renderContext, 0, tao_ogl_resources::buf_usg_dynamic_draw, tao_render_context::ResizeBufferPolicy},
                 _meshes(),
                 _meshesGraphicsData(),
                 _textures(),
@@ -461,6 +423,7 @@ namespace tao_pbr
                 _linearSampler          {_renderContext->CreateSampler()},
                 _linearSamplerRepeat    {_renderContext->CreateSampler()},
                 _linearMipLinearSampler {_renderContext->CreateSampler()},
+                _linearMipLinearSamplerRepeat {_renderContext->CreateSampler()},
                 _shadowSampler          {_renderContext->CreateSampler()},
                 _materials(),
                 _meshRenderers()
@@ -476,21 +439,23 @@ namespace tao_pbr
             InitSamplers();
             InitShadowMaps();
             InitStaticShaderBuffers();
+            InitMeshArena();
             InitEnvBRDFLut();
             InitLtcLut();
-
-            _frameDataUbo .SetData(sizeof(frame_gl_data_block) , nullptr, tao_ogl_resources::buf_usg_dynamic_draw);
-            _lightsDataUbo.SetData(sizeof(lights_gl_data_block), nullptr, tao_ogl_resources::buf_usg_dynamic_draw);
-
-            int glOffAlignment = _renderContext->UniformBufferOffsetAlignment();
-            int trBlkSize = sizeof(transform_gl_data_block);
-            int mtBlkSize = sizeof(material_gl_data_block);
-            _transformDataBlockAlignment = (trBlkSize/glOffAlignment)*glOffAlignment + ((trBlkSize%glOffAlignment) ? glOffAlignment : 0);
-            _materialDataBlockAlignment  = (mtBlkSize/glOffAlignment)*glOffAlignment + ((mtBlkSize%glOffAlignment) ? glOffAlignment : 0);
         }
 
+        // The first overload copies the mesh, the second one takes it over. With
+        // mesh_residency::gpu_only the geometry is freed after the upload.
+        // With lodCount > 1 coarser versions of the mesh are generated (each
+        // about half the triangles of the previous, see MeshSimplifier.h),
+        // renderers pick one every frame from their size on screen.
         [[nodiscard]] GenKey<Mesh>                AddMesh(Mesh& mesh);
+        [[nodiscard]] GenKey<Mesh>                AddMesh(Mesh&& mesh, mesh_residency residency = mesh_residency::cpu_and_gpu, int lodCount = 1);
+        // Returns at once, the image is decoded and uploaded in the background
+        // (see TextureStreamingSettings and TextureStatus).
         [[nodiscard]] GenKey<ImageTexture>        AddImageTexture(ImageTexture& texture);
+        // The HDRI is processed (or its cubes loaded from the disk
+        // cache) the first time it's made current, not here.
         [[nodiscard]] GenKey<EnvironmentLight>    AddEnvironmentTexture(const char* path);
         [[nodiscard]] GenKey<PbrMaterial>         AddMaterial(const PbrMaterial& material);
         [[nodiscard]] GenKey<MeshRenderer>        AddMeshRenderer(const Transformation& transform, const GenKey<Mesh>& mesh, const GenKey<PbrMaterial> &material);
@@ -501,9 +466,117 @@ namespace tao_pbr
         void UpdateDirectionalLight (GenKey<DirectionalLight>   key, const DirectionalLight& value);
         void UpdateSphereLight      (GenKey<SphereLight>        key, const SphereLight& value);
         void UpdateRectLight        (GenKey<RectLight>          key, const RectLight& value);
+        void UpdateMeshRenderer     (GenKey<MeshRenderer>       key, const Transformation& transformation);
+
+        // Scene queries (bvh over the mesh renderers' bounds)
+        [[nodiscard]] std::vector<GenKey<MeshRenderer>>   QueryMeshRenderers(const tao_math::Frustum& frustum);
+        [[nodiscard]] std::vector<GenKey<MeshRenderer>>   QueryMeshRenderers(const glm::vec3& center, float radius);
+        [[nodiscard]] std::optional<GenKey<MeshRenderer>> PickMeshRenderer(const tao_math::Ray& ray);
 
         void SetCurrentEnvironment(const GenKey<EnvironmentLight>& environment);
 
+        // Shadow maps are cached, they're redrawn only when their light or
+        // the casters in range change. With the split, mesh renderers that
+        // have been moved (UpdateMeshRenderer) are drawn over a copy of the
+        // other casters' depth, which is left as it is.
+        void SetShadowCasterSplit(bool enabled);
+
+        // Compact G-buffer: octahedral normals and 8 bit material
+        // targets, the position is rebuilt from the depth buffer
+        // (see GPassHelper.glsl). Otherwise 4 rgba16f targets.
+        void SetCompactGBuffer(bool enabled);
+
+        // Mesh positions as 16 bit fractions of the mesh's bounds (instead
+        // of floats). All the meshes share the format: set before AddMesh.
+        void SetQuantizedPositions(bool enabled);
+
+        // Tiled light pass: a compute shader shades 16x16 pixel tiles,
+        // each culls the lights against its own depth range and the sky
+        // only tiles skip the lighting (tiles reaching more than
+        // MAX_TILE_LIGHTS lights use the clusters). Otherwise a full screen
+        // quad with the lights culled by LightCulling.comp (clusters).
+        void SetTiledLightPass(bool enabled);
+
+        // Meshes above MESHLET_MIN_TRIANGLES are split in meshlets at AddMesh.
+        // When drawn at their full detail, a compute pass culls the meshlets
+        // against the pass's frustum and their normal cone (back facing) and
+        // appends the survivors' indices to a per-frame index buffer, which
+        // the G-pass and the shadow passes draw from.
+        void SetMeshletCulling(bool enabled);
+
+        // Directional shadows are split along the view depth, each
+        // cascade gets its own (stable, texel snapped) shadow map.
+        struct ShadowCascadeSettings
+        {
+            int   cascadeCount = 4;         // [1, MAX_DIR_SHADOW_CASCADES]
+            float splitLambda  = 0.75f;     // 0: uniform splits, 1: logarithmic
+            float maxDistance  = 0.0f;      // from the camera, 0: up to the far plane
+        };
+        void SetShadowCascades(const ShadowCascadeSettings& settings);
+
+        // All the shadow maps live in two atlases: a 2D depth texture for
+        // the directional cascades and a cube map array for sphere and rect
+        // lights (each cube is a page, a light takes the same square region
+        // of its 6 faces). Regions are assigned every frame, cube lights get
+        // a resolution that follows their range's size on screen, and are
+        // shrunk (then dropped, least covering first) to fit the budget.
+        struct ShadowAtlasSettings
+        {
+            int                directionalAtlasSize = 4096;         // power of two
+            int                maxDirectionalRes    = 1024;         // each cascade, power of two
+            int                cubePageSize         = 1024;         // power of two
+            int                maxCubeRes           = 512;          // power of two
+            int                minRes               = 64;           // power of two, regions aren't shrunk below it
+            unsigned long long memoryBudget         = 512ull << 20; // bytes, both atlases and their static copies
+        };
+        void SetShadowAtlas(const ShadowAtlasSettings& settings);
+
+        // Each renderer gets the coarsest lod whose error, projected at its
+        // bounding sphere's nearest point, stays under `pixelError` pixels.
+        // Shadow passes go `shadowBias` lods coarser than the camera's.
+        struct LodSettings
+        {
+            float pixelError = 1.0f;
+            int   shadowBias = 1;       // [0, MAX_MESH_LODS)
+        };
+        void SetLodSettings(const LodSettings& settings);
+
+        // Images are decoded by worker threads, then copied a few rows at a
+        // time into a persistent mapped staging ring (a partition for each
+        // frame in flight, fenced) and uploaded from there: at most
+        // `uploadBudget` bytes a frame, the rest waits for the next ones.
+        // Until its last row is in, materials leave the texture out (their
+        // constant factors stand in for it).
+        // Workers also build the mip chain and block compress it (see
+        // TextureCompression.h), compressed chains are cached as
+        // "<image path>.<format>.dds" and reused while newer than the image.
+        // Settings changes apply to the textures added afterwards.
+        struct TextureStreamingSettings
+        {
+            GLsizeiptr uploadBudget = 16 << 20;     // bytes a frame, at least TEXTURE_UPLOAD_MIN_BUDGET
+            bool blockCompression   = true;         // otherwise 8 bits a channel (mips anyway)
+            bool diskCache          = true;
+        };
+        void SetTextureStreaming(const TextureStreamingSettings& settings);
+
+        [[nodiscard]] texture_status TextureStatus(const GenKey<ImageTexture>& texture) const;
+
+        // Image textures keep all their levels in system memory, the GPU
+        // gets the coarse ones (up to TEXTURE_PINNED_SIZE texels) for good
+        // and the finer ones when the GPass asks for them: a fragment of
+        // each 8x8 pixels tile (another one every frame) records the finest
+        // level each texture would be sampled at, read back frames later.
+        // Past `memoryBudget` the least recently sampled textures lose their
+        // finest levels. Levels are released with ARB_sparse_texture
+        // (bindless textures, sizes multiple of the format's page) only:
+        // otherwise the whole chain is allocated (and counted) from the
+        // start and never evicted.
+        struct TextureResidencySettings
+        {
+            GLsizeiptr memoryBudget = 512 << 20;    // bytes of texture levels
+        };
+        void SetTextureResidency(const TextureResidencySettings& settings);
+
         void ReloadShaders();
 
         struct pbrRendererOut
@@ -516,12 +589,28 @@ namespace tao_pbr
 
         void Resize(int newWidth, int newHeight);
 
-        struct GpuPerfCounters
+        struct FramePerfCounters
         {
             unsigned long long GPassTime = 0;
             unsigned long long LightPassTime = 0;
+            unsigned long long LightCullingTime = 0;
+            unsigned long long MeshletCullingTime = 0;
+
+            int VisibleMeshRenderers = 0;   // camera frustum
+            int CulledMeshRenderers  = 0;   // ""
+            unsigned long long CameraTriangles = 0; // camera pass, at the selected lods (before meshlet culling)
+            int MeshletJobs          = 0;   // meshlet culled draws, all passes
+            int CulledShadowCasters  = 0;   // sum over the shadow maps' frustums (cube maps: light range)
+            int CubeShadowFaces      = 0;   // caster-face pairs drawn to cube shadow maps
+            int ShadowMapUpdates     = 0;   // shadow maps (cascades) redrawn (or just their dynamic casters)
+            int ShadowedLights       = 0;   // lights with (at least) a region in the shadow atlas
+            int PendingTextures      = 0;   // decoding or uploading
+            unsigned long long TextureUploadBytes = 0;  // this frame
+            unsigned long long TextureResidentBytes = 0;
+            int EvictedTextureLevels = 0;   // this frame
+            int DroppedTextures      = 0;   // no texture array for them (no bindless textures)
         };
-        GpuPerfCounters PerfCounters;
+        FramePerfCounters PerfCounters;
 
     private:
 
@@ -538,89 +627,150 @@ namespace tao_pbr
         static constexpr const char* LIGHTPASS_NAME_GBUFF2                  = "gBuff2";
         static constexpr const char* LIGHTPASS_NAME_GBUFF3                  = "gBuff3";
         static constexpr const char* LIGHTPASS_NAME_ENV_BRDF_LUT            = "envBrdfLut";
-        static constexpr const char* LIGHTPASS_NAME_ENV_IRRADIANCE          = "envIrradiance";
         static constexpr const char* LIGHTPASS_NAME_LTC_LUT_1               = "ltcLut1";
         static constexpr const char* LIGHTPASS_NAME_LTC_LUT_2               = "ltcLut2";
         static constexpr const char* LIGHTPASS_NAME_ENV_PREFILTERED         = "envPrefiltered";
         static constexpr const char* LIGHTPASS_NAME_ENV_PREFILTERED_MIN_LOD = "u_envPrefilteredMinLod";
         static constexpr const char* LIGHTPASS_NAME_ENV_PREFILTERED_MAX_LOD = "u_envPrefilteredMaxLod";
-        static constexpr const char* LIGHTPASS_NAME_DIR_SHADOW_MATRIX       = "u_dirShadowMatrix";
-        static constexpr const char* LIGHTPASS_NAME_DIR_SHADOW_POS          = "u_dirShadowPosition";
-        static constexpr const char* LIGHTPASS_NAME_DIR_SHADOW_SIZE         = "u_dirShadowSize";
-        static constexpr const char* LIGHTPASS_NAME_DO_DIR_SHADOW           = "u_doDirShadow";
-        static constexpr const char* LIGHTPASS_NAME_DO_SPHERE_SHADOW        = "u_doSphereShadow";
-        static constexpr const char* LIGHTPASS_NAME_SPHERE_SHADOW_SIZE      = "u_sphereShadowMapSize";
-        static constexpr const char* LIGHTPASS_NAME_SPHERE_SHADOW_RES       = "u_sphereShadowMapResolution";
-        static constexpr const char* LIGHTPASS_NAME_DO_RECT_SHADOW          = "u_doRectShadow";
-        static constexpr const char* LIGHTPASS_NAME_RECT_SHADOW_SIZE        = "u_rectShadowMapSize";
-        static constexpr const char* LIGHTPASS_NAME_RECT_SHADOW_RES         = "u_rectShadowMapResolution";
-        static constexpr const char* LIGHTPASS_NAME_RECT_SHADOW_RADIUS      = "u_rectShadowRadius";
+        static constexpr const char* LIGHTPASS_NAME_DIR_SHADOW_CASCADES     = "u_dirShadowCascades";
         static constexpr const char* POINT_SHADOWS_NAME_LIGHT_POS           = "u_lightWorldPos";
         static constexpr const char* POINT_SHADOWS_NAME_VIEWPROJ            = "u_viewProjMat";
+        static constexpr const char* POINT_SHADOWS_NAME_CUBE_LAYER          = "u_cubeLayer";
+        static constexpr const char* POINT_SHADOWS_VERTEX_LAYER_SYMBOL      = "POINT_SHADOWS_VERTEX_LAYER";
 
+        static constexpr const char* GPASS_BINDLESS_TEXTURES_SYMBOL         = "GPASS_BINDLESS_TEXTURES";
+        static constexpr const char* GPASS_MAX_TEXTURE_ARRAYS_SYMBOL        = "GPASS_MAX_TEXTURE_ARRAYS";
+        static constexpr const char* TEXTURE_FEEDBACK_TILE_SYMBOL           = "TEXTURE_FEEDBACK_TILE";
+        static constexpr const char* GBUFF_COMPACT_SYMBOL                   = "GBUFF_COMPACT";
         static constexpr const char* LIGHTPASS_ENV_LIGHTS_SYMBOL            = "LIGHT_PASS_ENVIRONMENT";
         static constexpr const char* LIGHTPASS_DIR_LIGHTS_SYMBOL            = "LIGHT_PASS_DIRECTIONAL";
         static constexpr const char* LIGHTPASS_SPHERE_LIGHTS_SYMBOL         = "LIGHT_PASS_SPHERE";
         static constexpr const char* LIGHTPASS_RECT_LIGHTS_SYMBOL           = "LIGHT_PASS_RECT";
-        static constexpr const char* LIGHTPASS_MAX_DIR_SHADOW_CNT_SYMBOL    = "MAX_DIR_LIGHT_SHADOW_COUNT";
-        static constexpr const char* LIGHTPASS_MAX_SPHERE_SHADOW_CNT_SYMBOL = "MAX_SPHERE_LIGHT_SHADOW_COUNT";
-        static constexpr const char* LIGHTPASS_MAX_RECT_SHADOW_CNT_SYMBOL   = "MAX_RECT_LIGHT_SHADOW_COUNT";
+        static constexpr const char* LIGHTPASS_MAX_DIR_CASCADES_SYMBOL      = "MAX_DIR_SHADOW_CASCADES";
+        static constexpr const char* CLUSTER_GRID_X_SYMBOL                  = "CLUSTER_GRID_X";
+        static constexpr const char* CLUSTER_GRID_Y_SYMBOL                  = "CLUSTER_GRID_Y";
+        static constexpr const char* CLUSTER_GRID_Z_SYMBOL                  = "CLUSTER_GRID_Z";
+        static constexpr const char* CLUSTER_INDEX_CAPACITY_SYMBOL          = "CLUSTER_INDEX_CAPACITY";
+        static constexpr const char* LIGHT_TILE_SIZE_SYMBOL                 = "LIGHT_TILE_SIZE";
+        static constexpr const char* MAX_TILE_LIGHTS_SYMBOL                 = "MAX_TILE_LIGHTS";
 
-        static constexpr int DIR_SHADOW_RES = 2048;
-        static constexpr int POINT_SHADOW_RES = 512;
         static constexpr int ENV_CUBE_RES = 512;
-        static constexpr int IRR_CUBE_RES = 64;
         static constexpr int PRE_CUBE_RES = 128;
         static constexpr int PRE_CUBE_MIN_LOD = 0;
         static constexpr int PRE_CUBE_MAX_LOD = 4;
-        static constexpr int MAX_DIR_SHADOW_COUNT = 4;
-        static constexpr int MAX_SPHERE_SHADOW_COUNT = 4;
-        static constexpr int MAX_RECT_SHADOW_COUNT = 4;
+        static constexpr int MAX_DIR_SHADOW_CASCADES = 4;
+
+        // Clustered lighting, see LightDefs.glsl. The index list
+        // has room for CLUSTER_AVG_LIGHTS lights per cluster on
+        // average (lights beyond that are dropped).
+        static constexpr int CLUSTER_GRID_X = 16;
+        static constexpr int CLUSTER_GRID_Y = 9;
+        static constexpr int CLUSTER_GRID_Z = 24;
+        static constexpr int CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+        static constexpr int CLUSTER_AVG_LIGHTS = 64;
+        static constexpr int CLUSTER_INDEX_CAPACITY = CLUSTER_COUNT * CLUSTER_AVG_LIGHTS;
+
+        // Tiled light pass, see LightPass.comp. Each light type has
+        // room for MAX_TILE_LIGHTS lights per tile, beyond that the
+        // tile reads the light clusters.
+        static constexpr int LIGHT_TILE_SIZE = 16;
+        static constexpr int MAX_TILE_LIGHTS = 256;
 
         static constexpr const int LIGHTPASS_TEX_BINDING_GBUFF0              = 0;
         static constexpr const int LIGHTPASS_TEX_BINDING_GBUFF1              = 1;
         static constexpr const int LIGHTPASS_TEX_BINDING_GBUFF2              = 2;
         static constexpr const int LIGHTPASS_TEX_BINDING_GBUFF3              = 3;
         static constexpr const int LIGHTPASS_TEX_BINDING_ENV_BRDF_LUT        = 4;
-        static constexpr const int LIGHTPASS_TEX_BINDING_ENV_IRRADIANCE      = 5;
         static constexpr const int LIGHTPASS_TEX_BINDING_ENV_PREFILTERED     = 6;
         static constexpr const int LIGHTPASS_TEX_BINDING_LTC_LUT_1           = 7;
         static constexpr const int LIGHTPASS_TEX_BINDING_LTC_LUT_2           = 8;
-        static constexpr const int LIGHTPASS_TEX_BINDING_DIR_SHADOW_MAP      = 9;
-        static constexpr const int LIGHTPASS_TEX_BINDING_SPHERE_SHADOW_MAP   = LIGHTPASS_TEX_BINDING_DIR_SHADOW_MAP + MAX_DIR_SHADOW_COUNT;
-        static constexpr const int LIGHTPASS_TEX_BINDING_RECT_SHADOW_MAP     = LIGHTPASS_TEX_BINDING_SPHERE_SHADOW_MAP + MAX_SPHERE_SHADOW_COUNT;
+        static constexpr const int LIGHTPASS_TEX_BINDING_DIR_SHADOW_ATLAS    = 9;
+        static constexpr const int LIGHTPASS_TEX_BINDING_CUBE_SHADOW_ATLAS   = 10;
+        static constexpr const int LIGHTPASS_TEX_BINDING_GBUFF_DEPTH         = 11;
+        static constexpr const int LIGHTPASS_IMAGE_BINDING_OUT               = 0;
 
         static constexpr const int LIGHTPASS_BUFFER_BINDING_DIR_LIGHTS      = 5;
         static constexpr const int LIGHTPASS_BUFFER_BINDING_SPHERE_LIGHTS   = 6;
         static constexpr const int LIGHTPASS_BUFFER_BINDING_RECT_LIGHTS     = 7;
-
-        static constexpr const int GPASS_TEX_BINDING_DIFFUSE    = 0;
-        static constexpr const int GPASS_TEX_BINDING_EMISSION   = 1;
-        static constexpr const int GPASS_TEX_BINDING_NORMALS    = 2;
-        static constexpr const int GPASS_TEX_BINDING_METALNESS  = 3;
-        static constexpr const int GPASS_TEX_BINDING_ROUGHNESS  = 4;
-        static constexpr const int GPASS_TEX_BINDING_OCCLUSION  = 5;
-
-        static constexpr const int GPASS_UBO_BINDING_TRANSFORM  = 2;
-        static constexpr const int GPASS_UBO_BINDING_MATERIAL   = 3;
+        static constexpr const int LIGHTPASS_BUFFER_BINDING_LIGHT_CLUSTERS  = 9;
+        static constexpr const int LIGHTPASS_BUFFER_BINDING_CLUSTER_INDICES = 10;
+        static constexpr const int LIGHTPASS_BUFFER_BINDING_DIR_SHADOWS     = 11;
+        static constexpr const int LIGHTPASS_BUFFER_BINDING_CUBE_SHADOWS    = 12;
+        static constexpr const int LIGHTPASS_BUFFER_BINDING_ENV_IRRADIANCE  = 21;
+
+        static constexpr const int GPASS_TEX_BINDING_ARRAYS     = 0;    // [0, GPASS_MAX_TEXTURE_ARRAYS)
+        static constexpr const int GPASS_MAX_TEXTURE_ARRAYS     = 16;   // see GPass.frag
+        static constexpr const int TEXTURE_ARRAY_MIN_LAYERS     = 4;
+
+        static constexpr const int GPASS_SSBO_BINDING_TRANSFORM = 2;
+        static constexpr const int GPASS_SSBO_BINDING_MATERIAL  = 3;
+        static constexpr const int GPASS_SSBO_BINDING_DRAW_DATA = 4;
+        static constexpr const int GPASS_SSBO_BINDING_TEXTURE_RESIDENCY = 19;
+        static constexpr const int GPASS_SSBO_BINDING_TEXTURE_FEEDBACK  = 20;
+        static constexpr const int SHADOW_SSBO_BINDING_CUBE_INSTANCES = 8;
+        static constexpr const int MESHLET_SSBO_BINDING_MESHLETS      = 13;   // see MeshletCulling.comp
+        static constexpr const int MESHLET_SSBO_BINDING_JOBS          = 14;
+        static constexpr const int MESHLET_SSBO_BINDING_VIEWS         = 15;
+        static constexpr const int MESHLET_SSBO_BINDING_INDICES       = 16;
+        static constexpr const int MESHLET_SSBO_BINDING_OUT_INDICES   = 17;
+        static constexpr const int MESHLET_SSBO_BINDING_COMMANDS      = 18;
         static constexpr const int GPASS_UBO_BINDING_CAMERA     = 1;
         static constexpr const int UBO_BINDING_FRAME_DATA       = 0;
         static constexpr const int LIGHTPASS_UBO_BINDING_LIGHTS_DATA = 4;
 
+        // Meshlets (see MeshletBuilder.h). The culled indices of a frame
+        // (all passes) past the budget fall back to the whole mesh.
+        static constexpr const unsigned int MESHLET_MAX_VERTICES        = 64;
+        static constexpr const unsigned int MESHLET_MAX_TRIANGLES       = 124;
+        static constexpr const unsigned int MESHLET_MIN_TRIANGLES       = 4096;
+        static constexpr const unsigned int MESHLET_CULLED_INDEX_BUDGET = 1u << 24;
+        static constexpr const unsigned int MESHLET_CULLING_GROUP_SIZE  = 64;      // see MeshletCulling.comp
+        static constexpr const unsigned int MAX_COMPUTE_GROUPS_X        = 65535;   // GL minimum
+
+        // Draw sort key, from the most significant bits:
+        // | pass: 4 | material: 20 | view depth: 24 | mesh: 16 |
+        static constexpr const int SORT_KEY_PASS_SHIFT      = 60;
+        static constexpr const int SORT_KEY_MATERIAL_SHIFT  = 40;
+        static constexpr const int SORT_KEY_DEPTH_SHIFT     = 16;
+        static constexpr const int SORT_KEY_MESH_SHIFT      = 0;
+        static constexpr const unsigned int SORT_KEY_PASS_GEOMETRY = 0;
+
+        // Mesh arena vertex (see MeshVertexHelper.glsl):
+        // | position: 3 x float (12) or 4 x unorm16 (8) |
+        // | normal, tangent: 4 x snorm16, octahedral (8) |
+        // | textureCoord: 2 x half (4) | bitangent sign: 4 x snorm8 (4) |
+        static constexpr const int MESH_ATTRIB_POSITION       = 0;
+        static constexpr const int MESH_ATTRIB_NORMAL_TANGENT = 1;
+        static constexpr const int MESH_ATTRIB_UV             = 2;
+        static constexpr const int MESH_ATTRIB_BITANGENT_SIGN = 3;
+        static constexpr const int MESH_ATTRIB_DRAW_ID        = 5;
+        static constexpr const int MESH_POSITION_SIZE           = 3 * sizeof(float);
+        static constexpr const int MESH_QUANTIZED_POSITION_SIZE = 4 * sizeof(unsigned short);
+        static constexpr const int MESH_ATTRIBUTES_SIZE         = 4 * sizeof(GLuint);   // all but the position
+
         static constexpr const char* PROCESS_ENV_COMPUTE_SOURCE      = "ProcessEnvironment.comp";
         static constexpr const char* GEN_ENV_SYMBOL                  = "GEN_ENVIRONMENT_CUBE";
-        static constexpr const char* GEN_IRR_SYMBOL                  = "GEN_IRRADIANCE_CUBE";
+        static constexpr const char* GEN_IRR_SH_SYMBOL               = "GEN_IRRADIANCE_SH";
+        static constexpr const char* REDUCE_IRR_SH_SYMBOL            = "REDUCE_IRRADIANCE_SH";
+        static constexpr const char* SH_TEXELS_SYMBOL                = "SH_TEXELS";
         static constexpr const char* GEN_PRE_SYMBOL                  = "GEN_PREFILTERED_ENV_CUBE";
         static constexpr const char* GEN_LUT_SYMBOL                  = "GEN_ENVIRONMENT_BRDF_LUT";
         static constexpr const char* PROCESS_ENV_ENV2D_TEX_NAME      = "envTex";
         static constexpr const char* PROCESS_ENV_ENVCUBE_TEX_NAME    = "envCube";
-        static constexpr const char* PROCESS_ENV_IRRCUBE_TEX_NAME    = "irradianceCube";
         static constexpr const char* PROCESS_ENV_PRECUBE_TEX_NAME    = "prefilteredEnvCube";
         static constexpr const char* PROCESS_ENV_ENVLUT_TEX_NAME     = "envBRDFLut";
         static constexpr const char* PROCESS_ENV_ROUGHNESS_NAME      = "u_roughness";
+        static constexpr const char* PROCESS_ENV_SH_PARTIALS_NAME    = "u_shPartials";
+        static constexpr int         PROCESS_ENV_SH_TEXELS           = 4;   // per invocation, on each axis
+        static constexpr int         PROCESS_ENV_BUFFER_BINDING_SH_PARTIALS = 0;
+        static constexpr int         PROCESS_ENV_BUFFER_BINDING_SH          = 1;
         static constexpr int         PROCESS_ENV_GROUP_SIZE_X        = 8;
         static constexpr int         PROCESS_ENV_GROUP_SIZE_Y        = 8;
         static constexpr int         PROCESS_ENV_GROUP_SIZE_Z        = 1;
+        static constexpr const char* LIGHT_CULLING_COMPUTE_SOURCE    = "LightCulling.comp";
+        static constexpr const char* LIGHTPASS_COMPUTE_SOURCE        = "LightPass.comp";
+        static constexpr const char* MESHLET_CULLING_COMPUTE_SOURCE  = "MeshletCulling.comp";
+        static constexpr const char* MESHLET_CULLING_NAME_THREADS    = "u_threadCount";
 
         static constexpr tao_ogl_resources::ogl_depth_state DEFAULT_DEPTH_STATE  =
                 tao_ogl_resources::ogl_depth_state
@@ -670,30 +820,78 @@ namespace tao_pbr
                                 .alpha_to_coverage_enable = false
                         };
 
-        struct DirectionalShadowMap
+        // Square region of a shadow atlas, res = 0: no shadow map
+        struct ShadowAtlasTile
+        {
+            int x    = 0;
+            int y    = 0;
+            int page = 0;   // cube map array only: the cube
+            int res  = 0;
+
+            bool operator==(const ShadowAtlasTile&) const = default;
+        };
+
+        struct ShadowCascade
         {
-            tao_ogl_resources::OglTexture2D                                     shadowMap;
-            tao_ogl_resources::OglFramebuffer<tao_ogl_resources::OglTexture2D>  shadowFbo;
+            ShadowAtlasTile                                                     tile;
             glm::mat4                                                           shadowMatrix;
+            glm::mat4                                                           viewMatrix;
+            glm::mat4                                                           projMatrix;
             glm::vec3                                                           lightPos;
             glm::vec4                                                           shadowSize;
+            float                                                               splitFar;           // view depth
+
+            bool                                                                dirty        = true;
+            bool                                                                dynamicDirty = true;
+        };
+
+        struct DirectionalShadowMap
+        {
+            ShadowCascade                                                            cascades[MAX_DIR_SHADOW_CASCADES];
         };
 
         struct SphereShadowMap
         {
-            tao_ogl_resources::OglTextureCube                                     shadowMapColor;
-            tao_ogl_resources::OglTextureCube                                     shadowMapDepth;
-            tao_ogl_resources::OglFramebuffer<tao_ogl_resources::OglTextureCube>  shadowFbo;
-            glm::vec3                                                             shadowCenter;
-            glm::vec4                                                             shadowSize;
+            ShadowAtlasTile                                                       tile;
+            glm::vec3                                                             shadowCenter{0.0f};
+            glm::vec4                                                             shadowSize{0.0f};
+
+            bool                                                                  dirty        = true;
+            bool                                                                  dynamicDirty = true;
+        };
+
+        // Textures are allocated when first needed, the static copies
+        // (same layout) keep the static casters' depth of every region.
+        struct ShadowAtlas
+        {
+            std::optional<tao_ogl_resources::OglTexture2D>                            directional;        // depth
+            std::optional<tao_ogl_resources::OglTexture2D>                            directionalStatic;
+            tao_ogl_resources::OglFramebuffer<tao_ogl_resources::OglTexture2D>        directionalFbo;
+
+            std::optional<tao_ogl_resources::OglTextureCubeArray>                     cubeColor;          // distance from the light
+            std::optional<tao_ogl_resources::OglTextureCubeArray>                     cubeDepth;
+            std::optional<tao_ogl_resources::OglTextureCubeArray>                     cubeColorStatic;
+            std::optional<tao_ogl_resources::OglTextureCubeArray>                     cubeDepthStatic;
+            tao_ogl_resources::OglFramebuffer<tao_ogl_resources::OglTextureCubeArray> cubeFbo;
+            int                                                                       cubePages = 0;
         };
 
+        // A region to be placed in a shadow atlas
+        struct ShadowAtlasRequest
+        {
+            int             owner;      // cascade (light * MAX_DIR_SHADOW_CASCADES + cascade) or cube light (sphere lights first)
+            int             res;        // 0: dropped
+            float           priority;   // lowest are shrunk and dropped first
+            ShadowAtlasTile tile;
+        };
+
+        // Compact layout in brackets, see GPassHelper.glsl
         struct GBuffer
         {
-            tao_ogl_resources::OglTexture2D texColor0; // position (3) - roughness (1)
-            tao_ogl_resources::OglTexture2D texColor1; // normal   (3) - metalness (1)
-            tao_ogl_resources::OglTexture2D texColor2; // diffuse  (3) - occlusion (1)
-            tao_ogl_resources::OglTexture2D texColor3; // emission (3) - unused    (1)
+            tao_ogl_resources::OglTexture2D texColor0; // position (3) - roughness (1)    [normal (2)]
+            tao_ogl_resources::OglTexture2D texColor1; // normal   (3) - metalness (1)    [diffuse (3) - occlusion (1)]
+            tao_ogl_resources::OglTexture2D texColor2; // diffuse  (3) - occlusion (1)    [roughness (1) - metalness (1)]
+            tao_ogl_resources::OglTexture2D texColor3; // emission (3) - unused    (1)    [emission (rgbm)]
 
             tao_ogl_resources::OglTexture2D texDepth;
 
@@ -716,9 +914,13 @@ namespace tao_pbr
         struct ComputeShaders
         {
             tao_ogl_resources::OglShaderProgram generateEnvironmentCube;
-            tao_ogl_resources::OglShaderProgram generateIrradianceCube;
+            tao_ogl_resources::OglShaderProgram projectIrradianceSh;
+            tao_ogl_resources::OglShaderProgram reduceIrradianceSh;
             tao_ogl_resources::OglShaderProgram generatePrefilteredEnvCube;
             tao_ogl_resources::OglShaderProgram generateEnvBRDFLut;
+            tao_ogl_resources::OglShaderProgram cullLights;
+            tao_ogl_resources::OglShaderProgram lightPass;
+            tao_ogl_resources::OglShaderProgram cullMeshlets;
         };
 
         struct NdcQuad
@@ -728,11 +930,157 @@ namespace tao_pbr
             tao_ogl_resources::OglVertexAttribArray vao;
         };
 
+        // Shared geometry storage for all the meshes, so that
+        // a whole pass can be issued with a single VAO bound.
+        struct MeshArena
+        {
+            tao_ogl_resources::OglVertexAttribArray vao;
+            tao_ogl_resources::OglVertexBuffer      vbo;
+            tao_ogl_resources::OglIndexBuffer       ebo;
+            tao_ogl_resources::OglVertexBuffer      drawIdVbo;    // 0, 1, 2... (instanced, fetched via base instance)
+
+            // Same vertices, the indices surviving the meshlet culling (per frame)
+            tao_ogl_resources::OglVertexAttribArray culledVao;
+            tao_render_context::ResizableEbo        culledEbo;
+
+            unsigned int vboCapacity    = 0;    // bytes
+            unsigned int vboSize        = 0;    // bytes
+            unsigned int eboCapacity    = 0;    // bytes
+            unsigned int eboSize        = 0;    // bytes
+            unsigned int drawIdCapacity = 0;    // elements
+        };
+
+        // Fallback for when bindless textures are not available:
+        // images with the same size and format share an array
+        // (bound once for the whole G-pass).
+        struct TextureArray
+        {
+            tao_ogl_resources::OglTexture2DArray            texture;
+            tao_ogl_resources::ogl_texture_internal_format  format;
+            int width;
+            int height;
+            int layerCount      = 0;
+            int layerCapacity   = 0;
+        };
+
+        struct DrawListEntry
+        {
+            tao_ogl_resources::draw_elements_indirect_command command;
+            GenKey<PbrMaterial>     material;
+            GenKey<Mesh>            mesh;
+            GenKey<MeshRenderer>    renderer;
+            glm::vec3               center;     // world space, for the sort key
+            float                   radius;     // world space bounding sphere (around the aabb)
+            float                   lodScale;   // object to world, the largest axis scale
+            bool                    dynamic;    // shadow caster split
+            bool                    shortIndices;
+            int                     lodCount;
+            MeshLod                 lods[MAX_MESH_LODS];
+            unsigned int            firstMeshlet;
+            int                     meshletCount;   // lod 0
+        };
+
+        // The (culled) commands of a single pass, they take the
+        // range [firstCommand, firstCommand+commandCount) of the
+        // indirect buffer, which is rewritten every frame.
+        struct DrawCommandList
+        {
+            int firstCommand = 0;
+            int commandCount = 0;
+            int shortCommandCount = 0;  // then 16 bit indices (a draw call each type)
+            int culledCommandCount = 0; // the last ones, meshlet culled (from the culled indices)
+        };
+
+        // Which draw call of its list a command goes to
+        enum class command_group : unsigned char
+        {
+            wide,           // 32 bit indices
+            short_indices,  // 16 bit indices
+            culled          // meshlet culled (32 bit culled indices)
+        };
+
+        // Static casters are drawn only when the whole shadow map
+        // is dirty, the dynamic ones go over the cached static depth.
+        struct ShadowCasterLists
+        {
+            DrawCommandList staticCasters;
+            DrawCommandList dynamicCasters;
+        };
+
         tao_ogl_resources::OglTexture2D   _envBRDFLut;  // env BRDF lut (split-sum approx)
         tao_ogl_resources::OglTexture2D   _ltcLut1;     // see: https://github.com/selfshadow/ltc_code
         tao_ogl_resources::OglTexture2D   _ltcLut2;     // "" ""
 
-        tao_ogl_resources::OglUniformBuffer _frameDataUbo;
+        // Per-frame uniform blocks (frame, lights, cameras) and shadow
+        // data, `FRAME_RING_PARTITIONS` frames can be in flight. The
+        // partitions grow with the lights (see ReserveFrameRing).
+        tao_ogl_resources::PersistentRingBuffer _frameRing;
+        static constexpr GLsizeiptr FRAME_RING_PARTITION_SIZE = 1 << 20;
+        static constexpr int        FRAME_RING_PARTITIONS     = 3;
+
+        // Texture uploads staging, a partition is a frame's upload budget
+        tao_ogl_resources::PersistentRingBuffer _textureUploadRing;
+        static constexpr GLsizeiptr TEXTURE_UPLOAD_MIN_BUDGET = 1 << 18;    // a row of the widest images
+
+        static constexpr int          TEXTURE_PINNED_SIZE   = 128;      // levels up to it are never evicted
+        static constexpr int          TEXTURE_FEEDBACK_TILE = 8;        // a fragment of each tile records its levels
+        static constexpr unsigned int TEXTURE_FEEDBACK_NONE = ~0u;      // texture not sampled
+        static constexpr std::size_t  MAX_IMAGE_TEXTURES    = 1 << 16;  // 16 bits texture ids in the materials
+
+        // From the decoding workers to the render thread
+        struct DecodedTexture
+        {
+            GenKey<ImageTextureGraphicsData>                graphicsData;
+            std::vector<std::vector<unsigned char>>         levels;         // mip chain, empty if the decoding failed
+            int                                             width  = 0;     // level 0
+            int                                             height = 0;
+            tao_ogl_resources::ogl_texture_internal_format  internalFormat  = tao_ogl_resources::tex_int_for_rgba8;
+            tao_ogl_resources::ogl_texture_format           format          = tao_ogl_resources::tex_for_rgba;  // uncompressed only
+            int                                             blockBytes      = 0;    // a 4x4 block, 0 if uncompressed
+        };
+
+        // Levels from `level` down to `lastLevel`, coarsest first. Rows
+        // [0, nextRow) of `level` are in (rows of blocks when compressed).
+        struct TextureUpload
+        {
+            std::size_t                                 texture;    // graphics data slot
+            int                                         level;
+            int                                         lastLevel;
+            int                                         nextRow = 0;
+        };
+
+        // Mip levels on the GPU (see TextureResidencySettings), one for
+        // each graphics data slot
+        struct TextureResidency
+        {
+            DecodedTexture      image;                  // all the levels, to stream them (back) in
+            int                 residentLevel = 0;      // levels [residentLevel, count) are in
+            int                 pinnedLevel   = 0;      // never evicted past it
+            int                 wantedLevel   = 0;      // finest level sampled (feedback)
+            unsigned long long  lastUsed      = 0;      // frame of the latest feedback naming it
+            bool                loading       = false;  // an upload is queued
+            bool                sparse        = false;  // levels above pinnedLevel are committed one by one
+        };
+
+        struct texture_residency_gl_data_block
+        {
+            float minLod;   // resident level, sampling clamps to it
+        };
+
+        static texture_residency_gl_data_block ToGraphicsData(const TextureResidency& residency)
+        {
+            return texture_residency_gl_data_block{.minLod = static_cast<float>(residency.residentLevel)};
+        }
+
+        // GPass feedback readback, one for each frame in flight
+        struct TextureFeedbackBuffer
+        {
+            tao_ogl_resources::OglShaderStorageBuffer   buffer;
+            std::optional<tao_ogl_resources::OglFence>  fence;          // written, not read back yet
+            unsigned long long                          frame    = 0;
+            std::size_t                                 capacity = 0;   // textures
+        };
+
         struct frame_gl_data_block
         {
             glm::vec4 eyePosition;
@@ -743,9 +1091,10 @@ namespace tao_pbr
             int radianceMinLod;
             int radianceMaxLod;
             int doTaa;
+            int textureFeedback;
+            glm::ivec2 feedbackTexel;   // of each TEXTURE_FEEDBACK_TILE tile
         };
 
-        tao_ogl_resources::OglUniformBuffer _lightsDataUbo;
         struct lights_gl_data_block
         {
             int doEnvironment;
@@ -817,16 +1166,88 @@ namespace tao_pbr
             glm::mat4 projectionMatrix;
             float near;
             float far;
+            float pad[2];
+            glm::mat4 inverseViewProjectionMatrix;
         };
 
-        int _transformDataBlockAlignment;
         struct transform_gl_data_block
         {
             glm::mat4 modelMatrix;
             glm::mat4 normalMatrix;
         };
 
-        int _materialDataBlockAlignment;
+        static transform_gl_data_block ToGraphicsData(const MeshRenderer &mesh)
+        {
+            glm::mat4 model  = mesh._transformation.matrix();
+            glm::mat3 normal = glm::transpose(glm::inverse(model));
+
+            return transform_gl_data_block
+            {
+                    .modelMatrix  = model,
+                    .normalMatrix = normal
+            };
+        }
+
+        struct draw_gl_data_block
+        {
+            int transformIndex;
+            int materialIndex;
+            int pad[2];
+            glm::vec4 positionOffset;   // dequantization (xyz)
+            glm::vec4 positionScale;    // ""
+        };
+
+        struct dir_shadow_gl_data_block
+        {
+            glm::mat4 shadowMatrix;
+            glm::vec4 shadowSize;
+            glm::vec4 tile;             // atlas uv offset (xy) and scale (zw), 0: no shadow map
+            glm::vec4 lightPosSplit;    // light position (xyz), split view depth (w)
+        };
+
+        struct cube_shadow_gl_data_block
+        {
+            glm::vec4 shadowSize;
+            glm::vec4 tile;             // page uv offset (xy), scale (z) and page (w), 0 scale: no shadow map
+        };
+
+        struct meshlet_gl_data_block
+        {
+            glm::vec4 sphere;           // object space center (xyz), radius (w)
+            glm::vec4 cone;             // axis (xyz), cutoff (w), see MeshletBuilder.h
+            GLuint    firstIndex;       // in the index arena (lod 0 of the mesh)
+            GLuint    indexCount;
+            GLuint    pad[2];
+        };
+
+        // A pass the meshlets are culled for
+        struct meshlet_view_gl_data_block
+        {
+            glm::vec4 planes[tao_math::Frustum::PLANE_COUNT];   // inwards
+            glm::vec4 eye;              // position (w = 1) or direction (w = 0, orthographic)
+            int       planeCount;
+            int       pad[3];
+        };
+
+        // The meshlets of a draw command, for a view
+        struct meshlet_job_gl_data_block
+        {
+            GLuint firstThread;         // one thread for each meshlet, prefix sum
+            GLuint firstMeshlet;
+            GLuint meshletCount;
+            GLuint command;             // in the frame's commands, its count is incremented
+            GLuint outputOffset;        // in the culled indices, room for all the meshlets
+            GLuint shortIndices;
+            int    transformIndex;
+            int    view;
+        };
+
+        struct cube_instance_gl_data_block
+        {
+            int drawIndex;
+            int faces;      // face index or face mask, see PointShadowMap.vert
+        };
+
         struct material_gl_data_block
         {
             glm::vec4 diffuse;
@@ -841,17 +1262,38 @@ namespace tao_pbr
             int has_merged_rough_metal;
             int has_metalness_tex;
             int has_occlusion_tex;
+            unsigned int diffuse_emission_ids;      // texture ids (residency
+                                                    // and feedback), 16 bits each
+            // Bindless handle or (array, layer)
+            glm::uvec2 diffuse_tex;
+            glm::uvec2 emission_tex;
+            glm::uvec2 normal_tex;
+            glm::uvec2 metalness_tex;
+            glm::uvec2 roughness_tex;
+            glm::uvec2 occlusion_tex;
+
+            unsigned int normal_metalness_ids;
+            unsigned int roughness_occlusion_ids;
         };
+        static_assert(sizeof(material_gl_data_block) == 128);
 
         struct ShaderBuffers
         {
-            tao_ogl_resources::OglUniformBuffer cameraUbo;
             tao_ogl_resources::OglUniformBuffer lightsUbo;
-            tao_render_context::ResizableUbo    transformUbo;
-            tao_render_context::ResizableUbo    materialUbo;
-            tao_render_context::ResizableSsbo   directionalLightsSsbo;
-            tao_render_context::ResizableSsbo   sphereLightsSsbo;
-            tao_render_context::ResizableSsbo   rectLightsSsbo;
+            // Synced with the collections, flushed once per frame
+            tao_render_context::SyncedBuffer<MeshRenderer, transform_gl_data_block>             transformSsbo;
+            tao_render_context::SyncedBuffer<PbrMaterial, material_gl_data_block>               materialSsbo;
+            tao_render_context::ResizableSsbo   drawDataSsbo;
+            tao_render_context::ResizableSsbo   cubeInstanceSsbo;
+            tao_render_context::ResizableSsbo   meshletSsbo;        // all the meshes' meshlets
+            tao_render_context::ResizableSsbo   meshletJobSsbo;     // per frame
+            tao_render_context::ResizableSsbo   meshletViewSsbo;    // ""
+            tao_render_context::SyncedBuffer<DirectionalLight, directional_light_gl_data_block> directionalLightsSsbo;
+            tao_render_context::SyncedBuffer<SphereLight, sphere_light_gl_data_block>           sphereLightsSsbo;
+            tao_render_context::SyncedBuffer<RectLight, rect_light_gl_data_block>               rectLightsSsbo;
+            tao_render_context::SyncedBuffer<TextureResidency, texture_residency_gl_data_block> textureResidencySsbo;   // by graphics data index
+            tao_ogl_resources::OglShaderStorageBuffer lightClustersSsbo;        // LightCluster per cluster
+            tao_ogl_resources::OglShaderStorageBuffer clusterLightIndicesSsbo;  // counter + CLUSTER_INDEX_CAPACITY indices
         };
 
 
@@ -861,9 +1303,10 @@ namespace tao_pbr
         GBuffer _gBuffer;
         OutputFramebuffer _outBuffer;
 
-        std::vector<DirectionalShadowMap> _directionalShadowMaps;
-        std::vector<SphereShadowMap>      _sphereShadowMaps;
-        std::vector<SphereShadowMap>      _rectShadowMaps;
+        ShadowAtlas                       _shadowAtlas;
+        std::vector<DirectionalShadowMap> _directionalShadowMaps;   // one for each light
+        std::vector<SphereShadowMap>      _sphereShadowMaps;        // ""
+        std::vector<SphereShadowMap>      _rectShadowMaps;          // ""
 
         Shaders _shaders;
         ShaderBuffers _shaderBuffers;
@@ -872,11 +1315,69 @@ namespace tao_pbr
 
         NdcQuad _fsQuad;
 
+        MeshArena                           _meshArena;
+        tao_render_context::ResizableDibo   _drawCommands;
+
+        // One entry for each mesh renderer, sorted by material.
+        // The entry index is also the draw id and the bvh item.
+        std::vector<DrawListEntry>                                     _drawList;
+        std::vector<int>                                               _rendererDrawEntry; // mesh renderer index -> entry
+        tao_math::Bvh                                                  _bvh;
+        bool                                                           _drawListDirty = true;
+
+        // Built by culling the draw list each frame
+        std::vector<tao_ogl_resources::draw_elements_indirect_command> _frameCommands;
+        std::vector<int>                                               _frameLods;         // draw entry -> camera lod
+        std::vector<int>                                               _visibleEntries;
+        std::vector<unsigned long long>                                _sortKeys;
+        std::vector<unsigned long long>                                _sortKeysTmp;
+        std::vector<int>                                               _sortValuesTmp;
+
+        DrawCommandList                                                _cameraDrawList;
+        std::vector<ShadowCasterLists>                                 _dirShadowCasters;  // light * MAX_DIR_SHADOW_CASCADES + cascade
+        std::vector<ShadowCasterLists>                                 _sphereShadowCasters;
+        std::vector<ShadowCasterLists>                                 _rectShadowCasters;
+        std::vector<cube_instance_gl_data_block>                       _frameCubeInstances;
+        tao_math::AabbSoA                                              _cubeCasterBoxes;
+        std::vector<unsigned char>                                     _cubeFaceVisible;
+        std::vector<unsigned char>                                     _cubeFaceMasks;     // draw entry -> faces
+        std::vector<command_group>                                     _commandGroups;     // scratch, see GroupDrawCommands
+        std::vector<meshlet_gl_data_block>                             _meshlets;
+        bool                                                           _meshletsDirty = false;
+        bool                                                           _meshletCulling = true;
+        std::vector<meshlet_view_gl_data_block>                        _frameMeshletViews;
+        std::vector<meshlet_job_gl_data_block>                         _frameMeshletJobs;
+        unsigned int                                                   _frameMeshletIndices = 0;   // culled indices reserved
+        bool                                                           _shadowCasterSplit = true;
+        bool                                                           _compactGBuffer = true;
+        bool                                                           _quantizedPositions = false;
+        bool                                                           _tiledLightPass = true;
+        ShadowCascadeSettings                                          _shadowCascadeSettings;
+        ShadowAtlasSettings                                            _shadowAtlasSettings;
+        LodSettings                                                    _lodSettings;
+        TextureStreamingSettings                                       _textureStreamingSettings;
+        std::deque<TextureUpload>                                      _textureUploads;
+        std::mutex                                                     _decodedTexturesMutex;
+        std::vector<DecodedTexture>                                    _decodedTextures;   // guarded by the mutex
+        int                                                            _decodingTextures = 0;
+        TextureResidencySettings                                       _textureResidencySettings;
+        std::vector<TextureResidency>                                  _textureResidency;  // by graphics data index
+        std::vector<TextureFeedbackBuffer>                             _textureFeedback;
+        int                                                            _textureFeedbackNext = 0;
+        unsigned long long                                             _textureFeedbackFrame = 0;  // latest read back
+        std::vector<unsigned int>                                      _textureFeedbackData;
+        GLsizeiptr                                                     _textureResidentBytes = 0;
+        unsigned long long                                             _frameCount = 0;
+        std::vector<ShadowAtlasRequest>                                _shadowAtlasRequests;
+        std::vector<dir_shadow_gl_data_block>                          _frameDirShadows;
+        std::vector<cube_shadow_gl_data_block>                         _frameCubeShadows;
+
         GenKeyVector<Mesh>                      _meshes;
         GenKeyVector<MeshGraphicsData>          _meshesGraphicsData;
 
         GenKeyVector<ImageTexture>              _textures;
         GenKeyVector<ImageTextureGraphicsData>  _texturesGraphicsData;
+        std::vector<TextureArray>               _textureArrays;
 
         GenKeyVector<EnvironmentLight>              _environmentTextures;
         GenKeyVector<EnvironmentTextureGraphicsData>  _environmentTexturesGraphicsData;
@@ -886,6 +1387,7 @@ namespace tao_pbr
         tao_ogl_resources::OglSampler _linearSampler;
         tao_ogl_resources::OglSampler _linearSamplerRepeat;
         tao_ogl_resources::OglSampler _linearMipLinearSampler;
+        tao_ogl_resources::OglSampler _linearMipLinearSamplerRepeat;   // material textures
         tao_ogl_resources::OglSampler _shadowSampler;
 
         GenKeyVector<PbrMaterial>       _materials;
@@ -897,6 +1399,10 @@ namespace tao_pbr
 #ifdef ENABLE_GPU_PROFILING
         tao_instrument::GpuStopwatch _gpuStopwatch;
 #endif
+
+        // Last: destroyed first, it waits for the running decodes
+        tao_concurrency::WorkerPool     _textureDecoders;
+
         void InitGBuffer        (int width, int height);
         void ResizeGBuffer      (int width, int height);
         void InitOutputBuffer   (int width, int height);
@@ -908,22 +1414,77 @@ namespace tao_pbr
         void InitLtcLut();
         void InitShadowMaps();
         void InitStaticShaderBuffers();
-        void WriteTransfromToShaderBuffer(const MeshRenderer& mesh, int offset);
-        void WriteTransfromToShaderBuffer(const std::vector<MeshRenderer>& meshes, int offset);
-        void WriteMaterialToShaderBuffer(const MeshRenderer& mesh, int offset);
-        void WriteMaterialToShaderBuffer(const std::vector<MeshRenderer>& meshes, int offset);
-        [[nodiscard]] GenKey<MeshGraphicsData>                CreateGraphicsData(Mesh& mesh);
-        [[nodiscard]] GenKey<ImageTextureGraphicsData>        CreateGraphicsData(ImageTexture& image);
+        void InitMeshArena();
+        int  MeshVertexSize() const;
+        void ReserveMeshArena(unsigned int vboRequiredSize, unsigned int eboRequiredSize);
+        void UpdateDrawList();
+        void CullDrawList(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+        void SelectLods(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+        void BuildLightClusters();
+        void QueryDrawEntries(const tao_math::Frustum* frustum, int planeCount);
+        void AppendDrawCommands(DrawCommandList& list, std::vector<int>::const_iterator first, std::vector<int>::const_iterator last, int lodBias, int meshletView);
+        int  BuildDrawCommandList(DrawCommandList& list, const tao_math::Frustum* frustum = nullptr, int planeCount = tao_math::Frustum::PLANE_COUNT, const glm::mat4* sortView = nullptr, int meshletView = -1);
+        int  BuildShadowCasterLists(ShadowCasterLists& lists, const tao_math::Frustum* frustum = nullptr, int planeCount = tao_math::Frustum::PLANE_COUNT, int meshletView = -1);
+        int  BuildCubeShadowCasterLists(ShadowCasterLists& lists, const glm::vec3& position, const glm::vec2& range);
+        void AppendCubeDrawCommands(DrawCommandList& list, std::vector<int>::const_iterator first, std::vector<int>::const_iterator last, int lodBias, int meshletView);
+        int  AddMeshletView(const tao_math::Frustum* frustum, int planeCount, const glm::vec4& eye);
+        void GroupDrawCommands(DrawCommandList& list, std::vector<int>::const_iterator first, std::vector<int>::const_iterator last, int lodBias, int meshletView);
+        void CullMeshlets();
+        [[nodiscard]] tao_ogl_resources::draw_elements_indirect_command LodCommand(int entry, int lodBias) const;
+        void ReserveDrawIds(unsigned int count);
+        void InvalidateShadowMaps();
+        void AllocateShadowAtlas(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+        void ReserveDirShadowAtlas();
+        void ReserveCubeShadowAtlas(int pages);
+        void ReleaseShadowAtlas();
+        void UploadShadowData();
+        void ReserveFrameRing();
+        static unsigned long long FitShadowAtlasRequests(std::vector<ShadowAtlasRequest>& requests, unsigned long long capacity, int minRes);
+        static void               PackShadowAtlasRequests(std::vector<ShadowAtlasRequest>& requests, int pageSize);
+        void InvalidateShadowMaps(const tao_math::BoundingBox<float, 3>::AaBb& casterBounds, bool dynamicCaster);
+        void SortDrawEntries(std::vector<int>& entries, const glm::mat4& viewMatrix, unsigned int pass);
+        void DrawMeshRenderers(const DrawCommandList& list, bool bindMaterials);
+        void BindMaterialTextures();
+        void FlushShaderBuffers();
+        material_gl_data_block ToGraphicsData(const PbrMaterial& material);
+        static tao_math::BoundingBox<float, 3>::AaBb WorldBounds(const Mesh& mesh, const glm::mat4& model);
+        static float     LodScale(const glm::mat4& model);
+        static glm::vec2 OctahedralEncode(const glm::vec3& v);
+        glm::uvec2 GetMaterialTextureRef(const std::optional<GenKey<ImageTexture>>& tex);
+        unsigned int GetMaterialTextureId(const std::optional<GenKey<ImageTexture>>& tex) const;
+        // The image's top levels to skip to fit an existing array (all arrays
+        // in use), -1 if none fits: the texture can't be sampled.
+        int AddToTextureArray(ImageTextureGraphicsData& gd, tao_ogl_resources::ogl_texture_internal_format internalFormat, int width, int height, int levels);
+        void StreamTextures();
+        void UpdateTextureResidency();
+        void ReadTextureFeedback();
+        bool BeginTextureFeedback();
+        void EndTextureFeedback();
+        void EvictTextureLevel(std::size_t index);
+        // Worker side (no GL): levels from the disk cache or the image
+        static DecodedTexture DecodeTexture(const std::string& path, bool accountForGamma, texture_content content, TextureStreamingSettings settings);
+        void BeginTextureUpload(DecodedTexture&& image);
+        bool TextureReady(const std::optional<GenKey<ImageTexture>>& tex) const;
+        [[nodiscard]] GenKey<MeshGraphicsData>                CreateGraphicsData(const Mesh& mesh, int lodCount);
+        [[nodiscard]] GenKey<ImageTextureGraphicsData>        CreateGraphicsData(const ImageTexture& image);
         [[nodiscard]] GenKey<EnvironmentTextureGraphicsData>  CreateGraphicsData(EnvironmentLight& image);
         [[nodiscard]] EnvironmentTextureGraphicsData          CreateEnvironmentTextures(tao_ogl_resources::OglTexture2D &env);
+        [[nodiscard]] std::optional<EnvironmentTextureGraphicsData> LoadEnvironmentTextures(const std::string& cachePath);
+        void SaveEnvironmentTextures(const EnvironmentTextureGraphicsData& gd, const std::string& cachePath);
+
+        void UpdateShadowMatrices(DirectionalShadowMap &shadowMapData, const tao_pbr::DirectionalLight &l,
+                                  const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, float near, float far);
+        void CreateShadowMap(DirectionalShadowMap &shadowMapData, int cascade, const ShadowCasterLists& casters);
+        void CreateShadowMap(SphereShadowMap      &shadowMapData, const ShadowCasterLists& casters, const tao_pbr::SphereLight      &l);
+        void CreateShadowMap(SphereShadowMap      &shadowMapData, const ShadowCasterLists& casters, const tao_pbr::RectLight        &l);
+        void CreateShadowMap(SphereShadowMap      &shadowMapData, const ShadowCasterLists& casters, const glm::vec3& position, const glm::vec3& direction, const glm::vec3& intensity, float radius);
+
+        // Cube shadow maps: light radius, (near, far) and the view-projection of each face
+        static float     CubeShadowRadius(const tao_pbr::SphereLight &l);
+        static float     CubeShadowRadius(const tao_pbr::RectLight   &l);
+        static glm::vec2 CubeShadowRange(const glm::vec3& intensity, float radius);
+        static void      CubeShadowMatrices(const glm::vec3& position, const glm::vec2& range, glm::mat4 (&matrices)[6]);
 
-        void CreateShadowMap(DirectionalShadowMap &shadowMapData, const tao_pbr::DirectionalLight &l, int shadowMapWidth, int shadowMapHeight);
-        void CreateShadowMap(SphereShadowMap      &shadowMapData, const tao_pbr::SphereLight      &l, int shadowMapResolution);
-        void CreateShadowMap(SphereShadowMap      &shadowMapData, const tao_pbr::RectLight        &l, int shadowMapResolution);
-        void CreateShadowMap(SphereShadowMap      &shadowMapData, const glm::vec3& position, const glm::vec3& direction, const glm::vec3& intensity, float radius, int shadowMapResolution);
-
-        tao_ogl_resources::OglTexture2D& GetGlTexture(const GenKey<ImageTexture>& tex);
-        void BindMaterialTextures(const GenKey<PbrMaterial>& mat);
     };
 
 }
\ No newline at end of file
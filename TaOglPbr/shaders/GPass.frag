@@ -3,6 +3,10 @@
 #define GPASS
 #define GBUFF_WRITE
 
+#ifdef GPASS_BINDLESS_TEXTURES
+#extension GL_ARB_bindless_texture : require
+#endif
+
 //! #include "UboDefs.glsl"
 //! #include "GPassHelper.glsl"
 
@@ -12,20 +16,94 @@ in VS_OUT
     vec3 fragPosWorld;
     vec2 textureCoordinates;
     mat3 TBN;
+    flat int materialIndex;
 }fs_in;
 
-layout(binding=0) uniform sampler2D t_Albedo;
-layout(binding=1) uniform sampler2D t_Emission;
-layout(binding=2) uniform sampler2D t_Normals;
-layout(binding=3) uniform sampler2D t_Metalness;
-layout(binding=4) uniform sampler2D t_Roughness;
-layout(binding=5) uniform sampler2D t_Occlusion;
+Material o_material;
+
+#ifndef TEXTURE_FEEDBACK_TILE
+#define TEXTURE_FEEDBACK_TILE 8
+#endif
+
+// By texture id: the finest resident level, the levels above
+// are streaming in (or evicted, sparse textures)
+layout (std430, binding = 19) readonly buffer blk_TextureResidency
+{
+    float o_textureMinLod[];
+};
+
+// By texture id: the finest level sampled this frame, read back
+// by the renderer to pick the levels to stream in
+layout (std430, binding = 20) buffer blk_TextureFeedback
+{
+    uint o_textureFeedback[];
+};
+
+#ifdef GPASS_BINDLESS_TEXTURES
+
+// The material stores the (resident) texture handle
+vec4 SampleTexture(uvec2 tex, vec2 uv, float minLod, out float lod)
+{
+    lod = textureQueryLod(sampler2D(tex), uv).y;
+    return textureLod(sampler2D(tex), uv, max(lod, minLod));
+}
+
+#else
+
+#ifndef GPASS_MAX_TEXTURE_ARRAYS
+#define GPASS_MAX_TEXTURE_ARRAYS 16
+#endif
+
+// The material stores (array, layer). The index of a sampler
+// array must be dynamically uniform, which the material's is
+// not (multi-draw), hence the switch with constant indices.
+layout(binding=0) uniform sampler2DArray t_TextureArrays[GPASS_MAX_TEXTURE_ARRAYS];
+
+#define SAMPLE_ARRAY(i) case i:                                          \
+    lod = textureQueryLod(t_TextureArrays[i], uv).y;                    \
+    return textureLod(t_TextureArrays[i], uvw, max(lod, minLod));
+
+vec4 SampleTexture(uvec2 tex, vec2 uv, float minLod, out float lod)
+{
+    vec3 uvw = vec3(uv, float(tex.y));
+    lod = 0.0;
+
+    switch(int(tex.x))
+    {
+        SAMPLE_ARRAY(0)  SAMPLE_ARRAY(1)  SAMPLE_ARRAY(2)  SAMPLE_ARRAY(3)
+        SAMPLE_ARRAY(4)  SAMPLE_ARRAY(5)  SAMPLE_ARRAY(6)  SAMPLE_ARRAY(7)
+        SAMPLE_ARRAY(8)  SAMPLE_ARRAY(9)  SAMPLE_ARRAY(10) SAMPLE_ARRAY(11)
+        SAMPLE_ARRAY(12) SAMPLE_ARRAY(13) SAMPLE_ARRAY(14) SAMPLE_ARRAY(15)
+    }
+
+    return vec4(0.0);
+}
+
+#endif
+
+// Two 16 bits ids in each uint
+uint TextureId(uint ids, int i)
+{
+    return (ids >> (16*i)) & 0xFFFFu;
+}
+
+vec4 SampleMaterialTexture(uvec2 tex, uint id, vec2 uv)
+{
+    float lod;
+    vec4 value = SampleTexture(tex, uv, o_textureMinLod[id], lod);
+
+    // One fragment of each tile reports, another one next frame
+    if(f_textureFeedback && ivec2(gl_FragCoord.xy) % TEXTURE_FEEDBACK_TILE == f_feedbackTexel)
+        atomicMin(o_textureFeedback[id], uint(max(lod, 0.0)));
+
+    return value;
+}
 
 vec3 GetAlbedo()
 {
     vec3 albedo =  
         o_material.hasTex_Albedo
-            ? texture(t_Albedo, fs_in.textureCoordinates).rgb
+            ? SampleMaterialTexture(o_material.tex_Albedo, TextureId(o_material.texIds_AlbedoEmission, 0), fs_in.textureCoordinates).rgb
             : o_material.Albedo.rgb;
 
     return albedo;
@@ -35,42 +113,61 @@ vec3 GetEmission()
 {
     vec3 emission =  
         o_material.hasTex_Emission
-            ? texture(t_Emission, fs_in.textureCoordinates).rgb
+            ? SampleMaterialTexture(o_material.tex_Emission, TextureId(o_material.texIds_AlbedoEmission, 1), fs_in.textureCoordinates).rgb
             : o_material.Emission.rgb;
 
     return emission;
 }
 
+// Normal maps are stored as xy (BC5), z is positive in tangent space
+vec3 SampleNormalMap(uvec2 tex, uint id, vec2 uv)
+{
+    vec2 xy = SampleMaterialTexture(tex, id, uv).rg*2.0-1.0;
+    return vec3(xy, sqrt(max(0.0, 1.0-dot(xy, xy))));
+}
+
 vec3 GetNormal()
 {
         return o_material.hasTex_Normals
-            ? normalize (fs_in.TBN * (texture(t_Normals, fs_in.textureCoordinates).rgb*2.0-1.0))
+            ? normalize (fs_in.TBN * SampleNormalMap(o_material.tex_Normals, TextureId(o_material.texIds_NormalsMetalness, 0), fs_in.textureCoordinates))
             : normalize (fs_in.worldNormal);
 }
 
+vec4 SampleMetalness()
+{
+    return SampleMaterialTexture(o_material.tex_Metalness, TextureId(o_material.texIds_NormalsMetalness, 1), fs_in.textureCoordinates);
+}
+
+vec4 SampleRoughness()
+{
+    return SampleMaterialTexture(o_material.tex_Roughness, TextureId(o_material.texIds_RoughnessOcclusion, 0), fs_in.textureCoordinates);
+}
+
 float GetMetalness()
 {
     return o_material.hasTex_Metalness
-            ? (o_material.has_merged_MetalRough ? texture(t_Metalness, fs_in.textureCoordinates).b : texture(t_Metalness, fs_in.textureCoordinates).r)
+            ? (o_material.has_merged_MetalRough ? SampleMetalness().b : SampleMetalness().r)
             : o_material.Metalness;
 }
 
 float GetRoughness()
 {
     return o_material.hasTex_Roughness
-            ? (o_material.has_merged_MetalRough ? texture(t_Roughness, fs_in.textureCoordinates).g : texture(t_Roughness, fs_in.textureCoordinates).r)
+            ? (o_material.has_merged_MetalRough ? SampleRoughness().g : SampleRoughness().r)
             : o_material.Roughness;
 }
 
 float GetOcclusion()
 {
     return o_material.hasTex_Occlusion
-            ? texture(t_Occlusion, fs_in.textureCoordinates).r
+            ? SampleMaterialTexture(o_material.tex_Occlusion, TextureId(o_material.texIds_RoughnessOcclusion, 1), fs_in.textureCoordinates).r
             : 1.0;
 }
 
 void main()
 {
+    o_material = o_materials[fs_in.materialIndex];
+
     vec3 position = fs_in.fragPosWorld;
     vec3 normal     = GetNormal();
     vec3 albedo     = GetAlbedo();
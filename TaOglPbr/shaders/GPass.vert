@@ -2,12 +2,13 @@
 
 #define GPASS
 //! #include "UboDefs.glsl"
+//! #include "MeshVertexHelper.glsl"
 
 layout(location = 0) in vec3 v_position;
-layout(location = 1) in vec3 v_normal;
+layout(location = 1) in vec4 v_normalTangent;
 layout(location = 2) in vec2 v_textureCoordinates;
-layout(location = 3) in vec3 v_tangent;
-layout(location = 4) in vec3 v_bitangent;
+layout(location = 3) in float v_bitangentSign;
+layout(location = 5) in uint v_drawId;
 
 out VS_OUT
 {
@@ -15,11 +16,19 @@ out VS_OUT
     vec3 fragPosWorld;
     vec2 textureCoordinates;
     mat3 TBN;
+    flat int materialIndex;
 }vs_out;
 
 void main()
 {
-    vec4 fragPosWorld = o_modelMat * vec4(v_position, 1.0);
+    DrawData draw = o_drawData[v_drawId];
+    mat4 o_modelMat  = o_transforms[draw.transformIndex].modelMat;
+    mat4 o_normalMat = o_transforms[draw.transformIndex].normalMat;
+
+    vec3 normal, tangent, bitangent;
+    DecodeTangentFrame(v_normalTangent, v_bitangentSign, normal, tangent, bitangent);
+
+    vec4 fragPosWorld = o_modelMat * vec4(DecodePosition(v_position, draw), 1.0);
 
     vec4 clip = f_projMat * f_viewMat * fragPosWorld;
     
@@ -29,14 +38,15 @@ void main()
 
     gl_Position = clip;
     vs_out.fragPosWorld = fragPosWorld.xyz;
-    vs_out.worldNormal = normalize((o_normalMat * vec4(v_normal, 0.0f)).xyz);
+    vs_out.worldNormal = normalize((o_normalMat * vec4(normal, 0.0f)).xyz);
     vs_out.textureCoordinates = v_textureCoordinates;
+    vs_out.materialIndex = draw.materialIndex;
 
     // TBN for normal mapping
     // ----------------------
-    vec3 T = normalize(vec3(o_normalMat * vec4(v_tangent,0.0)));
-    vec3 N = normalize(vec3(o_normalMat * vec4(v_normal, 0.0)));
-    vec3 B = normalize(vec3(o_normalMat * vec4(v_bitangent, 0.0)));
+    vec3 T = normalize(vec3(o_normalMat * vec4(tangent,0.0)));
+    vec3 N = normalize(vec3(o_normalMat * vec4(normal, 0.0)));
+    vec3 B = normalize(vec3(o_normalMat * vec4(bitangent, 0.0)));
 
     vs_out.TBN = mat3(T, B, N);        
        
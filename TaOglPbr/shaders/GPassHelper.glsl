@@ -1,5 +1,65 @@
 //? #version 430 core
 
+// Two layouts:
+// - default (4 x rgba16f):
+//      0: position (3) - roughness (1)
+//      1: normal   (3) - metalness (1)
+//      2: albedo   (3) - occlusion (1)
+//      3: emission (3) - unused    (1)
+// - GBUFF_COMPACT (rg16 + 3 x rgba8), the position
+//   is reconstructed from the depth buffer:
+//      0: normal   (2, octahedral)
+//      1: albedo   (3) - occlusion (1)
+//      2: roughness(1) - metalness (1) - unused (2)
+//      3: emission (4, RGBM)
+
+#ifdef GBUFF_COMPACT
+
+// Emission above this is clamped
+#define GBUFF_RGBM_RANGE 16.0
+
+vec2 OctWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Unit vector to [0, 1]^2
+vec2 EncodeNormalOct(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    n.xy = n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+
+    return n.xy * 0.5 + 0.5;
+}
+
+vec3 DecodeNormalOct(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+
+    vec3  n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+
+    return normalize(n);
+}
+
+vec4 EncodeRGBM(vec3 color)
+{
+    color /= GBUFF_RGBM_RANGE;
+
+    float m = clamp(max(max(color.r, color.g), max(color.b, 1e-6)), 0.0, 1.0);
+    m = ceil(m * 255.0) / 255.0;
+
+    return vec4(clamp(color / m, 0.0, 1.0), m);
+}
+
+vec3 DecodeRGBM(vec4 rgbm)
+{
+    return rgbm.rgb * rgbm.a * GBUFF_RGBM_RANGE;
+}
+#endif
+
 #ifdef GBUFF_WRITE
 layout (location = 0) out vec4 gBuff0;
 layout (location = 1) out vec4 gBuff1;
@@ -8,27 +68,67 @@ layout (location = 3) out vec4 gBuff3;
 
 void WriteGBuff(vec3 albedo, vec3 emission, vec3 position, vec3 normal, float roughness, float metalness, float occlusion)
 {
+#ifdef GBUFF_COMPACT
+    gBuff0 = vec4(EncodeNormalOct(normal), 0.0, 0.0);
+    gBuff1 = vec4(albedo, occlusion);
+    gBuff2 = vec4(roughness, metalness, 0.0, 0.0);
+    gBuff3 = EncodeRGBM(emission);
+#else
     gBuff0 = vec4(position, roughness);
     gBuff1 = vec4(normal, metalness);
     gBuff2 = vec4(albedo, occlusion);
     gBuff3 = vec4(emission, 0.0f);
+#endif
 }
 #endif
 
 #ifdef GBUFF_READ
 
+// Needs UboDefs.glsl (view and frame data)
+
 layout(binding = 0) uniform sampler2D gBuff0;
 layout(binding = 1) uniform sampler2D gBuff1;
 layout(binding = 2) uniform sampler2D gBuff2;
 layout(binding = 3) uniform sampler2D gBuff3;
 
-void ReadGBuff(ivec2 texCoord, out vec3 albedo, out vec3 emission, out vec3 position, out vec3 normal, out float roughness, out float metalness, out float occlusion)
+#ifdef GBUFF_COMPACT
+layout(binding = 11) uniform sampler2D gBuffDepth;
+
+vec3 ReconstructWorldPos(ivec2 texCoord, float depth)
+{
+    vec2 ndc = (vec2(texCoord) + 0.5) / f_viewportSize * 2.0 - 1.0;
+
+    // Undo the TAA jitter (see GPass.vert)
+    if(f_doTaa)
+        ndc -= f_taa_jitter / (0.5 * f_viewportSize);
+
+    vec4 p = f_invViewProjMat * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+
+    return p.xyz / p.w;
+}
+#endif
+
+// Returns false where no geometry was drawn (sky)
+bool ReadGBuff(ivec2 texCoord, out vec3 albedo, out vec3 emission, out vec3 position, out vec3 normal, out float roughness, out float metalness, out float occlusion)
 {
     vec4 gData0 = texelFetch(gBuff0, texCoord, 0).rgba;
     vec4 gData1 = texelFetch(gBuff1, texCoord, 0).rgba;
     vec4 gData2 = texelFetch(gBuff2, texCoord, 0).rgba;
     vec4 gData3 = texelFetch(gBuff3, texCoord, 0).rgba;
 
+#ifdef GBUFF_COMPACT
+    float depth = texelFetch(gBuffDepth, texCoord, 0).r;
+
+    position    = ReconstructWorldPos(texCoord, depth);
+    normal      = DecodeNormalOct(gData0.rg);
+    albedo      = gData1.rgb;
+    occlusion   = gData1.a;
+    roughness   = gData2.r;
+    metalness   = gData2.g;
+    emission    = DecodeRGBM(gData3);
+
+    return depth < 1.0;
+#else
     position    = gData0.rgb;
     roughness   = gData0.a;
     normal      = gData1.rgb;
@@ -36,5 +136,8 @@ void ReadGBuff(ivec2 texCoord, out vec3 albedo, out vec3 emission, out vec3 posi
     albedo      = gData2.rgb;
     occlusion   = gData2.a;
     emission    = gData3.rgb;
+
+    return position != vec3(0.0);
+#endif
 }
 #endif
@@ -0,0 +1,119 @@
+//? #version 430 core
+
+// Needs UboDefs.glsl (view and frame data)
+
+layout (std140, binding = 4) uniform blk_LightsData
+{
+    bool    u_doEnvironment;
+    float   u_environmentIntensity;
+    int     u_directionalLightsCnt;
+    int     u_sphereLightsCnt;
+    int     u_rectLightsCnt;
+};
+
+// -------------!!! IMPORTANT !!!------------------ //
+// ------------------------------------------------ //
+// All the following structures have vec4s          //
+// instead of vec3 on the cpp side. std430          //
+// still needs padding for vec3.                    //
+// Here I left vec3s to avoid unnecessary .xyz      //
+// in the shader code.                              //
+// ------------------------------------------------ //
+struct DirectionalLight
+{
+    vec3 direction;
+    vec3 intensity;
+};
+
+struct SphereLight
+{
+    vec3  position;
+    vec3  intensity;
+    float radius;
+};
+
+struct RectLight
+{
+    vec3 position;
+    vec3 intensity;
+    vec3 axisX; // plane's x
+    vec3 axisY; // plane's y
+    vec3 axisZ; // plane's normal
+    vec2 size;
+};
+
+// Light clusters
+// ------------------------------------------------
+// The view frustum is split in CLUSTER_GRID_X * CLUSTER_GRID_Y
+// screen tiles and CLUSTER_GRID_Z depth slices (exponential,
+// between f_near and f_far). LightCulling.comp lists the sphere
+// and rect lights reaching each cluster: their indices are at
+// [offset, offset + sphereCount) and right after at
+// [offset + sphereCount, offset + sphereCount + rectCount).
+struct LightCluster
+{
+    uint offset;
+    uint sphereCount;
+    uint rectCount;
+    uint pad;
+};
+
+layout (std430, binding = 9) buffer blk_LightClusters
+{
+    LightCluster o_lightClusters[];
+};
+
+layout (std430, binding = 10) buffer blk_ClusterLightIndices
+{
+    uint o_clusterLightIndexCount;  // reset every frame, can exceed CLUSTER_INDEX_CAPACITY
+    uint o_clusterLightIndices[];   // CLUSTER_INDEX_CAPACITY
+};
+
+// Same as ComputeSphereLightRadius (PbrRenderer.cpp)
+#define LIGHT_INFLUENCE_TOLERANCE 0.0002
+
+float ClusterSliceDepth(int slice)
+{
+    return f_near * pow(f_far / f_near, float(slice) / float(CLUSTER_GRID_Z));
+}
+
+int ClusterSlice(float viewDepth)
+{
+    int slice = int(floor(log(max(viewDepth, f_near) / f_near) / log(f_far / f_near) * float(CLUSTER_GRID_Z)));
+    return clamp(slice, 0, CLUSTER_GRID_Z - 1);
+}
+
+int ClusterIndex(ivec3 cluster)
+{
+    return cluster.x + CLUSTER_GRID_X * (cluster.y + CLUSTER_GRID_Y * cluster.z);
+}
+
+ivec3 ClusterCoord(vec2 fragCoord, float viewDepth)
+{
+    ivec2 tile = ivec2(fragCoord / f_viewportSize * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y));
+    tile = clamp(tile, ivec2(0), ivec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+
+    return ivec3(tile, ClusterSlice(viewDepth));
+}
+
+bool SphereAabbOverlap(vec3 center, float radius, vec3 aabbMin, vec3 aabbMax)
+{
+    vec3 d = center - clamp(center, aabbMin, aabbMax);
+    return dot(d, d) <= radius * radius;
+}
+
+// Point at `depth` on the ray from the eye through `ndc` (view space)
+vec3 ViewRayAtDepth(mat4 invProj, vec2 ndc, float depth)
+{
+    vec4 p = invProj * vec4(ndc, -1.0, 1.0);
+    p.xyz /= p.w;
+
+    return p.xyz * (depth / -p.z);
+}
+
+// Distance from the light's center beyond which
+// its contribution is negligible
+float LightInfluenceRange(vec3 intensity, float radius)
+{
+    return radius + sqrt(max(max(intensity.r, intensity.g), intensity.b) / (4.0 * PI * LIGHT_INFLUENCE_TOLERANCE));
+}
@@ -1,9 +1,5 @@
 #version 430 core
 
-#define GBUFF_READ
-
-//! #include "GPassHelper.glsl"
-
 layout(location = 0) in vec2 v_position;
 
 void main()
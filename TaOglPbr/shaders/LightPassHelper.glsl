@@ -0,0 +1,332 @@
+//? #version 440 core
+
+// Light pass shading, shared by the fragment shader (full screen
+// quad) and the compute shader (16x16 tiles). Needs UboDefs.glsl,
+// PbrHelper.glsl, ShadowHelper.glsl and LightDefs.glsl.
+
+#ifdef LIGHT_PASS_ENVIRONMENT
+layout(binding = 4) uniform sampler2D   envBrdfLut;
+layout(std430, binding = 21) readonly buffer buff_env_irradiance
+{
+    vec4 envIrradianceSh[9];                // see EvalSH9
+};
+layout(binding = 6) uniform samplerCube envPrefiltered;
+
+uniform int u_envPrefilteredMinLod;
+uniform int u_envPrefilteredMaxLod;
+#endif
+
+#ifdef LIGHT_PASS_DIRECTIONAL
+// The cascades of all the lights share the atlas,
+// at [lightIndex * MAX_DIR_SHADOW_CASCADES + cascade]
+struct DirShadowCascade
+{
+    mat4 shadowMatrix;
+    vec4 size;
+    vec4 tile;          // atlas uv offset (xy) and scale (zw), 0: no shadow map
+    vec4 lightPosSplit; // light position (xyz), split view depth (w)
+};
+
+layout(binding = 9) uniform sampler2D dirShadowAtlas;
+                    uniform int       u_dirShadowCascades;
+layout(std430, binding = 11) readonly buffer buff_dir_shadows
+{
+    DirShadowCascade dirShadows[];
+};
+layout(std430, binding = 5) buffer buff_directional_lights
+{
+    DirectionalLight directionalLights[];
+};
+#endif
+
+#if defined(LIGHT_PASS_SPHERE) || defined(LIGHT_PASS_RECT)
+// Sphere lights first, then rect lights ([u_sphereLightsCnt + lightIndex])
+struct CubeShadow
+{
+    vec4 size;
+    vec4 tile;          // page uv offset (xy), scale (z) and page (w), 0 scale: no shadow map
+};
+
+layout(binding = 10) uniform samplerCubeArray cubeShadowAtlas;
+layout(std430, binding = 12) readonly buffer buff_cube_shadows
+{
+    CubeShadow cubeShadows[];
+};
+#endif
+
+#ifdef LIGHT_PASS_SPHERE
+layout(std430, binding = 6) buffer buff_sphere_lights
+{
+    SphereLight sphereLights[];
+};
+#endif
+
+#ifdef LIGHT_PASS_RECT
+const float LTC_LUT_SIZE  = 64.0;
+const float LTC_LUT_BIAS  = 0.5/LTC_LUT_SIZE;
+const float LTC_LUT_SCALE = ((LTC_LUT_SIZE - 1.0)/LTC_LUT_SIZE);
+
+//! #include "LtcHelper.glsl"
+
+layout(binding = 7) uniform sampler2D ltcLut1;
+layout(binding = 8) uniform sampler2D ltcLut2;
+
+layout(std430, binding = 7) buffer buff_rect_lights
+{
+    RectLight rectLights[];
+};
+#endif
+
+// Directional Light
+// -------------------------------------------------------------------------------------------------------------------------
+vec3 DiffuseDirectionalLight(vec3 lightDirection, vec3 surfNormal, vec3 diffuse, float metalness, vec3 lightColor)
+{
+    float NoL = CLAMPED_DOT(lightDirection, surfNormal);
+    vec3 c = diffuse.rgb * lightColor * NoL;
+    return  mix(c, vec3(0.0), metalness);
+}
+
+vec3 SpecularDirectionalLight(vec3 viewDirection, vec3 lightDirection, vec3 surfNormal,vec3 F0, float roughness, vec3 lightColor)
+{
+    return  lightColor * CLAMPED_DOT(lightDirection, surfNormal) * SpecularBRDF(viewDirection, lightDirection, surfNormal, F0, roughness);
+}
+
+// First cascade whose split is beyond the surface, -1 if none
+int SelectShadowCascade(vec3 surfPosition, int lightIndex)
+{
+    float viewDepth = -(f_viewMat * vec4(surfPosition, 1.0)).z;
+
+    for(int c = 0; c < u_dirShadowCascades; c++)
+        if(viewDepth < dirShadows[lightIndex * MAX_DIR_SHADOW_CASCADES + c].lightPosSplit.w) return c;
+
+    return -1;
+}
+
+vec3 ComputeDirectionalLight(vec3 viewDirection, vec3 lightDirection, vec3 surfPosition, vec3 surfNormal, vec3 f0, vec3 diffuse, float roughness,float metalness, vec3 lightColor,
+                             int lightIndex)
+{
+    int cascade = SelectShadowCascade(surfPosition, lightIndex);
+
+    if(cascade >= 0)
+    {
+        DirShadowCascade shadow = dirShadows[lightIndex * MAX_DIR_SHADOW_CASCADES + cascade];
+
+        // No room in the atlas: no shadows
+        if(shadow.tile.z > 0.0)
+        {
+            float visibility =
+            PCSS_DirectionalLight(
+                surfPosition, surfNormal,
+                dirShadowAtlas, shadow.tile,
+                shadow.shadowMatrix,
+                shadow.size,
+                shadow.lightPosSplit.xyz,
+                lightDirection, 0.02, 1e-3);
+
+            lightColor*=visibility;
+        }
+    }
+
+    vec3 kd = 1.0 - SpecularF(f0, CLAMPED_DOT(surfNormal, viewDirection));
+    vec3 directDiffuse  = DiffuseDirectionalLight(lightDirection, surfNormal, diffuse, metalness, lightColor);
+    vec3 directSpecular = SpecularDirectionalLight(viewDirection, lightDirection, surfNormal, f0, roughness, lightColor);
+
+    return kd * directDiffuse + directSpecular; // "ks" is already in the GGX brdf
+}
+vec3 ComputeDirectionalLight(vec3 viewDirection, vec3 surfPosition, vec3 surfNormal, vec3 f0, vec3 diffuse, float roughness,float metalness, DirectionalLight l,
+                             int lightIndex)
+{
+    return ComputeDirectionalLight(viewDirection, -l.direction, surfPosition, surfNormal, f0, diffuse, roughness,metalness, l.intensity, lightIndex);
+}
+
+// Sphere Light (area)
+// -------------------------------------------------------------------------------------------------------------------------
+vec3 ComputeSphereLight(
+    vec3 viewDirection, vec3 surfPosition, vec3 surfNormal , vec3 surfDiffuse, float surfRoughness, float surfMetalness, vec3 surfF0,
+    SphereLight l, int lightIndex)
+{
+    // avoid problems with radius = 0.0
+    l.radius = max(l.radius, 1e-4);
+
+     CubeShadow shadow = cubeShadows[lightIndex];
+     if(shadow.tile.z > 0.0)
+     {
+         float visibility = PCSS_SphereLight
+         (
+           surfPosition, surfNormal, cubeShadowAtlas, shadow.tile,
+           l.position, l.radius, shadow.size, 5e-3
+         );
+
+         l.intensity*=visibility;
+     }
+
+    // Diffuse
+    // --------------------------------------------------
+    vec3 kd = 1.0 - SpecularF(surfF0, CLAMPED_DOT(viewDirection, surfNormal));
+
+    float ill = ComputeSphereLightIlluminanceW(surfPosition, surfNormal, l.position, l.radius);
+    ill*= 1.0/(4.0*PI*l.radius*l.radius);
+
+    vec3 c = surfDiffuse.rgb * l.intensity * ill;
+    vec3 diffuse =  mix(c, vec3(0.0), surfMetalness);
+
+
+    // Specular
+    // --------------------------------------------------
+    // see Karis notes "Representative point method"
+    vec3 mrp = RepresentativePointOnSphere(viewDirection, surfPosition, surfNormal, surfRoughness, l.position, l.radius);
+    vec3 dominantDir = normalize(mrp -surfPosition);
+
+    float lightDistance = length(surfPosition - l.position);
+    float a0 = surfRoughness*surfRoughness;
+    float a1 = SATURATE(a0 + (l.radius)/(3.0*lightDistance));
+    float a  = a1*a1;
+
+    // Instead of a falloff I'm using the illuminance computed earlier
+    vec3 lIn = l.intensity*CLAMPED_DOT(surfNormal, dominantDir)*ill;
+
+    vec3 specular = lIn*SpecularBRDF_Area(viewDirection, dominantDir, surfNormal, surfF0, surfRoughness, a);
+
+    return kd*diffuse + specular;
+}
+
+// Rect Light (area)
+// -------------------------------------------------------------------------------------------------------------------------
+
+// from: https://github.com/selfshadow/ltc_code
+vec3 ComputeRectLightLTC(vec3 viewDirection, vec3 surfPosition, vec3 surfNormal , vec3 surfDiffuse, float surfRoughness, float surfMetalness, vec3 surfF0, RectLight l,
+                         int lightIndex)
+{
+    CubeShadow shadow = cubeShadows[u_sphereLightsCnt + lightIndex];
+    if(shadow.tile.z > 0.0)
+    {
+        // do rect smooth shadows as if they were sphere lights
+        float visibility = PCSS_SphereLight
+        (
+            surfPosition, surfNormal, cubeShadowAtlas, shadow.tile,
+            l.position, 0.5 * min(l.size.x, l.size.y),
+            shadow.size, 5e-3
+        );
+
+        l.intensity*=visibility;
+    }
+
+    l.size = max(l.size, vec2(1e-4));
+    bool twoSided = false;
+
+    vec3 pos = surfPosition;
+    vec3 N = surfNormal;
+    vec3 V = viewDirection;
+
+    vec3 points[4];
+    LTC_InitRectPoints(l, points);
+
+    float ndotv = SATURATE(dot(N, V));
+    vec2 uv = vec2(surfRoughness, sqrt(1.0 - ndotv));
+    uv = uv*LTC_LUT_SCALE + LTC_LUT_BIAS;
+
+    vec4 t1 = texture(ltcLut1, uv);
+    vec4 t2 = texture(ltcLut2, uv);
+
+    mat3 Minv = mat3(
+        vec3(t1.x, 0, t1.y),
+        vec3(  0,  1,    0),
+        vec3(t1.z, 0, t1.w)
+    );
+
+    vec3 spec = LTC_Evaluate(N, V, pos, Minv, points, twoSided, ltcLut2);
+    // BRDF shadowing and Fresnel
+    spec *= surfF0*t2.x + (1.0 - surfF0)*t2.y;
+
+    vec3 diff = mix(LTC_Evaluate(N, V, pos, mat3(1), points, twoSided, ltcLut2), vec3(0.0), surfMetalness);
+
+    return  (l.intensity/(l.size.x*l.size.y))*(spec + surfDiffuse*diff);
+}
+
+// This was not great and is not used anymore....
+// See ComputeRectLightLTC instead.
+//vec3 ComputeRectLight(vec3 viewDirection, vec3 surfPosition, vec3 surfNormal , vec3 surfDiffuse, float surfRoughness, float surfMetalness, vec3 surfF0, RectLight l)
+//{
+//    // Diffuse
+//    // --------------------------------------------------
+//    vec3 kd = 1.0 - SpecularF(surfF0, CLAMPED_DOT(viewDirection, surfNormal));
+//
+//    if ( dot ( surfPosition - l.position , l.axisZ) <= 0.0) return vec3(0.0);
+//
+//    // most representative pointS, see Lagarde's presentation:
+//    // https://seblagarde.files.wordpress.com/2015/07/course_notes_moving_frostbite_to_pbr_v32.pdf
+//    vec3 p0 = l.position - 0.5 * l.size.x * l.axisX + 0.5 * l.size.y * l.axisY;
+//    vec3 p1 = l.position - 0.5 * l.size.x * l.axisX - 0.5 * l.size.y * l.axisY;
+//    vec3 p2 = l.position + 0.5 * l.size.x * l.axisX - 0.5 * l.size.y * l.axisY;
+//    vec3 p3 = l.position + 0.5 * l.size.x * l.axisX + 0.5 * l.size.y * l.axisY;
+//    float solidAngle = RectangleSolidAngle (surfPosition , p0 , p1 , p2 , p3 );
+//
+//    float ill = solidAngle * 0.2 * (
+//    SATURATE( dot( normalize ( p0 - surfPosition ) , surfNormal ) )+
+//    SATURATE( dot( normalize ( p1 - surfPosition ) , surfNormal ) )+
+//    SATURATE( dot( normalize ( p2 - surfPosition ) , surfNormal ) )+
+//    SATURATE( dot( normalize ( p3 - surfPosition ) , surfNormal ) )+
+//    SATURATE( dot( normalize ( l.position - surfPosition ) , surfNormal )));
+//
+//
+//    ill*= 1.0/(l.size.x*l.size.y);
+//
+//    vec3 c = surfDiffuse.rgb * l.intensity * ill;
+//    vec3 diffuse =  mix(c, vec3(0.0), surfMetalness);
+//
+//
+//    ReprPointRectRes mrp = RepresentativePointOnRect(viewDirection, surfPosition, surfNormal, surfRoughness, l.position, l.axisX, l.axisY, l.axisZ, l.size);
+//    vec3 mrd = normalize(mrp.pointClamped-surfPosition);
+//
+//    float fac = mrp.overlap;
+//
+//    vec3 specular = fac*ill*l.intensity* CLAMPED_DOT(surfNormal, mrd)* SpecularBRDF(viewDirection, mrd, surfNormal, surfF0, surfRoughness);
+//
+//    return kd*diffuse + specular;
+//}
+
+
+// Ambient Light
+// -------------------------------------------------------------------------------------------------------------------------
+vec3 ComputeAmbientLight(vec3 viewDir, vec3 normal, vec3 f0, vec3 diffuse, float roughness, float metalness,
+                         float environemtIntensity, float radianceMinLod, float radianceMaxLod,
+                         vec4 irradianceSh[9], samplerCube prefilteredEnv, sampler2D brdfLut)
+{
+    // Diffuse
+    // -------------
+    vec3 ambientD = environemtIntensity * diffuse * EvalSH9(irradianceSh, normal.xzy * vec3(1,-1,1));
+    ambientD = mix(ambientD, vec3(0.0), metalness);
+
+    // Specular
+    // -------------
+    vec3 reflDir = reflect(-viewDir, normal);
+    reflDir = reflDir.xzy * vec3(1,-1,1); // TODO
+
+    float NoV = CLAMPED_DOT(normal, viewDir);
+    float lod = radianceMinLod + roughness * (radianceMaxLod - radianceMinLod);
+    vec3 irr       = textureLod(prefilteredEnv, normalize(reflDir), lod).rgb;
+    vec2 scaleBias = texture(brdfLut, vec2(roughness, NoV)).xy;
+    vec3 ambientS  = environemtIntensity * irr * (f0 * scaleBias.x + scaleBias.y);
+
+    return ambientS + ambientD;
+}
+
+// Directional and environment lights (they reach every surface)
+// -------------------------------------------------------------------------------------------------------------------------
+vec3 ComputeGlobalLights(vec3 viewDir, vec3 posWorld, vec3 nrmWorld, vec3 f0, vec3 albedo, float roughness, float metalness)
+{
+    vec3 col = vec3(0.0);
+
+#ifdef LIGHT_PASS_DIRECTIONAL
+    for(int i=0;i<u_directionalLightsCnt;i++)
+        col += ComputeDirectionalLight(viewDir, posWorld, nrmWorld, f0, albedo, roughness, metalness, directionalLights[i], i);
+#endif
+
+#ifdef LIGHT_PASS_ENVIRONMENT
+    if(u_doEnvironment)
+        col += ComputeAmbientLight(viewDir, nrmWorld, f0, albedo, roughness, metalness, u_environmentIntensity,
+                                   u_envPrefilteredMinLod, u_envPrefilteredMaxLod, envIrradianceSh, envPrefiltered, envBrdfLut);
+#endif
+
+    return col;
+}
@@ -0,0 +1,29 @@
+//? #version 430 core
+
+// Mesh arena vertex decoding (see PbrRenderer::CreateGraphicsData):
+//  - position: floats, or 16 bit fractions of the mesh bounds
+//  - normal and tangent: octahedral, snorm16
+//  - bitangent: sign * cross(normal, tangent)
+
+vec3 DecodePosition(vec3 position, DrawData draw)
+{
+    return draw.positionOffset.xyz + draw.positionScale.xyz * position;
+}
+
+// [-1, 1]^2 to unit vector
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3  v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-v.z, 0.0, 1.0);
+    v.x += v.x >= 0.0 ? -t : t;
+    v.y += v.y >= 0.0 ? -t : t;
+
+    return normalize(v);
+}
+
+void DecodeTangentFrame(vec4 normalTangent, float bitangentSign, out vec3 normal, out vec3 tangent, out vec3 bitangent)
+{
+    normal    = DecodeOctahedral(normalTangent.xy);
+    tangent   = DecodeOctahedral(normalTangent.zw);
+    bitangent = bitangentSign * cross(normal, tangent);
+}
@@ -35,7 +35,37 @@ vec3 ClampHDRValue(vec3 val, float maxIntensity)
     // insanely high values (>1e3).
     // so by clamping the intensity we get smooth irradiance
     // maps even with this limited amount of samples
-    return (val/intensity) * min(intensity, maxIntensity);
+    return intensity>0.0 ? (val/intensity) * min(intensity, maxIntensity) : val;
+}
+
+// Spherical harmonics, 3 bands (9 coefficients)
+// from: https://graphics.stanford.edu/papers/envmap/envmap.pdf
+// ------------------------------------------------------------------------------------------------------
+void SH9Basis(vec3 d, out float y[9])
+{
+    y[0] = 0.282095;
+    y[1] = 0.488603 * d.y;
+    y[2] = 0.488603 * d.z;
+    y[3] = 0.488603 * d.x;
+    y[4] = 1.092548 * d.x*d.y;
+    y[5] = 1.092548 * d.y*d.z;
+    y[6] = 0.315392 * (3.0*d.z*d.z - 1.0);
+    y[7] = 1.092548 * d.x*d.z;
+    y[8] = 0.546274 * (d.x*d.x - d.y*d.y);
+}
+
+// `sh` is the radiance convolved with the clamped cosine (over PI):
+// the result is the irradiance the diffuse albedo multiplies.
+vec3 EvalSH9(vec4 sh[9], vec3 d)
+{
+    float y[9];
+    SH9Basis(d, y);
+
+    vec3 res = vec3(0.0);
+    for(int i=0;i<9;i++) res += sh[i].rgb * y[i];
+
+    // ringing can go below zero
+    return max(res, vec3(0.0));
 }
 
 // from: https://blog.selfshadow.com/publications/s2013-shading-course/karis/s2013_pbs_epic_notes_v2.pdf
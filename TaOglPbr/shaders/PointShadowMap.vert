@@ -1,13 +1,42 @@
 #version 430 core
 
+#ifdef POINT_SHADOWS_VERTEX_LAYER
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
+
 #define SHADOWPASS
+#define CUBE_SHADOWPASS
 //! #include "UboDefs.glsl"
+//! #include "MeshVertexHelper.glsl"
 
 layout(location = 0) in vec3 v_position;
+layout(location = 5) in uint v_drawId;
+
+#ifdef POINT_SHADOWS_VERTEX_LAYER
+uniform vec3 u_lightWorldPos;
+uniform mat4 u_viewProjMat[6];
+uniform int  u_cubeLayer;   // cube of the atlas (page)
+
+out float v_lightDstWorld;
+#else
+flat out int v_faceMask;
+#endif
 
 void main()
 {
-    vec4 fragPosWorld = o_modelMat * vec4(v_position, 1.0);
+    CubeInstance cubeInstance = o_cubeInstances[v_drawId];
+
+    DrawData draw   = o_drawData[cubeInstance.drawIndex];
+    mat4 o_modelMat = o_transforms[draw.transformIndex].modelMat;
+    vec4 fragPosWorld = o_modelMat * vec4(DecodePosition(v_position, draw), 1.0);
 
+#ifdef POINT_SHADOWS_VERTEX_LAYER
+    // One instance for each face the caster is seen from
+    gl_Layer = u_cubeLayer * 6 + cubeInstance.faces;
+    gl_Position = u_viewProjMat[cubeInstance.faces] * fragPosWorld;
+    v_lightDstWorld = length(fragPosWorld.xyz-u_lightWorldPos);
+#else
     gl_Position = fragPosWorld; // the view-proj transform is applied in the geometry shader
+    v_faceMask = cubeInstance.faces;
+#endif
 }
\ No newline at end of file
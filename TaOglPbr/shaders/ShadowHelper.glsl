@@ -44,6 +44,50 @@ vec2 Rotate2D(vec2 p, float angle)
     return vec2(p.x*c-p.y*s, p.x*s+p.y*c);
 }
 
+// Shadow atlases
+// -------------------------------------------------------------------------------------------------------------------------
+// `tile`: uv offset (xy) and scale (zw) of the shadow map in the atlas.
+// Samples are kept half a texel inside, the neighbours don't leak in.
+vec2 AtlasUV(sampler2D atlas, vec4 tile, vec2 uv)
+{
+    vec2 halfTexel = 0.5 / (vec2(textureSize(atlas, 0)) * tile.zw);
+    return tile.xy + clamp(uv, halfTexel, 1.0 - halfTexel) * tile.zw;
+}
+
+// Each cube of the array (page) holds several shadow maps, each one takes
+// the same square region of the 6 faces. `tile`: uv offset (xy) and scale
+// (z) of the region, page (w). Returns the direction (xyz) and the layer
+// (w) to sample the light's cube map at `dir`.
+vec4 CubeAtlasCoord(samplerCubeArray atlas, vec4 tile, vec3 dir)
+{
+    // Face and face uv, see the OpenGL spec (cube map texture selection)
+    vec3  a = abs(dir);
+    int   face;
+    float sc, tc, ma;
+    if(a.x >= a.y && a.x >= a.z) { face = dir.x > 0.0 ? 0 : 1; ma = a.x; sc = dir.x > 0.0 ? -dir.z : dir.z; tc = -dir.y; }
+    else if(a.y >= a.z)          { face = dir.y > 0.0 ? 2 : 3; ma = a.y; sc = dir.x; tc = dir.y > 0.0 ? dir.z : -dir.z; }
+    else                         { face = dir.z > 0.0 ? 4 : 5; ma = a.z; sc = dir.z > 0.0 ? dir.x : -dir.x; tc = -dir.y; }
+
+    vec2 uv = 0.5 * (vec2(sc, tc) / ma + 1.0);
+
+    float halfTexel = 0.5 / (float(textureSize(atlas, 0).x) * tile.z);
+    uv = tile.xy + clamp(uv, halfTexel, 1.0 - halfTexel) * tile.z;
+
+    // Back to a direction, same face
+    sc = 2.0 * uv.x - 1.0;
+    tc = 2.0 * uv.y - 1.0;
+
+    vec3 d;
+    if     (face == 0) d = vec3( 1.0, -tc , -sc );
+    else if(face == 1) d = vec3(-1.0, -tc ,  sc );
+    else if(face == 2) d = vec3( sc ,  1.0,  tc );
+    else if(face == 3) d = vec3( sc , -1.0, -tc );
+    else if(face == 4) d = vec3( sc , -tc ,  1.0);
+    else               d = vec3(-sc , -tc , -1.0);
+
+    return vec4(d, tile.w);
+}
+
 float BiasPointShadow(vec3 lightPos, vec3 surfPos, vec3 lightDir, vec3 surfNormal, vec4 shadowMapSize, ivec2 shadowMapRes)
 {
 
@@ -62,6 +106,12 @@ float InterleavedGradientNoise(vec2 position_screen)
     return fract(magic.z * fract(dot(position_screen, magic.xy)));
 }
 
+// Screen pixel seeding the noise, the compute light
+// pass defines its own (no gl_FragCoord there)
+#ifndef SHADOW_NOISE_PIXEL
+#define SHADOW_NOISE_PIXEL (gl_FragCoord.xy-0.5)
+#endif
+
 float SlopeBiasForPCSS(vec3 worldNormal, vec3 worldLightDirection, float sampleOffsetWorld)
 {
     float angle = acos(dot(worldNormal, worldLightDirection));
@@ -70,7 +120,7 @@ float SlopeBiasForPCSS(vec3 worldNormal, vec3 worldLightDirection, float sampleO
 }
 
 float FindBlockerDistance_DirectionalLight(
-    vec3 surfPos,vec3 surfNormal, sampler2D shadowMap,
+    vec3 surfPos,vec3 surfNormal, sampler2D shadowAtlas, vec4 tile,
     mat4 shadowTransform, vec4 shadowSize,
     vec3 lightDir, float searchWidth,
     float bias /* base bias added to a slope bias computed here  */)
@@ -93,14 +143,14 @@ float FindBlockerDistance_DirectionalLight(
     {
 
         // random rotation (better noise than banding)
-        float rnd = InterleavedGradientNoise(gl_FragCoord.xy-0.5);
+        float rnd = InterleavedGradientNoise(SHADOW_NOISE_PIXEL);
         vec2 offsetDir = SMP_VOGEL_16[i];
         offsetDir = Rotate2D(offsetDir, rnd*PI2);
 
         vec2 offset = searchWidthUV*offsetDir;
         float coneBiasSmp = coneBias*searchWidth*length(offsetDir)/zScale;
 
-        float closestDepth = texture(shadowMap, smpLS.xy+offset).r;
+        float closestDepth = texture(shadowAtlas, AtlasUV(shadowAtlas, tile, smpLS.xy+offset)).r;
 
         float diff = (refVal - closestDepth);
 
@@ -119,7 +169,7 @@ float FindBlockerDistance_DirectionalLight(
 }
 
 float FindBlockerDistance_SphereLight(
-    vec3 surfPos,vec3 surfNormal, samplerCube shadowMap,
+    vec3 surfPos,vec3 surfNormal, samplerCubeArray shadowAtlas, vec4 tile,
     vec3 lightPos, float searchRadius,
     float bias /* base bias added to a slope bias computed here  */)
 {
@@ -145,14 +195,14 @@ float FindBlockerDistance_SphereLight(
     {
 
         // random rotation (better noise than banding)
-        float rnd = InterleavedGradientNoise(gl_FragCoord.xy-0.5);
+        float rnd = InterleavedGradientNoise(SHADOW_NOISE_PIXEL);
         vec2 offsetDir = Rotate2D(SMP_GRID_9[i], rnd*PI2);
         vec3 offset = offsetDir.x*right + offsetDir.y*up;
         vec3 smpDir= dir + searchW*offset;
 
         float smpBias = searchW * length(offset) * coneBias;
 
-        float closestDepth = texture(shadowMap, smpDir).r;
+        float closestDepth = texture(shadowAtlas, CubeAtlasCoord(shadowAtlas, tile, smpDir)).r;
 
         float diff = (refVal - closestDepth);
 
@@ -171,7 +221,7 @@ float FindBlockerDistance_SphereLight(
 }
 
 float PCF_DirectionalLight(
-    vec3 surfPos,vec3 surfNormal, sampler2D shadowMap,
+    vec3 surfPos,vec3 surfNormal, sampler2D shadowAtlas, vec4 tile,
     mat4 shadowTransform, vec4 shadowSize,
     vec3 lightDir, float filterSize,
     float bias /* base bias added to a slope bias computed here  */)
@@ -194,10 +244,10 @@ float PCF_DirectionalLight(
         float coneBiasSmp = coneBias*filterSize*length(offsetDir);
 
         // random rotation (better noise than banding)
-        float rnd = InterleavedGradientNoise(gl_FragCoord.xy-0.5);
+        float rnd = InterleavedGradientNoise(SHADOW_NOISE_PIXEL);
         vec2 offset = filterSizeUV * Rotate2D(offsetDir, rnd*PI2);
 
-        float diff = refVal - texture(shadowMap, smpLS.xy+offset).r;
+        float diff = refVal - texture(shadowAtlas, AtlasUV(shadowAtlas, tile, smpLS.xy+offset)).r;
         if (diff < (bias + coneBiasSmp))
         {
             sum++;
@@ -208,7 +258,7 @@ float PCF_DirectionalLight(
 }
 
 float PCF_SphereLight(
-    vec3 surfPos,vec3 surfNormal, samplerCube shadowMap,
+    vec3 surfPos,vec3 surfNormal, samplerCubeArray shadowAtlas, vec4 tile,
     vec3 lightPos, float filterRadius,
     float bias /* base bias added to a slope bias computed here  */)
 {
@@ -232,14 +282,14 @@ float PCF_SphereLight(
     {
 
         // random rotation (better noise than banding)
-        float rnd = InterleavedGradientNoise(gl_FragCoord.xy-0.5);
+        float rnd = InterleavedGradientNoise(SHADOW_NOISE_PIXEL);
         vec2 offsetDir = Rotate2D(SMP_VOGEL_16[i], rnd*PI2);
         vec3 offset = offsetDir.x*right + offsetDir.y*up;
         vec3 smpDir= dir + searchW*offset;
 
         float smpBias = searchW * length(offset) * coneBias;
 
-        float closestDepth = texture(shadowMap, smpDir).r;
+        float closestDepth = texture(shadowAtlas, CubeAtlasCoord(shadowAtlas, tile, smpDir)).r;
 
         float diff = (refVal - closestDepth);
 
@@ -254,7 +304,7 @@ float PCF_SphereLight(
 
 float PCSS_DirectionalLight(
     vec3 surfPos,vec3 surfNormal,
-    sampler2D shadowMap, mat4 shadowTransform,
+    sampler2D shadowAtlas, vec4 tile, mat4 shadowTransform,
     vec4 shadowSize, vec3 lightPos,
     vec3 lightDir, float angle,
     float bias /* base bias added to a slope bias computed here  */)
@@ -263,7 +313,7 @@ float PCSS_DirectionalLight(
 
     // blocker search
     float searchW = dot(lightPos-surfPos, lightDir)*tanAngle;
-    float blockerDistance = FindBlockerDistance_DirectionalLight(surfPos,surfNormal, shadowMap,
+    float blockerDistance = FindBlockerDistance_DirectionalLight(surfPos,surfNormal, shadowAtlas, tile,
                                                                  shadowTransform, shadowSize,
                                                                  lightDir, searchW, bias);
 
@@ -275,24 +325,24 @@ float PCSS_DirectionalLight(
 
     return PCF_DirectionalLight(
         surfPos, surfNormal,
-        shadowMap, shadowTransform ,shadowSize,
+        shadowAtlas, tile, shadowTransform ,shadowSize,
         lightDir, pcfRadius,
         bias);
 }
 
 float PCSS_SphereLight(
-    vec3 surfPos,vec3 surfNormal, samplerCube shadowMap,
-    vec3 lightPos, float lightRadius,
-    vec4 shadowMapSize, ivec2 shadowMapResolution,
+    vec3 surfPos,vec3 surfNormal, samplerCubeArray shadowAtlas, vec4 tile,
+    vec3 lightPos, float lightRadius, vec4 shadowMapSize,
     float bias /* base bias added to a slope bias computed here  */)
 {
+    ivec2 shadowMapResolution = ivec2(float(textureSize(shadowAtlas, 0).x) * tile.z);
 
     float realBias = bias + BiasPointShadow(lightPos, surfPos, normalize(lightPos-surfPos),
                                             surfNormal, shadowMapSize, shadowMapResolution);
 
     // blocker search
     float searchW = lightRadius*0.5; // ???
-    float blockerDistance = FindBlockerDistance_SphereLight(surfPos,surfNormal, shadowMap, lightPos, searchW, realBias);
+    float blockerDistance = FindBlockerDistance_SphereLight(surfPos,surfNormal, shadowAtlas, tile, lightPos, searchW, realBias);
 
 
     if (blockerDistance == -1) // no blocker found
@@ -301,5 +351,5 @@ float PCSS_SphereLight(
     // filtering
     float pcfRadius = blockerDistance * searchW/length(surfPos-lightPos);
 
-    return PCF_SphereLight(surfPos,surfNormal, shadowMap, lightPos, pcfRadius, realBias);
+    return PCF_SphereLight(surfPos,surfNormal, shadowAtlas, tile, lightPos, pcfRadius, realBias);
 }
\ No newline at end of file
@@ -14,6 +14,18 @@ struct Material
     bool has_merged_MetalRough   ;
     bool hasTex_Metalness        ;
     bool hasTex_Occlusion        ;
+    uint texIds_AlbedoEmission   ;  // residency and feedback, 16 bits each
+
+    // Bindless handles or (array, layer), see GPass.frag
+    uvec2 tex_Albedo             ;
+    uvec2 tex_Emission           ;
+    uvec2 tex_Normals            ;
+    uvec2 tex_Metalness          ;
+    uvec2 tex_Roughness          ;
+    uvec2 tex_Occlusion          ;
+
+    uint texIds_NormalsMetalness ;
+    uint texIds_RoughnessOcclusion;
 };
 
 #ifndef MAX_POINT_LIGHTS
@@ -25,19 +37,55 @@ struct Material
 #endif
 
 
+struct Transform
+{
+    mat4 modelMat;                      // 64 byte
+    mat4 normalMat;                     // 64 byte
+};
+
+struct DrawData
+{
+    int  transformIndex;
+    int  materialIndex;
+    vec4 positionOffset;                // object space position =
+    vec4 positionScale;                 // offset + scale * v_position
+};
+
 #if defined(GPASS) || defined(SHADOWPASS)
-layout (std140, binding = 2) uniform blk_PerObjectTransform
+layout (std430, binding = 2) readonly buffer blk_PerObjectTransform
+{
+    Transform   o_transforms[];
+};
+
+// One entry for each command of the multi-draw,
+// the draw id comes in as an instanced attribute.
+layout (std430, binding = 4) readonly buffer blk_PerDrawData
+{
+    DrawData    o_drawData[];
+};
+#endif
+
+#ifdef CUBE_SHADOWPASS
+// Casters of a cube shadow map, the draw id indexes this.
+// `faces` is the face (layered path, one instance per face)
+// or a mask of the faces to draw to (geometry shader path).
+struct CubeInstance
+{
+    int drawIndex;
+    int faces;
+};
+
+layout (std430, binding = 8) readonly buffer blk_CubeInstances
 {
-    uniform mat4        o_modelMat;     // 64 byte
-    uniform mat4        o_normalMat;    // 64 byte
-                                        // TOTAL => 128 byte
+    CubeInstance o_cubeInstances[];
 };
 #endif
 
 #ifdef GPASS
-layout (std140, binding = 3) uniform blk_PerObjectMaterial
+// One entry for each material (not per object)
+layout (std430, binding = 3) readonly buffer blk_Materials
 {
-    uniform Material    o_material;     // 64 byte
+    Material    o_materials[];
 };
 #endif
 
@@ -47,7 +95,8 @@ layout (std140, binding = 1) uniform blk_ViewData
     uniform mat4    f_projMat;          // 64  byte
     uniform float   f_near;             // 4   byte
     uniform float   f_far;              // 4   byte
-                                        // TOTAL => 136
+    uniform mat4    f_invViewProjMat;   // 64  byte (offset 144)
+                                        // TOTAL => 208
 };
 
 layout (std140, binding = 0) uniform blk_PerFrameData
@@ -67,5 +116,7 @@ layout (std140, binding = 0) uniform blk_PerFrameData
     uniform int                f_radianceMinLod;                             // 4   byte
     uniform int                f_radianceMaxLod;                             // 4   byte
     uniform bool               f_doTaa;                                      // 4   byte
+    uniform bool               f_textureFeedback;                            // 4   byte
+    uniform ivec2              f_feedbackTexel;                              // 8   byte
                                                                              // TOTAL => 796 byte
 };
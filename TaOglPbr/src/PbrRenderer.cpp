@@ -1,8 +1,14 @@
 #include "PbrRenderer.h"
 #include "TaOglPbrConfig.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "TextureCompression.h"
 #include "stb_image/stb_image.h"
 #include "gli/gli.hpp"
 #include "glm/gtc/type_ptr.hpp"
+#include <limits>
+#include <filesystem>
+#include <fstream>
 
 namespace tao_pbr
 {
@@ -15,11 +21,7 @@ namespace tao_pbr
 
     void PbrRenderer::InitGBuffer(int width, int height)
     {
-        _gBuffer.texColor0.TexImage(0, tex_int_for_rgba16f, width, height,tex_for_rgba, tex_typ_float, nullptr);
-        _gBuffer.texColor1.TexImage(0, tex_int_for_rgba16f, width, height,tex_for_rgba, tex_typ_float, nullptr);
-        _gBuffer.texColor2.TexImage(0, tex_int_for_rgba16f, width, height,tex_for_rgba, tex_typ_float, nullptr);
-        _gBuffer.texColor3.TexImage(0, tex_int_for_rgba16f, width, height,tex_for_rgba, tex_typ_float, nullptr);
-        _gBuffer.texDepth.TexImage(0, tex_int_for_depth_stencil, width, height, tex_for_depth, tex_typ_float, nullptr);
+        ResizeGBuffer(width, height);
 
         ogl_tex_filter_params pointFilter
         {
@@ -53,10 +55,21 @@ namespace tao_pbr
 
     void PbrRenderer::ResizeGBuffer(int width, int height)
     {
-        _gBuffer.texColor0.TexImage(0, tex_int_for_rgba16f, width, height,tex_for_rgba, tex_typ_float, nullptr);
-        _gBuffer.texColor1.TexImage(0, tex_int_for_rgba16f, width, height,tex_for_rgba, tex_typ_float, nullptr);
-        _gBuffer.texColor2.TexImage(0, tex_int_for_rgba16f, width, height,tex_for_rgba, tex_typ_float, nullptr);
-        _gBuffer.texColor3.TexImage(0, tex_int_for_rgba16f, width, height,tex_for_rgba, tex_typ_float, nullptr);
+        if(_compactGBuffer)
+        {
+            // 20 bytes per pixel (depth included) instead of 36
+            _gBuffer.texColor0.TexImage(0, tex_int_for_rg16   , width, height,tex_for_rg  , tex_typ_usigned_short, nullptr);
+            _gBuffer.texColor1.TexImage(0, tex_int_for_rgba8  , width, height,tex_for_rgba, tex_typ_unsigned_byte, nullptr);
+            _gBuffer.texColor2.TexImage(0, tex_int_for_rgba8  , width, height,tex_for_rgba, tex_typ_unsigned_byte, nullptr);
+            _gBuffer.texColor3.TexImage(0, tex_int_for_rgba8  , width, height,tex_for_rgba, tex_typ_unsigned_byte, nullptr);
+        }
+        else
+        {
+            _gBuffer.texColor0.TexImage(0, tex_int_for_rgba16f, width, height,tex_for_rgba, tex_typ_float, nullptr);
+            _gBuffer.texColor1.TexImage(0, tex_int_for_rgba16f, width, height,tex_for_rgba, tex_typ_float, nullptr);
+            _gBuffer.texColor2.TexImage(0, tex_int_for_rgba16f, width, height,tex_for_rgba, tex_typ_float, nullptr);
+            _gBuffer.texColor3.TexImage(0, tex_int_for_rgba16f, width, height,tex_for_rgba, tex_typ_float, nullptr);
+        }
         _gBuffer.texDepth .TexImage(0, tex_int_for_depth_stencil, width, height, tex_for_depth, tex_typ_float, nullptr);
     }
 
@@ -76,68 +89,18 @@ namespace tao_pbr
 
     void PbrRenderer::InitShadowMaps()
     {
-        ogl_tex_filter_params pointFilter
-        {
-                .min_filter = tex_min_filter_nearest,
-                .mag_filter = tex_mag_filter_nearest
-        };
-
-        // Directional Shadow Map
-        // ---------------------------------------------------
-        for(int i=0; i<MAX_DIR_SHADOW_COUNT; i++)
-        {
-            _directionalShadowMaps.push_back(DirectionalShadowMap
-             {
-                     .shadowMap = _renderContext->CreateTexture2D(),
-                     .shadowFbo = _renderContext->CreateFramebuffer<OglTexture2D>()
-             });
-
-            _directionalShadowMaps[i].shadowMap.TexImage(0, tex_int_for_depth, DIR_SHADOW_RES, DIR_SHADOW_RES,
-                                                     tex_for_depth, tex_typ_float, nullptr);
-
-            _directionalShadowMaps[i].shadowFbo.AttachTexture(fbo_attachment_depth, _directionalShadowMaps[i].shadowMap, 0);
-
-            // don't write to any color buffer
-            ogl_framebuffer_read_draw_buffs buffs[] = {fbo_read_draw_buff_none};
-            _directionalShadowMaps[i].shadowFbo.SetDrawBuffers(1, buffs);
-            _directionalShadowMaps[i].shadowFbo.SetReadBuffer(buffs[0]);
-        }
-
-
-        // Point and Rect Shadow Map
-        // ---------------------------------------------------
-        for(int i=0; i<MAX_SPHERE_SHADOW_COUNT + MAX_RECT_SHADOW_COUNT; i++)
-        {
-            bool sphere = i<MAX_SPHERE_SHADOW_COUNT;
-            int idx = sphere ? i : i-MAX_SPHERE_SHADOW_COUNT;
-            vector<SphereShadowMap>& shadows = sphere ? _sphereShadowMaps : _rectShadowMaps;
-
-            shadows.push_back(SphereShadowMap
-            {
-                .shadowMapColor = _renderContext->CreateTextureCube(),
-                .shadowMapDepth = _renderContext->CreateTextureCube(),
-                .shadowFbo = _renderContext->CreateFramebuffer<OglTextureCube>(),
-                .shadowCenter = vec3{0.0f}
-            });
-
-            for (int f = 0; f < 6; f++)
-            {
-                shadows[idx].shadowMapDepth.TexImage(
-                        static_cast<ogl_texture_cube_target>(tex_tar_cube_map_positive_x + f), 0, tex_int_for_depth,
-                        POINT_SHADOW_RES, POINT_SHADOW_RES, 0, tex_for_depth, tex_typ_float, nullptr);
-                shadows[idx].shadowMapColor.TexImage(
-                        static_cast<ogl_texture_cube_target>(tex_tar_cube_map_positive_x + f), 0, tex_int_for_r16f,
-                        POINT_SHADOW_RES, POINT_SHADOW_RES, 0, tex_for_red, tex_typ_float, nullptr);
-                shadows[idx].shadowMapColor.SetFilterParams(pointFilter);
-            }
-            shadows[idx].shadowFbo.AttachTexture(fbo_attachment_color0, shadows[idx].shadowMapColor, 0);
-            shadows[idx].shadowFbo.AttachTexture(fbo_attachment_depth, shadows[idx].shadowMapDepth, 0);
-
-            // don't write to any color buffer
-            ogl_framebuffer_read_draw_buffs buffs1[] = {fbo_read_draw_buff_color0};
-            shadows[idx].shadowFbo.SetDrawBuffers(1, buffs1);
-            shadows[idx].shadowFbo.SetReadBuffer(buffs1[0]);
-        }
+        // The atlases' textures are allocated (and attached)
+        // when needed, see ReserveDirShadowAtlas/ReserveCubeShadowAtlas
+
+        // don't write to any color buffer
+        ogl_framebuffer_read_draw_buffs buffs[] = {fbo_read_draw_buff_none};
+        _shadowAtlas.directionalFbo.SetDrawBuffers(1, buffs);
+        _shadowAtlas.directionalFbo.SetReadBuffer(buffs[0]);
+
+        // distance from the light
+        ogl_framebuffer_read_draw_buffs buffs1[] = {fbo_read_draw_buff_color0};
+        _shadowAtlas.cubeFbo.SetDrawBuffers(1, buffs1);
+        _shadowAtlas.cubeFbo.SetReadBuffer(buffs1[0]);
     }
 
     void PbrRenderer::InitSamplers()
@@ -190,6 +153,7 @@ namespace tao_pbr
         _linearSampler          .SetParams(ogl_sampler_params{.filter_params = linearFilter,            .wrap_params = clamp, .lod_params{}, .compare_params = noCompare,});
         _linearSamplerRepeat    .SetParams(ogl_sampler_params{.filter_params = linearFilter,            .wrap_params = repeat,.lod_params{}, .compare_params = noCompare,});
         _linearMipLinearSampler .SetParams(ogl_sampler_params{.filter_params = linearMipLinearFilter,   .wrap_params = clamp, .lod_params{}, .compare_params = noCompare,});
+        _linearMipLinearSamplerRepeat.SetParams(ogl_sampler_params{.filter_params = linearMipLinearFilter,.wrap_params = repeat,.lod_params{}, .compare_params = noCompare,});
         _shadowSampler          .SetParams(ogl_sampler_params{.filter_params = linearFilter,            .wrap_params = clamp, .lod_params{}, .compare_params = compareLess,});
     }
 
@@ -197,31 +161,68 @@ namespace tao_pbr
     {
         // Geometry and Light - Pass shaders
         // ------------------------------------
+        // Material textures: bindless handles if available, texture arrays otherwise
+        vector<string> gPassDefinitions = _renderContext->BindlessTexturesSupported()
+                    ? vector<string>{GPASS_BINDLESS_TEXTURES_SYMBOL}
+                    : vector<string>{string{GPASS_MAX_TEXTURE_ARRAYS_SYMBOL}.append(" ").append(to_string(GPASS_MAX_TEXTURE_ARRAYS))};
+        if(_compactGBuffer) gPassDefinitions.emplace_back(GBUFF_COMPACT_SYMBOL);
+        gPassDefinitions.push_back(string{TEXTURE_FEEDBACK_TILE_SYMBOL}.append(" ").append(to_string(TEXTURE_FEEDBACK_TILE)));
+
         auto gPassShader = _renderContext->CreateShaderProgram(
                 ShaderLoader::LoadShader(GPASS_VERT_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR).c_str(),
-                ShaderLoader::LoadShader(GPASS_FRAG_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR).c_str()
+                ShaderLoader::DefineConditional(
+            ShaderLoader::LoadShader(GPASS_FRAG_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR), gPassDefinitions).c_str()
         );
 
+        // Shared by the light pass and the light culling
+        const vector<string> lightDefinitions
+        {
+            string{LIGHTPASS_MAX_DIR_CASCADES_SYMBOL     }.append(" ").append(to_string(MAX_DIR_SHADOW_CASCADES)),
+            string{CLUSTER_GRID_X_SYMBOL                 }.append(" ").append(to_string(CLUSTER_GRID_X)),
+            string{CLUSTER_GRID_Y_SYMBOL                 }.append(" ").append(to_string(CLUSTER_GRID_Y)),
+            string{CLUSTER_GRID_Z_SYMBOL                 }.append(" ").append(to_string(CLUSTER_GRID_Z)),
+            string{CLUSTER_INDEX_CAPACITY_SYMBOL         }.append(" ").append(to_string(CLUSTER_INDEX_CAPACITY)),
+        };
+
+        // Uber-shader approach: contains the code (and branching) for
+        // all the supported light types.
+        vector<string> lightPassDefinitions
+        {
+            LIGHTPASS_DIR_LIGHTS_SYMBOL,
+            LIGHTPASS_ENV_LIGHTS_SYMBOL,
+            LIGHTPASS_SPHERE_LIGHTS_SYMBOL,
+            LIGHTPASS_RECT_LIGHTS_SYMBOL,
+        };
+        lightPassDefinitions.insert(lightPassDefinitions.end(), lightDefinitions.begin(), lightDefinitions.end());
+        if(_compactGBuffer) lightPassDefinitions.emplace_back(GBUFF_COMPACT_SYMBOL);
+
         auto lightPassShader = _renderContext->CreateShaderProgram(
                 ShaderLoader::LoadShader(LIGHTPASS_VERT_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR).c_str(),
                 ShaderLoader::DefineConditional(
-            ShaderLoader::LoadShader(LIGHTPASS_FRAG_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR),
-                // Uber-shader approach: contains the code (and branching) for
-                // all the supported light types.
-                {
-                            LIGHTPASS_DIR_LIGHTS_SYMBOL,
-                            LIGHTPASS_ENV_LIGHTS_SYMBOL,
-                            LIGHTPASS_SPHERE_LIGHTS_SYMBOL,
-                            LIGHTPASS_RECT_LIGHTS_SYMBOL,
-                            string{LIGHTPASS_MAX_DIR_SHADOW_CNT_SYMBOL   }.append(" ").append(to_string(MAX_DIR_SHADOW_COUNT)),
-                            string{LIGHTPASS_MAX_SPHERE_SHADOW_CNT_SYMBOL}.append(" ").append(to_string(MAX_SPHERE_SHADOW_COUNT)),
-                            string{LIGHTPASS_MAX_RECT_SHADOW_CNT_SYMBOL  }.append(" ").append(to_string(MAX_RECT_SHADOW_COUNT)),
-                }).c_str()
+            ShaderLoader::LoadShader(LIGHTPASS_FRAG_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR), lightPassDefinitions).c_str()
+        );
+
+        // Tiled (compute) light pass, same shading code
+        lightPassDefinitions.emplace_back(string{LIGHT_TILE_SIZE_SYMBOL}.append(" ").append(to_string(LIGHT_TILE_SIZE)));
+        lightPassDefinitions.emplace_back(string{MAX_TILE_LIGHTS_SYMBOL}.append(" ").append(to_string(MAX_TILE_LIGHTS)));
+
+        auto tiledLightPassShader = _renderContext->CreateShaderProgram(
+                ShaderLoader::DefineConditional(
+            ShaderLoader::LoadShader(LIGHTPASS_COMPUTE_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR), lightPassDefinitions).c_str()
         );
 
         // Shadow mapping shaders
         // ------------------------------------
-        auto pointLightShadowShader = _renderContext->CreateShaderProgram(
+        // Cube shadow maps: the layer (face) is picked in the vertex
+        // shader if possible (one instance per face), otherwise the
+        // geometry shader emits each triangle to the visible faces.
+        auto pointLightShadowShader = _renderContext->VertexShaderLayerSupported()
+            ? _renderContext->CreateShaderProgram(
+                ShaderLoader::DefineConditional(
+            ShaderLoader::LoadShader(POINT_SHADOWS_VERT_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR), {POINT_SHADOWS_VERTEX_LAYER_SYMBOL}).c_str(),
+                ShaderLoader::LoadShader(POINT_SHADOWS_FRAG_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR).c_str()
+                )
+            : _renderContext->CreateShaderProgram(
                 ShaderLoader::LoadShader(POINT_SHADOWS_VERT_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR).c_str(),
                 ShaderLoader::LoadShader(POINT_SHADOWS_GEOM_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR).c_str(),
                 ShaderLoader::LoadShader(POINT_SHADOWS_FRAG_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR).c_str()
@@ -233,24 +234,68 @@ namespace tao_pbr
         lightPassShader.SetUniform(LIGHTPASS_NAME_ENV_PREFILTERED_MIN_LOD, PRE_CUBE_MIN_LOD);
         lightPassShader.SetUniform(LIGHTPASS_NAME_ENV_PREFILTERED_MAX_LOD, PRE_CUBE_MAX_LOD);
 
+        tiledLightPassShader.UseProgram();
+        tiledLightPassShader.SetUniform(LIGHTPASS_NAME_ENV_PREFILTERED_MIN_LOD, PRE_CUBE_MIN_LOD);
+        tiledLightPassShader.SetUniform(LIGHTPASS_NAME_ENV_PREFILTERED_MAX_LOD, PRE_CUBE_MAX_LOD);
+
         // Compute Shaders
         // --------------------------------------
         auto source = ShaderLoader::LoadShader(PROCESS_ENV_COMPUTE_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR);
 
         auto genEnv = _renderContext->CreateShaderProgram(ShaderLoader::DefineConditional(source, {GEN_ENV_SYMBOL}).c_str());
-        auto genIrr = _renderContext->CreateShaderProgram(ShaderLoader::DefineConditional(source, {GEN_IRR_SYMBOL}).c_str());
+        auto genIrr = _renderContext->CreateShaderProgram(ShaderLoader::DefineConditional(source,
+                {GEN_IRR_SH_SYMBOL, string{SH_TEXELS_SYMBOL}.append(" ").append(to_string(PROCESS_ENV_SH_TEXELS))}).c_str());
+        auto redIrr = _renderContext->CreateShaderProgram(ShaderLoader::DefineConditional(source, {REDUCE_IRR_SH_SYMBOL}).c_str());
         auto genPre = _renderContext->CreateShaderProgram(ShaderLoader::DefineConditional(source, {GEN_PRE_SYMBOL}).c_str());
         auto genLut = _renderContext->CreateShaderProgram(ShaderLoader::DefineConditional(source, {GEN_LUT_SYMBOL}).c_str());
 
+        auto cullLights = _renderContext->CreateShaderProgram(
+                ShaderLoader::DefineConditional(
+            ShaderLoader::LoadShader(LIGHT_CULLING_COMPUTE_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR), lightDefinitions).c_str());
+
+        auto cullMeshlets = _renderContext->CreateShaderProgram(
+            ShaderLoader::LoadShader(MESHLET_CULLING_COMPUTE_SOURCE, SHADER_SRC_DIR, SHADER_SRC_DIR).c_str());
+
         // if CreateShaderProgram() throws the
         // current shader is not affected.
         _shaders.gPass                              = std::move(gPassShader);
         _shaders.lightPass                          = std::move(lightPassShader);
         _shaders.pointShadowMap                     = std::move(pointLightShadowShader);
         _computeShaders.generateEnvironmentCube     = std::move(genEnv);
-        _computeShaders.generateIrradianceCube      = std::move(genIrr);
+        _computeShaders.projectIrradianceSh         = std::move(genIrr);
+        _computeShaders.reduceIrradianceSh          = std::move(redIrr);
         _computeShaders.generatePrefilteredEnvCube  = std::move(genPre);
         _computeShaders.generateEnvBRDFLut          = std::move(genLut);
+        _computeShaders.cullLights                  = std::move(cullLights);
+        _computeShaders.lightPass                   = std::move(tiledLightPassShader);
+        _computeShaders.cullMeshlets                = std::move(cullMeshlets);
+    }
+
+    void PbrRenderer::BuildLightClusters()
+    {
+        // Expects the camera and lights data to be bound already.
+        // One work group for each depth slice, one thread for each
+        // cluster of the slice (see LightCulling.comp).
+
+#ifdef ENABLE_GPU_PROFILING
+        auto swc = _gpuStopwatch.Start("LightCulling");
+#endif
+
+        constexpr unsigned int zero = 0;
+        _shaderBuffers.clusterLightIndicesSsbo.SetSubData(0, sizeof(unsigned int), &zero);
+
+        _shaderBuffers.sphereLightsSsbo.OglBuffer().Bind(LIGHTPASS_BUFFER_BINDING_SPHERE_LIGHTS);
+        _shaderBuffers.rectLightsSsbo.OglBuffer()  .Bind(LIGHTPASS_BUFFER_BINDING_RECT_LIGHTS);
+        _shaderBuffers.lightClustersSsbo           .Bind(LIGHTPASS_BUFFER_BINDING_LIGHT_CLUSTERS);
+        _shaderBuffers.clusterLightIndicesSsbo     .Bind(LIGHTPASS_BUFFER_BINDING_CLUSTER_INDICES);
+
+        _computeShaders.cullLights.UseProgram();
+        _renderContext->DispatchCompute(1, 1, CLUSTER_GRID_Z);
+        _renderContext->MemoryBarrier(shader_storage_barrier_bit);
+
+#ifdef ENABLE_GPU_PROFILING
+        PerfCounters.LightCullingTime = _gpuStopwatch.Stop<tao_instrument::Stopwatch::MILLISECONDS>(swc);
+#endif
     }
 
     void PbrRenderer::InitFsQuad()
@@ -277,357 +322,2257 @@ namespace tao_pbr
 
     void PbrRenderer::InitStaticShaderBuffers()
     {
-        _shaderBuffers.cameraUbo.SetData(sizeof(camera_gl_data_block), nullptr, buf_usg_dynamic_draw);
+        // Light clusters: (offset, sphere count, rect count, pad) per cluster,
+        // indices list: counter followed by the indices.
+        _shaderBuffers.lightClustersSsbo      .SetData(CLUSTER_COUNT * 4 * sizeof(unsigned int), nullptr, buf_usg_dynamic_copy);
+        _shaderBuffers.clusterLightIndicesSsbo.SetData((1 + CLUSTER_INDEX_CAPACITY) * sizeof(unsigned int), nullptr, buf_usg_dynamic_copy);
+    }
+
+    void PbrRenderer::InitMeshArena()
+    {
+        // Vertex attribs (interleaved, see MESH_ATTRIB_*)
+        const int stride      = MeshVertexSize();
+        const int attribsBase = stride - MESH_ATTRIBUTES_SIZE;
+
+        // The same vertices for both, the indices differ
+        for(OglVertexAttribArray* vao : {&_meshArena.vao, &_meshArena.culledVao})
+        {
+            if(_quantizedPositions)
+                vao->SetVertexAttribPointer(_meshArena.vbo, MESH_ATTRIB_POSITION, 4, vao_typ_unsigned_short, true, stride, 0);
+            else
+                vao->SetVertexAttribPointer(_meshArena.vbo, MESH_ATTRIB_POSITION, 3, vao_typ_float, false, stride, 0);
+
+            vao->SetVertexAttribPointer(_meshArena.vbo, MESH_ATTRIB_NORMAL_TANGENT, 4, vao_typ_short     , true , stride, reinterpret_cast<void*>(attribsBase));
+            vao->SetVertexAttribPointer(_meshArena.vbo, MESH_ATTRIB_UV            , 2, vao_typ_half_float, false, stride, reinterpret_cast<void*>(attribsBase + 2 * sizeof(GLuint)));
+            vao->SetVertexAttribPointer(_meshArena.vbo, MESH_ATTRIB_BITANGENT_SIGN, 4, vao_typ_byte      , true , stride, reinterpret_cast<void*>(attribsBase + 3 * sizeof(GLuint)));
+
+            // Draw id: one per instance, the indirect command's
+            // base instance selects the element to start from.
+            vao->SetVertexAttribIPointer(_meshArena.drawIdVbo, MESH_ATTRIB_DRAW_ID, 1, vao_typ_unsigned_int, sizeof(GLuint), nullptr, 1);
+
+            vao->EnableVertexAttrib(MESH_ATTRIB_POSITION);
+            vao->EnableVertexAttrib(MESH_ATTRIB_NORMAL_TANGENT);
+            vao->EnableVertexAttrib(MESH_ATTRIB_UV);
+            vao->EnableVertexAttrib(MESH_ATTRIB_BITANGENT_SIGN);
+            vao->EnableVertexAttrib(MESH_ATTRIB_DRAW_ID);
+        }
+
+        _meshArena.vao      .SetIndexBuffer(_meshArena.ebo);
+        _meshArena.culledVao.SetIndexBuffer(_meshArena.culledEbo.OglBuffer());
+    }
+
+    int PbrRenderer::MeshVertexSize() const
+    {
+        return (_quantizedPositions ? MESH_QUANTIZED_POSITION_SIZE : MESH_POSITION_SIZE) + MESH_ATTRIBUTES_SIZE;
+    }
+
+    void PbrRenderer::ReserveMeshArena(unsigned int vboRequiredSize, unsigned int eboRequiredSize)
+    {
+        bool rebuildVao = false;
+
+        // Growing the arena means allocating a new buffer and
+        // copying the old content GPU-side (no CPU round trip).
+        if(auto newCapacity = ResizeBufferPolicy(_meshArena.vboCapacity, vboRequiredSize); newCapacity!=_meshArena.vboCapacity)
+        {
+            auto newVbo = _renderContext->CreateVertexBuffer(nullptr, newCapacity, buf_usg_static_draw);
+            if(_meshArena.vboSize) newVbo.CopySubData(_meshArena.vbo, 0, 0, _meshArena.vboSize);
+
+            _meshArena.vbo          = std::move(newVbo);
+            _meshArena.vboCapacity  = newCapacity;
+            rebuildVao = true;
+        }
+
+        if(auto newCapacity = ResizeBufferPolicy(_meshArena.eboCapacity, eboRequiredSize); newCapacity!=_meshArena.eboCapacity)
+        {
+            auto newEbo = _renderContext->CreateIndexBuffer();
+            newEbo.SetData(newCapacity, nullptr, buf_usg_static_draw);
+            if(_meshArena.eboSize) newEbo.CopySubData(_meshArena.ebo, 0, 0, _meshArena.eboSize);
+
+            _meshArena.ebo          = std::move(newEbo);
+            _meshArena.eboCapacity  = newCapacity;
+            rebuildVao = true;
+        }
+
+        if(rebuildVao) InitMeshArena();
+    }
+
+    vec2 PbrRenderer::OctahedralEncode(const vec3& v)
+    {
+        // Unit vector to [-1, 1]^2
+        vec3 n = v / (abs(v.x) + abs(v.y) + abs(v.z));
+        if(n.z < 0.0f)
+            n = vec3{(1.0f - abs(vec2{n.y, n.x})) * vec2{n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f}, n.z};
+
+        return vec2{n};
     }
 
-    GenKey<MeshGraphicsData>  PbrRenderer::CreateGraphicsData(Mesh& mesh)
+    GenKey<MeshGraphicsData>  PbrRenderer::CreateGraphicsData(const Mesh& mesh, int lodCount)
     {
-        constexpr int kVertSize =
-                3* sizeof(float) +    // position
-                3* sizeof(float) +    // normal
-                2* sizeof(float) +    // textureCoord
-                3* sizeof(float) +    // tangent
-                3* sizeof(float);     // bitangent
+        const int          stride       = MeshVertexSize();
+        const int          vertexCount  = static_cast<int>(mesh._positions.size());
+        const bool         shortIndices = vertexCount <= std::numeric_limits<unsigned short>::max();
+        const unsigned int indexSize    = shortIndices ? sizeof(unsigned short) : sizeof(int);
+
+        // Coarser lods, each about half the previous. Those which
+        // don't get 10% smaller than the previous aren't worth it.
+        std::vector<tao_geometry::SimplifiedMesh> lods;
+        if(lodCount > 1)
+        {
+            std::vector<size_t> targets;
+            for(size_t count = mesh._indices.size() / 6 * 3; targets.size() < static_cast<size_t>(lodCount - 1) && count >= 3; count = count / 6 * 3)
+                targets.push_back(count);
+
+            lods = tao_geometry::SimplifyMesh(mesh._positions, mesh._indices, targets);
+
+            size_t previous = mesh._indices.size();
+            std::erase_if(lods, [&previous](const tao_geometry::SimplifiedMesh& lod)
+            {
+                if(lod.indices.size() > previous * 9 / 10) return true;
+                previous = lod.indices.size();
+                return false;
+            });
+        }
+
+        // Lod 0 in meshlets, its triangles reordered
+        std::vector<int>                    baseIndices;
+        std::vector<tao_geometry::Meshlet>  meshlets;
+        if(mesh._indices.size() / 3 >= MESHLET_MIN_TRIANGLES)
+        {
+            baseIndices = mesh._indices;
+            meshlets    = tao_geometry::BuildMeshlets(mesh._positions, baseIndices, MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES);
+        }
+        const std::vector<int>& lod0Indices = meshlets.empty() ? mesh._indices : baseIndices;
+
+        size_t indicesCount = mesh._indices.size();
+        for(const auto& lod : lods) indicesCount += lod.indices.size();
+
+        const unsigned int vtxDataSize  = vertexCount * stride;
+        const unsigned int idxDataSize  = indicesCount * indexSize;
+
+        // 16 and 32 bit indices share the arena,
+        // each mesh starts at a multiple of its size.
+        const unsigned int idxOffset    = (_meshArena.eboSize + indexSize - 1) / indexSize * indexSize;
 
+        // Whole words: the meshlet culling reads the arena as uints
+        ReserveMeshArena(_meshArena.vboSize + vtxDataSize, (idxOffset + idxDataSize + 3) / 4 * 4);
+
+        // Indices are relative to the mesh,
+        // the draw command's base vertex does the rest.
         MeshGraphicsData graphicsData
         {
-                ._glVao{_renderContext->CreateVertexAttribArray()},
-                ._glVbo{_renderContext->CreateVertexBuffer()},
-                ._glEbo{_renderContext->CreateIndexBuffer()}
+            ._firstIndex    = idxOffset / indexSize,
+            ._baseVertex    = static_cast<int>(_meshArena.vboSize / stride),
+            ._indicesCount  = static_cast<int>(mesh._indices.size()),
+            ._verticesCount = vertexCount,
+            ._shortIndices  = shortIndices
         };
 
-        // Vertex buffer (interleaved)
-        tao_render_context::BufferDataPacker pack{};
-        auto data = pack
-                .AddDataArray(mesh._positions)
-                .AddDataArray(mesh._normals)
-                .AddDataArray(mesh._textureCoordinates)
-                .AddDataArray(mesh._tangents)
-                .AddDataArray(mesh._bitangents)
-                .InterleavedBuffer();
-
-        graphicsData._glVbo.SetData(data.size(),reinterpret_cast<void*>(data.data()), tao_ogl_resources::buf_usg_static_draw);
-
-        // Index buffer
-        graphicsData._indicesCount = mesh._indices.size();
-        graphicsData._glEbo.SetData(mesh._indices.size()*sizeof(int), mesh._indices.data(), tao_ogl_resources::buf_usg_static_draw);
-        graphicsData._glVao = _renderContext->CreateVertexAttribArray();
-
-        // Vertex attribs
-        graphicsData._glVao.SetVertexAttribPointer(graphicsData._glVbo, 0, 3, tao_ogl_resources::vao_typ_float, false, kVertSize, 0);
-        graphicsData._glVao.SetVertexAttribPointer(graphicsData._glVbo, 1, 3, tao_ogl_resources::vao_typ_float, false, kVertSize, reinterpret_cast<void*>(3 * sizeof (float)));
-        graphicsData._glVao.SetVertexAttribPointer(graphicsData._glVbo, 2, 2, tao_ogl_resources::vao_typ_float, false, kVertSize, reinterpret_cast<void*>(6 * sizeof (float)));
-        graphicsData._glVao.SetVertexAttribPointer(graphicsData._glVbo, 3, 3, tao_ogl_resources::vao_typ_float, false, kVertSize, reinterpret_cast<void*>(8 * sizeof (float)));
-        graphicsData._glVao.SetVertexAttribPointer(graphicsData._glVbo, 4, 3, tao_ogl_resources::vao_typ_float, false, kVertSize, reinterpret_cast<void*>(11 * sizeof (float)));
-
-        graphicsData._glVao.EnableVertexAttrib(0);
-        graphicsData._glVao.EnableVertexAttrib(1);
-        graphicsData._glVao.EnableVertexAttrib(2);
-        graphicsData._glVao.EnableVertexAttrib(3);
-        graphicsData._glVao.EnableVertexAttrib(4);
-
-        graphicsData._glVao.SetIndexBuffer(graphicsData._glEbo);
+        // The lods' indices follow the mesh's
+        graphicsData._lods[0] = MeshLod{graphicsData._firstIndex, graphicsData._indicesCount, 0.0f};
+        graphicsData._lodCount = 1 + static_cast<int>(lods.size());
+        for(int l=1; l<graphicsData._lodCount; l++)
+        {
+            const auto& previous = graphicsData._lods[l-1];
+            graphicsData._lods[l] = MeshLod
+            {
+                .firstIndex   = previous.firstIndex + previous.indicesCount,
+                .indicesCount = static_cast<int>(lods[l-1].indices.size()),
+                .error        = lods[l-1].error
+            };
+        }
+
+        // Quantized positions are fractions of the bounds (flat
+        // axes get a zero scale, every vertex is on the min).
+        if(_quantizedPositions)
+        {
+            graphicsData._positionOffset = mesh._bounds.Min;
+            graphicsData._positionScale  = mesh._bounds.Max - mesh._bounds.Min;
+        }
+        const vec3 divisorScale = glm::max(graphicsData._positionScale, vec3{std::numeric_limits<float>::min()});
+
+        // Encoded straight into the arena. Nothing drawn so far
+        // reads past the arena's size, no need to sync with the GPU.
+        constexpr GLbitfield mapAccess = map_range_flags_write | map_range_flags_invalidate_range | map_range_flags_unsynchronized;
+
+        if(vtxDataSize)
+        {
+            auto* dst = static_cast<unsigned char*>(_meshArena.vbo.MapBufferRange(_meshArena.vboSize, vtxDataSize, mapAccess));
+
+            for(int i=0; i<vertexCount; i++, dst+=stride)
+            {
+                const vec3& n = mesh._normals[i];
+                const vec3& t = mesh._tangents[i];
+
+                if(_quantizedPositions)
+                {
+                    const vec3 p = (mesh._positions[i] - graphicsData._positionOffset) / divisorScale;
+                    const GLuint packed[2] = { packUnorm2x16(vec2{p.x, p.y}), packUnorm2x16(vec2{p.z, 0.0f}) };
+                    memcpy(dst, packed, MESH_QUANTIZED_POSITION_SIZE);
+                }
+                else
+                {
+                    memcpy(dst, value_ptr(mesh._positions[i]), MESH_POSITION_SIZE);
+                }
+
+                // The bitangent is rebuilt as sign * cross(n, t)
+                const float bitangentSign = dot(cross(n, t), mesh._bitangents[i]) < 0.0f ? -1.0f : 1.0f;
+
+                const GLuint attributes[4] =
+                {
+                    packSnorm2x16(OctahedralEncode(n)),
+                    packSnorm2x16(OctahedralEncode(t)),
+                    packHalf2x16(mesh._textureCoordinates[i]),
+                    packSnorm4x8(vec4{bitangentSign, 0.0f, 0.0f, 0.0f})
+                };
+                memcpy(dst + (stride - MESH_ATTRIBUTES_SIZE), attributes, MESH_ATTRIBUTES_SIZE);
+            }
+
+            if(!_meshArena.vbo.UnmapBuffer())
+                throw std::runtime_error("Failed to upload the mesh vertices (buffer content lost).");
+        }
+
+        if(idxDataSize)
+        {
+            void* dst = _meshArena.ebo.MapBufferRange(idxOffset, idxDataSize, mapAccess);
+
+            for(int l=0; l<graphicsData._lodCount; l++)
+            {
+                const std::vector<int>& indices = l==0 ? lod0Indices : lods[l-1].indices;
+
+                if(shortIndices)
+                {
+                    auto* idx = static_cast<unsigned short*>(dst);
+                    for(int i=0; i<indices.size(); i++) idx[i] = static_cast<unsigned short>(indices[i]);
+                }
+                else
+                {
+                    memcpy(dst, indices.data(), indices.size() * sizeof(int));
+                }
+
+                dst = static_cast<unsigned char*>(dst) + indices.size() * indexSize;
+            }
+
+            if(!_meshArena.ebo.UnmapBuffer())
+                throw std::runtime_error("Failed to upload the mesh indices (buffer content lost).");
+        }
+
+        _meshArena.vboSize += vtxDataSize;
+        _meshArena.eboSize  = idxOffset + idxDataSize;
+
+        // Quantized positions are off by up to half a step
+        const float quantizationError = _quantizedPositions ? 0.5f * length(graphicsData._positionScale) / 65535.0f : 0.0f;
+
+        graphicsData._firstMeshlet = static_cast<unsigned int>(_meshlets.size());
+        graphicsData._meshletCount = static_cast<int>(meshlets.size());
+        for(const auto& m : meshlets)
+        {
+            _meshlets.push_back(meshlet_gl_data_block
+            {
+                .sphere     = vec4{m.center, m.radius + quantizationError},
+                .cone       = vec4{m.coneAxis, m.coneCutoff},
+                .firstIndex = graphicsData._firstIndex + m.firstIndex,
+                .indexCount = m.indexCount,
+                .pad        = {}
+            });
+        }
+        _meshletsDirty |= !meshlets.empty();
 
         return _meshesGraphicsData.insert(std::move(graphicsData));
     }
 
-    GenKey<ImageTextureGraphicsData>  PbrRenderer::CreateGraphicsData(ImageTexture& image)
+    GenKey<ImageTextureGraphicsData>  PbrRenderer::CreateGraphicsData(const ImageTexture& image)
     {
-        int w, h, c;
-        void* data = stbi_load(image._path.c_str(), &w, &h, &c, 0);
+        // The ids are packed on 16 bits in the materials
+        if(_texturesGraphicsData.slot_count() >= MAX_IMAGE_TEXTURES)
+            throw std::runtime_error("Too many image textures.");
+
+        // Pending until it's streamed in (see StreamTextures)
+        const auto key = _texturesGraphicsData.insert(ImageTextureGraphicsData{});
+        _textureResidency.resize(_texturesGraphicsData.slot_count());
+
+        _decodingTextures++;
+        _textureDecoders.Submit([this, path = image._path, accountForGamma = image._accountForGamma, content = image._content,
+                                 settings = _textureStreamingSettings, key]
+        {
+            DecodedTexture decoded = DecodeTexture(path, accountForGamma, content, settings);
+            decoded.graphicsData = key;
+
+            std::lock_guard lock{_decodedTexturesMutex};
+            _decodedTextures.push_back(std::move(decoded));
+        });
+
+        return key;
+    }
 
-        if(!data)
+    PbrRenderer::DecodedTexture PbrRenderer::DecodeTexture(const std::string& path, bool accountForGamma, texture_content content, TextureStreamingSettings settings)
+    {
+        using namespace tao_texture;
+
+        DecodedTexture decoded{};
+
+        int width, height, channels;
+        if(!stbi_info(path.c_str(), &width, &height, &channels)) return decoded;
+
+        decoded.width  = width;
+        decoded.height = height;
+
+        // 1-2 channels formats have no sRGB version (sampled linear, filtered linear)
+        const bool srgb = accountForGamma && channels>=3 && content==texture_content::color;
+
+        block_format block      = block_format::bc7;
+        gli::format  cacheFormat= srgb ? gli::FORMAT_RGBA_BP_SRGB_BLOCK16 : gli::FORMAT_RGBA_BP_UNORM_BLOCK16;
+        const char*  cacheTag   = srgb ? "bc7_srgb" : "bc7";
+        decoded.internalFormat  = srgb ? tex_int_for_compressed_srgb_alpha_bptc_unorm : tex_int_for_compressed_rgba_bptc_unorm;
+
+        if(content==texture_content::normal_map || channels==2)
+        {
+            block                  = block_format::bc5;
+            cacheFormat            = gli::FORMAT_RG_ATI2N_UNORM_BLOCK16;
+            cacheTag               = "bc5";
+            decoded.internalFormat = tex_int_for_compressed_rg_rgtc2;
+        }
+        else if(channels==1)
         {
-            throw runtime_error(std::format("Failed to load texture data at {}: {}", image._path, stbi_failure_reason()));
+            block                  = block_format::bc4;
+            cacheFormat            = gli::FORMAT_R_ATI1N_UNORM_BLOCK8;
+            cacheTag               = "bc4";
+            decoded.internalFormat = tex_int_for_compressed_red_rgtc1;
         }
 
-        tao_ogl_resources::ogl_texture_internal_format ifmt;
-        tao_ogl_resources::ogl_texture_format fmt;
-        switch(c)
+        const auto cachePath = std::format("{}.{}.dds", path, cacheTag);
+        const int  levels    = MipCount(width, height);
+
+        // A cache older than the image is stale
+        if(settings.blockCompression && settings.diskCache)
         {
-            case(1): ifmt = tao_ogl_resources::tex_int_for_red;  fmt = tao_ogl_resources::tex_for_red; break;
-            case(2): ifmt = tao_ogl_resources::tex_int_for_rg;   fmt = tao_ogl_resources::tex_for_rg; break;
+            std::error_code cacheError, imageError;
+            const auto cacheTime = std::filesystem::last_write_time(cachePath, cacheError);
+            const auto imageTime = std::filesystem::last_write_time(path, imageError);
 
-            case(3): ifmt = image._accountForGamma ? tao_ogl_resources::tex_int_for_srgb8        : tao_ogl_resources::tex_int_for_rgb ; fmt = tao_ogl_resources::tex_for_rgb; break;
-            case(4): ifmt = image._accountForGamma ? tao_ogl_resources::tex_int_for_srgb8_alpha8 : tao_ogl_resources::tex_int_for_rgba; fmt = tao_ogl_resources::tex_for_rgba; break;
+            if(!cacheError && !imageError && cacheTime>=imageTime)
+            {
+                const gli::texture cached = gli::load_dds(cachePath);
+                if(!cached.empty() && cached.target()==gli::TARGET_2D && cached.format()==cacheFormat &&
+                   cached.extent(0).x==width && cached.extent(0).y==height && static_cast<int>(cached.levels())==levels)
+                {
+                    for(int l=0; l<levels; l++)
+                    {
+                        const auto* data = static_cast<const unsigned char*>(cached.data(0, 0, l));
+                        decoded.levels.emplace_back(data, data + cached.size(l));
+                    }
+                    decoded.blockBytes = BlockBytes(block);
+                    return decoded;
+                }
+            }
         }
 
-        ImageTextureGraphicsData gd{._glTexture = _renderContext->CreateTexture2D()};
+        std::unique_ptr<unsigned char, void(*)(void*)> pixels{stbi_load(path.c_str(), &width, &height, &channels, 0), stbi_image_free};
+        if(!pixels) return decoded;
 
-        gd._glTexture.TexImage(0, ifmt, w, h, fmt, tao_ogl_resources::tex_typ_unsigned_byte, data);
+        const mip_filter filter = content==texture_content::normal_map ? mip_filter::normal_map
+                                : srgb                                 ? mip_filter::srgb
+                                :                                        mip_filter::linear;
+        MipChain chain = GenerateMips(pixels.get(), width, height, channels, filter);
+        pixels.reset();
 
-        stbi_image_free(data);
+        if(!settings.blockCompression)
+        {
+            switch(channels)
+            {
+                // sized formats, textures use immutable storage
+                case(1): decoded.internalFormat = tex_int_for_r8;   decoded.format = tex_for_red; break;
+                case(2): decoded.internalFormat = tex_int_for_rg8;  decoded.format = tex_for_rg; break;
+
+                case(3): decoded.internalFormat = srgb ? tex_int_for_srgb8        : tex_int_for_rgb8 ; decoded.format = tex_for_rgb; break;
+                case(4): decoded.internalFormat = srgb ? tex_int_for_srgb8_alpha8 : tex_int_for_rgba8; decoded.format = tex_for_rgba; break;
+            }
+
+            decoded.levels = std::move(chain.levels);
+            return decoded;
+        }
+
+        decoded.blockBytes = BlockBytes(block);
+        decoded.levels.reserve(levels);
+        for(int l=0; l<levels; l++)
+            decoded.levels.push_back(CompressImage(chain.levels[l].data(), glm::max(1, width>>l), glm::max(1, height>>l), channels, block));
+
+        // Best effort, a read-only directory just means no cache
+        if(settings.diskCache)
+        {
+            gli::texture2d cache{cacheFormat, gli::extent2d{width, height}, static_cast<gli::texture2d::size_type>(levels)};
+            for(int l=0; l<levels; l++)
+                memcpy(cache.data(0, 0, l), decoded.levels[l].data(), glm::min(cache.size(l), decoded.levels[l].size()));
 
-        return _texturesGraphicsData.insert(std::move(gd));
+            gli::save_dds(cache, cachePath);
+        }
+
+        return decoded;
     }
 
-    GenKey<EnvironmentTextureGraphicsData>  PbrRenderer::CreateGraphicsData(EnvironmentLight& image)
+    void PbrRenderer::BeginTextureUpload(DecodedTexture&& image)
     {
-        int w, h, c;
-        void* data = stbi_loadf(image._path.c_str(), &w, &h, &c, 3);
+        const std::size_t slot = image.graphicsData.Index;
+        auto& gd = _texturesGraphicsData.at(image.graphicsData);
 
-        tao_ogl_resources::ogl_texture_internal_format ifmt {tex_int_for_rgb16f};
-        tao_ogl_resources::ogl_texture_format fmt           {tex_for_rgb};
+        if(image.levels.empty())
+        {
+            gd._status = texture_status::failed;
+            return;
+        }
 
-        // needed only to create the cube version of the environment
-        auto env2DTex = _renderContext->CreateTexture2D();
-        env2DTex.TexImage(0, ifmt, w, h, fmt, tao_ogl_resources::tex_typ_float, data);
+        // No bindless: a layer of the array of its size and format
+        if(!_renderContext->BindlessTexturesSupported())
+        {
+            const int skip = AddToTextureArray(gd, image.internalFormat, image.width, image.height, static_cast<int>(image.levels.size()));
+            if(skip<0)
+            {
+                // The material falls back to its factors
+                PerfCounters.DroppedTextures++;
+                gd._status = texture_status::failed;
+                return;
+            }
 
-        EnvironmentTextureGraphicsData gd = CreateEnvironmentTextures(env2DTex);
+            // Downsized to an existing array's size: the finer levels go
+            image.levels.erase(image.levels.begin(), image.levels.begin() + skip);
+            image.width  = glm::max(1, image.width  >> skip);
+            image.height = glm::max(1, image.height >> skip);
+        }
 
-        stbi_image_free(data);
+        const auto ifmt   = image.internalFormat;
+        const int  width  = image.width;
+        const int  height = image.height;
+        const int  levels = static_cast<int>(image.levels.size());
+
+        // The finer levels wait for the feedback
+        int pinned = 0;
+        while(glm::max(width>>pinned, height>>pinned) > TEXTURE_PINNED_SIZE) pinned++;
+
+        TextureResidency residency
+        {
+            .image         = std::move(image),
+            .residentLevel = levels,
+            .pinnedLevel   = pinned,
+            .wantedLevel   = pinned,
+            .lastUsed      = _frameCount,
+            .loading       = true
+        };
+
+        // Storage now (arrays: the layer above), the levels over the next frames
+        if(_renderContext->BindlessTexturesSupported())
+        {
+            gd._glTexture.emplace(_renderContext->CreateTexture2D());
+
+            // Pinned whole (nothing to release) or not page aligned: the whole chain
+            residency.sparse = pinned>0 && _renderContext->SparseTextureSupported(ifmt, width, height);
+            if(residency.sparse) gd._glTexture->SetSparse(true);
+
+            gd._glTexture->TexStorage(levels, ifmt, width, height);
+
+            // The mip tail is committed as a whole, it's pinned too
+            if(residency.sparse)
+            {
+                residency.pinnedLevel = glm::min(pinned, static_cast<int>(gd._glTexture->NumSparseLevels()));
+                for(int l=residency.pinnedLevel; l<levels; l++)
+                    gd._glTexture->PageCommitment(l, 0, 0, glm::max(1, width>>l), glm::max(1, height>>l), true);
+            }
+        }
+
+        for(int l = residency.sparse ? residency.pinnedLevel : 0; l<levels; l++)
+            _textureResidentBytes += static_cast<GLsizeiptr>(residency.image.levels[l].size());
+
+        _textureUploads.push_back(TextureUpload
+        {
+            .texture   = slot,
+            .level     = levels-1,
+            .lastLevel = residency.pinnedLevel
+        });
+
+        _textureResidency[slot] = std::move(residency);
+        _shaderBuffers.textureResidencySsbo.Set(slot, _textureResidency[slot]);
+    }
+
+    void PbrRenderer::StreamTextures()
+    {
+        PerfCounters.TextureUploadBytes = 0;
+
+        {
+            std::vector<DecodedTexture> decoded;
+            {
+                std::lock_guard lock{_decodedTexturesMutex};
+                decoded.swap(_decodedTextures);
+            }
+
+            _decodingTextures -= static_cast<int>(decoded.size());
+            for(auto& image : decoded) BeginTextureUpload(std::move(image));
+        }
+
+        PerfCounters.PendingTextures = _decodingTextures + static_cast<int>(std::count_if(_textureUploads.begin(), _textureUploads.end(),
+                [this](const TextureUpload& u){ return _texturesGraphicsData.at_index(u.texture)._status==texture_status::pending; }));
+        if(_textureUploads.empty()) return;
+
+        // Waits if the GPU is still reading this partition, at
+        // most `uploadBudget` bytes can be staged this frame.
+        _textureUploadRing.BeginFrame();
+        _textureUploadRing.BindPixelUnpack();
+
+        bool anyReady = false;
+        while(!_textureUploads.empty())
+        {
+            TextureUpload&          upload    = _textureUploads.front();
+            ImageTextureGraphicsData& gd      = _texturesGraphicsData.at_index(upload.texture);
+            TextureResidency&       residency = _textureResidency[upload.texture];
+            const DecodedTexture&   image     = residency.image;
+
+            const auto& level       = image.levels[upload.level];
+            const int   levelWidth  = glm::max(1, image.width  >> upload.level);
+            const int   levelHeight = glm::max(1, image.height >> upload.level);
+
+            // Compressed rows are rows of blocks. Staged rows are 4 bytes
+            // aligned (GL_UNPACK_ALIGNMENT), blocks are 8 or 16 bytes.
+            const int        rowTexels  = image.blockBytes>0 ? 4 : 1;
+            const int        levelRows  = (levelHeight + rowTexels - 1) / rowTexels;
+            const GLsizeiptr levelPitch = static_cast<GLsizeiptr>(level.size()) / levelRows;
+            const GLsizeiptr rowPitch   = (levelPitch + 3) / 4 * 4;
+            const int        rows       = static_cast<int>(glm::min<GLsizeiptr>(levelRows - upload.nextRow, _textureUploadRing.Available() / rowPitch));
+
+            if(rows==0) break;
+
+            const auto staging = _textureUploadRing.Allocate(rows * rowPitch);
+            for(int r=0; r<rows; r++)
+                memcpy(static_cast<unsigned char*>(staging.data) + r*rowPitch, level.data() + (upload.nextRow+r)*levelPitch, levelPitch);
+
+            const void* offset = reinterpret_cast<const void*>(staging.offset);
+            const int   y      = upload.nextRow * rowTexels;
+            const int   height = glm::min(rows * rowTexels, levelHeight - y);
+            const auto  size   = static_cast<GLsizei>(rows * levelPitch);
+
+            if(gd._glTexture)
+            {
+                if(image.blockBytes>0)
+                    gd._glTexture->CompressedTexSubImage(upload.level, 0, y, levelWidth, height, image.internalFormat, size, offset);
+                else
+                    gd._glTexture->TexSubImage(upload.level, 0, y, levelWidth, height, image.format, tex_typ_unsigned_byte, offset);
+            }
+            else
+            {
+                auto& array = _textureArrays[gd._array].texture;
+                if(image.blockBytes>0)
+                    array.CompressedTexSubImage(upload.level, 0, y, gd._layer, levelWidth, height, image.internalFormat, size, offset);
+                else
+                    array.TexSubImage(upload.level, 0, y, gd._layer, levelWidth, height, image.format, tex_typ_unsigned_byte, offset);
+            }
+
+            upload.nextRow += rows;
+            PerfCounters.TextureUploadBytes += staging.size;
+
+            if(upload.nextRow < levelRows) continue;
+
+            // Sampled from the next flush on (GL orders the uploads before any later draw)
+            residency.residentLevel = upload.level;
+            _shaderBuffers.textureResidencySsbo.Set(upload.texture, residency);
+
+            upload.nextRow = 0;
+            if(upload.level-- > upload.lastLevel) continue;
+
+            residency.loading = false;
+            _textureUploads.pop_front();
+
+            if(gd._status==texture_status::ready) continue;
+
+            // The pinned levels are in
+            if(gd._glTexture)
+            {
+                // The handle is made resident once and for all
+                gd._handle = gd._glTexture->GetSamplerHandle(_linearMipLinearSamplerRepeat);
+                OglTexture2D::MakeHandleResident(gd._handle);
+            }
+            gd._status = texture_status::ready;
+            anyReady = true;
+        }
+
+        OglPixelUnpackBuffer::UnBind();
+        _textureUploadRing.EndFrame();
+
+        // Their materials can sample them now
+        if(anyReady)
+            for(size_t m=0; m<_materials.size(); m++)
+                _shaderBuffers.materialSsbo.Set(_materials.key_of(m).Index, _materials.values()[m]);
+    }
+
+    void PbrRenderer::UpdateTextureResidency()
+    {
+        PerfCounters.EvictedTextureLevels = 0;
+
+        ReadTextureFeedback();
+
+        const auto evictable = [this](std::size_t i)
+        {
+            const auto& r = _textureResidency[i];
+            return _texturesGraphicsData.indexValid(i) && _texturesGraphicsData.at_index(i)._status==texture_status::ready &&
+                   r.sparse && !r.loading && r.residentLevel<r.pinnedLevel;
+        };
+
+        // Levels finer than wanted go first, then the least recently
+        // sampled textures' (not sampled since `sampledBefore`).
+        const auto evictOne = [&](unsigned long long sampledBefore)
+        {
+            std::size_t victim = _textureResidency.size();
+            for(std::size_t i=0; i<_textureResidency.size(); i++)
+            {
+                if(!evictable(i)) continue;
+
+                const auto& r        = _textureResidency[i];
+                const bool  unwanted = r.residentLevel < r.wantedLevel;
+                if(!unwanted && r.lastUsed>=sampledBefore) continue;
+
+                if(victim==_textureResidency.size()) { victim = i; continue; }
+
+                const auto& v              = _textureResidency[victim];
+                const bool  victimUnwanted = v.residentLevel < v.wantedLevel;
+                if(unwanted!=victimUnwanted ? unwanted : r.lastUsed<v.lastUsed) victim = i;
+            }
+
+            if(victim==_textureResidency.size()) return false;
+
+            EvictTextureLevel(victim);
+            return true;
+        };
+
+        // The budget may have been lowered
+        const GLsizeiptr budget = _textureResidencySettings.memoryBudget;
+        while(_textureResidentBytes>budget && evictOne(_textureFeedbackFrame)) {}
+
+        // A level at a time, the most recently sampled textures first
+        std::vector<std::size_t> loads;
+        for(std::size_t i=0; i<_textureResidency.size(); i++)
+        {
+            const auto& r = _textureResidency[i];
+            if(_texturesGraphicsData.indexValid(i) && _texturesGraphicsData.at_index(i)._status==texture_status::ready &&
+               !r.loading && r.wantedLevel<r.residentLevel)
+                loads.push_back(i);
+        }
+        std::sort(loads.begin(), loads.end(), [this](std::size_t a, std::size_t b)
+        {
+            return _textureResidency[a].lastUsed > _textureResidency[b].lastUsed;
+        });
+
+        for(const std::size_t i : loads)
+        {
+            auto&      r     = _textureResidency[i];
+            const int  level = r.residentLevel - 1;
+            const auto bytes = r.sparse ? static_cast<GLsizeiptr>(r.image.levels[level].size()) : 0;
+
+            // Only textures sampled less recently make room,
+            // the ones after this were sampled even less.
+            bool room = true;
+            while(room && _textureResidentBytes+bytes>budget) room = evictOne(r.lastUsed);
+            if(!room) break;
+
+            if(r.sparse)
+            {
+                _texturesGraphicsData.at_index(i)._glTexture->PageCommitment(level, 0, 0,
+                        glm::max(1, r.image.width>>level), glm::max(1, r.image.height>>level), true);
+                _textureResidentBytes += bytes;
+            }
+
+            r.loading = true;
+            _textureUploads.push_back(TextureUpload{.texture = i, .level = level, .lastLevel = level});
+        }
+
+        PerfCounters.TextureResidentBytes = static_cast<unsigned long long>(_textureResidentBytes);
+    }
+
+    void PbrRenderer::EvictTextureLevel(std::size_t index)
+    {
+        auto&     r     = _textureResidency[index];
+        const int level = r.residentLevel++;
+
+        // Frames in flight sampled it before the decommit, the
+        // next ones clamp to the coarser level (in the next flush).
+        _shaderBuffers.textureResidencySsbo.Set(index, r);
+        _texturesGraphicsData.at_index(index)._glTexture->PageCommitment(level, 0, 0,
+                glm::max(1, r.image.width>>level), glm::max(1, r.image.height>>level), false);
+
+        _textureResidentBytes -= static_cast<GLsizeiptr>(r.image.levels[level].size());
+        PerfCounters.EvictedTextureLevels++;
+    }
+
+    void PbrRenderer::ReadTextureFeedback()
+    {
+        // Oldest first, newer readbacks override the wanted levels
+        for(std::size_t k=0; k<_textureFeedback.size(); k++)
+        {
+            auto& feedback = _textureFeedback[(_textureFeedbackNext + k) % _textureFeedback.size()];
+            if(!feedback.fence) continue;
+
+            const auto res = feedback.fence->ClientWaitSync(wait_sync_flags_none, 0);
+            if(res==wait_sync_res_timeout_expired) break;
+            if(res!=wait_sync_res_already_signaled && res!=wait_sync_res_condition_satisfied)
+                throw std::runtime_error("Unexpected OpenGl sync object state.");
+
+            feedback.fence.reset();
+
+            // Already there, no stall
+            _textureFeedbackData.resize(feedback.capacity);
+            feedback.buffer.GetSubData(0, static_cast<GLsizeiptr>(feedback.capacity * sizeof(unsigned int)), _textureFeedbackData.data());
+
+            for(std::size_t i=0; i<glm::min(feedback.capacity, _textureResidency.size()); i++)
+            {
+                if(_textureFeedbackData[i]==TEXTURE_FEEDBACK_NONE) continue;
+
+                auto& r = _textureResidency[i];
+                if(r.image.levels.empty()) continue;
+
+                r.wantedLevel = glm::min(static_cast<int>(_textureFeedbackData[i]), static_cast<int>(r.image.levels.size()) - 1);
+                r.lastUsed    = feedback.frame;
+            }
+            _textureFeedbackFrame = feedback.frame;
+
+            feedback.buffer.ClearData(tex_int_for_r32ui, tex_for_red_integer, tex_typ_unsigned_int, &TEXTURE_FEEDBACK_NONE);
+        }
+    }
+
+    bool PbrRenderer::BeginTextureFeedback()
+    {
+        if(_textureFeedback.empty())
+            for(int i=0; i<FRAME_RING_PARTITIONS; i++)
+                _textureFeedback.push_back(TextureFeedbackBuffer{.buffer = _renderContext->CreateShaderStorageBuffer()});
+
+        // Still to be read back: no feedback this frame
+        auto& feedback = _textureFeedback[_textureFeedbackNext];
+        if(feedback.fence || _textureResidency.empty()) return false;
+
+        if(feedback.capacity < _textureResidency.size())
+        {
+            feedback.capacity = std::bit_ceil(_textureResidency.size());
+            feedback.buffer.SetData(static_cast<GLsizeiptr>(feedback.capacity * sizeof(unsigned int)), nullptr, buf_usg_dynamic_read);
+            feedback.buffer.ClearData(tex_int_for_r32ui, tex_for_red_integer, tex_typ_unsigned_int, &TEXTURE_FEEDBACK_NONE);
+        }
+
+        feedback.buffer.Bind(GPASS_SSBO_BINDING_TEXTURE_FEEDBACK);
+        feedback.frame = _frameCount;
+
+        return true;
+    }
+
+    void PbrRenderer::EndTextureFeedback()
+    {
+        // The readback (a buffer copy) sees the atomics
+        _renderContext->MemoryBarrier(buffer_update_barrier_bit);
+
+        _textureFeedback[_textureFeedbackNext].fence.emplace(_renderContext->CreateFence());
+        _textureFeedbackNext = (_textureFeedbackNext + 1) % static_cast<int>(_textureFeedback.size());
+    }
+
+    bool PbrRenderer::TextureReady(const std::optional<GenKey<ImageTexture>>& tex) const
+    {
+        return tex && _texturesGraphicsData.at(_textures.at(tex.value())._graphicsData.value())._status == texture_status::ready;
+    }
+
+    texture_status PbrRenderer::TextureStatus(const GenKey<ImageTexture>& texture) const
+    {
+        return _texturesGraphicsData.at(_textures.at(texture)._graphicsData.value())._status;
+    }
+
+    // FNV-1a of the file content, 0 if it can't be read
+    static unsigned long long HashFile(const std::string& path)
+    {
+        std::ifstream file{path, std::ios::binary};
+        if(!file) return 0;
+
+        unsigned long long hash = 0xcbf29ce484222325ull;
+        std::vector<char>  chunk(1 << 16);
+        while(file.read(chunk.data(), static_cast<std::streamsize>(chunk.size())) || file.gcount()>0)
+        {
+            for(std::streamsize i=0; i<file.gcount(); i++)
+            {
+                hash ^= static_cast<unsigned char>(chunk[i]);
+                hash *= 0x100000001b3ull;
+            }
+        }
+
+        return hash;
+    }
+
+    GenKey<EnvironmentTextureGraphicsData>  PbrRenderer::CreateGraphicsData(EnvironmentLight& image)
+    {
+        // Keyed by content and resolutions: an edited (or replaced)
+        // HDRI or new resolutions just miss, stale entries are left.
+        const unsigned long long hash      = HashFile(image._path);
+        const std::string        cachePath = std::format("{}.{:016x}.{}-{}", image._path, hash, ENV_CUBE_RES, PRE_CUBE_RES);
+
+        if(hash!=0)
+            if(auto cached = LoadEnvironmentTextures(cachePath))
+                return _environmentTexturesGraphicsData.insert(std::move(*cached));
+
+        int w, h, c;
+        void* data = stbi_loadf(image._path.c_str(), &w, &h, &c, 3);
+
+        tao_ogl_resources::ogl_texture_internal_format ifmt {tex_int_for_rgb16f};
+        tao_ogl_resources::ogl_texture_format fmt           {tex_for_rgb};
+
+        // needed only to create the cube version of the environment
+        auto env2DTex = _renderContext->CreateTexture2D();
+        env2DTex.TexImage(0, ifmt, w, h, fmt, tao_ogl_resources::tex_typ_float, data);
+
+        EnvironmentTextureGraphicsData gd = CreateEnvironmentTextures(env2DTex);
+
+        stbi_image_free(data);
+
+        if(hash!=0) SaveEnvironmentTextures(gd, cachePath);
+
+        return _environmentTexturesGraphicsData.insert(std::move(gd));
+    }
+
+    std::optional<EnvironmentTextureGraphicsData> PbrRenderer::LoadEnvironmentTextures(const std::string& cachePath)
+    {
+        EnvironmentTextureGraphicsData res
+        {
+            ._envCube{_renderContext->CreateTextureCube()},
+            ._irradianceSh{_renderContext->CreateShaderStorageBuffer()},
+            ._prefilteredEnvCube{_renderContext->CreateTextureCube()}
+        };
+
+        // Every level of the chains, as saved by SaveEnvironmentTextures
+        const auto load = [&](OglTextureCube& cube, const char* suffix, int resolution, int levels)
+        {
+            const gli::texture cached = gli::load_dds(std::format("{}.{}.dds", cachePath, suffix));
+            if(cached.empty() || cached.target()!=gli::TARGET_CUBE || cached.format()!=gli::FORMAT_RGBA16_SFLOAT_PACK16 ||
+               cached.extent(0).x!=resolution || static_cast<int>(cached.levels())!=levels)
+                return false;
+
+            for(int l=0; l<levels; l++)
+                for(int f=0; f<6; f++)
+                {
+                    const auto face = static_cast<ogl_texture_cube_target>(tex_tar_cube_map_positive_x + f);
+                    const int  size = glm::max(1, resolution>>l);
+                    cube.TexImage(face, l, tex_int_for_rgba16f, size, size, 0, tex_for_rgba, tex_typ_half_float, cached.data(0, f, l));
+                }
+
+            return true;
+        };
+
+        if(!load(res._envCube,            "env", ENV_CUBE_RES, 1) ||
+           !load(res._prefilteredEnvCube, "pre", PRE_CUBE_RES, static_cast<int>(std::bit_width(static_cast<unsigned int>(PRE_CUBE_RES)))))
+            return std::nullopt;
+
+        // The 9 coefficients as a 9 texels 1D texture
+        const gli::texture sh = gli::load_dds(std::format("{}.sh9.dds", cachePath));
+        if(sh.empty() || sh.target()!=gli::TARGET_1D || sh.format()!=gli::FORMAT_RGBA32_SFLOAT_PACK32 || sh.extent(0).x!=9)
+            return std::nullopt;
+
+        res._irradianceSh.SetData(static_cast<GLsizeiptr>(9 * sizeof(glm::vec4)), sh.data(0, 0, 0), buf_usg_static_draw);
+
+        // As CreateEnvironmentTextures leaves them
+        res._envCube             .SetFilterParams(ogl_tex_filter_params{.min_filter = tex_min_filter_nearest, .mag_filter = tex_mag_filter_nearest});
+        res._prefilteredEnvCube  .SetFilterParams(ogl_tex_filter_params{.min_filter = tex_min_filter_linear_mip_linear, .mag_filter = tex_mag_filter_linear});
+
+        return res;
+    }
+
+    void PbrRenderer::SaveEnvironmentTextures(const EnvironmentTextureGraphicsData& gd, const std::string& cachePath)
+    {
+        // Blocks until the compute chain is done, once per environment
+        const auto save = [&](const OglTextureCube& cube, const char* suffix, int resolution, int levels)
+        {
+            gli::texture_cube cache{gli::FORMAT_RGBA16_SFLOAT_PACK16, gli::extent2d{resolution, resolution}, static_cast<gli::texture_cube::size_type>(levels)};
+
+            for(int l=0; l<levels; l++)
+            {
+                const int        size      = glm::max(1, resolution>>l);
+                const GLsizei    faceBytes = size * size * 4 * 2;
+                std::vector<unsigned char> faces(6 * faceBytes);
+
+                cube.GetTexImage(l, tex_for_rgba, tex_typ_half_float, static_cast<GLsizei>(faces.size()), faces.data());
+                for(int f=0; f<6; f++)
+                    memcpy(cache.data(0, f, l), faces.data() + f*faceBytes, glm::min<std::size_t>(cache.size(l), faceBytes));
+            }
+
+            // Best effort, a read-only directory just means no cache
+            gli::save_dds(cache, std::format("{}.{}.dds", cachePath, suffix));
+        };
+
+        save(gd._envCube,            "env", ENV_CUBE_RES, 1);
+        save(gd._prefilteredEnvCube, "pre", PRE_CUBE_RES, static_cast<int>(std::bit_width(static_cast<unsigned int>(PRE_CUBE_RES))));
+
+        gli::texture1d sh{gli::FORMAT_RGBA32_SFLOAT_PACK32, gli::extent1d{9}, 1};
+        gd._irradianceSh.GetSubData(0, static_cast<GLsizeiptr>(sh.size(0)), sh.data(0, 0, 0));
+        gli::save_dds(sh, std::format("{}.sh9.dds", cachePath));
+    }
+
+    GenKey<Mesh> PbrRenderer::AddMesh(Mesh& mesh)
+    {
+        return AddMesh(Mesh{mesh});
+    }
+
+    GenKey<Mesh> PbrRenderer::AddMesh(Mesh&& mesh, mesh_residency residency, int lodCount)
+    {
+        if(lodCount<1 || lodCount>MAX_MESH_LODS)
+            throw std::runtime_error("Invalid lod count.");
+
+        mesh._bounds       = tao_math::BoundingBox<float, 3>::ComputeBbox(mesh._positions);
+        mesh._graphicsData = CreateGraphicsData(mesh, lodCount);
+
+        if(residency==mesh_residency::gpu_only) mesh.ReleaseCpuData();
+
+        return _meshes.insert(std::move(mesh));
+    }
+
+    GenKey<ImageTexture> PbrRenderer::AddImageTexture(ImageTexture& texture)
+    {
+        auto key = _textures.insert(texture);
+
+        _textures.at(key)._graphicsData = CreateGraphicsData(texture);
+
+        return key;
+    }
+
+    GenKey<EnvironmentLight> PbrRenderer::AddEnvironmentTexture(const char* path)
+    {
+        // Processed lazily, see SetCurrentEnvironment
+        return _environmentTextures.insert(EnvironmentLight{path});
+    }
+
+    GenKey<PbrMaterial> PbrRenderer::AddMaterial(const PbrMaterial& material)
+    {
+        if(!PbrMaterial::CheckKey(material._diffuseTex, _textures))     throw std::runtime_error("Invalid texture key for `Diffuse` texture.");
+        if(!PbrMaterial::CheckKey(material._metalnessMap, _textures))   throw std::runtime_error("Invalid texture key for `Metalness` texture.");
+        if(!PbrMaterial::CheckKey(material._normalMap, _textures))      throw std::runtime_error("Invalid texture key for `Normal` texture.");
+        if(!PbrMaterial::CheckKey(material._roughnessMap, _textures))   throw std::runtime_error("Invalid texture key for `Roughness` texture.");
+
+        auto key = _materials.insert(material);
+
+        // The material table is indexed by the material key,
+        // draws sharing a material share its entry.
+        _shaderBuffers.materialSsbo.Set(key.Index, material);
+
+        return key;
+    }
+
+    void PbrRenderer::SetCurrentEnvironment(const GenKey<tao_pbr::EnvironmentLight> &environment)
+    {
+        if(!_environmentTextures.keyValid(environment))
+            throw std::runtime_error("The given key is not valid.");
+
+        auto& env = _environmentTextures.at(environment);
+        if(!env._graphicsData) env._graphicsData = CreateGraphicsData(env);
+
+        _currentEnvironment = environment;
+    }
+
+    PbrRenderer::material_gl_data_block PbrRenderer::ToGraphicsData(const PbrMaterial& mat)
+    {
+        return material_gl_data_block
+        {
+                .diffuse = glm::vec4(mat._diffuse, 1.0f),
+                .emission = glm::vec4(mat._emission, 1.0f),
+                .roughness = mat._roughness,
+                .metalness = mat._metalness,
+
+                // Textures still streaming are left out
+                .has_diffuse_tex    = TextureReady(mat._diffuseTex),
+                .has_emission_tex   = TextureReady(mat._emissionTex),
+                .has_normal_tex     = TextureReady(mat._normalMap),
+                .has_roughness_tex  = TextureReady(mat._roughnessMap),
+                .has_merged_rough_metal = mat._mergedMetalRough,
+                .has_metalness_tex  = TextureReady(mat._metalnessMap),
+                .has_occlusion_tex  = TextureReady(mat._occlusionMap),
+                .diffuse_emission_ids = GetMaterialTextureId(mat._diffuseTex) | GetMaterialTextureId(mat._emissionTex) << 16,
+
+                .diffuse_tex        = GetMaterialTextureRef(mat._diffuseTex),
+                .emission_tex       = GetMaterialTextureRef(mat._emissionTex),
+                .normal_tex         = GetMaterialTextureRef(mat._normalMap),
+                .metalness_tex      = GetMaterialTextureRef(mat._metalnessMap),
+                .roughness_tex      = GetMaterialTextureRef(mat._roughnessMap),
+                .occlusion_tex      = GetMaterialTextureRef(mat._occlusionMap),
+
+                .normal_metalness_ids    = GetMaterialTextureId(mat._normalMap)    | GetMaterialTextureId(mat._metalnessMap) << 16,
+                .roughness_occlusion_ids = GetMaterialTextureId(mat._roughnessMap) | GetMaterialTextureId(mat._occlusionMap) << 16
+        };
+    }
+
+    void PbrRenderer::FlushShaderBuffers()
+    {
+        // Only what changed since the last frame
+        _shaderBuffers.transformSsbo        .Flush();
+        _shaderBuffers.materialSsbo         .Flush();
+        _shaderBuffers.directionalLightsSsbo.Flush();
+        _shaderBuffers.sphereLightsSsbo     .Flush();
+        _shaderBuffers.rectLightsSsbo       .Flush();
+        _shaderBuffers.textureResidencySsbo .Flush();
+    }
+
+    GenKey<MeshRenderer> PbrRenderer::AddMeshRenderer(const Transformation& transform, const GenKey<Mesh>& mesh, const GenKey<PbrMaterial> &material)
+    {
+        if(!_meshes.keyValid(mesh))        throw std::runtime_error("Invalid `mesh` key.");
+        if(!_materials.keyValid(material)) throw std::runtime_error("Invalid `material` key.");
+
+        MeshRenderer mr(this, mesh, material, transform);
+        mr._aabb = WorldBounds(_meshes.at(mesh), mr._transformation.matrix());
+
+        auto key = _meshRenderers.insert(mr);
+
+        // The material is already in its buffer, the
+        // transform is uploaded with the next frame
+        _shaderBuffers.transformSsbo.Set(key.Index, mr);
+
+        _drawListDirty = true;
+
+        InvalidateShadowMaps(mr._aabb, false);
+
+        return key;
+    }
+
+    tao_math::BoundingBox<float, 3>::AaBb PbrRenderer::WorldBounds(const Mesh& mesh, const glm::mat4& model)
+    {
+        // Tight with the vertices, a (looser) box around
+        // the transformed object space box without them.
+        return mesh._residency==mesh_residency::gpu_only
+            ? tao_math::BoundingBox<float, 3>::TransformBbox(mesh._bounds, model)
+            : tao_math::BoundingBox<float, 3>::ComputeBbox(mesh._positions, model);
+    }
+
+    float PbrRenderer::LodScale(const glm::mat4& model)
+    {
+        // Lod errors are object space distances, scaled by at most this
+        const vec3 x{model[0]}, y{model[1]}, z{model[2]};
+        return std::sqrt(glm::max(glm::max(dot(x, x), dot(y, y)), dot(z, z)));
+    }
+
+    void PbrRenderer::UpdateMeshRenderer(GenKey<MeshRenderer> key, const Transformation& transformation)
+    {
+        MeshRenderer& mr = _meshRenderers.at(key);
+
+        const auto oldAabb = mr._aabb;
+
+        mr._transformation = transformation;
+        mr._aabb = WorldBounds(_meshes.at(mr._mesh), mr._transformation.matrix());
+
+        _shaderBuffers.transformSsbo.Set(key.Index, mr);
+
+        // A renderer which moves once is likely to move again:
+        // it leaves the cached (static) part of the shadow maps
+        // and it's drawn on top of it from now on.
+        bool dynamicCaster = mr._dynamic && _shadowCasterSplit;
+        if(!mr._dynamic)
+        {
+            mr._dynamic = true;
+            if(!_drawListDirty && _shadowCasterSplit) _drawList[_rendererDrawEntry[key.Index]].dynamic = true;
+        }
+
+        InvalidateShadowMaps(oldAabb, dynamicCaster);
+        InvalidateShadowMaps(mr._aabb, dynamicCaster);
+
+        // No need to rebuild: just refit the bvh (if
+        // the draw list is dirty it's rebuilt anyway).
+        if(!_drawListDirty)
+        {
+            const int entry = _rendererDrawEntry[key.Index];
+            _drawList[entry].center   = mr._aabb.Center();
+            _drawList[entry].radius   = 0.5f * length(mr._aabb.Max - mr._aabb.Min);
+            _drawList[entry].lodScale = LodScale(mr._transformation.matrix());
+            _bvh.Refit(entry, mr._aabb.Min, mr._aabb.Max);
+        }
+    }
+
+    void PbrRenderer::SetCompactGBuffer(bool enabled)
+    {
+        if(enabled == _compactGBuffer) return;
+
+        _compactGBuffer = enabled;
+
+        ResizeGBuffer(_windowWidth, _windowHeight);
+        InitShaders();
+    }
+
+    void PbrRenderer::SetQuantizedPositions(bool enabled)
+    {
+        if(enabled == _quantizedPositions) return;
+
+        if(_meshArena.vboSize)
+            throw std::runtime_error("The positions format can't change once meshes have been added.");
+
+        _quantizedPositions = enabled;
+
+        InitMeshArena();
+    }
+
+    void PbrRenderer::SetTiledLightPass(bool enabled)
+    {
+        _tiledLightPass = enabled;
+    }
+
+    void PbrRenderer::SetMeshletCulling(bool enabled)
+    {
+        // Draw commands are rebuilt every frame
+        _meshletCulling = enabled;
+    }
+
+    void PbrRenderer::SetShadowCasterSplit(bool enabled)
+    {
+        if(enabled == _shadowCasterSplit) return;
+
+        _shadowCasterSplit = enabled;
+
+        // draw entries carry the static/dynamic flag,
+        // the static copies count towards the atlas budget
+        _drawListDirty = true;
+        ReleaseShadowAtlas();
+    }
+
+    void PbrRenderer::SetLodSettings(const LodSettings& settings)
+    {
+        if(!(settings.pixelError > 0.0f))
+            throw std::runtime_error("The lod pixel error should be positive.");
+
+        if(settings.shadowBias<0 || settings.shadowBias>=MAX_MESH_LODS)
+            throw std::runtime_error("Invalid lod shadow bias.");
+
+        // Lods are selected every frame
+        _lodSettings = settings;
+    }
+
+    void PbrRenderer::SetTextureStreaming(const TextureStreamingSettings& settings)
+    {
+        if(settings.uploadBudget < TEXTURE_UPLOAD_MIN_BUDGET)
+            throw std::runtime_error(std::format("The texture upload budget should be at least {} bytes.", TEXTURE_UPLOAD_MIN_BUDGET));
+
+        if(settings.uploadBudget == _textureStreamingSettings.uploadBudget) return;
+
+        // Uploads in flight keep reading the old one (GL side)
+        _textureUploadRing        = _renderContext->CreatePersistentRingBuffer(settings.uploadBudget, FRAME_RING_PARTITIONS);
+        _textureStreamingSettings = settings;
+    }
+
+    void PbrRenderer::SetTextureResidency(const TextureResidencySettings& settings)
+    {
+        if(settings.memoryBudget <= 0)
+            throw std::runtime_error("The texture memory budget should be positive.");
+
+        // Enforced from the next frame on
+        _textureResidencySettings = settings;
+    }
+
+    void PbrRenderer::SetShadowCascades(const ShadowCascadeSettings& settings)
+    {
+        if(settings.cascadeCount<1 || settings.cascadeCount>MAX_DIR_SHADOW_CASCADES)
+            throw std::runtime_error("Invalid cascade count.");
+
+        if(settings.splitLambda<0.0f || settings.splitLambda>1.0f)
+            throw std::runtime_error("The split lambda should be in [0, 1].");
+
+        _shadowCascadeSettings = settings;
+
+        // The cascades' matrices are recomputed every frame
+        // and they get dirty if something changed.
+    }
+
+    // Atlases memory, static copies included
+    static unsigned long long DirShadowAtlasBytes(int size, bool casterSplit)
+    {
+        return static_cast<unsigned long long>(size) * size * sizeof(float) * (casterSplit ? 2 : 1);
+    }
+
+    static unsigned long long CubeShadowPageBytes(int size, bool casterSplit)
+    {
+        // 6 faces of distance (r16f) and depth (32f)
+        return static_cast<unsigned long long>(size) * size * 6 * (2 + sizeof(float)) * (casterSplit ? 2 : 1);
+    }
+
+    void PbrRenderer::SetShadowAtlas(const ShadowAtlasSettings& settings)
+    {
+        auto powerOfTwo = [](int v){ return v>0 && std::has_single_bit(static_cast<unsigned int>(v)); };
+
+        if(!powerOfTwo(settings.directionalAtlasSize) || !powerOfTwo(settings.maxDirectionalRes) ||
+           !powerOfTwo(settings.cubePageSize)         || !powerOfTwo(settings.maxCubeRes)        ||
+           !powerOfTwo(settings.minRes))
+            throw std::runtime_error("Shadow atlas sizes and resolutions should be powers of two.");
+
+        if(settings.maxDirectionalRes>settings.directionalAtlasSize || settings.maxCubeRes>settings.cubePageSize)
+            throw std::runtime_error("Shadow resolutions can't exceed the atlas (page) size.");
+
+        if(settings.minRes>settings.maxDirectionalRes || settings.minRes>settings.maxCubeRes)
+            throw std::runtime_error("The min shadow resolution can't exceed the max ones.");
+
+        if(DirShadowAtlasBytes(settings.directionalAtlasSize, _shadowCasterSplit)>settings.memoryBudget)
+            throw std::runtime_error("The directional shadow atlas exceeds the memory budget.");
+
+        _shadowAtlasSettings = settings;
+
+        // Allocated again, with the new sizes, when needed
+        ReleaseShadowAtlas();
+    }
+
+    static bool SphereBoxOverlap(const vec3& center, float radius, const tao_math::BoundingBox<float, 3>::AaBb& box)
+    {
+        const vec3 closest = clamp(center, box.Min, box.Max);
+        return dot(closest-center, closest-center) <= radius*radius;
+    }
+
+    void PbrRenderer::InvalidateShadowMaps()
+    {
+        for(auto& sm : _directionalShadowMaps)
+            for(auto& c : sm.cascades) c.dirty = true;
+        for(auto& sm : _sphereShadowMaps)      sm.dirty = true;
+        for(auto& sm : _rectShadowMaps)        sm.dirty = true;
+    }
+
+    void PbrRenderer::InvalidateShadowMaps(const tao_math::BoundingBox<float, 3>::AaBb& casterBounds, bool dynamicCaster)
+    {
+        // Directional lights see everything (the shadow
+        // matrix covers the whole scene)
+        for(auto& sm : _directionalShadowMaps)
+            for(auto& c : sm.cascades) (dynamicCaster ? c.dynamicDirty : c.dirty) = true;
+
+        // Point shadows only if the caster is within the light's range
+        // (maps which were never drawn are dirty anyway).
+        auto invalidateInRange = [&casterBounds, dynamicCaster](SphereShadowMap& sm)
+        {
+            if(sm.dirty) return;
+            if(SphereBoxOverlap(sm.shadowCenter, sm.shadowSize.w, casterBounds))
+                (dynamicCaster ? sm.dynamicDirty : sm.dirty) = true;
+        };
+
+        for(auto& sm : _sphereShadowMaps) invalidateInRange(sm);
+        for(auto& sm : _rectShadowMaps)   invalidateInRange(sm);
+    }
+
+    static bool SphereInFrustum(const Frustum& frustum, const vec3& center, float radius)
+    {
+        for(int p=0;p<Frustum::PLANE_COUNT;p++)
+        {
+            const vec4& plane = frustum.PlaneEquation(p);
+            if(dot(vec3{plane}, center) + plane.w < -radius) return false;
+        }
+
+        return true;
+    }
+
+    // Every other bit (the even ones) of a Morton code
+    static unsigned int MortonCompact(unsigned long long code)
+    {
+        code &= 0x5555555555555555ull;
+        code = (code | (code >> 1 )) & 0x3333333333333333ull;
+        code = (code | (code >> 2 )) & 0x0f0f0f0f0f0f0f0full;
+        code = (code | (code >> 4 )) & 0x00ff00ff00ff00ffull;
+        code = (code | (code >> 8 )) & 0x0000ffff0000ffffull;
+        code = (code | (code >> 16)) & 0x00000000ffffffffull;
+        return static_cast<unsigned int>(code);
+    }
+
+    // Halves the resolution of the largest requests, or drops the lowest
+    // priority one when none can be shrunk further, until the total
+    // area fits `capacity` texels. Returns the area.
+    unsigned long long PbrRenderer::FitShadowAtlasRequests(std::vector<ShadowAtlasRequest>& requests, unsigned long long capacity, int minRes)
+    {
+        unsigned long long area = 0;
+        for(const auto& r : requests) area += static_cast<unsigned long long>(r.res) * r.res;
+
+        while(area>capacity)
+        {
+            ShadowAtlasRequest* shrink = nullptr;
+            ShadowAtlasRequest* drop   = nullptr;
+            for(auto& r : requests)
+            {
+                if(r.res==0) continue;
+
+                if(r.res>minRes && (!shrink || r.res>shrink->res || (r.res==shrink->res && r.priority<shrink->priority)))
+                    shrink = &r;
+                if(!drop || r.priority<drop->priority)
+                    drop = &r;
+            }
+
+            if(shrink)
+            {
+                const unsigned long long half = shrink->res/2;
+                area -= 3*half*half;
+                shrink->res /= 2;
+            }
+            else
+            {
+                area -= static_cast<unsigned long long>(drop->res) * drop->res;
+                drop->res = 0;
+            }
+        }
+
+        return area;
+    }
+
+    // Requests are sorted by resolution (largest first) and laid out one after
+    // the other along a Morton curve: power of two regions end up aligned, with
+    // no gaps, and never straddle two pages. Same resolutions, same places.
+    void PbrRenderer::PackShadowAtlasRequests(std::vector<ShadowAtlasRequest>& requests, int pageSize)
+    {
+        std::sort(requests.begin(), requests.end(), [](const auto& a, const auto& b)
+        {
+            return a.res!=b.res ? a.res>b.res : a.owner<b.owner;
+        });
+
+        const unsigned long long pageArea = static_cast<unsigned long long>(pageSize) * pageSize;
+        unsigned long long offset = 0;
+        for(auto& r : requests)
+        {
+            r.tile = {};
+            if(r.res==0) continue;
+
+            const unsigned long long area = static_cast<unsigned long long>(r.res) * r.res;
+            const unsigned long long cell = (offset % pageArea) / area;
+
+            r.tile.x    = static_cast<int>(MortonCompact(cell     )) * r.res;
+            r.tile.y    = static_cast<int>(MortonCompact(cell >> 1)) * r.res;
+            r.tile.page = static_cast<int>(offset / pageArea);
+            r.tile.res  = r.res;
+
+            offset += area;
+        }
+    }
+
+    void PbrRenderer::AllocateShadowAtlas(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+    {
+        const auto& settings = _shadowAtlasSettings;
+
+        const int dirCount    = static_cast<int>(_directionalLights.slot_count());
+        const int sphereCount = static_cast<int>(_sphereLights.slot_count());
+        const int rectCount   = static_cast<int>(_rectLights.slot_count());
+
+        // New lights come in dirty
+        _directionalShadowMaps.resize(dirCount);
+        _sphereShadowMaps     .resize(sphereCount);
+        _rectShadowMaps       .resize(rectCount);
+        _dirShadowCasters     .resize(dirCount*MAX_DIR_SHADOW_CASCADES);
+        _sphereShadowCasters  .resize(sphereCount);
+        _rectShadowCasters    .resize(rectCount);
+
+        PerfCounters.ShadowedLights = 0;
+
+        // Directional Shadows
+        // ---------------------------------------------------
+        // Cascades cover the view, they all ask for the max
+        // resolution: the nearest ones are kept the longest.
+        _shadowAtlasRequests.clear();
+        for(int i=0;i<dirCount;i++)
+        {
+            if(!_directionalLights.indexValid(i)) continue;
+
+            const vec3& intensity = _directionalLights.at_index(i).intensity;
+            for(int c=0;c<_shadowCascadeSettings.cascadeCount;c++)
+                _shadowAtlasRequests.push_back(ShadowAtlasRequest
+                {
+                    .owner    = i*MAX_DIR_SHADOW_CASCADES+c,
+                    .res      = settings.maxDirectionalRes,
+                    .priority = glm::max(glm::max(intensity.r, intensity.g), intensity.b) / static_cast<float>(c+1)
+                });
+        }
+
+        if(!_shadowAtlasRequests.empty() && !_shadowAtlas.directional) ReserveDirShadowAtlas();
+
+        const unsigned long long dirArea = static_cast<unsigned long long>(settings.directionalAtlasSize) * settings.directionalAtlasSize;
+        FitShadowAtlasRequests(_shadowAtlasRequests, dirArea, settings.minRes);
+        PackShadowAtlasRequests(_shadowAtlasRequests, settings.directionalAtlasSize);
+
+        // Back in owner order, the ones without a request lose their region
+        auto byOwner = [](const ShadowAtlasRequest& a, const ShadowAtlasRequest& b){ return a.owner<b.owner; };
+        std::sort(_shadowAtlasRequests.begin(), _shadowAtlasRequests.end(), byOwner);
+
+        auto request = _shadowAtlasRequests.cbegin();
+        auto nextTile = [this, &request](int owner)
+        {
+            ShadowAtlasTile tile{};
+            if(request!=_shadowAtlasRequests.cend() && request->owner==owner) tile = (request++)->tile;
+            return tile;
+        };
+
+        for(int i=0;i<dirCount;i++)
+        {
+            bool shadowed = false;
+            for(int c=0;c<MAX_DIR_SHADOW_CASCADES;c++)
+            {
+                auto& cascade = _directionalShadowMaps[i].cascades[c];
+                const ShadowAtlasTile tile = nextTile(i*MAX_DIR_SHADOW_CASCADES+c);
+
+                // Moved or resized: drawn again
+                if(tile.res>0 && tile!=cascade.tile) cascade.dirty = true;
+                cascade.tile = tile;
+                shadowed = shadowed || tile.res>0;
+            }
+            PerfCounters.ShadowedLights += shadowed;
+        }
+
+        // Sphere and Rect Shadows
+        // ---------------------------------------------------
+        // The resolution follows the size (pixels) of the light's
+        // range on screen, lights out of the view get nothing.
+        const Frustum cameraFrustum{projectionMatrix*viewMatrix};
+        const vec3    eyePosition   = vec3{inverse(viewMatrix)[3]};
+        const float   pixelsPerUnit = 0.5f * projectionMatrix[1][1] * static_cast<float>(_windowHeight); // at unit distance
+
+        _shadowAtlasRequests.clear();
+        auto requestCube = [&](int owner, const vec3& position, const vec2& range)
+        {
+            if(!SphereInFrustum(cameraFrustum, position, range.y)) return;
+
+            const float distance = length(position-eyePosition);
+            const float coverage = distance>range.y
+                    ? range.y * pixelsPerUnit / distance
+                    : static_cast<float>(settings.maxCubeRes); // the camera is in range
+
+            const float res = glm::clamp(coverage, static_cast<float>(settings.minRes), static_cast<float>(settings.maxCubeRes));
+            _shadowAtlasRequests.push_back(ShadowAtlasRequest
+            {
+                .owner    = owner,
+                .res      = static_cast<int>(std::bit_floor(static_cast<unsigned int>(res))),
+                .priority = coverage
+            });
+        };
+
+        for(int i=0;i<sphereCount;i++)
+        {
+            if(!_sphereLights.indexValid(i)) continue;
+
+            const auto& l = _sphereLights.at_index(i);
+            requestCube(i, vec3{l.transformation.matrix()[3]}, CubeShadowRange(l.intensity, CubeShadowRadius(l)));
+        }
+
+        for(int i=0;i<rectCount;i++)
+        {
+            if(!_rectLights.indexValid(i)) continue;
+
+            const auto& l = _rectLights.at_index(i);
+            requestCube(sphereCount+i, vec3{l.transformation.matrix()[3]}, CubeShadowRange(l.intensity, CubeShadowRadius(l)));
+        }
+
+        // Pages within what's left of the budget
+        const unsigned long long dirBytes  = _shadowAtlas.directional ? DirShadowAtlasBytes(settings.directionalAtlasSize, _shadowCasterSplit) : 0;
+        const unsigned long long pageBytes = CubeShadowPageBytes(settings.cubePageSize, _shadowCasterSplit);
+        const unsigned long long pageArea  = static_cast<unsigned long long>(settings.cubePageSize) * settings.cubePageSize;
+        const int maxPages = static_cast<int>(settings.memoryBudget>dirBytes ? (settings.memoryBudget-dirBytes)/pageBytes : 0);
+
+        const unsigned long long cubeArea = FitShadowAtlasRequests(_shadowAtlasRequests, maxPages*pageArea, settings.minRes);
+        const int pages = static_cast<int>((cubeArea + pageArea - 1) / pageArea);
+
+        if(pages>_shadowAtlas.cubePages)
+            ReserveCubeShadowAtlas(glm::min(static_cast<int>(std::bit_ceil(static_cast<unsigned int>(pages))), maxPages));
+
+        PackShadowAtlasRequests(_shadowAtlasRequests, settings.cubePageSize);
+        std::sort(_shadowAtlasRequests.begin(), _shadowAtlasRequests.end(), byOwner);
+
+        request = _shadowAtlasRequests.cbegin();
+        for(int i=0;i<sphereCount+rectCount;i++)
+        {
+            auto& sm = i<sphereCount ? _sphereShadowMaps[i] : _rectShadowMaps[i-sphereCount];
+            const ShadowAtlasTile tile = nextTile(i);
+
+            // Moved or resized: drawn again
+            if(tile.res>0 && tile!=sm.tile) sm.dirty = true;
+            sm.tile = tile;
+            PerfCounters.ShadowedLights += tile.res>0;
+        }
+    }
+
+    void PbrRenderer::ReserveDirShadowAtlas()
+    {
+        const int size = _shadowAtlasSettings.directionalAtlasSize;
+
+        _shadowAtlas.directional.emplace(_renderContext->CreateTexture2D());
+        _shadowAtlas.directional->TexImage(0, tex_int_for_depth_32f, size, size, tex_for_depth, tex_typ_float, nullptr);
+        _shadowAtlas.directional->SetFilterParams(ogl_tex_filter_params
+        {
+            .min_filter = tex_min_filter_nearest,
+            .mag_filter = tex_mag_filter_nearest
+        });
+        _shadowAtlas.directionalStatic.reset();
+
+        _shadowAtlas.directionalFbo.AttachTexture(fbo_attachment_depth, _shadowAtlas.directional.value(), 0);
+
+        for(auto& sm : _directionalShadowMaps)
+            for(auto& c : sm.cascades) c.dirty = true;
+    }
+
+    void PbrRenderer::ReserveCubeShadowAtlas(int pages)
+    {
+        const int size = _shadowAtlasSettings.cubePageSize;
+        ogl_tex_filter_params pointFilter
+        {
+            .min_filter = tex_min_filter_nearest,
+            .mag_filter = tex_mag_filter_nearest
+        };
+
+        _shadowAtlas.cubeColor.emplace(_renderContext->CreateTextureCubeArray());
+        _shadowAtlas.cubeDepth.emplace(_renderContext->CreateTextureCubeArray());
+        _shadowAtlas.cubeColor->TexStorage(1, tex_int_for_r16f, size, pages);
+        _shadowAtlas.cubeDepth->TexStorage(1, tex_int_for_depth_32f, size, pages);
+        _shadowAtlas.cubeColor->SetFilterParams(pointFilter);
+        _shadowAtlas.cubeDepth->SetFilterParams(pointFilter);
+        _shadowAtlas.cubeColorStatic.reset();
+        _shadowAtlas.cubeDepthStatic.reset();
+        _shadowAtlas.cubePages = pages;
+
+        // Layered: the layer-face is picked when drawing
+        _shadowAtlas.cubeFbo.AttachTexture(fbo_attachment_color0, _shadowAtlas.cubeColor.value(), 0);
+        _shadowAtlas.cubeFbo.AttachTexture(fbo_attachment_depth , _shadowAtlas.cubeDepth.value(), 0);
+
+        for(auto& sm : _sphereShadowMaps) sm.dirty = true;
+        for(auto& sm : _rectShadowMaps)   sm.dirty = true;
+    }
+
+    void PbrRenderer::ReleaseShadowAtlas()
+    {
+        _shadowAtlas.directional      .reset();
+        _shadowAtlas.directionalStatic.reset();
+        _shadowAtlas.cubeColor        .reset();
+        _shadowAtlas.cubeDepth        .reset();
+        _shadowAtlas.cubeColorStatic  .reset();
+        _shadowAtlas.cubeDepthStatic  .reset();
+        _shadowAtlas.cubePages = 0;
+
+        InvalidateShadowMaps();
+    }
+
+    void PbrRenderer::UploadShadowData()
+    {
+        const float dirAtlasSize = static_cast<float>(_shadowAtlasSettings.directionalAtlasSize);
+        const float cubePageSize = static_cast<float>(_shadowAtlasSettings.cubePageSize);
+
+        _frameDirShadows.clear();
+        for(const auto& sm : _directionalShadowMaps)
+            for(const auto& c : sm.cascades)
+            {
+                const float scale = static_cast<float>(c.tile.res)/dirAtlasSize;
+                _frameDirShadows.push_back(dir_shadow_gl_data_block
+                {
+                    .shadowMatrix   = c.shadowMatrix,
+                    .shadowSize     = c.shadowSize,
+                    .tile           = vec4{static_cast<float>(c.tile.x)/dirAtlasSize, static_cast<float>(c.tile.y)/dirAtlasSize, scale, scale},
+                    .lightPosSplit  = vec4{c.lightPos, c.splitFar}
+                });
+            }
+
+        _frameCubeShadows.clear();
+        auto addCubeShadow = [this, cubePageSize](const SphereShadowMap& sm)
+        {
+            _frameCubeShadows.push_back(cube_shadow_gl_data_block
+            {
+                .shadowSize = vec4{sm.shadowSize.x, sm.shadowSize.z, sm.shadowSize.y, sm.shadowSize.w},
+                .tile       = vec4{static_cast<float>(sm.tile.x)/cubePageSize, static_cast<float>(sm.tile.y)/cubePageSize,
+                                   static_cast<float>(sm.tile.res)/cubePageSize, static_cast<float>(sm.tile.page)}
+            });
+        };
+        for(const auto& sm : _sphereShadowMaps) addCubeShadow(sm);
+        for(const auto& sm : _rectShadowMaps)   addCubeShadow(sm);
+
+        // Empty ranges can't be bound, the
+        // shaders don't read them anyway
+        if(_frameDirShadows.empty())  _frameDirShadows.emplace_back();
+        if(_frameCubeShadows.empty()) _frameCubeShadows.emplace_back();
+
+        _frameRing.BindStorageRange(LIGHTPASS_BUFFER_BINDING_DIR_SHADOWS,
+            _frameRing.Write(_frameDirShadows.data(), _frameDirShadows.size()*sizeof(dir_shadow_gl_data_block)));
+        _frameRing.BindStorageRange(LIGHTPASS_BUFFER_BINDING_CUBE_SHADOWS,
+            _frameRing.Write(_frameCubeShadows.data(), _frameCubeShadows.size()*sizeof(cube_shadow_gl_data_block)));
+    }
+
+    void PbrRenderer::ReserveFrameRing()
+    {
+        const GLsizeiptr alignment = _frameRing.Alignment();
+        auto aligned = [alignment](std::size_t size) { return (static_cast<GLsizeiptr>(size) + alignment - 1) / alignment * alignment; };
+
+        // The shadow maps follow the light slots (see AllocateShadowAtlas)
+        const std::size_t cascades    = _directionalLights.slot_count() * MAX_DIR_SHADOW_CASCADES;
+        const std::size_t cubeShadows = _sphereLights.slot_count() + _rectLights.slot_count();
+
+        // Frame and lights blocks, a camera block for the view and
+        // each cascade, the shadow data (see UploadShadowData)
+        const GLsizeiptr needed =
+            aligned(sizeof(frame_gl_data_block)) +
+            aligned(sizeof(lights_gl_data_block)) +
+            static_cast<GLsizeiptr>(cascades + 1) * aligned(sizeof(camera_gl_data_block)) +
+            aligned(std::max<std::size_t>(cascades,    1) * sizeof(dir_shadow_gl_data_block)) +
+            aligned(std::max<std::size_t>(cubeShadows, 1) * sizeof(cube_shadow_gl_data_block));
+
+        if(needed <= _frameRing.PartitionSize()) return;
+
+        // The frames in flight still hold the old buffer (GL side)
+        _frameRing = _renderContext->CreatePersistentRingBuffer(std::max(needed, 2 * _frameRing.PartitionSize()), FRAME_RING_PARTITIONS);
+    }
+
+    std::vector<GenKey<MeshRenderer>> PbrRenderer::QueryMeshRenderers(const Frustum& frustum)
+    {
+        if(_drawListDirty) UpdateDrawList();
+
+        std::vector<int> entries{};
+        _bvh.QueryFrustum(frustum, entries);
+
+        std::vector<GenKey<MeshRenderer>> res(entries.size());
+        for(int i=0;i<entries.size();i++) res[i] = _drawList[entries[i]].renderer;
+
+        return res;
+    }
+
+    std::vector<GenKey<MeshRenderer>> PbrRenderer::QueryMeshRenderers(const glm::vec3& center, float radius)
+    {
+        if(_drawListDirty) UpdateDrawList();
+
+        std::vector<int> entries{};
+        _bvh.QuerySphere(center, radius, entries);
+
+        std::vector<GenKey<MeshRenderer>> res(entries.size());
+        for(int i=0;i<entries.size();i++) res[i] = _drawList[entries[i]].renderer;
+
+        return res;
+    }
+
+    std::optional<GenKey<MeshRenderer>> PbrRenderer::PickMeshRenderer(const Ray& ray)
+    {
+        if(_drawListDirty) UpdateDrawList();
+
+        // Boxes first, then the actual triangles (in object space)
+        auto hitTest = [this, &ray](int entry) -> std::optional<float>
+        {
+            const MeshRenderer& mr   = _meshRenderers.at(_drawList[entry].renderer);
+            const Mesh&         mesh = _meshes.at(mr._mesh);
+
+            // No triangles left, the box will do
+            if(mesh._residency==mesh_residency::gpu_only)
+                return RayAabbIntersection(ray, mr._aabb.Min, mr._aabb.Max);
+
+            const mat4 model    = mr._transformation.matrix();
+            const mat4 modelInv = inverse(model);
+            const Ray  objRay{vec3{modelInv*vec4{ray.Origin(), 1.0f}}, vec3{modelInv*vec4{ray.Direction(), 0.0f}}};
+
+            std::optional<float> closest = std::nullopt;
+            for(int i=0; i+2<mesh._indices.size(); i+=3)
+            {
+                auto hit = RayTriangleIntersection(objRay,
+                                                   mesh._positions[mesh._indices[i  ]],
+                                                   mesh._positions[mesh._indices[i+1]],
+                                                   mesh._positions[mesh._indices[i+2]]);
+                if(!hit) continue;
+
+                const float t = dot(vec3{model*vec4{hit.value(), 1.0f}}-ray.Origin(), ray.Direction());
+                if(t>=0.0f && (!closest || t<closest.value())) closest = t;
+            }
+
+            return closest;
+        };
+
+        auto hit = _bvh.Raycast(ray, hitTest);
+        if(!hit) return std::nullopt;
+
+        return _drawList[hit.value().item].renderer;
+    }
+
+    void PbrRenderer::UpdateDrawList()
+    {
+        // The order doesn't matter here, the
+        // passes sort what they need to draw.
+        const auto renderers = _meshRenderers.values();
+
+        std::vector<draw_gl_data_block> drawData(renderers.size());
+        std::vector<vec3> mins(renderers.size()), maxs(renderers.size());
+
+        _drawList.resize(renderers.size());
+        _rendererDrawEntry.assign(_meshRenderers.slot_count(), -1);
+
+        for(int d=0; d<renderers.size(); d++)
+        {
+            const MeshRenderer& mr  = renderers[d];
+            const auto          key = _meshRenderers.key_of(d);
+            auto meshDataKey = _meshes.at(mr._mesh)._graphicsData;
+
+            if(!meshDataKey.has_value()) throw std::runtime_error("The mesh has no graphics data.");
+
+            const auto& meshData = _meshesGraphicsData.at(meshDataKey.value());
+
+            _drawList[d] = DrawListEntry
+            {
+                .command = draw_elements_indirect_command
+                {
+                    .count          = static_cast<GLuint>(meshData._indicesCount),
+                    .instance_count = 1,
+                    .first_index    = meshData._firstIndex,
+                    .base_vertex    = meshData._baseVertex,
+                    .base_instance  = static_cast<GLuint>(d) // -> draw id
+                },
+                .material   = mr._material,
+                .mesh       = mr._mesh,
+                .renderer   = key,
+                .center     = mr._aabb.Center(),
+                .radius     = 0.5f * length(mr._aabb.Max - mr._aabb.Min),
+                .lodScale   = LodScale(mr._transformation.matrix()),
+                .dynamic    = _shadowCasterSplit && mr._dynamic,
+                .shortIndices = meshData._shortIndices,
+                .lodCount   = meshData._lodCount,
+                .firstMeshlet = meshData._firstMeshlet,
+                .meshletCount = meshData._meshletCount
+            };
+            std::copy_n(meshData._lods, meshData._lodCount, _drawList[d].lods);
+
+            _rendererDrawEntry[key.Index] = d;
+
+            mins[d] = mr._aabb.Min;
+            maxs[d] = mr._aabb.Max;
+
+            drawData[d] = draw_gl_data_block
+            {
+                .transformIndex = static_cast<int>(key.Index),
+                .materialIndex  = static_cast<int>(mr._material.Index),
+                .pad            = {},
+                .positionOffset = vec4{meshData._positionOffset, 0.0f},
+                .positionScale  = vec4{meshData._positionScale , 0.0f}
+            };
+        }
+
+        _bvh.Build(mins, maxs);
+
+        if(!drawData.empty())
+        {
+            _shaderBuffers.drawDataSsbo.Resize(drawData.size()*sizeof(draw_gl_data_block));
+            _shaderBuffers.drawDataSsbo.OglBuffer().SetSubData(0, drawData.size()*sizeof(draw_gl_data_block), drawData.data());
+        }
+
+        ReserveDrawIds(drawData.size());
+
+        _drawListDirty = false;
+    }
+
+    void PbrRenderer::ReserveDrawIds(unsigned int count)
+    {
+        // The draw ids buffer only ever grows (0, 1, 2, ...)
+        if(_meshArena.drawIdCapacity < count)
+        {
+            std::vector<GLuint> ids(ResizeBufferPolicy(_meshArena.drawIdCapacity, count));
+            for(int i=0;i<ids.size();i++) ids[i] = i;
+
+            _meshArena.drawIdVbo.SetData(ids.size()*sizeof(GLuint), ids.data(), buf_usg_static_draw);
+            _meshArena.drawIdCapacity = ids.size();
+        }
+    }
+
+    void PbrRenderer::SortDrawEntries(std::vector<int>& entries, const glm::mat4& viewMatrix, unsigned int pass)
+    {
+        _sortKeys.resize(entries.size());
+
+        for(int i=0;i<entries.size();i++)
+        {
+            const DrawListEntry& e = _drawList[entries[i]];
+
+            // For non-negative floats the bit pattern sorts like the value,
+            // its top 24 bits are the quantized depth (no need for near/far).
+            const float depth = glm::max(0.0f, -(viewMatrix*vec4{e.center, 1.0f}).z);
+            const unsigned long long depthBits = std::bit_cast<unsigned int>(depth) >> 7;
+
+            _sortKeys[i] =
+                    ((static_cast<unsigned long long>(pass)             & 0xF     ) << SORT_KEY_PASS_SHIFT)     |
+                    ((static_cast<unsigned long long>(e.material.Index) & 0xFFFFF ) << SORT_KEY_MATERIAL_SHIFT) |
+                    ((depthBits                                          & 0xFFFFFF) << SORT_KEY_DEPTH_SHIFT)    |
+                    ((static_cast<unsigned long long>(e.mesh.Index)     & 0xFFFF  ) << SORT_KEY_MESH_SHIFT);
+        }
+
+        RadixSort(_sortKeys, entries, _sortKeysTmp, _sortValuesTmp);
+    }
+
+    void PbrRenderer::QueryDrawEntries(const Frustum* frustum, int planeCount)
+    {
+        _visibleEntries.clear();
+
+        if(frustum)
+        {
+            _bvh.QueryFrustum(*frustum, _visibleEntries, planeCount);
+        }
+        else
+        {
+            _visibleEntries.resize(_drawList.size());
+            std::iota(_visibleEntries.begin(), _visibleEntries.end(), 0);
+        }
+    }
+
+    void PbrRenderer::GroupDrawCommands(DrawCommandList& list, std::vector<int>::const_iterator first, std::vector<int>::const_iterator last, int lodBias, int meshletView)
+    {
+        list.firstCommand       = static_cast<int>(_frameCommands.size());
+        list.commandCount       = static_cast<int>(last-first);
+        list.shortCommandCount  = 0;
+        list.culledCommandCount = 0;
+
+        _commandGroups.resize(list.commandCount);
+
+        // Entries drawn at lod 0 go through the meshlet culling
+        // (while the frame's culled indices budget lasts).
+        for(auto d = first; d!=last; ++d)
+        {
+            const DrawListEntry& e = _drawList[*d];
+
+            const bool culled =
+                    meshletView>=0 && e.meshletCount>0 &&
+                    glm::min(_frameLods[*d] + lodBias, e.lodCount - 1)==0 &&
+                    _frameMeshletIndices + e.lods[0].indicesCount <= MESHLET_CULLED_INDEX_BUDGET;
+
+            if(culled)
+            {
+                const GLuint firstThread = _frameMeshletJobs.empty() ? 0 : _frameMeshletJobs.back().firstThread + _frameMeshletJobs.back().meshletCount;
+
+                _frameMeshletJobs.push_back(meshlet_job_gl_data_block
+                {
+                    .firstThread    = firstThread,
+                    .firstMeshlet   = e.firstMeshlet,
+                    .meshletCount   = static_cast<GLuint>(e.meshletCount),
+                    .command        = static_cast<GLuint>(list.culledCommandCount),    // the list's culled ones, see below
+                    .outputOffset   = _frameMeshletIndices,
+                    .shortIndices   = e.shortIndices,
+                    .transformIndex = static_cast<int>(e.renderer.Index),
+                    .view           = meshletView
+                });
+
+                _frameMeshletIndices += e.lods[0].indicesCount;
+                list.culledCommandCount++;
+            }
+
+            _commandGroups[d-first] = culled ? command_group::culled : e.shortIndices ? command_group::short_indices : command_group::wide;
+            list.shortCommandCount += _commandGroups[d-first]==command_group::short_indices;
+        }
+
+        // The culled commands go last
+        const GLuint culledBase = list.firstCommand + list.commandCount - list.culledCommandCount;
+        for(auto job = _frameMeshletJobs.end() - list.culledCommandCount; job!=_frameMeshletJobs.end(); ++job)
+            job->command += culledBase;
+    }
+
+    void PbrRenderer::AppendDrawCommands(DrawCommandList& list, std::vector<int>::const_iterator first, std::vector<int>::const_iterator last, int lodBias, int meshletView)
+    {
+        GroupDrawCommands(list, first, last, lodBias, meshletView);
+
+        // 32 bit indices first, then 16 bit, then the meshlet
+        // culled ones (same order otherwise). These start empty,
+        // the culling appends to their indices.
+        size_t job = _frameMeshletJobs.size() - list.culledCommandCount;
+
+        for(command_group group : {command_group::wide, command_group::short_indices, command_group::culled})
+            for(auto d = first; d!=last; ++d)
+            {
+                if(_commandGroups[d-first] != group) continue;
+
+                auto command = LodCommand(*d, lodBias);
+                if(group==command_group::culled)
+                {
+                    command.first_index = _frameMeshletJobs[job++].outputOffset;
+                    command.count       = 0;
+                }
+
+                _frameCommands.push_back(command);
+            }
+    }
+
+    int PbrRenderer::AddMeshletView(const Frustum* frustum, int planeCount, const glm::vec4& eye)
+    {
+        if(!_meshletCulling) return -1;
+
+        meshlet_view_gl_data_block view
+        {
+            .planes     = {},
+            .eye        = eye,
+            .planeCount = frustum ? planeCount : 0,
+            .pad        = {}
+        };
+        for(int p=0; p<view.planeCount; p++) view.planes[p] = frustum->PlaneEquation(p);
+
+        _frameMeshletViews.push_back(view);
+
+        return static_cast<int>(_frameMeshletViews.size()) - 1;
+    }
+
+    int PbrRenderer::BuildDrawCommandList(DrawCommandList& list, const Frustum* frustum, int planeCount, const glm::mat4* sortView, int meshletView)
+    {
+        QueryDrawEntries(frustum, planeCount);
+
+        // Material first (shared texture cache lines), then front to back.
+        // Lists which don't read materials don't care about the order.
+        if(sortView)
+            SortDrawEntries(_visibleEntries, *sortView, SORT_KEY_PASS_GEOMETRY);
+
+        AppendDrawCommands(list, _visibleEntries.cbegin(), _visibleEntries.cend(), 0, meshletView);
 
-        return _environmentTexturesGraphicsData.insert(std::move(gd));
+        return list.commandCount;
     }
 
-    GenKey<Mesh> PbrRenderer::AddMesh(Mesh& mesh)
+    int PbrRenderer::BuildShadowCasterLists(ShadowCasterLists& lists, const Frustum* frustum, int planeCount, int meshletView)
     {
-        auto key = _meshes.insert(mesh);
+        QueryDrawEntries(frustum, planeCount);
 
-        _meshes.at(key)._graphicsData = CreateGraphicsData(mesh);
+        auto dynamicBegin = std::partition(_visibleEntries.begin(), _visibleEntries.end(), [this](int d){ return !_drawList[d].dynamic; });
 
-        return key;
+        AppendDrawCommands(lists.staticCasters , _visibleEntries.cbegin(), dynamicBegin, _lodSettings.shadowBias, meshletView);
+        AppendDrawCommands(lists.dynamicCasters, dynamicBegin, _visibleEntries.cend(), _lodSettings.shadowBias, meshletView);
+
+        return static_cast<int>(_visibleEntries.size());
     }
 
-    GenKey<ImageTexture> PbrRenderer::AddImageTexture(ImageTexture& texture)
+    int PbrRenderer::BuildCubeShadowCasterLists(ShadowCasterLists& lists, const vec3& position, const vec2& range)
     {
-        auto key = _textures.insert(texture);
+        // Light range first...
+        _visibleEntries.clear();
+        _bvh.QuerySphere(position, range.y, _visibleEntries);
 
-        _textures.at(key)._graphicsData = CreateGraphicsData(texture);
+        _cubeCasterBoxes.Clear();
+        _cubeCasterBoxes.Reserve(_visibleEntries.size());
+        for(int d : _visibleEntries)
+        {
+            const auto& aabb = _meshRenderers.at(_drawList[d].renderer)._aabb;
+            _cubeCasterBoxes.PushBack(aabb.Min, aabb.Max);
+        }
 
-        return key;
-    }
+        // ...then each face. As for directional shadows
+        // the near plane is left out.
+        mat4 faceMatrices[6];
+        CubeShadowMatrices(position, range, faceMatrices);
 
-    GenKey<EnvironmentLight> PbrRenderer::AddEnvironmentTexture(const char* path)
-    {
-        EnvironmentLight envLight{path};
-        auto key = _environmentTextures.insert(envLight);
+        _cubeFaceMasks.resize(_drawList.size());
+        for(int d : _visibleEntries) _cubeFaceMasks[d] = 0;
 
-        _environmentTextures.at(key)._graphicsData = CreateGraphicsData(envLight);
+        for(int f=0;f<6;f++)
+        {
+            FrustumCull(Frustum{faceMatrices[f]}, _cubeCasterBoxes, _cubeFaceVisible, Frustum::PLANE_COUNT-1);
 
-        return key;
-    }
+            for(int i=0;i<_visibleEntries.size();i++)
+                _cubeFaceMasks[_visibleEntries[i]] |= _cubeFaceVisible[i] << f;
+        }
 
-    GenKey<PbrMaterial> PbrRenderer::AddMaterial(const PbrMaterial& material)
-    {
-        if(!PbrMaterial::CheckKey(material._diffuseTex, _textures))     throw std::runtime_error("Invalid texture key for `Diffuse` texture.");
-        if(!PbrMaterial::CheckKey(material._metalnessMap, _textures))   throw std::runtime_error("Invalid texture key for `Metalness` texture.");
-        if(!PbrMaterial::CheckKey(material._normalMap, _textures))      throw std::runtime_error("Invalid texture key for `Normal` texture.");
-        if(!PbrMaterial::CheckKey(material._roughnessMap, _textures))   throw std::runtime_error("Invalid texture key for `Roughness` texture.");
+        std::erase_if(_visibleEntries, [this](int d){ return _cubeFaceMasks[d]==0; });
 
-        auto key = _materials.insert(material);
+        auto dynamicBegin = std::partition(_visibleEntries.begin(), _visibleEntries.end(), [this](int d){ return !_drawList[d].dynamic; });
 
-        return key;
-    }
+        // Meshlets: back facing from the light (any face), the
+        // casters are already within range.
+        const int meshletView = AddMeshletView(nullptr, 0, vec4{position, 1.0f});
 
-    void PbrRenderer::SetCurrentEnvironment(const GenKey<tao_pbr::EnvironmentLight> &environment)
-    {
-        if(!_environmentTextures.keyValid(environment))
-            throw std::runtime_error("The given key is not valid.");
+        AppendCubeDrawCommands(lists.staticCasters , _visibleEntries.cbegin(), dynamicBegin, _lodSettings.shadowBias, meshletView);
+        AppendCubeDrawCommands(lists.dynamicCasters, dynamicBegin, _visibleEntries.cend(), _lodSettings.shadowBias, meshletView);
 
-        _currentEnvironment = environment;
+        return static_cast<int>(_visibleEntries.size());
     }
 
-    void PbrRenderer::WriteTransfromToShaderBuffer(const MeshRenderer& mesh, int offset)
+    void PbrRenderer::AppendCubeDrawCommands(DrawCommandList& list, std::vector<int>::const_iterator first, std::vector<int>::const_iterator last, int lodBias, int meshletView)
     {
-        WriteTransfromToShaderBuffer(std::vector<MeshRenderer>{mesh}, offset);
+        GroupDrawCommands(list, first, last, lodBias, meshletView);
+
+        const bool layered = _renderContext->VertexShaderLayerSupported();
+
+        // The draw id points to the cube instances, which
+        // point to the draw data (see PointShadowMap.vert).
+        // 32 bit indices first, then 16 bit, then meshlet culled
+        // (all the faces draw the same culled indices).
+        size_t job = _frameMeshletJobs.size() - list.culledCommandCount;
+
+        for(command_group group : {command_group::wide, command_group::short_indices, command_group::culled})
+            for(auto d = first; d!=last; ++d)
+            {
+                if(_commandGroups[d-first] != group) continue;
+
+                const unsigned int faces = _cubeFaceMasks[*d];
+
+                auto command = LodCommand(*d, lodBias);
+                command.base_instance = static_cast<GLuint>(_frameCubeInstances.size());
+                if(group==command_group::culled)
+                {
+                    command.first_index = _frameMeshletJobs[job++].outputOffset;
+                    command.count       = 0;
+                }
+
+                if(layered)
+                {
+                    command.instance_count = std::popcount(faces);
+                    for(int f=0;f<6;f++)
+                        if(faces & (1u<<f)) _frameCubeInstances.push_back({.drawIndex = *d, .faces = f});
+                }
+                else
+                {
+                    _frameCubeInstances.push_back({.drawIndex = *d, .faces = static_cast<int>(faces)});
+                }
+
+                PerfCounters.CubeShadowFaces += std::popcount(faces);
+
+                _frameCommands.push_back(command);
+            }
     }
 
-    void PbrRenderer::WriteTransfromToShaderBuffer(const std::vector<MeshRenderer>& meshes, int offset)
+    void PbrRenderer::SelectLods(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
     {
-        const int trDataBlkSize = sizeof(transform_gl_data_block);
+        // Pixels per world unit at distance 1 (perspective), an error e
+        // at distance z covers e * pixelsPerUnit / z pixels on screen.
+        const vec3  cameraPosition = vec3{inverse(viewMatrix)[3]};
+        const float pixelsPerUnit  = projectionMatrix[1][1] * 0.5f * static_cast<float>(_windowHeight);
+        const float maxError       = _lodSettings.pixelError / pixelsPerUnit;
 
-        std::vector<transform_gl_data_block> dataTra(meshes.size());
+        _frameLods.resize(_drawList.size());
 
-        for (int i = 0; i < meshes.size(); i++)
+        for(int d=0; d<_drawList.size(); d++)
         {
-            glm::mat4 model = meshes[i]._transformation.matrix();
-            glm::mat3 normal = glm::transpose(glm::inverse(model));
+            const DrawListEntry& e = _drawList[d];
 
-            dataTra[i] = (transform_gl_data_block
-                    {
-                            .modelMatrix = model,
-                            .normalMatrix = normal
-                    });
-
-        }
+            // Nearest point of the bounding sphere, inside it counts as close
+            const float distance = glm::max(length(e.center - cameraPosition) - e.radius, std::numeric_limits<float>::min());
 
-        BufferDataPacker pack{};
-        pack.AddDataArray(dataTra);
+            int lod = 0;
+            while(lod+1 < e.lodCount && e.lods[lod+1].error * e.lodScale <= maxError * distance) lod++;
 
-        // Since we need to glBindBufferRange we should take
-        // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT into account.
-        auto data = pack.InterleavedBuffer(_renderContext->UniformBufferOffsetAlignment());
-        _shaderBuffers.transformUbo.OglBuffer().SetSubData(offset, meshes.size()*_transformDataBlockAlignment, data.data());
+            _frameLods[d] = lod;
+        }
     }
 
-    void PbrRenderer::WriteMaterialToShaderBuffer(const MeshRenderer& mesh, int offset)
+    draw_elements_indirect_command PbrRenderer::LodCommand(int entry, int lodBias) const
     {
-        WriteMaterialToShaderBuffer((std::vector<MeshRenderer>{mesh}), offset);
+        const DrawListEntry& e   = _drawList[entry];
+        const MeshLod&       lod = e.lods[glm::min(_frameLods[entry] + lodBias, e.lodCount - 1)];
+
+        auto command = e.command;
+        command.first_index = lod.firstIndex;
+        command.count       = static_cast<GLuint>(lod.indicesCount);
+
+        return command;
     }
 
-    void PbrRenderer::WriteMaterialToShaderBuffer(const std::vector<MeshRenderer>& meshes, int offset)
+    void PbrRenderer::CullDrawList(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
     {
-        const int matDataBlockSize = sizeof(material_gl_data_block);
+        _frameCommands.clear();
+        _frameCubeInstances.clear();
+        _frameMeshletViews.clear();
+        _frameMeshletJobs.clear();
+        _frameMeshletIndices = 0;
+
+        const int drawCount = static_cast<int>(_drawList.size());
+
+        // Lods for this frame, shadows go from the camera's ones
+        SelectLods(viewMatrix, projectionMatrix);
+
+        // Camera
+        const Frustum cameraFrustum{projectionMatrix*viewMatrix};
+        const int cameraMeshletView = AddMeshletView(&cameraFrustum, Frustum::PLANE_COUNT, vec4{vec3{inverse(viewMatrix)[3]}, 1.0f});
+        const int visible = BuildDrawCommandList(_cameraDrawList, &cameraFrustum, Frustum::PLANE_COUNT, &viewMatrix, cameraMeshletView);
+        PerfCounters.VisibleMeshRenderers = visible;
+        PerfCounters.CulledMeshRenderers  = drawCount - visible;
+
+        // Before the meshlet culling (the culled commands start empty)
+        PerfCounters.CameraTriangles = _frameMeshletIndices / 3;
+        for(int c=0; c<_cameraDrawList.commandCount; c++)
+            PerfCounters.CameraTriangles += _frameCommands[_cameraDrawList.firstCommand + c].count / 3;
+
+        // Directional shadows. The near plane is left out:
+        // casters between the light and the frustum still
+        // cast their shadow on what's inside.
+        // Cached (clean) shadow maps don't need their casters.
+        PerfCounters.CulledShadowCasters = 0;
+        for(int i=0;i<static_cast<int>(_directionalShadowMaps.size());i++)
+        {
+            if(!_directionalLights.indexValid(i)) continue;
+
+            for(int c=0;c<_shadowCascadeSettings.cascadeCount;c++)
+            {
+                const auto& cascade = _directionalShadowMaps[i].cascades[c];
+                if(cascade.tile.res==0 || !(cascade.dirty || cascade.dynamicDirty)) continue;
+
+                // Orthographic: the meshlets face away from the light direction
+                const Frustum shadowFrustum{cascade.shadowMatrix};
+                const vec3    lightDirection = normalize(vec3{inverse(cascade.shadowMatrix)*vec4{0.0f, 0.0f, 1.0f, 0.0f}});
+                const int     meshletView    = AddMeshletView(&shadowFrustum, Frustum::PLANE_COUNT-1, vec4{lightDirection, 0.0f});
 
-        std::vector<material_gl_data_block> dataMat(meshes.size());
+                PerfCounters.CulledShadowCasters += drawCount - BuildShadowCasterLists(_dirShadowCasters[i*MAX_DIR_SHADOW_CASCADES+c], &shadowFrustum, Frustum::PLANE_COUNT-1, meshletView);
+            }
+        }
 
-        for (int i = 0; i < meshes.size(); i++)
+        // Cube shadows, against the light range and then each face.
+        PerfCounters.CubeShadowFaces = 0;
+        for(int i=0;i<static_cast<int>(_sphereShadowMaps.size());i++)
         {
+            const auto& shadowMap = _sphereShadowMaps[i];
+            if(!_sphereLights.indexValid(i) || shadowMap.tile.res==0 || !(shadowMap.dirty || shadowMap.dynamicDirty)) continue;
 
-            const PbrMaterial &mat = _materials.at(meshes[i]._material);
+            const auto& l = _sphereLights.at_index(i);
+            PerfCounters.CulledShadowCasters += drawCount - BuildCubeShadowCasterLists(_sphereShadowCasters[i],
+                                                                                      vec3{l.transformation.matrix()[3]},
+                                                                                      CubeShadowRange(l.intensity, CubeShadowRadius(l)));
+        }
 
-            dataMat[i] = material_gl_data_block
-                    {
-                            .diffuse = glm::vec4(mat._diffuse, 1.0f),
-                            .emission = glm::vec4(mat._emission, 1.0f),
-                            .roughness = mat._roughness,
-                            .metalness = mat._metalness,
+        for(int i=0;i<static_cast<int>(_rectShadowMaps.size());i++)
+        {
+            const auto& shadowMap = _rectShadowMaps[i];
+            if(!_rectLights.indexValid(i) || shadowMap.tile.res==0 || !(shadowMap.dirty || shadowMap.dynamicDirty)) continue;
+
+            const auto& l = _rectLights.at_index(i);
+            PerfCounters.CulledShadowCasters += drawCount - BuildCubeShadowCasterLists(_rectShadowCasters[i],
+                                                                                      vec3{l.transformation.matrix()[3]},
+                                                                                      CubeShadowRange(l.intensity, CubeShadowRadius(l)));
+        }
 
-                            .has_diffuse_tex    = mat._diffuseTex.has_value(),
-                            .has_emission_tex   = mat._emissionTex.has_value(),
-                            .has_normal_tex     = mat._normalMap.has_value(),
-                            .has_roughness_tex  = mat._roughnessMap.has_value(),
-                            .has_merged_rough_metal = mat._mergedMetalRough,
-                            .has_metalness_tex  = mat._metalnessMap.has_value(),
-                            .has_occlusion_tex  = mat._occlusionMap.has_value()
-                    };
+        if(!_frameCommands.empty())
+        {
+            _drawCommands.Resize(_frameCommands.size()*sizeof(draw_elements_indirect_command));
+            _drawCommands.OglBuffer().SetSubData(0, _frameCommands.size()*sizeof(draw_elements_indirect_command), _frameCommands.data());
         }
 
-        BufferDataPacker pack{};
-        pack.AddDataArray(dataMat);
+        if(!_frameCubeInstances.empty())
+        {
+            _shaderBuffers.cubeInstanceSsbo.Resize(_frameCubeInstances.size()*sizeof(cube_instance_gl_data_block));
+            _shaderBuffers.cubeInstanceSsbo.OglBuffer().SetSubData(0, _frameCubeInstances.size()*sizeof(cube_instance_gl_data_block), _frameCubeInstances.data());
+            ReserveDrawIds(_frameCubeInstances.size());
+        }
 
-        // Since we need to glBindBufferRange we should take
-        // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT into account.
-        auto data = pack.InterleavedBuffer(_renderContext->UniformBufferOffsetAlignment());
-        _shaderBuffers.materialUbo.OglBuffer().SetSubData(offset, meshes.size() * _materialDataBlockAlignment, data.data());
+        PerfCounters.MeshletJobs = static_cast<int>(_frameMeshletJobs.size());
+        CullMeshlets();
     }
 
-    GenKey<MeshRenderer> PbrRenderer::AddMeshRenderer(const Transformation& transform, const GenKey<Mesh>& mesh, const GenKey<PbrMaterial> &material)
+    void PbrRenderer::CullMeshlets()
     {
-        if(!_meshes.keyValid(mesh))        throw std::runtime_error("Invalid `mesh` key.");
-        if(!_materials.keyValid(material)) throw std::runtime_error("Invalid `material` key.");
-
-        MeshRenderer mr(this, mesh, material, transform);
-        mr._aabb = tao_math::BoundingBox<float, 3>::ComputeBbox(
-                _meshes.at(mesh)._positions,
-                mr._transformation.matrix());
+        // One thread for each meshlet of each job, the survivors append
+        // their indices to the culled indices of their command (its count
+        // is the append counter, see MeshletCulling.comp).
+        if(_frameMeshletJobs.empty()) return;
 
-        auto key = _meshRenderers.insert(mr);
+        if(_meshletsDirty)
+        {
+            _shaderBuffers.meshletSsbo.Resize(_meshlets.size()*sizeof(meshlet_gl_data_block));
+            _shaderBuffers.meshletSsbo.OglBuffer().SetSubData(0, _meshlets.size()*sizeof(meshlet_gl_data_block), _meshlets.data());
+            _meshletsDirty = false;
+        }
 
-        // Write transform and material to their buffers.
-        // Resize and copy back old data if necessary.
-        // ----------------------------------------------
-        int rdrCount = _meshRenderers.vector().size();
+        _shaderBuffers.meshletJobSsbo.Resize(_frameMeshletJobs.size()*sizeof(meshlet_job_gl_data_block));
+        _shaderBuffers.meshletJobSsbo.OglBuffer().SetSubData(0, _frameMeshletJobs.size()*sizeof(meshlet_job_gl_data_block), _frameMeshletJobs.data());
+        _shaderBuffers.meshletViewSsbo.Resize(_frameMeshletViews.size()*sizeof(meshlet_view_gl_data_block));
+        _shaderBuffers.meshletViewSsbo.OglBuffer().SetSubData(0, _frameMeshletViews.size()*sizeof(meshlet_view_gl_data_block), _frameMeshletViews.data());
+        _meshArena.culledEbo.Resize(_frameMeshletIndices*sizeof(GLuint));
 
-        // Transformations
-        if( _shaderBuffers.transformUbo.Resize(rdrCount*_transformDataBlockAlignment))
-            WriteTransfromToShaderBuffer(_meshRenderers.vector(), 0);                                    // resized, need to re-write everything
-        else
-            WriteTransfromToShaderBuffer(_meshRenderers.at(key), key.Index*_transformDataBlockAlignment); // possibly overwrite existing old data
+#ifdef ENABLE_GPU_PROFILING
+        auto swc = _gpuStopwatch.Start("MeshletCulling");
+#endif
 
-        // Materials
-        if( _shaderBuffers.materialUbo.Resize(rdrCount*_materialDataBlockAlignment))
-            WriteMaterialToShaderBuffer(_meshRenderers.vector(), 0);                                    // resized, need to re-write everything
-        else
-            WriteMaterialToShaderBuffer(_meshRenderers.at(key), key.Index*_materialDataBlockAlignment);  // possibly overwrite existing old data
+        _shaderBuffers.transformSsbo.OglBuffer()  .Bind(GPASS_SSBO_BINDING_TRANSFORM);
+        _shaderBuffers.meshletSsbo.OglBuffer()    .Bind(MESHLET_SSBO_BINDING_MESHLETS);
+        _shaderBuffers.meshletJobSsbo.OglBuffer() .Bind(MESHLET_SSBO_BINDING_JOBS);
+        _shaderBuffers.meshletViewSsbo.OglBuffer().Bind(MESHLET_SSBO_BINDING_VIEWS);
+        _meshArena.ebo                            .BindStorage(MESHLET_SSBO_BINDING_INDICES);
+        _meshArena.culledEbo.OglBuffer()          .BindStorage(MESHLET_SSBO_BINDING_OUT_INDICES);
+        _drawCommands.OglBuffer()                 .BindStorage(MESHLET_SSBO_BINDING_COMMANDS);
+
+        const auto& lastJob     = _frameMeshletJobs.back();
+        const GLuint threads    = lastJob.firstThread + lastJob.meshletCount;
+        const GLuint groups     = (threads + MESHLET_CULLING_GROUP_SIZE - 1) / MESHLET_CULLING_GROUP_SIZE;
+        const GLuint groupsX    = glm::min(groups, MAX_COMPUTE_GROUPS_X);
+        const GLuint groupsY    = (groups + groupsX - 1) / groupsX;
+
+        _computeShaders.cullMeshlets.UseProgram();
+        _computeShaders.cullMeshlets.SetUniform(MESHLET_CULLING_NAME_THREADS, threads);
+        _renderContext->DispatchCompute(groupsX, groupsY, 1);
+        _renderContext->MemoryBarrier(static_cast<ogl_barrier_bit>(command_barrier_bit | element_array_barrier_bit));
 
-        return key;
+#ifdef ENABLE_GPU_PROFILING
+        PerfCounters.MeshletCullingTime = _gpuStopwatch.Stop<tao_instrument::Stopwatch::MILLISECONDS>(swc);
+#endif
     }
 
-    // TODO: this "CPU-GPU synced buffer" should become an entity on its own
-    template<typename T, typename G>
-    GenKey<T> AddToCollectionSyncGpu(GenKeyVector<T>& genKeyedCollection, ResizableSsbo& gpuBuffer, const T& elemToAdd, std::function<G(const T&)> converter)
+    void PbrRenderer::DrawMeshRenderers(const DrawCommandList& list, bool bindMaterials)
     {
-        auto key = genKeyedCollection.insert(elemToAdd);
+        if(list.commandCount==0) return;
 
-        int totalElementsCnt = genKeyedCollection.vector().size();
-        // this works with SSBOs and std430(I hope...), for UBOs
-        // we should query  the gpu  offset alignment.
-        int gpuRequiredCapacity = totalElementsCnt * sizeof(G) /* which should exactly match gpu-side size...*/;
+        _meshArena.vao.Bind();
 
-        if(gpuBuffer.Resize(gpuRequiredCapacity))
-        {
-            // There wasn't enough space, gpu buffer resized.
-            // Need to copy all the elements from the start.
-            vector<G> gpuData(totalElementsCnt);
-            for(int i=0;i<gpuData.size(); i++) gpuData[i] = converter(genKeyedCollection.vector()[i]);
-            gpuBuffer.OglBuffer().SetSubData(0, gpuData.size()*sizeof(G), gpuData.data());
-        }
-        else
+        _shaderBuffers.transformSsbo.OglBuffer().Bind(GPASS_SSBO_BINDING_TRANSFORM);
+        _shaderBuffers.drawDataSsbo .OglBuffer().Bind(GPASS_SSBO_BINDING_DRAW_DATA);
+        if(bindMaterials)
         {
-            // There was enough space to insert a new element
-            // in the gpu buffer.
-            G elem = converter(elemToAdd);
-            gpuBuffer.OglBuffer().SetSubData((totalElementsCnt-1)*sizeof(G), sizeof(G), &elem);
+            _shaderBuffers.materialSsbo.OglBuffer().Bind(GPASS_SSBO_BINDING_MATERIAL);
+            _shaderBuffers.textureResidencySsbo.OglBuffer().Bind(GPASS_SSBO_BINDING_TEXTURE_RESIDENCY);
+            BindMaterialTextures();
         }
 
-        return key;
-    }
-    // TODO: this "CPU-GPU synced buffer" should become an entity on its own
-    template<typename T, typename G>
-    void WriteToCollectionSyncGpu(GenKeyVector<T>& genKeyedCollection, GenKey<T>& where, ResizableSsbo& gpuBuffer, const T& newVal, std::function<G(const T&)> converter)
-    {
-        if(where.Index>=genKeyedCollection.vector().size())
-            throw runtime_error("Invalid index");
+        _drawCommands.OglBuffer().Bind();
+
+        // Whole pass at once (one draw for each index type): materials
+        // are fetched from the table, no texture binds between draws.
+        const int wideCommandCount = list.commandCount - list.shortCommandCount - list.culledCommandCount;
 
-        genKeyedCollection.at(where) = newVal;
+        if(wideCommandCount>0)
+            _renderContext->MultiDrawElementsIndirect(
+                    pmt_type_triangles, idx_typ_unsigned_int,
+                    reinterpret_cast<const void*>(list.firstCommand*sizeof(draw_elements_indirect_command)),
+                    wideCommandCount);
 
-        G elem = converter(newVal);
-        gpuBuffer.OglBuffer().SetSubData((where.Index)*sizeof(G), sizeof(G), &elem);
+        if(list.shortCommandCount>0)
+            _renderContext->MultiDrawElementsIndirect(
+                    pmt_type_triangles, idx_typ_unsigned_short,
+                    reinterpret_cast<const void*>((list.firstCommand+wideCommandCount)*sizeof(draw_elements_indirect_command)),
+                    list.shortCommandCount);
+
+        // Same vertices, the culled indices
+        if(list.culledCommandCount>0)
+        {
+            _meshArena.culledVao.Bind();
+            _renderContext->MultiDrawElementsIndirect(
+                    pmt_type_triangles, idx_typ_unsigned_int,
+                    reinterpret_cast<const void*>((list.firstCommand+wideCommandCount+list.shortCommandCount)*sizeof(draw_elements_indirect_command)),
+                    list.culledCommandCount);
+        }
+
+        OglDrawIndirectBuffer::UnBind();
+        OglVertexAttribArray::UnBind();
     }
 
     void PbrRenderer::UpdateDirectionalLight(GenKey<DirectionalLight> key, const DirectionalLight& value)
     {
-        std::function<directional_light_gl_data_block(const DirectionalLight&)> converter =
-                static_cast<directional_light_gl_data_block(*)(const DirectionalLight&)>(ToGraphicsData);
+        _directionalLights.at(key) = value;
+        _shaderBuffers.directionalLightsSsbo.Set(key.Index, value);
 
-        WriteToCollectionSyncGpu(_directionalLights, key, _shaderBuffers.directionalLightsSsbo, value, converter);
+        if(key.Index<_directionalShadowMaps.size())
+            for(auto& c : _directionalShadowMaps[key.Index].cascades) c.dirty = true;
     }
 
     GenKey<DirectionalLight> PbrRenderer::AddLight(const DirectionalLight &directionalLight)
     {
-        std::function<directional_light_gl_data_block(const DirectionalLight&)> converter =
-                static_cast<directional_light_gl_data_block(*)(const DirectionalLight&)>(ToGraphicsData);
+        auto key = _directionalLights.insert(directionalLight);
+        _shaderBuffers.directionalLightsSsbo.Set(key.Index, directionalLight);
 
-        return AddToCollectionSyncGpu(_directionalLights, _shaderBuffers.directionalLightsSsbo, directionalLight, converter);
+        if(key.Index<_directionalShadowMaps.size())
+            for(auto& c : _directionalShadowMaps[key.Index].cascades) c.dirty = true;
+
+        return key;
     }
 
     void PbrRenderer::UpdateSphereLight(GenKey<SphereLight> key, const SphereLight& value)
     {
-        std::function<sphere_light_gl_data_block(const SphereLight&)> converter =
-                static_cast<sphere_light_gl_data_block(*)(const SphereLight&)>(ToGraphicsData);
+        _sphereLights.at(key) = value;
+        _shaderBuffers.sphereLightsSsbo.Set(key.Index, value);
 
-        WriteToCollectionSyncGpu(_sphereLights, key, _shaderBuffers.sphereLightsSsbo, value, converter);
+        if(key.Index<_sphereShadowMaps.size()) _sphereShadowMaps[key.Index].dirty = true;
     }
 
     GenKey<SphereLight> PbrRenderer::AddLight(const SphereLight &sphereLight)
     {
-        std::function<sphere_light_gl_data_block(const SphereLight&)> converter =
-                static_cast<sphere_light_gl_data_block(*)(const SphereLight&)>(ToGraphicsData);
+        auto key = _sphereLights.insert(sphereLight);
+        _shaderBuffers.sphereLightsSsbo.Set(key.Index, sphereLight);
 
-        return AddToCollectionSyncGpu(_sphereLights, _shaderBuffers.sphereLightsSsbo, sphereLight, converter);
+        if(key.Index<_sphereShadowMaps.size()) _sphereShadowMaps[key.Index].dirty = true;
+
+        return key;
     }
 
     void PbrRenderer::UpdateRectLight(GenKey<RectLight> key, const RectLight& value)
     {
-        std::function<rect_light_gl_data_block(const RectLight&)> converter =
-                static_cast<rect_light_gl_data_block(*)(const RectLight&)>(ToGraphicsData);
+        _rectLights.at(key) = value;
+        _shaderBuffers.rectLightsSsbo.Set(key.Index, value);
 
-        WriteToCollectionSyncGpu(_rectLights, key, _shaderBuffers.rectLightsSsbo, value, converter);
+        if(key.Index<_rectShadowMaps.size()) _rectShadowMaps[key.Index].dirty = true;
     }
 
     GenKey<RectLight> PbrRenderer::AddLight(const RectLight &rectLigth)
     {
-        std::function<rect_light_gl_data_block(const RectLight&)> converter =
-                static_cast<rect_light_gl_data_block(*)(const RectLight&)>(ToGraphicsData);
+        auto key = _rectLights.insert(rectLigth);
+        _shaderBuffers.rectLightsSsbo.Set(key.Index, rectLigth);
 
-        return AddToCollectionSyncGpu(_rectLights, _shaderBuffers.rectLightsSsbo, rectLigth, converter);
+        if(key.Index<_rectShadowMaps.size()) _rectShadowMaps[key.Index].dirty = true;
+
+        return key;
     }
 
     void PbrRenderer::ReloadShaders()
     {
         InitShaders();
+        InvalidateShadowMaps();
     }
 
     void PbrRenderer::Resize(int newWidth, int newHeight)
@@ -645,53 +2590,114 @@ namespace tao_pbr
         ResizeOutputBuffer(newWidth, newHeight);
     }
 
-    OglTexture2D& PbrRenderer::GetGlTexture(const GenKey<ImageTexture>& tex)
+    glm::uvec2 PbrRenderer::GetMaterialTextureRef(const std::optional<GenKey<ImageTexture>>& tex)
     {
-        return _texturesGraphicsData.at(_textures.at(tex)._graphicsData.value())._glTexture;
+        if(!tex) return glm::uvec2{0};
+
+        const auto& gd = _texturesGraphicsData.at(_textures.at(tex.value())._graphicsData.value());
+
+        return _renderContext->BindlessTexturesSupported()
+            ? glm::uvec2{static_cast<unsigned int>(gd._handle & 0xFFFFFFFF), static_cast<unsigned int>(gd._handle >> 32)}
+            : glm::uvec2{static_cast<unsigned int>(gd._array), static_cast<unsigned int>(gd._layer)};
     }
-    void PbrRenderer::BindMaterialTextures(const GenKey<PbrMaterial>& mat)
+
+    unsigned int PbrRenderer::GetMaterialTextureId(const std::optional<GenKey<ImageTexture>>& tex) const
     {
-        if(auto tex = _materials.at(mat)._diffuseTex) // --- Diffuse
-        {
-            GetGlTexture(tex.value()).BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + GPASS_TEX_BINDING_DIFFUSE));
-            _linearSamplerRepeat.BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + GPASS_TEX_BINDING_DIFFUSE));
-        }
-        if(auto tex = _materials.at(mat)._normalMap) // --- Normal
-        {
-            GetGlTexture(tex.value()).BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + GPASS_TEX_BINDING_NORMALS));
-            _linearSamplerRepeat.BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + GPASS_TEX_BINDING_NORMALS));
-        }
-        if(auto tex = _materials.at(mat)._roughnessMap) // --- Roughness
+        if(!tex) return 0;
+
+        // Residency and feedback are indexed by the graphics data slot
+        return static_cast<unsigned int>(_textures.at(tex.value())._graphicsData.value().Index);
+    }
+
+    int PbrRenderer::AddToTextureArray(ImageTextureGraphicsData& gd, ogl_texture_internal_format internalFormat, int width, int height, int levels)
+    {
+        int  skip = 0;
+        auto arr  = std::find_if(_textureArrays.begin(), _textureArrays.end(), [&](const TextureArray& a)
         {
-            GetGlTexture(tex.value()).BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + GPASS_TEX_BINDING_ROUGHNESS));
-            _linearSamplerRepeat.BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + GPASS_TEX_BINDING_ROUGHNESS));
-        }
-        if(auto tex = _materials.at(mat)._metalnessMap) // --- Metalness
+            return a.width==width && a.height==height && a.format==internalFormat;
+        });
+
+        // No room for another array: the largest one of the same
+        // format whose size is one of the image's mip levels.
+        while(arr==_textureArrays.end() && _textureArrays.size()==GPASS_MAX_TEXTURE_ARRAYS)
         {
-            GetGlTexture(tex.value()).BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + GPASS_TEX_BINDING_METALNESS));
-            _linearSamplerRepeat.BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + GPASS_TEX_BINDING_METALNESS));
+            if(++skip>=levels) return -1;
+
+            arr = std::find_if(_textureArrays.begin(), _textureArrays.end(), [&](const TextureArray& a)
+            {
+                return a.width==glm::max(1, width>>skip) && a.height==glm::max(1, height>>skip) && a.format==internalFormat;
+            });
         }
-        if(auto tex = _materials.at(mat)._emissionTex) // --- Emission
+
+        width  = glm::max(1, width  >> skip);
+        height = glm::max(1, height >> skip);
+        levels = levels - skip;
+
+        if(arr==_textureArrays.end())
         {
-            GetGlTexture(tex.value()).BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + GPASS_TEX_BINDING_EMISSION));
-            _linearSamplerRepeat.BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + GPASS_TEX_BINDING_EMISSION));
+            _textureArrays.push_back(TextureArray
+            {
+                .texture        = _renderContext->CreateTexture2DArray(),
+                .format         = internalFormat,
+                .width          = width,
+                .height         = height,
+            });
+            arr = _textureArrays.end()-1;
         }
-        if(auto tex = _materials.at(mat)._occlusionMap) // --- Occlusion
+
+        // Full: storage is immutable, move the
+        // layers to a bigger array and swap.
+        if(arr->layerCount==arr->layerCapacity)
         {
-            GetGlTexture(tex.value()).BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + GPASS_TEX_BINDING_OCCLUSION));
-            _linearSamplerRepeat.BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + GPASS_TEX_BINDING_OCCLUSION));
+            const int capacity = glm::max(TEXTURE_ARRAY_MIN_LAYERS, arr->layerCapacity*2);
+
+            auto grown = _renderContext->CreateTexture2DArray();
+            grown.TexStorage(levels, internalFormat, width, height, capacity);
+            if(arr->layerCount>0)
+                for(int l=0; l<levels; l++)
+                    grown.CopySubData(arr->texture, l, 0, 0, glm::max(1, width>>l), glm::max(1, height>>l), arr->layerCount);
+
+            arr->texture       = std::move(grown);
+            arr->layerCapacity = capacity;
         }
+
+        // The layer's contents are uploaded by the caller
+        gd._array = static_cast<int>(arr - _textureArrays.begin());
+        gd._layer = arr->layerCount++;
+
+        return skip;
     }
 
-    string GetUniformArrayName(const char* name, int index)
+    void PbrRenderer::BindMaterialTextures()
     {
-        return std::format("{}[{}]", name, to_string(index));
+        // Bindless: resident handles, nothing to bind
+        if(_renderContext->BindlessTexturesSupported()) return;
+
+        for(int i=0;i<_textureArrays.size();i++)
+        {
+            const auto unit = static_cast<ogl_texture_unit>(tex_unit_0 + GPASS_TEX_BINDING_ARRAYS + i);
+            _textureArrays[i].texture.BindToTextureUnit(unit);
+            _linearMipLinearSamplerRepeat.BindToTextureUnit(unit);
+        }
     }
 
     PbrRenderer::pbrRendererOut PbrRenderer::Render(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, float near, float far)
     {
         _renderContext->MakeCurrent();
 
+        // Waits if the GPU is still reading this partition
+        ReserveFrameRing();
+        _frameRing.BeginFrame();
+        _frameCount++;
+
+        // Before the flush: materials of the textures coming in
+        // and the residency of the levels streamed in and out.
+        UpdateTextureResidency();
+        StreamTextures();
+        FlushShaderBuffers();
+
+        const bool textureFeedback = BeginTextureFeedback();
+
         // loading per-frame data
         frame_gl_data_block frameGlDataBlock
         {
@@ -702,30 +2708,49 @@ namespace tao_pbr
                 .gamma              = 2.2,
                 .radianceMinLod = PRE_CUBE_MIN_LOD,
                 .radianceMaxLod = PRE_CUBE_MAX_LOD,
-                .doTaa          = 0
+                .doTaa          = 0,
+                .textureFeedback = textureFeedback,
+                .feedbackTexel  = ivec2(_frameCount % TEXTURE_FEEDBACK_TILE, _frameCount / TEXTURE_FEEDBACK_TILE % TEXTURE_FEEDBACK_TILE)
         };
-        _frameDataUbo.SetSubData(0, sizeof(frame_gl_data_block), &frameGlDataBlock);
-        _frameDataUbo.Bind(UBO_BINDING_FRAME_DATA);
+        _frameRing.BindUniformRange(UBO_BINDING_FRAME_DATA, _frameRing.Write(&frameGlDataBlock, sizeof(frame_gl_data_block)));
+
+        if(_drawListDirty) UpdateDrawList();
+
+        // Atlas regions first, the cascades are snapped to their resolution
+        AllocateShadowAtlas(viewMatrix, projectionMatrix);
+
+        for(int i=0;i<static_cast<int>(_directionalShadowMaps.size());i++)
+        {
+            if(_directionalLights.indexValid(i))
+                UpdateShadowMatrices(_directionalShadowMaps[i], _directionalLights.at_index(i), viewMatrix, projectionMatrix, near, far);
+        }
 
+        /// Culling
+        ////////////////////////////////////////////
+        CullDrawList(viewMatrix, projectionMatrix);
 
         /// Shadow Pass
         ////////////////////////////////////////////
-        for(int i=0;i<MAX_DIR_SHADOW_COUNT;i++)
+        // Clean shadow maps and lights without a region are skipped (see CreateShadowMap)
+        PerfCounters.ShadowMapUpdates = 0;
+        for(int i=0;i<static_cast<int>(_directionalShadowMaps.size());i++)
         {
-            if(_directionalLights.indexValid(i))
-            CreateShadowMap(_directionalShadowMaps[i], _directionalLights.vector()[i], DIR_SHADOW_RES, DIR_SHADOW_RES);
+            if(!_directionalLights.indexValid(i)) continue;
+
+            for(int c=0;c<_shadowCascadeSettings.cascadeCount;c++)
+                CreateShadowMap(_directionalShadowMaps[i], c, _dirShadowCasters[i*MAX_DIR_SHADOW_CASCADES+c]);
         }
 
-        for(int i=0;i<MAX_SPHERE_SHADOW_COUNT;i++)
+        for(int i=0;i<static_cast<int>(_sphereShadowMaps.size());i++)
         {
             if(_sphereLights.indexValid(i))
-            CreateShadowMap(_sphereShadowMaps[i],_sphereLights.vector()[i], POINT_SHADOW_RES);
+                CreateShadowMap(_sphereShadowMaps[i], _sphereShadowCasters[i], _sphereLights.at_index(i));
         }
 
-        for(int i=0;i<MAX_RECT_SHADOW_COUNT;i++)
+        for(int i=0;i<static_cast<int>(_rectShadowMaps.size());i++)
         {
             if(_rectLights.indexValid(i))
-                CreateShadowMap(_rectShadowMaps[i], _rectLights.vector()[i], POINT_SHADOW_RES);
+                CreateShadowMap(_rectShadowMaps[i], _rectShadowCasters[i], _rectLights.at_index(i));
         }
 
         _renderContext->SetViewport(0, 0, _windowWidth, _windowHeight);
@@ -739,12 +2764,11 @@ namespace tao_pbr
         {
             .doEnvironment= _currentEnvironment.has_value(),
             .environmentIntensity = 0.25f,
-            .directionalLightsCnt = static_cast<int>(_directionalLights.vector().size()),
-            .sphereLightsCnt      = static_cast<int>(_sphereLights.vector().size()),
-            .rectLightsCnt        = static_cast<int>(_rectLights.vector().size())
+            .directionalLightsCnt = static_cast<int>(_directionalLights.slot_count()),
+            .sphereLightsCnt      = static_cast<int>(_sphereLights.slot_count()),
+            .rectLightsCnt        = static_cast<int>(_rectLights.slot_count())
         };
-        _lightsDataUbo.SetSubData(0, sizeof(lights_gl_data_block), &lightsGlDataBlock);
-        _lightsDataUbo.Bind(LIGHTPASS_UBO_BINDING_LIGHTS_DATA);
+        _frameRing.BindUniformRange(LIGHTPASS_UBO_BINDING_LIGHTS_DATA, _frameRing.Write(&lightsGlDataBlock, sizeof(lights_gl_data_block)));
 
         // loading view data
         camera_gl_data_block cameraGlDataBlock
@@ -752,10 +2776,15 @@ namespace tao_pbr
             .viewMatrix = viewMatrix,
             .projectionMatrix = projectionMatrix,
             .near = near,
-            .far = far
+            .far = far,
+            .inverseViewProjectionMatrix = inverse(projectionMatrix * viewMatrix)
         };
-        _shaderBuffers.cameraUbo.SetSubData(0, sizeof(camera_gl_data_block), &cameraGlDataBlock);
-        _shaderBuffers.cameraUbo.Bind(GPASS_UBO_BINDING_CAMERA);
+        _frameRing.BindUniformRange(GPASS_UBO_BINDING_CAMERA, _frameRing.Write(&cameraGlDataBlock, sizeof(camera_gl_data_block)));
+
+        /// Light Culling
+        ////////////////////////////////////////////
+        // Also for the tiled light pass: its crowded tiles fall back to the clusters
+        BuildLightClusters();
 
         /// Geometry Pass
         ////////////////////////////////////////////
@@ -770,26 +2799,8 @@ namespace tao_pbr
 
         _shaders.gPass.UseProgram();
 
-        for(int i=0;i<_meshRenderers.vector().size(); i++)
-        {
-            if(!_meshRenderers.indexValid(i)) continue;
-
-            auto meshKey = _meshRenderers.vector()[i]._mesh;
-            auto matKey = _meshRenderers.vector()[i]._material;
-            auto meshDataKey = _meshes.at(meshKey)._graphicsData;
-
-            if(!meshDataKey.has_value()) throw std::runtime_error("The mesh has no graphics data.");
-
-            auto& gfxData = _meshesGraphicsData.at(meshDataKey.value());
-            gfxData._glVao.Bind();
-
-            _shaderBuffers.transformUbo.OglBuffer().BindRange(GPASS_UBO_BINDING_TRANSFORM, i*_transformDataBlockAlignment, sizeof(transform_gl_data_block));
-            _shaderBuffers.materialUbo.OglBuffer().BindRange(GPASS_UBO_BINDING_MATERIAL, i*_materialDataBlockAlignment, sizeof(material_gl_data_block));
-
-            BindMaterialTextures(matKey);
-
-            _renderContext->DrawElements(pmt_type_triangles, gfxData._indicesCount, idx_typ_unsigned_int, nullptr);
-        }
+        DrawMeshRenderers(_cameraDrawList, true);
+        if(textureFeedback) EndTextureFeedback();
 
         OglFramebuffer<OglTexture2D>::UnBind(fbo_read_draw);
 
@@ -805,10 +2816,17 @@ namespace tao_pbr
 #endif
         _renderContext->SetDepthState(DEPTH_STATE_OFF);
 
-        _outBuffer.buff.Bind(fbo_read_draw);
-        _renderContext->ClearColor(0.1f, 0.1f, 0.1f, 0.0f);
+        // Either a compute shader over 16x16 tiles, writing straight
+        // to the output texture, or a full screen quad.
+        OglShaderProgram& lightPassShader = _tiledLightPass ? _computeShaders.lightPass : _shaders.lightPass;
+
+        if(!_tiledLightPass)
+        {
+            _outBuffer.buff.Bind(fbo_read_draw);
+            _renderContext->ClearColor(0.1f, 0.1f, 0.1f, 0.0f);
+        }
 
-        _shaders.lightPass.UseProgram();
+        lightPassShader.UseProgram();
 
         // Bind GBuffer and samplers
         _gBuffer.texColor0.BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_GBUFF0));
@@ -821,6 +2839,12 @@ namespace tao_pbr
         _pointSampler.BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_GBUFF2));
         _pointSampler.BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_GBUFF3));
 
+        if(_compactGBuffer)
+        {
+            _gBuffer.texDepth.BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_GBUFF_DEPTH));
+            _pointSampler    .BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_GBUFF_DEPTH));
+        }
+
         // Bind ambient IBL textures and samplers
         if(_currentEnvironment.has_value())
         {
@@ -828,11 +2852,10 @@ namespace tao_pbr
             EnvironmentTextureGraphicsData& currEnvData = _environmentTexturesGraphicsData.at(currEnvTex._graphicsData.value());
 
             _envBRDFLut                     .BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_ENV_BRDF_LUT));
-            currEnvData._irradianceCube     .BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_ENV_IRRADIANCE));
             currEnvData._prefilteredEnvCube .BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_ENV_PREFILTERED));
+            currEnvData._irradianceSh       .Bind(LIGHTPASS_BUFFER_BINDING_ENV_IRRADIANCE);
 
             _pointSampler           .BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_ENV_BRDF_LUT));
-            _pointSampler           .BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_ENV_IRRADIANCE));
             _linearMipLinearSampler .BindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_ENV_PREFILTERED));
         }
 
@@ -849,72 +2872,45 @@ namespace tao_pbr
         _shaderBuffers.directionalLightsSsbo.OglBuffer().Bind(LIGHTPASS_BUFFER_BINDING_DIR_LIGHTS);
         _shaderBuffers.sphereLightsSsbo.OglBuffer()     .Bind(LIGHTPASS_BUFFER_BINDING_SPHERE_LIGHTS);
         _shaderBuffers.rectLightsSsbo.OglBuffer()       .Bind(LIGHTPASS_BUFFER_BINDING_RECT_LIGHTS);
+        _shaderBuffers.lightClustersSsbo                .Bind(LIGHTPASS_BUFFER_BINDING_LIGHT_CLUSTERS);
+        _shaderBuffers.clusterLightIndicesSsbo          .Bind(LIGHTPASS_BUFFER_BINDING_CLUSTER_INDICES);
 
 
-        // Directional Shadow data
-        for(int i=0;i<MAX_SPHERE_SHADOW_COUNT; i++)
-        {
-            if(!_directionalLights.indexValid(i)) continue;
-
-            auto texUnit = static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_DIR_SHADOW_MAP + i);
+        // Shadow data, regions of the atlases
+        UploadShadowData();
+        lightPassShader.SetUniform(LIGHTPASS_NAME_DIR_SHADOW_CASCADES, _shadowCascadeSettings.cascadeCount);
 
-            _directionalShadowMaps[i].shadowMap.BindToTextureUnit(texUnit);
+        if(_shadowAtlas.directional)
+        {
+            auto texUnit = static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_DIR_SHADOW_ATLAS);
+            _shadowAtlas.directional->BindToTextureUnit(texUnit);
             _pointSampler.BindToTextureUnit(texUnit);
-
-            _shaders.lightPass.SetUniformMatrix4(GetUniformArrayName(LIGHTPASS_NAME_DIR_SHADOW_MATRIX, i).c_str(), glm::value_ptr(_directionalShadowMaps[i].shadowMatrix));
-            _shaders.lightPass.SetUniform(GetUniformArrayName(LIGHTPASS_NAME_DO_DIR_SHADOW , i).c_str(), true);
-            _shaders.lightPass.SetUniform(GetUniformArrayName(LIGHTPASS_NAME_DIR_SHADOW_POS, i).c_str(),
-                                                                                                        _directionalShadowMaps[i].lightPos.x,
-                                                                                                        _directionalShadowMaps[i].lightPos.y,
-                                                                                                        _directionalShadowMaps[i].lightPos.z);
-            _shaders.lightPass.SetUniform(GetUniformArrayName(LIGHTPASS_NAME_DIR_SHADOW_SIZE, i).c_str(),
-                                                                                                        _directionalShadowMaps[i].shadowSize.x,
-                                                                                                        _directionalShadowMaps[i].shadowSize.y,
-                                                                                                        _directionalShadowMaps[i].shadowSize.z,
-                                                                                                        _directionalShadowMaps[i].shadowSize.w);
         }
 
-        // Sphere Shadow data
-        for(int i=0;i<MAX_SPHERE_SHADOW_COUNT; i++)
+        if(_shadowAtlas.cubeColor)
         {
-            if(!_sphereLights.indexValid(i)) continue;
-
-            auto texUnit = static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_SPHERE_SHADOW_MAP + i);
-
-            _shaders.lightPass.SetUniform(GetUniformArrayName(LIGHTPASS_NAME_DO_SPHERE_SHADOW  , i).c_str(), true);
-            _shaders.lightPass.SetUniform(GetUniformArrayName(LIGHTPASS_NAME_SPHERE_SHADOW_RES , i).c_str(), POINT_SHADOW_RES, POINT_SHADOW_RES);
-            _shaders.lightPass.SetUniform(GetUniformArrayName(LIGHTPASS_NAME_SPHERE_SHADOW_SIZE, i).c_str(),
-                                                                                                            _sphereShadowMaps[i].shadowSize.x,
-                                                                                                            _sphereShadowMaps[i].shadowSize.z,
-                                                                                                            _sphereShadowMaps[i].shadowSize.y,
-                                                                                                            _sphereShadowMaps[i].shadowSize.w);
-
-            _sphereShadowMaps[i].shadowMapColor.BindToTextureUnit(texUnit);
+            auto texUnit = static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_CUBE_SHADOW_ATLAS);
+            _shadowAtlas.cubeColor->BindToTextureUnit(texUnit);
             _pointSampler.BindToTextureUnit(texUnit);
         }
 
-        // Rect Shadow data
-        for(int i=0;i<MAX_RECT_SHADOW_COUNT; i++)
+        if(_tiledLightPass)
         {
-            if(!_rectLights.indexValid(i)) continue;
-
-            auto texUnit = static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_RECT_SHADOW_MAP + i);
+            _outBuffer.texColor.BindToImageUnit(LIGHTPASS_IMAGE_BINDING_OUT, 0, image_access_write, image_format_rgba16f);
 
-            _shaders.lightPass.SetUniform(GetUniformArrayName(LIGHTPASS_NAME_DO_RECT_SHADOW    , i).c_str(), true);
-            _shaders.lightPass.SetUniform(GetUniformArrayName(LIGHTPASS_NAME_RECT_SHADOW_RADIUS, i).c_str(), glm::min(_rectLights.vector()[i].size.x, _rectLights.vector()[i].size.y) * 0.5f);
-            _shaders.lightPass.SetUniform(GetUniformArrayName(LIGHTPASS_NAME_RECT_SHADOW_RES   , i).c_str(), POINT_SHADOW_RES, POINT_SHADOW_RES);
-            _shaders.lightPass.SetUniform(GetUniformArrayName(LIGHTPASS_NAME_RECT_SHADOW_SIZE  , i).c_str(),
-                                          _rectShadowMaps[i].shadowSize.x,
-                                          _rectShadowMaps[i].shadowSize.z,
-                                          _rectShadowMaps[i].shadowSize.y,
-                                          _rectShadowMaps[i].shadowSize.w);
+            _renderContext->DispatchCompute(
+                    (_windowWidth  + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE,
+                    (_windowHeight + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE,
+                    1);
 
-            _rectShadowMaps[i].shadowMapColor.BindToTextureUnit(texUnit);
-            _pointSampler.BindToTextureUnit(texUnit);
+            _outBuffer.texColor.UnBindToImageUnit(LIGHTPASS_IMAGE_BINDING_OUT);
+            _renderContext->MemoryBarrier(static_cast<ogl_barrier_bit>(texture_fetch_barrier_bit | framebuffer_barrier_bit));
+        }
+        else
+        {
+            _fsQuad.vao.Bind();
+            _renderContext->DrawElements(pmt_type_triangles, 6, idx_typ_unsigned_int, nullptr);
         }
-
-        _fsQuad.vao.Bind();
-        _renderContext->DrawElements(pmt_type_triangles, 6, idx_typ_unsigned_int, nullptr);
 
         // reset Framebuffer and texture bindings
         OglFramebuffer<OglTexture2D>::UnBind(fbo_read_draw);
@@ -922,6 +2918,8 @@ namespace tao_pbr
         OglTexture2D::UnBindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_GBUFF1));
         OglTexture2D::UnBindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_GBUFF2));
         OglTexture2D::UnBindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_GBUFF3));
+        if(_compactGBuffer)
+            OglTexture2D::UnBindToTextureUnit(static_cast<ogl_texture_unit>(tex_unit_0 + LIGHTPASS_TEX_BINDING_GBUFF_DEPTH));
 
         if(_currentEnvironment.has_value())
         {
@@ -942,6 +2940,8 @@ namespace tao_pbr
         PerfCounters.LightPassTime = _gpuStopwatch.Stop<tao_instrument::Stopwatch::MILLISECONDS>(swl);
 #endif
 
+        _frameRing.EndFrame();
+
         return pbrRendererOut
         {
             ._colorTexture = &_outBuffer.texColor,
@@ -1017,7 +3017,7 @@ namespace tao_pbr
         EnvironmentTextureGraphicsData res
         {
             ._envCube{_renderContext->CreateTextureCube()},
-            ._irradianceCube{_renderContext->CreateTextureCube()},
+            ._irradianceSh{_renderContext->CreateShaderStorageBuffer()},
             ._prefilteredEnvCube{_renderContext->CreateTextureCube()}
         };
 
@@ -1025,7 +3025,6 @@ namespace tao_pbr
         for(ogl_texture_cube_target face = tex_tar_cube_map_positive_x; face <=tex_tar_cube_map_negative_z; face = static_cast<ogl_texture_cube_target>(face+1))
         {
             res._envCube             .TexImage(face, 0, tex_int_for_rgba16f, ENV_CUBE_RES, ENV_CUBE_RES, 0,  tex_for_rgba, tex_typ_float, nullptr);
-            res._irradianceCube      .TexImage(face, 0, tex_int_for_rgba16f, IRR_CUBE_RES, IRR_CUBE_RES, 0,  tex_for_rgba, tex_typ_float, nullptr);
             res._prefilteredEnvCube  .TexImage(face, 0, tex_int_for_rgba16f, PRE_CUBE_RES, PRE_CUBE_RES, 0,  tex_for_rgba, tex_typ_float, nullptr);
         }
 
@@ -1037,7 +3036,6 @@ namespace tao_pbr
         // detected the issue. Is this by OGL specs???
         // -------------------------------------------------------------------------------------------------
         res._envCube             .SetFilterParams(ogl_tex_filter_params{.min_filter = tex_min_filter_nearest, .mag_filter = tex_mag_filter_nearest});
-        res._irradianceCube      .SetFilterParams(ogl_tex_filter_params{.min_filter = tex_min_filter_nearest, .mag_filter = tex_mag_filter_nearest});
         res._prefilteredEnvCube  .SetFilterParams(ogl_tex_filter_params{.min_filter = tex_min_filter_linear_mip_linear, .mag_filter = tex_mag_filter_linear});
 
         _linearSampler.BindToTextureUnit(tex_unit_0);
@@ -1065,26 +3063,34 @@ namespace tao_pbr
 
         _renderContext->MemoryBarrier(static_cast<ogl_barrier_bit>(texture_fetch_barrier_bit | shader_image_access_barrier_bit));
 
-        // Generate IRRADIANCE cube map
+        // Project the IRRADIANCE on spherical harmonics
         // ------------------------------------------------------------------------------------------------------
-        /* tex unit 0 */ res._envCube         .BindToTextureUnit(tex_unit_0); // linear sampler should be bound!!!
-        /* img unit 0 */ res._irradianceCube  .BindToImageUnit(0, 0, true, 0, image_access_write, image_format_rgba16f);
+        // Each work group sums a tile of a face, a single
+        // one sums those (order 2 SH, 9 rgb coefficients).
+        const int shTile     = PROCESS_ENV_GROUP_SIZE_X * PROCESS_ENV_SH_TEXELS;
+        const int shPartials = ((ENV_CUBE_RES + shTile - 1) / shTile) * ((ENV_CUBE_RES + shTile - 1) / shTile) * 6;
 
-        _computeShaders.generateIrradianceCube.UseProgram();
-        _computeShaders.generateIrradianceCube.SetUniform(PROCESS_ENV_ENVCUBE_TEX_NAME  , 0);
-        _computeShaders.generateIrradianceCube.SetUniform(PROCESS_ENV_IRRCUBE_TEX_NAME, 0);
+        auto partials = _renderContext->CreateShaderStorageBuffer();
+        partials.SetData(static_cast<GLsizeiptr>(shPartials * 9 * sizeof(glm::vec4)), nullptr, buf_usg_dynamic_copy);
+        res._irradianceSh.SetData(static_cast<GLsizeiptr>(9 * sizeof(glm::vec4)), nullptr, buf_usg_static_draw);
 
-        ComputeShaderNumGroups(
-                IRR_CUBE_RES, IRR_CUBE_RES, 6/*cube map faces*/,
-                PROCESS_ENV_GROUP_SIZE_X, PROCESS_ENV_GROUP_SIZE_Y, PROCESS_ENV_GROUP_SIZE_Z,
-                grpCntX, grpCntY, grpCntZ
-        );
-        _renderContext->DispatchCompute(grpCntX, grpCntY, grpCntZ);
+        /* tex unit 0 */ res._envCube.BindToTextureUnit(tex_unit_0); // linear sampler should be bound!!!
+        partials        .Bind(PROCESS_ENV_BUFFER_BINDING_SH_PARTIALS);
+        res._irradianceSh.Bind(PROCESS_ENV_BUFFER_BINDING_SH);
 
-        res._envCube         .UnBindToTextureUnit(tex_unit_0);
-        res._irradianceCube  .UnBindToImageUnit(0);
+        _computeShaders.projectIrradianceSh.UseProgram();
+        _computeShaders.projectIrradianceSh.SetUniform(PROCESS_ENV_ENVCUBE_TEX_NAME, 0);
+        _renderContext->DispatchCompute((ENV_CUBE_RES + shTile - 1) / shTile, (ENV_CUBE_RES + shTile - 1) / shTile, 6/*cube map faces*/);
 
-        _renderContext->MemoryBarrier(static_cast<ogl_barrier_bit>(texture_fetch_barrier_bit | shader_image_access_barrier_bit));
+        _renderContext->MemoryBarrier(shader_storage_barrier_bit);
+
+        _computeShaders.reduceIrradianceSh.UseProgram();
+        _computeShaders.reduceIrradianceSh.SetUniform(PROCESS_ENV_SH_PARTIALS_NAME, shPartials);
+        _renderContext->DispatchCompute(1, 1, 1);
+
+        res._envCube.UnBindToTextureUnit(tex_unit_0);
+
+        _renderContext->MemoryBarrier(static_cast<ogl_barrier_bit>(shader_storage_barrier_bit | buffer_update_barrier_bit));
 
         // Generate PREFILTERED ENVIRONMENT cube map
         // ------------------------------------------------------------------------------------------------------
@@ -1117,74 +3123,172 @@ namespace tao_pbr
         return res;
     }
 
-    void PbrRenderer::CreateShadowMap(DirectionalShadowMap &shadowMapData, const tao_pbr::DirectionalLight &l, int shadowMapWidth, int shadowMapHeight)
+    void PbrRenderer::UpdateShadowMatrices(DirectionalShadowMap &shadowMapData, const tao_pbr::DirectionalLight &l,
+                                           const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, float near, float far)
     {
-        // Compute scene Bbox
-        int mrCnt = _meshRenderers.vector().size();
-        vector<vec3> pts{}; pts.reserve(mrCnt*2);
-        for(int i=0;i<mrCnt; i++)
+        // Scene Bbox is the bvh's root
+        auto sceneAABB = _bvh.Bounds();
+
+        const int   cascadeCount = _shadowCascadeSettings.cascadeCount;
+        const float lambda       = _shadowCascadeSettings.splitLambda;
+        const float maxDistance  = _shadowCascadeSettings.maxDistance > 0.0f ? glm::min(far, _shadowCascadeSettings.maxDistance) : far;
+
+        // The light's view doesn't depend on the camera, only
+        // the (snapped) ortho bounds move with it.
+        vec3  viewDir    = vec3{l.transformation.matrix()[2]};
+        mat4  lightView  = lookAt(vec3{0.0f}, viewDir, vec3{l.transformation.matrix()[1]});
+        mat4  lightViewInv = inverse(lightView);
+
+        // Depth range: the whole scene, casters outside
+        // of the cascade still cast their shadow in it.
+        float zMin = std::numeric_limits<float>::max();
+        float zMax = std::numeric_limits<float>::lowest();
+        for(int k=0;k<8;k++)
         {
-            if(!_meshRenderers.indexValid(i)) continue;
+            vec3 corner{ k&1 ? sceneAABB.Max.x : sceneAABB.Min.x,
+                         k&2 ? sceneAABB.Max.y : sceneAABB.Min.y,
+                         k&4 ? sceneAABB.Max.z : sceneAABB.Min.z};
+            float z = (lightView*vec4{corner, 1.0f}).z;
+            zMin = glm::min(zMin, z);
+            zMax = glm::max(zMax, z);
+        }
+        const float viewNear = -zMax - 1e-3f;
+        const float viewFar  = -zMin + 1e-3f;
 
-            pts.push_back(_meshRenderers.vector()[i]._aabb.Min);
-            pts.push_back(_meshRenderers.vector()[i]._aabb.Max);
+        // Camera frustum corners (world space), near plane first
+        const mat4 cameraInv = inverse(projectionMatrix*viewMatrix);
+        vec3 corners[8];
+        for(int k=0;k<8;k++)
+        {
+            vec4 c = cameraInv*vec4{k&1 ? 1.0f : -1.0f, k&2 ? 1.0f : -1.0f, k&4 ? 1.0f : -1.0f, 1.0f};
+            corners[k] = vec3{c}/c.w;
         }
 
-        auto sceneAABB = BoundingBox<float, 3>::ComputeBbox(pts);
+        float splitNear = near;
+        for(int c=0;c<cascadeCount;c++)
+        {
+            ShadowCascade& cascade = shadowMapData.cascades[c];
+
+            // Practical split scheme: blend of the uniform
+            // and the logarithmic splits.
+            const float p        = static_cast<float>(c+1)/static_cast<float>(cascadeCount);
+            const float splitLog = near*glm::pow(maxDistance/near, p);
+            const float splitUni = near + (maxDistance-near)*p;
+            const float splitFar = glm::mix(splitUni, splitLog, lambda);
+
+            // Slice of the frustum, enclosed in a sphere: its size doesn't
+            // change when the camera rotates, no shimmering.
+            vec3 sliceCorners[8];
+            vec3 sliceCenter{0.0f};
+            const float tNear = (splitNear-near)/(far-near);
+            const float tFar  = (splitFar -near)/(far-near);
+            for(int k=0;k<4;k++)
+            {
+                sliceCorners[k  ] = mix(corners[k], corners[k+4], tNear);
+                sliceCorners[k+4] = mix(corners[k], corners[k+4], tFar);
+            }
+            for(const auto& sc : sliceCorners) sliceCenter += sc/8.0f;
 
-        // Use the enclosing sphere to determine the camera position
-        vec3  sceneCenter = sceneAABB.Center();
-        float sceneRadius = sceneAABB.Diagonal()*0.5;
+            float radius = 0.0f;
+            for(const auto& sc : sliceCorners) radius = glm::max(radius, length(sc-sliceCenter));
+            radius = glm::ceil(radius*16.0f)/16.0f;
 
-        vec3  viewDir    = vec3{l.transformation.matrix()[2]};
-        vec3  viewPos    = sceneCenter-viewDir*sceneRadius;
-        float viewNear   = 1e-3; // mh...
-        float viewFar    = sceneRadius*2.0;
-        mat4  viewMatrix = lookAt(viewPos, sceneCenter,vec3{l.transformation.matrix()[1]});
-        mat4  projMatrix = ortho(-sceneRadius, sceneRadius, -sceneRadius, sceneRadius, viewNear, viewFar);
+            // Snap the center to the shadow map texels
+            const int   resolution = cascade.tile.res>0 ? cascade.tile.res : _shadowAtlasSettings.maxDirectionalRes;
+            const float texelSize  = 2.0f*radius/static_cast<float>(resolution);
+            vec3 centerLS = vec3{lightView*vec4{sliceCenter, 1.0f}};
+            centerLS.x = glm::floor(centerLS.x/texelSize)*texelSize;
+            centerLS.y = glm::floor(centerLS.y/texelSize)*texelSize;
 
-        shadowMapData.shadowMatrix = projMatrix*viewMatrix;
-        shadowMapData.shadowSize   = glm::vec4(sceneRadius * 2.0f, sceneRadius * 2.0f, viewNear, viewFar);
-        shadowMapData.lightPos     = viewPos;
+            mat4 projMatrix = ortho(centerLS.x-radius, centerLS.x+radius, centerLS.y-radius, centerLS.y+radius, viewNear, viewFar);
+
+            // e.g. the camera or the scene bounds changed
+            if(projMatrix*lightView != cascade.shadowMatrix)
+                cascade.dirty = true;
+
+            cascade.shadowMatrix = projMatrix*lightView;
+            cascade.viewMatrix   = lightView;
+            cascade.projMatrix   = projMatrix;
+            cascade.shadowSize   = glm::vec4(radius * 2.0f, radius * 2.0f, viewNear, viewFar);
+            cascade.lightPos     = vec3{lightViewInv*vec4{centerLS.x, centerLS.y, -viewNear, 1.0f}};
+            cascade.splitFar     = splitFar;
+
+            splitNear = splitFar;
+        }
+    }
+
+    void PbrRenderer::CreateShadowMap(DirectionalShadowMap &shadowMapData, int cascade, const ShadowCasterLists& casters)
+    {
+        ShadowCascade&         cascadeData = shadowMapData.cascades[cascade];
+        const ShadowAtlasTile& tile        = cascadeData.tile;
+
+        // No room in the atlas
+        if(tile.res==0) return;
+
+        // Nothing changed since the last time
+        if(!cascadeData.dirty && !cascadeData.dynamicDirty) return;
+
+        // The static depth is needed from the cache
+        if(!_shadowAtlas.directionalStatic) cascadeData.dirty = true;
+
+        PerfCounters.ShadowMapUpdates++;
 
         // set view data
         camera_gl_data_block cameraGlDataBlock
         {
-            .viewMatrix         = viewMatrix,
-            .projectionMatrix   = projMatrix,
-            .near               = viewNear,
-            .far                = viewFar
+            .viewMatrix         = cascadeData.viewMatrix,
+            .projectionMatrix   = cascadeData.projMatrix,
+            .near               = cascadeData.shadowSize.z,
+            .far                = cascadeData.shadowSize.w
         };
-        _shaderBuffers.cameraUbo.SetSubData(0, sizeof(camera_gl_data_block), &cameraGlDataBlock);
-        _shaderBuffers.cameraUbo.Bind(GPASS_UBO_BINDING_CAMERA);
+        _frameRing.BindUniformRange(GPASS_UBO_BINDING_CAMERA, _frameRing.Write(&cameraGlDataBlock, sizeof(camera_gl_data_block)));
 
-        _renderContext->SetViewport(0, 0, shadowMapWidth, shadowMapHeight);
+        _renderContext->SetViewport(tile.x, tile.y, tile.res, tile.res);
 
-        shadowMapData.shadowFbo.Bind(fbo_read_draw);
+        _shadowAtlas.directionalFbo.Bind(fbo_read_draw);
 
         _renderContext->SetDepthState(DEFAULT_DEPTH_STATE);
         _renderContext->SetRasterizerState(RASTERIZER_STATE_SHADOW_MAP);
 
-        _renderContext->ClearDepth(1.0f);
-
         _shaders.gPass.UseProgram(); // using the gPass shader for now....
-        for(int i=0;i<_meshRenderers.vector().size(); i++)
-        {
-            if(!_meshRenderers.indexValid(i)) continue;
 
-            auto meshKey = _meshRenderers.vector()[i]._mesh;
-            auto meshDataKey = _meshes.at(meshKey)._graphicsData;
-
-            if(!meshDataKey.has_value()) throw std::runtime_error("The mesh has no graphics data.");
+        OglTexture2D& atlas = _shadowAtlas.directional.value();
 
-            auto& gfxData = _meshesGraphicsData.at(meshDataKey.value());
-            gfxData._glVao.Bind();
+        if(cascadeData.dirty)
+        {
+            // Only the cascade's region, the atlas is shared
+            constexpr float clearDepth = 1.0f;
+            atlas.ClearSubImage(0, tile.x, tile.y, tile.res, tile.res, tex_for_depth, tex_typ_float, &clearDepth);
+            DrawMeshRenderers(casters.staticCasters, false);
 
-            _shaderBuffers.transformUbo.OglBuffer().BindRange(GPASS_UBO_BINDING_TRANSFORM, i*_transformDataBlockAlignment, sizeof(transform_gl_data_block));
-            _renderContext->DrawElements(pmt_type_triangles, gfxData._indicesCount, idx_typ_unsigned_int, nullptr);
+            // Keep the static casters' depth for later
+            if(_shadowCasterSplit)
+            {
+                if(!_shadowAtlas.directionalStatic)
+                {
+                    const int size = _shadowAtlasSettings.directionalAtlasSize;
+                    _shadowAtlas.directionalStatic.emplace(_renderContext->CreateTexture2D());
+                    _shadowAtlas.directionalStatic->TexImage(0, tex_int_for_depth_32f, size, size, tex_for_depth, tex_typ_float, nullptr);
+                    _shadowAtlas.directionalStatic->SetFilterParams(ogl_tex_filter_params
+                    {
+                        .min_filter = tex_min_filter_nearest,
+                        .mag_filter = tex_mag_filter_nearest
+                    });
+                }
+                _shadowAtlas.directionalStatic->CopySubData(atlas, 0, tile.x, tile.y, tile.x, tile.y, tile.res, tile.res);
+            }
+        }
+        else
+        {
+            atlas.CopySubData(_shadowAtlas.directionalStatic.value(), 0, tile.x, tile.y, tile.x, tile.y, tile.res, tile.res);
         }
 
-        shadowMapData.shadowFbo.UnBind(fbo_read_draw);
+        DrawMeshRenderers(casters.dynamicCasters, false);
+
+        _shadowAtlas.directionalFbo.UnBind(fbo_read_draw);
+
+        cascadeData.dirty        = false;
+        cascadeData.dynamicDirty = false;
     }
 
     float ComputeSphereLightRadius(const vec3& intensity, float tolerance=0.0002)
@@ -1206,11 +3310,26 @@ namespace tao_pbr
         return glm::sqrt(glm::max(glm::max(intensity.r, intensity.g), intensity.b) / (4.0*pi<float>()*tolerance));
     }
 
-    void PbrRenderer::CreateShadowMap(SphereShadowMap &shadowMapData, const vec3& position, const vec3& direction, const vec3& intensity, float radius, int shadowMapResolution)
+    float PbrRenderer::CubeShadowRadius(const tao_pbr::SphereLight &l)
+    {
+        return l.radius;
+    }
+
+    float PbrRenderer::CubeShadowRadius(const tao_pbr::RectLight &l)
+    {
+        // TODO: currently we limit the shadow frustum for sphere lights with a formula that shouldn't work for rect lights
+        // TODO: add ComputeRectLightRadius method
+        return glm::min(l.size.x, l.size.y) * 0.5f;
+    }
+
+    vec2 PbrRenderer::CubeShadowRange(const vec3& intensity, float radius)
     {
         float rMin = glm::max(1e-3f, radius);
-        float rMax = rMin + ComputeSphereLightRadius(intensity);
-        vec3 viewPos = position;
+        return vec2{rMin, rMin + ComputeSphereLightRadius(intensity)};
+    }
+
+    void PbrRenderer::CubeShadowMatrices(const vec3& position, const vec2& range, mat4 (&matrices)[6])
+    {
         vec3 viewDirections[6] =
         {
             vec3{1.0, 0.0, 0.0},
@@ -1221,37 +3340,57 @@ namespace tao_pbr
             vec3{0.0, 0.0, -1.0}
         };
 
-        mat4 projMatrix = perspective(0.5f * pi<float>(), 1.0f, rMin, rMax);
-
+        mat4 projMatrix = perspective(0.5f * pi<float>(), 1.0f, range.x, range.y);
 
         // see: https://registry.khronos.org/OpenGL/specs/gl/glspec33.core.pdf
         // page 169
         // big LOL......
-        mat4 shadowMatrices[6] =
-        {
-            projMatrix * lookAt(viewPos, viewPos + viewDirections[0], vec3(0.0, -1.0, 0.0)),
-            projMatrix * lookAt(viewPos, viewPos + viewDirections[1], vec3(0.0, -1.0, 0.0)),
-            projMatrix * lookAt(viewPos, viewPos + viewDirections[2], vec3(0.0, 0.0, 1.0)),
-            projMatrix * lookAt(viewPos, viewPos + viewDirections[3], vec3(0.0, 0.0, -1.0)),
-            projMatrix * lookAt(viewPos, viewPos + viewDirections[4], vec3(0.0, -1.0, 0.0)),
-            projMatrix * lookAt(viewPos, viewPos + viewDirections[5], vec3(0.0, -1.0, 0.0)),
-        };
+        matrices[0] = projMatrix * lookAt(position, position + viewDirections[0], vec3(0.0, -1.0, 0.0));
+        matrices[1] = projMatrix * lookAt(position, position + viewDirections[1], vec3(0.0, -1.0, 0.0));
+        matrices[2] = projMatrix * lookAt(position, position + viewDirections[2], vec3(0.0, 0.0, 1.0));
+        matrices[3] = projMatrix * lookAt(position, position + viewDirections[3], vec3(0.0, 0.0, -1.0));
+        matrices[4] = projMatrix * lookAt(position, position + viewDirections[4], vec3(0.0, -1.0, 0.0));
+        matrices[5] = projMatrix * lookAt(position, position + viewDirections[5], vec3(0.0, -1.0, 0.0));
+    }
+
+    void PbrRenderer::CreateShadowMap(SphereShadowMap &shadowMapData, const ShadowCasterLists& casters, const vec3& position, const vec3& direction, const vec3& intensity, float radius)
+    {
+        const ShadowAtlasTile& tile = shadowMapData.tile;
+
+        // No room in the atlas
+        if(tile.res==0) return;
+
+        // Nothing changed since the last time
+        if(!shadowMapData.dirty && !shadowMapData.dynamicDirty) return;
+
+        // The static depth is needed from the cache
+        if(!_shadowAtlas.cubeColorStatic) shadowMapData.dirty = true;
+
+        PerfCounters.ShadowMapUpdates++;
+
+        const vec2 range = CubeShadowRange(intensity, radius);
+        float rMin = range.x;
+        float rMax = range.y;
+        vec3 viewPos = position;
+
+        mat4 shadowMatrices[6];
+        CubeShadowMatrices(viewPos, range, shadowMatrices);
 
         shadowMapData.shadowCenter = viewPos;
         shadowMapData.shadowSize = vec4{ rMin*2.0f, rMin*2.0f  ,rMin, rMax}; // size x, size y, z min, zmax
 
-        _renderContext->SetViewport(0, 0, shadowMapResolution, shadowMapResolution);
+        // Same region of the 6 faces of the page
+        _renderContext->SetViewport(tile.x, tile.y, tile.res, tile.res);
 
-        shadowMapData.shadowFbo.Bind(fbo_read_draw);
+        _shadowAtlas.cubeFbo.Bind(fbo_read_draw);
 
         _renderContext->SetBlendState(DEFAULT_BLEND_STATE);
         _renderContext->SetDepthState(DEFAULT_DEPTH_STATE);
-        _renderContext->ClearDepth(1.0f);
-        _renderContext->ClearColor(rMax, 0.0, 0.0, 0.0);
 
-        // Setting uniforms (6 transform matrices, light position)
+        // Setting uniforms (6 transform matrices, light position, page)
         _shaders.pointShadowMap.UseProgram();
         _shaders.pointShadowMap.SetUniform(POINT_SHADOWS_NAME_LIGHT_POS, viewPos.x, viewPos.y, viewPos.z);
+        _shaders.pointShadowMap.SetUniform(POINT_SHADOWS_NAME_CUBE_LAYER, tile.page);
         for(int i=0;i<6;i++)
         {
             string name = string{POINT_SHADOWS_NAME_VIEWPROJ}
@@ -1260,37 +3399,56 @@ namespace tao_pbr
             _shaders.pointShadowMap.SetUniformMatrix4(name.c_str(), value_ptr(shadowMatrices[i]));
         }
 
-        for (int i = 0; i < _meshRenderers.vector().size(); i++)
-        {
-            if (!_meshRenderers.indexValid(i)) continue;
+        _shaderBuffers.cubeInstanceSsbo.OglBuffer().Bind(SHADOW_SSBO_BINDING_CUBE_INSTANCES);
 
-            auto meshKey = _meshRenderers.vector()[i]._mesh;
-            auto meshDataKey = _meshes.at(meshKey)._graphicsData;
+        OglTextureCubeArray& color = _shadowAtlas.cubeColor.value();
+        OglTextureCubeArray& depth = _shadowAtlas.cubeDepth.value();
 
-            if (!meshDataKey.has_value()) throw std::runtime_error("The mesh has no graphics data.");
+        if(shadowMapData.dirty)
+        {
+            // Only the light's region, the page is shared
+            constexpr float clearDepth = 1.0f;
+            color.ClearSubImage(0, tile.page, tile.x, tile.y, tile.res, tile.res, 1, tex_for_red  , tex_typ_float, &rMax);
+            depth.ClearSubImage(0, tile.page, tile.x, tile.y, tile.res, tile.res, 1, tex_for_depth, tex_typ_float, &clearDepth);
+            DrawMeshRenderers(casters.staticCasters, false);
+
+            // Keep the static casters' distance and depth for later
+            if(_shadowCasterSplit)
+            {
+                if(!_shadowAtlas.cubeColorStatic)
+                {
+                    const int size = _shadowAtlasSettings.cubePageSize;
+                    _shadowAtlas.cubeColorStatic.emplace(_renderContext->CreateTextureCubeArray());
+                    _shadowAtlas.cubeDepthStatic.emplace(_renderContext->CreateTextureCubeArray());
+                    _shadowAtlas.cubeColorStatic->TexStorage(1, tex_int_for_r16f, size, _shadowAtlas.cubePages);
+                    _shadowAtlas.cubeDepthStatic->TexStorage(1, tex_int_for_depth_32f, size, _shadowAtlas.cubePages);
+                }
+                _shadowAtlas.cubeColorStatic->CopySubData(color, 0, tile.page, tile.page, tile.x, tile.y, tile.res, tile.res, 1);
+                _shadowAtlas.cubeDepthStatic->CopySubData(depth, 0, tile.page, tile.page, tile.x, tile.y, tile.res, tile.res, 1);
+            }
+        }
+        else
+        {
+            color.CopySubData(_shadowAtlas.cubeColorStatic.value(), 0, tile.page, tile.page, tile.x, tile.y, tile.res, tile.res, 1);
+            depth.CopySubData(_shadowAtlas.cubeDepthStatic.value(), 0, tile.page, tile.page, tile.x, tile.y, tile.res, tile.res, 1);
+        }
 
-            auto &gfxData = _meshesGraphicsData.at(meshDataKey.value());
-            gfxData._glVao.Bind();
+        DrawMeshRenderers(casters.dynamicCasters, false);
 
-            _shaderBuffers.transformUbo.OglBuffer().BindRange(GPASS_UBO_BINDING_TRANSFORM,
-                                                              i * _transformDataBlockAlignment,
-                                                              sizeof(transform_gl_data_block));
-            _renderContext->DrawElements(pmt_type_triangles, gfxData._indicesCount, idx_typ_unsigned_int, nullptr);
-        }
+        _shadowAtlas.cubeFbo.UnBind(fbo_read_draw);
 
-        shadowMapData.shadowFbo.UnBind(fbo_read_draw);
+        shadowMapData.dirty        = false;
+        shadowMapData.dynamicDirty = false;
     }
 
-    void PbrRenderer::CreateShadowMap(SphereShadowMap &shadowMapData, const tao_pbr::SphereLight &l, int shadowMapResolution)
+    void PbrRenderer::CreateShadowMap(SphereShadowMap &shadowMapData, const ShadowCasterLists& casters, const tao_pbr::SphereLight &l)
     {
-        CreateShadowMap(shadowMapData, vec3{l.transformation.matrix()[3]}, vec3{l.transformation.matrix()[2]}, l.intensity, l.radius, shadowMapResolution);
+        CreateShadowMap(shadowMapData, casters, vec3{l.transformation.matrix()[3]}, vec3{l.transformation.matrix()[2]}, l.intensity, CubeShadowRadius(l));
     }
 
-    void PbrRenderer::CreateShadowMap(SphereShadowMap &shadowMapData, const tao_pbr::RectLight &l, int shadowMapResolution)
+    void PbrRenderer::CreateShadowMap(SphereShadowMap &shadowMapData, const ShadowCasterLists& casters, const tao_pbr::RectLight &l)
     {
-        // TODO: currently we limit the shadow frustum for sphere lights with a formula that shouldn't work for rect lights
-        // TODO: add ComputeRectLightRadius method
-        CreateShadowMap(shadowMapData, vec3{l.transformation.matrix()[3]}, vec3{l.transformation.matrix()[2]}, l.intensity, glm::min(l.size.x, l.size.y) * 0.5, shadowMapResolution);
+        CreateShadowMap(shadowMapData, casters, vec3{l.transformation.matrix()[3]}, vec3{l.transformation.matrix()[2]}, l.intensity, CubeShadowRadius(l));
     }
 
 }
\ No newline at end of file